@@ -1,15 +1,21 @@
 use std::{
+    cell::Cell,
     collections::BTreeMap,
     io::Write,
-    sync::Arc,
+    net::SocketAddr,
+    sync::{
+        Arc,
+        atomic::{AtomicU64, Ordering},
+    },
     time::{Duration, Instant},
 };
 
 use axum::{
     Router,
     body::Body,
-    http::{Request, StatusCode},
+    http::{Request, StatusCode, header::CONTENT_TYPE},
 };
+use futures_util::{StreamExt, stream::FuturesUnordered};
 use hyper::{body::Incoming, service::service_fn};
 use hyper_util::{
     rt::{TokioExecutor, TokioIo},
@@ -17,8 +23,8 @@ use hyper_util::{
 };
 use tokio::{
     io::{AsyncRead, AsyncReadExt, AsyncWrite, AsyncWriteExt},
-    net::{TcpListener, TcpStream},
-    sync::{Semaphore, watch},
+    net::{TcpListener, TcpSocket, TcpStream},
+    sync::{Semaphore, oneshot, watch},
 };
 use tokio_rustls::TlsAcceptor;
 use tower::ServiceExt;
@@ -27,15 +33,18 @@ use tracing::{Instrument, debug, info, warn};
 use crate::{
     analytics::Analytics,
     artifact::producer::ArtifactProducer,
-    auth::{AccessDecision, RequestContext},
+    auth::{AccessDecision, ConnectionAuth, RequestContext},
     config::{AcceleratedFileServingConfig, AcceleratedFileServingMode},
     constants::response_stream_chunk_bytes,
+    fair_admission,
     memory::{MemoryController, ResponseStreamAdmissionPatience},
     runtime::HttpTrafficClass,
+    shards::CachePadded,
+    stage_timing::{self, Stage, StageTimings},
     state::SharedState,
     store::AcceleratedArtifactFile,
     usage::Usage,
-    utils::{blob_key, module_key},
+    utils::{SplicedRequestBody, blob_key, module_key},
 };
 
 const MAX_HEADER_BYTES: usize = 16 * 1024;
@@ -53,6 +62,10 @@ const CONNECTION_MAX_AGE_GRACE: Duration = Duration::from_secs(900);
 const IO_TIMEOUT: Duration = Duration::from_secs(120);
 const KEEP_ALIVE_IDLE_TIMEOUT: Duration = Duration::from_secs(60);
 const TLS_HANDSHAKE_TIMEOUT: Duration = Duration::from_secs(10);
+const PER_CORE_LISTEN_BACKLOG: u32 = 1024;
+// Upload responses are a status line and at most a short error message.
+const MAX_UPLOAD_RESPONSE_BYTES: usize = 64 * 1024;
+const CORE_IMBALANCE_INTERVAL: Duration = Duration::from_secs(10);
 const NX_NAMESPACE_ID: &str = "nx";
 const METRO_NAMESPACE_ID: &str = "metro";
 const TENANT_SCOPE_NAMESPACE_ID: &str = "";
@@ -69,7 +82,7 @@ pub async fn serve_public_http(
     router: Router,
     state: SharedState,
     config: AcceleratedFileServingConfig,
-    mut shutdown_rx: watch::Receiver<bool>,
+    shutdown_rx: watch::Receiver<bool>,
     configure_http2: Http2BuilderConfig,
 ) -> Result<(), String> {
     let semaphore = Arc::new(Semaphore::new(config.max_concurrent));
@@ -86,6 +99,291 @@ pub async fn serve_public_http(
     } else {
         info!("Kura public HTTP listener on {address} (accelerated artifact serving disabled)");
     }
+    accept_loop(
+        listener,
+        router,
+        state,
+        config,
+        semaphore,
+        shutdown_rx,
+        configure_http2,
+        None,
+    )
+    .await
+}
+
+/// Runs the public plaintext port with one listener per core: each core gets
+/// its own `SO_REUSEPORT` socket on `address`, accepted by a current-thread
+/// runtime on a thread pinned to that core, with its own slice of the
+/// accelerator's concurrency limit. The kernel spreads new connections over
+/// the listeners by flow hash, and `SO_INCOMING_CPU` steers each one to the
+/// listener of the core that took its packets, so the accept, the request
+/// and the transfer of a connection all stay on one core. The runtimes'
+/// blocking pools are pinned too, so the sendfile/splice stays put as well.
+///
+/// Returns once every core has stopped accepting. The runtimes keep running
+/// their open connections until the process exits, like the shared pool does
+/// for the single listener. A core that stops before shutdown (its listener
+/// could not be registered) fails the whole port at once rather than leave
+/// its share of connections unserved until drain.
+pub async fn serve_public_http_per_core(
+    address: SocketAddr,
+    router: Router,
+    state: SharedState,
+    config: AcceleratedFileServingConfig,
+    shutdown_rx: watch::Receiver<bool>,
+    configure_http2: Http2BuilderConfig,
+) -> Result<(), String> {
+    let cpus = pinnable_cpus();
+    let mut listeners = Vec::with_capacity(cpus.len());
+    let mut address = address;
+    for &cpu in &cpus {
+        let listener = bind_reuseport_listener(address, cpu)?;
+        // With an ephemeral port the first bind picks it; the rest join it.
+        address = listener
+            .local_addr()
+            .map_err(|error| format!("failed to read public HTTP listener address: {error}"))?;
+        listeners.push(listener);
+    }
+    let per_core_concurrent = config.max_concurrent.div_ceil(cpus.len()).max(1);
+    info!(
+        cores = cpus.len(),
+        mode = config.mode.as_str(),
+        per_core_concurrent,
+        chunk_bytes = config.chunk_bytes,
+        "Kura public HTTP listener using per-core accelerated artifact serving on {address}"
+    );
+    let accepted: Arc<[CachePadded<AtomicU64>]> =
+        cpus.iter().map(|_| CachePadded::default()).collect();
+    let mut stopped = FuturesUnordered::new();
+    for (core, (cpu, listener)) in cpus.into_iter().zip(listeners).enumerate() {
+        let (stopped_tx, stopped_rx) = oneshot::channel();
+        stopped.push(stopped_rx);
+        let router = router.clone();
+        let state = state.clone();
+        let config = config.clone();
+        let shutdown_rx = shutdown_rx.clone();
+        let core_slot = CoreSlot {
+            index: core,
+            accepted: accepted.clone(),
+        };
+        let runtime = tokio::runtime::Builder::new_current_thread()
+            .enable_all()
+            .on_thread_start(move || pin_current_thread(cpu))
+            .build()
+            .map_err(|error| format!("failed to build runtime for core {core}: {error}"))?;
+        std::thread::Builder::new()
+            .name(format!("kura-http-core-{core}"))
+            .spawn(move || {
+                pin_current_thread(cpu);
+                CURRENT_CORE.with(|current| current.set(Some(core)));
+                runtime.block_on(async move {
+                    let result = match TcpListener::from_std(listener) {
+                        Ok(listener) => {
+                            accept_loop(
+                                listener,
+                                router,
+                                state,
+                                config,
+                                Arc::new(Semaphore::new(per_core_concurrent)),
+                                shutdown_rx,
+                                configure_http2,
+                                Some(core_slot),
+                            )
+                            .await
+                        }
+                        Err(error) => Err(format!(
+                            "failed to register listener for core {core}: {error}"
+                        )),
+                    };
+                    let _ = stopped_tx.send(result);
+                    // Keep serving the connections already accepted; they
+                    // close themselves on drain.
+                    std::future::pending::<()>().await;
+                });
+            })
+            .map_err(|error| format!("failed to spawn listener thread for core {core}: {error}"))?;
+    }
+
+    let mut imbalance_tick = tokio::time::interval(CORE_IMBALANCE_INTERVAL);
+    imbalance_tick.set_missed_tick_behavior(tokio::time::MissedTickBehavior::Delay);
+    let mut last_accepted = vec![0_u64; accepted.len()];
+    let mut shutdown = shutdown_rx.clone();
+    loop {
+        tokio::select! {
+            Some(result) = stopped.next() => {
+                result.map_err(|_| "per-core listener thread exited".to_owned())??;
+            }
+            _ = imbalance_tick.tick() => {
+                let deltas = accepted
+                    .iter()
+                    .zip(last_accepted.iter_mut())
+                    .map(|(count, last)| {
+                        let count = count.0.load(Ordering::Relaxed);
+                        let delta = count - *last;
+                        *last = count;
+                        delta
+                    })
+                    .collect::<Vec<_>>();
+                if let Some(imbalance) = core_imbalance(&deltas) {
+                    state.metrics.observe_accelerated_core_imbalance(imbalance);
+                }
+            }
+            changed = shutdown.changed() => {
+                if changed.is_err() || *shutdown.borrow() {
+                    break;
+                }
+            }
+        }
+    }
+    while let Some(result) = stopped.next().await {
+        result.map_err(|_| "per-core listener thread exited".to_owned())??;
+    }
+    Ok(())
+}
+
+/// The CPUs this process may run on, one listener each, capped at the
+/// parallelism the cgroup quota allows.
+#[cfg(not(target_os = "linux"))]
+fn pinnable_cpus() -> Vec<usize> {
+    let limit = std::thread::available_parallelism()
+        .map(|count| count.get())
+        .unwrap_or(1);
+    (0..limit).collect()
+}
+
+#[cfg(target_os = "linux")]
+fn pinnable_cpus() -> Vec<usize> {
+    let limit = std::thread::available_parallelism()
+        .map(|count| count.get())
+        .unwrap_or(1);
+    // SAFETY: `set` is a plain bitmask the kernel fills in.
+    let mut set = unsafe { std::mem::zeroed::<libc::cpu_set_t>() };
+    let read =
+        unsafe { libc::sched_getaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &mut set) };
+    if read != 0 {
+        return (0..limit).collect();
+    }
+    (0..libc::CPU_SETSIZE as usize)
+        .filter(|&cpu| unsafe { libc::CPU_ISSET(cpu, &set) })
+        .take(limit)
+        .collect()
+}
+
+#[cfg(not(target_os = "linux"))]
+fn pin_current_thread(_cpu: usize) {}
+
+#[cfg(target_os = "linux")]
+fn pin_current_thread(cpu: usize) {
+    // SAFETY: a zeroed bitmask with one CPU set. A failed pin leaves the
+    // thread floating, which only costs locality.
+    let mut set = unsafe { std::mem::zeroed::<libc::cpu_set_t>() };
+    unsafe { libc::CPU_SET(cpu, &mut set) };
+    let pinned =
+        unsafe { libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &set) };
+    if pinned != 0 {
+        debug!(
+            cpu,
+            "failed to pin thread: {}",
+            std::io::Error::last_os_error()
+        );
+    }
+}
+
+fn bind_reuseport_listener(
+    address: SocketAddr,
+    cpu: usize,
+) -> Result<std::net::TcpListener, String> {
+    let socket = if address.is_ipv4() {
+        TcpSocket::new_v4()
+    } else {
+        TcpSocket::new_v6()
+    }
+    .map_err(|error| format!("failed to create public HTTP socket: {error}"))?;
+    socket
+        .set_reuseaddr(true)
+        .and_then(|()| socket.set_reuseport(true))
+        .map_err(|error| format!("failed to set SO_REUSEPORT on public HTTP socket: {error}"))?;
+    steer_incoming_cpu(&socket, cpu);
+    socket
+        .bind(address)
+        .map_err(|error| format!("failed to bind public HTTP listener: {error}"))?;
+    let listener = socket
+        .listen(PER_CORE_LISTEN_BACKLOG)
+        .map_err(|error| format!("failed to listen on public HTTP listener: {error}"))?;
+    // Registered with the core's own runtime once it is up.
+    listener
+        .into_std()
+        .map_err(|error| format!("failed to detach public HTTP listener: {error}"))
+}
+
+#[cfg(not(target_os = "linux"))]
+fn steer_incoming_cpu(_socket: &TcpSocket, _cpu: usize) {}
+
+/// Prefers this listener for connections whose packets the kernel processes
+/// on `cpu`, when several `SO_REUSEPORT` listeners share the port.
+#[cfg(target_os = "linux")]
+fn steer_incoming_cpu(socket: &TcpSocket, cpu: usize) {
+    use std::os::fd::AsRawFd;
+
+    let cpu_option = cpu as libc::c_int;
+    // SAFETY: a valid socket and a c_int-sized option value.
+    let steered = unsafe {
+        libc::setsockopt(
+            socket.as_raw_fd(),
+            libc::SOL_SOCKET,
+            libc::SO_INCOMING_CPU,
+            (&cpu_option as *const libc::c_int).cast(),
+            std::mem::size_of::<libc::c_int>() as libc::socklen_t,
+        )
+    };
+    if steered != 0 {
+        debug!(
+            cpu,
+            "failed to set SO_INCOMING_CPU: {}",
+            std::io::Error::last_os_error()
+        );
+    }
+}
+
+/// How unevenly the last interval's connections spread over the cores: the
+/// busiest core's count over the mean, so 1.0 is a perfectly even spread and
+/// `cores` means one core took everything. `None` when nothing was accepted.
+fn core_imbalance(accepted: &[u64]) -> Option<f64> {
+    let total: u64 = accepted.iter().sum();
+    let busiest = accepted.iter().copied().max()?;
+    (total > 0).then(|| busiest as f64 * accepted.len() as f64 / total as f64)
+}
+
+/// A per-core listener's index and the accept counters the imbalance
+/// sampler reads.
+struct CoreSlot {
+    index: usize,
+    accepted: Arc<[CachePadded<AtomicU64>]>,
+}
+
+thread_local! {
+    /// The core whose runtime is running on this thread, for per-core
+    /// listeners. A current-thread runtime polls every task it owns on the
+    /// thread that drives it, so this holds for each of its connections.
+    static CURRENT_CORE: Cell<Option<usize>> = const { Cell::new(None) };
+}
+
+#[allow(clippy::too_many_arguments)]
+async fn accept_loop(
+    listener: TcpListener,
+    router: Router,
+    state: SharedState,
+    config: AcceleratedFileServingConfig,
+    semaphore: Arc<Semaphore>,
+    mut shutdown_rx: watch::Receiver<bool>,
+    configure_http2: Http2BuilderConfig,
+    core: Option<CoreSlot>,
+) -> Result<(), String> {
+    let connection_polls = state
+        .metrics
+        .task_poll_metrics("public_http_connection")
+        .sampled();
 
     loop {
         tokio::select! {
@@ -97,6 +395,10 @@ pub async fn serve_public_http(
                         continue;
                     }
                 };
+                if let Some(core) = &core {
+                    core.accepted[core.index].0.fetch_add(1, Ordering::Relaxed);
+                    state.metrics.record_accelerated_core_connection(core.index);
+                }
                 // Unary REAPI calls (FindMissingBlobs, GetActionResult) are
                 // small and latency-bound; Nagle + delayed ACK stalls them.
                 if let Err(error) = stream.set_nodelay(true) {
@@ -108,14 +410,15 @@ pub async fn serve_public_http(
                 let config = config.clone();
                 let semaphore = semaphore.clone();
                 let shutdown = shutdown_rx.clone();
-                tokio::spawn(
+                tokio::spawn(crate::tasks::timed(
+                    connection_polls.clone(),
                     async move {
                         if let Err(error) = serve_connection(stream, router, state, config, semaphore, configure_http2, accepted_at, shutdown).await {
                             tracing::debug!("public HTTP connection failed: {error}");
                         }
                     }
                     .in_current_span(),
-                );
+                ));
             }
             changed = shutdown_rx.changed() => {
                 if changed.is_err() || *shutdown_rx.borrow() {
@@ -142,6 +445,7 @@ async fn serve_connection(
     if !config.enabled {
         return serve_hyper(stream, router, configure_http2, accepted_at, shutdown).await;
     }
+    let connection_auth = ConnectionAuth::default();
     loop {
         // Bound the wait for the next request so idle keep-alive connections do
         // not pin a task and file descriptor forever, and close idle fast-path
@@ -157,7 +461,8 @@ async fn serve_connection(
         };
 
         // Match the route from a non-destructive peek before doing any access or
-        // store work. Anything that is not an accelerable artifact GET, including
+        // store work. Anything that is not an accelerable artifact GET or a
+        // spliceable upload, including
         // a pipelined follow-up on a reused connection, or anything that arrives
         // once the accelerator is at capacity, falls through to the normal
         // Axum/Hyper path before request bytes are consumed and without
@@ -166,21 +471,83 @@ async fn serve_connection(
         let Some((parsed, artifact)) = classified else {
             return serve_hyper(stream, router, configure_http2, accepted_at, shutdown).await;
         };
+        // The raw response writer has no header to carry stage timings, so a
+        // request that asks for them is served by the Axum path instead.
+        if parsed
+            .headers
+            .contains_key(stage_timing::SERVER_TIMING_REQUEST_HEADER)
+        {
+            return serve_hyper(stream, router, configure_http2, accepted_at, shutdown).await;
+        }
         let keep_alive = request_wants_keep_alive(&parsed);
         let request_started_at = Instant::now();
         let Ok(permit) = semaphore.clone().try_acquire_owned() else {
             return serve_hyper(stream, router, configure_http2, accepted_at, shutdown).await;
         };
-        match open_and_authorize(&state, parsed, artifact).await {
-            ClassifiedRequest::Accelerate(candidate) => {
-                consume_headers(&mut stream, candidate.header_len).await?;
-                let reuse = serve_accelerated(
+        let timings = Arc::new(StageTimings::default());
+        if let Some(content_length) = spliceable_upload_length(&parsed, &artifact) {
+            // A draining node or one shedding writes answers through the
+            // public router's middleware, which Hyper runs and this path
+            // would skip.
+            if state.runtime.is_draining()
+                || crate::http::public_write_shed_reason(&state).is_some()
+            {
+                drop(permit);
+                return serve_hyper(stream, router, configure_http2, accepted_at, shutdown).await;
+            }
+            let denial = stage_timing::scope(
+                timings.clone(),
+                authorize(&state, &connection_auth, &parsed, &artifact),
+            )
+            .await;
+            if let Some(denial) = denial {
+                drop(permit);
+                return write_denial(stream, &state, denial).await;
+            }
+            consume_headers(&mut stream, parsed.header_len).await?;
+            // The permit bounds how many requests are being classified and
+            // authorized here; the body transfer is bounded by the store's
+            // own write admission, like an upload on the Hyper path.
+            drop(permit);
+            let reuse = stage_timing::scope(
+                timings,
+                serve_accelerated_upload(
                     stream,
                     &state,
                     &config,
-                    candidate,
+                    &parsed,
+                    artifact,
+                    content_length,
                     request_started_at,
-                    keep_alive,
+                ),
+            )
+            .await;
+            match reuse? {
+                Some(reused) if !*shutdown.borrow() => {
+                    stream = reused;
+                    continue;
+                }
+                _ => return Ok(()),
+            }
+        }
+        let classified = stage_timing::scope(
+            timings.clone(),
+            open_and_authorize(&state, &connection_auth, parsed, artifact),
+        )
+        .await;
+        match classified {
+            ClassifiedRequest::Accelerate(candidate) => {
+                consume_headers(&mut stream, candidate.header_len).await?;
+                let reuse = stage_timing::scope(
+                    timings.clone(),
+                    serve_accelerated(
+                        stream,
+                        &state,
+                        &config,
+                        candidate,
+                        request_started_at,
+                        keep_alive,
+                    ),
                 )
                 .await;
                 drop(permit);
@@ -196,24 +563,7 @@ async fn serve_connection(
             }
             ClassifiedRequest::Deny(denial) => {
                 drop(permit);
-                consume_headers(&mut stream, denial.header_len).await?;
-                let headers = BTreeMap::new();
-                let result = write_response(
-                    &mut stream,
-                    denial.status,
-                    denial.reason,
-                    "text/plain",
-                    &headers,
-                    denial.body.as_bytes(),
-                )
-                .await;
-                state.metrics.record_http(
-                    denial.route.to_owned(),
-                    StatusCode::from_u16(denial.status)
-                        .unwrap_or(StatusCode::INTERNAL_SERVER_ERROR),
-                    Duration::ZERO,
-                );
-                return result;
+                return write_denial(stream, &state, denial).await;
             }
             ClassifiedRequest::Fallback => {
                 drop(permit);
@@ -223,20 +573,44 @@ async fn serve_connection(
     }
 }
 
+async fn write_denial(
+    mut stream: TcpStream,
+    state: &SharedState,
+    denial: Denial,
+) -> std::io::Result<()> {
+    consume_headers(&mut stream, denial.header_len).await?;
+    let headers = BTreeMap::new();
+    let result = write_response(
+        &mut stream,
+        denial.status,
+        denial.reason,
+        "text/plain",
+        &headers,
+        denial.body.as_bytes(),
+        false,
+    )
+    .await;
+    state.metrics.record_http(
+        denial.route.to_owned(),
+        StatusCode::from_u16(denial.status).unwrap_or(StatusCode::INTERNAL_SERVER_ERROR),
+        Duration::ZERO,
+    );
+    result
+}
+
+fn connection_close_requested(parsed: &ParsedRequest) -> bool {
+    parsed.headers.get("connection").is_some_and(|value| {
+        value
+            .split(',')
+            .any(|token| token.trim().eq_ignore_ascii_case("close"))
+    })
+}
+
 fn request_wants_keep_alive(parsed: &ParsedRequest) -> bool {
     // Only HTTP/1.1 GETs reach here. Default to keep-alive unless the client
     // asked to close, or the request carries a body we did not consume, which
     // would desync a reused connection.
-    if parsed
-        .headers
-        .get("connection")
-        .map(|value| {
-            value
-                .split(',')
-                .any(|token| token.trim().eq_ignore_ascii_case("close"))
-        })
-        .unwrap_or(false)
-    {
+    if connection_close_requested(parsed) {
         return false;
     }
     if parsed.headers.contains_key("transfer-encoding") {
@@ -262,14 +636,14 @@ where
 {
     let mut builder = HttpBuilder::new(TokioExecutor::new());
     configure_http2(&mut builder);
+    // What this connection has already been allowed, so the requests a
+    // long-lived channel repeats skip the shared authorization path.
+    let connection_auth = Arc::new(ConnectionAuth::default());
     let service = service_fn(move |request: Request<Incoming>| {
         let router = router.clone();
-        async move {
-            router
-                .oneshot(request.map(Body::new))
-                .await
-                .map_err(std::io::Error::other)
-        }
+        let mut request = request.map(Body::new);
+        request.extensions_mut().insert(connection_auth.clone());
+        async move { router.oneshot(request).await.map_err(std::io::Error::other) }
     });
     let connection = builder.serve_connection(TokioIo::new(stream), service);
     let mut connection = std::pin::pin!(connection);
@@ -306,6 +680,7 @@ pub async fn serve_public_tls(
     configure_http2: Http2BuilderConfig,
 ) -> Result<(), String> {
     let acceptor = TlsAcceptor::from(tls_config);
+    let router = router.layer(axum::Extension(crate::http::TlsConnection));
     let address = listener
         .local_addr()
         .map_err(|error| format!("failed to read public HTTPS listener address: {error}"))?;
@@ -422,15 +797,42 @@ async fn classify_route(
             return None;
         }
     };
-    if parsed.version != 1 || parsed.method != "GET" {
+    if parsed.version != 1 {
         return None;
     }
     let artifact = artifact_request(&parsed.target, &state.config.tenant_id)?;
+    if parsed.method != "GET" && spliceable_upload_length(&parsed, &artifact).is_none() {
+        return None;
+    }
     Some((parsed, artifact))
 }
 
+/// The declared body length of an upload the accelerator can splice: the
+/// producer's single-request upload (`POST` for Xcode CAS, `PUT` for Gradle,
+/// Nx and Metro) with a `Content-Length` body and at most an
+/// `Expect: 100-continue`. Chunked bodies and multipart module parts go to
+/// Hyper.
+fn spliceable_upload_length(parsed: &ParsedRequest, artifact: &ArtifactRequest) -> Option<u64> {
+    let method = match artifact.producer {
+        ArtifactProducer::Xcode => "POST",
+        ArtifactProducer::Gradle | ArtifactProducer::Nx | ArtifactProducer::Metro => "PUT",
+        ArtifactProducer::Module | ArtifactProducer::Reapi => return None,
+    };
+    if parsed.method != method
+        || parsed.headers.contains_key("transfer-encoding")
+        || parsed
+            .headers
+            .get("expect")
+            .is_some_and(|expect| !expect.eq_ignore_ascii_case("100-continue"))
+    {
+        return None;
+    }
+    parsed.headers.get("content-length")?.parse::<u64>().ok()
+}
+
 async fn open_and_authorize(
     state: &SharedState,
+    connection_auth: &ConnectionAuth,
     parsed: ParsedRequest,
     artifact: ArtifactRequest,
 ) -> ClassifiedRequest {
@@ -446,20 +848,8 @@ async fn open_and_authorize(
         Ok(Some(file)) => file,
         _ => return ClassifiedRequest::Fallback,
     };
-    let access_context = request_context(state, &parsed, &artifact, None);
-    if let Some(auth) = state.auth.as_ref() {
-        match auth.evaluate_access(&access_context).await {
-            AccessDecision::Allow => {}
-            AccessDecision::Deny(deny) => {
-                return ClassifiedRequest::Deny(Denial {
-                    header_len: parsed.header_len,
-                    route: artifact.route,
-                    status: deny.status,
-                    reason: reason_for_status(deny.status),
-                    body: deny.message,
-                });
-            }
-        }
+    if let Some(denial) = authorize(state, connection_auth, &parsed, &artifact).await {
+        return ClassifiedRequest::Deny(denial);
     }
 
     ClassifiedRequest::Accelerate(AcceleratedCandidate {
@@ -469,6 +859,31 @@ async fn open_and_authorize(
     })
 }
 
+async fn authorize(
+    state: &SharedState,
+    connection_auth: &ConnectionAuth,
+    parsed: &ParsedRequest,
+    artifact: &ArtifactRequest,
+) -> Option<Denial> {
+    let auth = state.auth.as_ref()?;
+    let access_context = request_context(state, parsed, artifact, None);
+    let decision = {
+        let _auth = stage_timing::enter(Stage::Auth);
+        auth.evaluate_access_on_connection(&access_context, Some(connection_auth))
+            .await
+    };
+    match decision {
+        AccessDecision::Allow => None,
+        AccessDecision::Deny(deny) => Some(Denial {
+            header_len: parsed.header_len,
+            route: artifact.route,
+            status: deny.status,
+            reason: reason_for_status(deny.status),
+            body: deny.message,
+        }),
+    }
+}
+
 async fn peek_request(stream: &TcpStream) -> std::io::Result<Option<ParsedRequest>> {
     let started_at = Instant::now();
     let mut bytes = vec![0_u8; MAX_HEADER_BYTES];
@@ -507,16 +922,28 @@ fn parse_request(bytes: &[u8]) -> Result<Option<ParsedRequest>, httparse::Error>
     let Some(version) = request.version else {
         return Ok(None);
     };
-    let headers = request
+    let mut headers = BTreeMap::new();
+    for header in request
         .headers
         .iter()
         .filter(|header| !header.name.is_empty())
-        .filter_map(|header| {
-            std::str::from_utf8(header.value)
-                .ok()
-                .map(|value| (header.name.to_ascii_lowercase(), value.trim().to_string()))
-        })
-        .collect();
+    {
+        let Ok(value) = std::str::from_utf8(header.value) else {
+            continue;
+        };
+        let name = header.name.to_ascii_lowercase();
+        let value = value.trim().to_string();
+        // A repeated framing header is kept as a list so it never parses as
+        // one length: the request goes to Hyper, which rejects it.
+        if matches!(name.as_str(), "content-length" | "transfer-encoding")
+            && let Some(previous) = headers.get_mut(&name)
+        {
+            previous.push_str(", ");
+            previous.push_str(&value);
+            continue;
+        }
+        headers.insert(name, value);
+    }
     Ok(Some(ParsedRequest {
         method: method.to_owned(),
         target: target.to_owned(),
@@ -579,6 +1006,7 @@ async fn serve_accelerated(
                 "text/plain",
                 &headers,
                 body,
+                false,
             )
             .await?;
             state.metrics.record_http(
@@ -589,7 +1017,8 @@ async fn serve_accelerated(
             return Ok(None);
         }
     };
-    let result = tokio::task::spawn_blocking(
+    let timings = stage_timing::current();
+    let result = crate::tasks::spawn_blocking(
         move || -> std::io::Result<(std::net::TcpStream, u64, Duration)> {
             let _response_stream_permit = response_stream_permit;
             let mut stream = stream.into_std()?;
@@ -600,6 +1029,7 @@ async fn serve_accelerated(
             // before the body transfer, so large downloads do not inflate the
             // responsiveness signal.
             let time_to_first_byte = request_started_at.elapsed();
+            let _transfer = timings.map(|timings| stage_timing::enter_in(timings, Stage::Transfer));
             let mut cache_drop = AcceleratedReadCacheDrop::new(chunk_bytes);
             let transfer = transfer_file(
                 &mut stream,
@@ -620,6 +1050,12 @@ async fn serve_accelerated(
     match result {
         Ok((std_stream, bytes, time_to_first_byte)) => {
             state.metrics.record_artifact_serving_path("accelerated");
+            if let Some(core) = CURRENT_CORE.with(Cell::get) {
+                state.metrics.record_accelerated_core_bytes(core, bytes);
+            }
+            if let Some(timings) = stage_timing::current() {
+                timings.observe(&state.metrics, "http");
+            }
             state.runtime.record_public_request_latency(
                 &state.metrics,
                 "http",
@@ -686,6 +1122,84 @@ async fn serve_accelerated(
     }
 }
 
+/// Stores a plaintext HTTP/1 upload whose headers have been consumed, with
+/// the body spliced from the socket into the staging file. Existence checks,
+/// single-flight, admission, the commit and its metrics are the Axum
+/// handler's; this only frames the request and the response, and runs the
+/// handler in the request's admission flow as the public router would.
+async fn serve_accelerated_upload(
+    stream: TcpStream,
+    state: &SharedState,
+    config: &AcceleratedFileServingConfig,
+    parsed: &ParsedRequest,
+    artifact: ArtifactRequest,
+    content_length: u64,
+    request_started_at: Instant,
+) -> std::io::Result<Option<TcpStream>> {
+    let _request_guard = state.start_http_request(HttpTrafficClass::Public);
+    let expect_continue = parsed.headers.contains_key("expect");
+    let mut body =
+        SplicedRequestBody::new(stream, content_length, expect_continue, config.chunk_bytes);
+    let params: std::collections::HashMap<_, _> = artifact.query.clone().into_iter().collect();
+    let id = artifact.artifact_hash.as_deref().unwrap_or(&artifact.key);
+    let flow =
+        crate::http::public_admission_flow(state, &params, fair_admission::TrafficClass::Write);
+    let response = fair_admission::scope(
+        flow,
+        crate::http::put_spliced_artifact(state.clone(), artifact.producer, id, &params, &mut body),
+    )
+    .await;
+    let status = response.status();
+    state.metrics.record_http(
+        artifact.route.to_owned(),
+        status,
+        request_started_at.elapsed(),
+    );
+    // A body left on the connection (an existing artifact, a rejection) would
+    // be read as the next request, so the connection closes after it.
+    let keep_alive =
+        body.consumed() && !connection_close_requested(parsed) && !state.runtime.is_draining();
+    let Some(mut stream) = body.into_stream() else {
+        return Ok(None);
+    };
+    let content_type = response
+        .headers()
+        .get(CONTENT_TYPE)
+        .and_then(|value| value.to_str().ok())
+        .unwrap_or("text/plain")
+        .to_owned();
+    let headers = response
+        .headers()
+        .iter()
+        .filter(|(name, _)| {
+            !matches!(
+                name.as_str(),
+                "content-length" | "content-type" | "connection" | "transfer-encoding"
+            )
+        })
+        .filter_map(|(name, value)| {
+            value
+                .to_str()
+                .ok()
+                .map(|value| (name.as_str().to_owned(), value.to_owned()))
+        })
+        .collect();
+    let response_body = axum::body::to_bytes(response.into_body(), MAX_UPLOAD_RESPONSE_BYTES)
+        .await
+        .map_err(std::io::Error::other)?;
+    write_response(
+        &mut stream,
+        status.as_u16(),
+        status.canonical_reason().unwrap_or("Unknown"),
+        &content_type,
+        &headers,
+        &response_body,
+        keep_alive,
+    )
+    .await?;
+    Ok(keep_alive.then_some(stream))
+}
+
 struct AcceleratedReadCacheDrop {
     interval_bytes: u64,
     page_bytes: u64,
@@ -952,7 +1466,12 @@ fn request_context(
         transport: "http".into(),
         route: artifact.route.to_owned(),
         method: parsed.method.clone(),
-        operation: "artifact.read".into(),
+        operation: if parsed.method == "GET" {
+            "artifact.read"
+        } else {
+            "artifact.write"
+        }
+        .into(),
         server_tenant_id: state.config.tenant_id.clone(),
         tenant_id: Some(artifact.tenant_id.clone()),
         namespace_id: if artifact.namespace_id.is_empty() {
@@ -1023,13 +1542,20 @@ async fn write_response(
     content_type: &str,
     headers: &BTreeMap<String, String>,
     body: &[u8],
+    keep_alive: bool,
 ) -> std::io::Result<()> {
+    let connection = if keep_alive { "keep-alive" } else { "close" };
     let mut response = Vec::new();
-    write!(
-        response,
-        "HTTP/1.1 {status} {reason}\r\ncontent-length: {}\r\ncontent-type: {content_type}\r\nconnection: close\r\n",
-        body.len()
-    )?;
+    write!(response, "HTTP/1.1 {status} {reason}\r\n")?;
+    // 204 carries neither a body nor a length.
+    if status != 204 {
+        write!(
+            response,
+            "content-length: {}\r\ncontent-type: {content_type}\r\n",
+            body.len()
+        )?;
+    }
+    write!(response, "connection: {connection}\r\n")?;
     append_headers(&mut response, headers)?;
     response.extend_from_slice(b"\r\n");
     response.extend_from_slice(body);
@@ -1344,10 +1870,31 @@ mod tests {
 
     use super::{
         AcceleratedCandidate, AcceleratedReadCacheDrop, ArtifactRequest, ParsedRequest,
-        TransferFailure, artifact_request, parse_request, request_wants_keep_alive,
-        sanitized_content_type, serve_accelerated, system_page_bytes,
+        TransferFailure, artifact_request, bind_reuseport_listener, core_imbalance, parse_request,
+        request_wants_keep_alive, sanitized_content_type, serve_accelerated,
+        spliceable_upload_length, system_page_bytes,
     };
 
+    // `TcpSocket::listen` registers with the current runtime's reactor.
+    #[tokio::test]
+    async fn per_core_listeners_share_one_port() {
+        let first = bind_reuseport_listener("127.0.0.1:0".parse().unwrap(), 0)
+            .expect("first listener should bind");
+        let address = first.local_addr().unwrap();
+        let second =
+            bind_reuseport_listener(address, 1).expect("second listener should join the port");
+
+        assert_eq!(second.local_addr().unwrap(), address);
+    }
+
+    #[test]
+    fn core_imbalance_is_the_busiest_core_over_the_even_share() {
+        assert_eq!(core_imbalance(&[10, 10, 10, 10]), Some(1.0));
+        assert_eq!(core_imbalance(&[40, 0, 0, 0]), Some(4.0));
+        assert_eq!(core_imbalance(&[30, 10]), Some(1.5));
+        assert_eq!(core_imbalance(&[0, 0]), None);
+    }
+
     #[test]
     fn client_hangups_are_not_server_errors() {
         for kind in [
@@ -1476,6 +2023,39 @@ mod tests {
         }
     }
 
+    #[test]
+    fn only_length_framed_uploads_with_the_producer_method_are_spliced() {
+        let gradle = artifact_request("/api/cache/gradle/key?tenant_id=acme", "acme")
+            .expect("gradle request should parse");
+        let upload = |method: &str, headers: &[(&str, &str)]| {
+            let mut parsed = parsed_with_headers(headers);
+            parsed.method = method.to_owned();
+            spliceable_upload_length(&parsed, &gradle)
+        };
+
+        assert_eq!(upload("PUT", &[("content-length", "42")]), Some(42));
+        assert_eq!(
+            upload(
+                "PUT",
+                &[("content-length", "42"), ("expect", "100-continue")]
+            ),
+            Some(42)
+        );
+        assert_eq!(upload("POST", &[("content-length", "42")]), None);
+        assert_eq!(upload("PUT", &[("transfer-encoding", "chunked")]), None);
+        assert_eq!(
+            upload("PUT", &[("content-length", "42"), ("expect", "other")]),
+            None
+        );
+
+        let duplicated = parse_request(
+            b"PUT /api/cache/gradle/key HTTP/1.1\r\ncontent-length: 4\r\ncontent-length: 4\r\n\r\n",
+        )
+        .expect("request should parse")
+        .expect("request should be complete");
+        assert_eq!(spliceable_upload_length(&duplicated, &gradle), None);
+    }
+
     #[test]
     fn keep_alive_defaults_on_and_disables_for_close_or_unconsumed_body() {
         assert!(request_wants_keep_alive(&parsed_with_headers(&[(
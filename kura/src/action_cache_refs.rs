@@ -34,7 +34,11 @@ pub fn referenced_blob_keys(action_result_bytes: &[u8]) -> Vec<String> {
     let Ok(result) = reapi::ActionResult::decode(action_result_bytes) else {
         return Vec::new();
     };
+    action_result_blob_keys(&result)
+}
 
+/// [`referenced_blob_keys`] for an already-decoded action result.
+pub fn action_result_blob_keys(result: &reapi::ActionResult) -> Vec<String> {
     let mut keys = Vec::new();
     for file in &result.output_files {
         push_blob_key(&mut keys, file.digest.as_ref());
@@ -1,10 +1,4 @@
-use std::{
-    sync::{
-        Arc,
-        atomic::{AtomicUsize, Ordering},
-    },
-    time::Duration,
-};
+use std::{sync::Arc, time::Duration};
 
 use hmac::{Hmac, Mac};
 use reqwest::{Client, StatusCode, header::CONTENT_TYPE};
@@ -16,7 +10,11 @@ use tokio::{
 };
 use tracing::error;
 
-use crate::{config::AnalyticsConfig, metrics::Metrics};
+use crate::{
+    config::AnalyticsConfig,
+    metrics::Metrics,
+    shards::{ShardedCounter, shard_count},
+};
 
 type HmacSha256 = Hmac<Sha256>;
 
@@ -26,8 +24,10 @@ const GRADLE_WEBHOOK_PATH: &str = "/webhooks/gradle-cache";
 #[derive(Clone)]
 pub struct Analytics {
     sender: mpsc::Sender<AnalyticsEvent>,
-    pending: Arc<AtomicUsize>,
-    queue_capacity: usize,
+    /// Events accepted since the runtime last published the count. Sharded
+    /// and published on the batch tick, so recording an event touches no
+    /// metric another worker is writing at the same time.
+    enqueued: Arc<ShardedCounter>,
     metrics: Metrics,
 }
 
@@ -43,7 +43,7 @@ struct AnalyticsRuntime {
     config: AnalyticsConfig,
     cache_endpoint: String,
     metrics: Metrics,
-    pending: Arc<AtomicUsize>,
+    enqueued: Arc<ShardedCounter>,
 }
 
 #[derive(Clone, Debug, Serialize, PartialEq, Eq)]
@@ -99,13 +99,13 @@ impl Analytics {
             .build()
             .map_err(|error| format!("failed to build analytics client: {error}"))?;
         let (sender, receiver) = mpsc::channel(config.queue_capacity);
-        let pending = Arc::new(AtomicUsize::new(0));
+        let enqueued = Arc::new(ShardedCounter::new(shard_count()));
         let runtime = AnalyticsRuntime {
             client,
             config: config.clone(),
             cache_endpoint: analytics_endpoint(node_url),
             metrics: metrics.clone(),
-            pending: pending.clone(),
+            enqueued: enqueued.clone(),
         };
 
         metrics.update_analytics_queue(config.queue_capacity, 0);
@@ -115,8 +115,7 @@ impl Analytics {
 
         Ok(Some(Self {
             sender,
-            pending,
-            queue_capacity: config.queue_capacity,
+            enqueued,
             metrics,
         }))
     }
@@ -187,17 +186,17 @@ impl Analytics {
 
     fn enqueue(&self, event: AnalyticsEvent) {
         match self.sender.try_send(event) {
-            Ok(()) => {
-                let depth = self.pending.fetch_add(1, Ordering::Relaxed) + 1;
-                self.metrics.record_analytics_event("queue", "enqueued", 1);
-                self.metrics
-                    .update_analytics_queue(self.queue_capacity, depth);
-            }
+            Ok(()) => self.enqueued.add(1),
             Err(_) => {
                 self.metrics.record_analytics_event("queue", "dropped", 1);
             }
         }
     }
+
+    #[cfg(test)]
+    fn queued(&self) -> usize {
+        self.sender.max_capacity() - self.sender.capacity()
+    }
 }
 
 impl AnalyticsRuntime {
@@ -219,15 +218,12 @@ impl AnalyticsRuntime {
             tokio::select! {
                 maybe_event = receiver.recv() => {
                     let Some(event) = maybe_event else {
+                        self.publish_queue(&receiver);
                         self.flush_xcode(&mut xcode_batch, &mut xcode_breaker).await;
                         self.flush_gradle(&mut gradle_batch, &mut gradle_breaker).await;
                         break;
                     };
 
-                    let depth = self.pending.fetch_sub(1, Ordering::Relaxed).saturating_sub(1);
-                    self.metrics
-                        .update_analytics_queue(self.config.queue_capacity, depth);
-
                     match event {
                         AnalyticsEvent::Xcode(event) => {
                             xcode_batch.push(event);
@@ -244,6 +240,7 @@ impl AnalyticsRuntime {
                     }
                 }
                 _ = ticker.tick() => {
+                    self.publish_queue(&receiver);
                     self.flush_xcode(&mut xcode_batch, &mut xcode_breaker).await;
                     self.flush_gradle(&mut gradle_batch, &mut gradle_breaker).await;
                 }
@@ -251,6 +248,15 @@ impl AnalyticsRuntime {
         }
     }
 
+    /// Publishes what the recording side counted since the last tick, and
+    /// the queue depth as the channel itself reports it.
+    fn publish_queue(&self, receiver: &mpsc::Receiver<AnalyticsEvent>) {
+        self.metrics
+            .record_analytics_event("queue", "enqueued", self.enqueued.take());
+        self.metrics
+            .update_analytics_queue(self.config.queue_capacity, receiver.len());
+    }
+
     async fn flush_xcode(
         &self,
         batch: &mut Vec<XcodeAnalyticsEvent>,
@@ -661,7 +667,7 @@ mod tests {
 
         timeout(Duration::from_secs(2), async {
             loop {
-                if analytics.pending.load(std::sync::atomic::Ordering::Relaxed) == 0 {
+                if analytics.queued() == 0 {
                     break;
                 }
                 sleep(Duration::from_millis(10)).await;
@@ -24,7 +24,9 @@ use crate::{
     auth::AuthEngine,
     bandwidth::BandwidthLimiter,
     config::Config,
+    fair_admission::FairnessWeights,
     http,
+    inflight_uploads::InflightUploads,
     io::IoController,
     memory::{MemoryController, MemoryPressure},
     metrics::Metrics,
@@ -35,6 +37,7 @@ use crate::{
     runtime::{DataDirLock, RuntimeState},
     state::{AppState, ReadinessState, SharedState},
     store::Store,
+    tasks,
     telemetry::{init_tracing, log_context_span},
     usage::Usage,
     utils::directory_size_bytes,
@@ -141,6 +144,12 @@ async fn run_with_config(
         config.memory_hard_limit_bytes,
         config.anon_admission_budget_bytes(),
     );
+    let fairness_weights = Arc::new(FairnessWeights::new(
+        config.admission_read_weight,
+        config.namespace_shares.clone(),
+    ));
+    io.set_fairness_weights(fairness_weights.clone());
+    memory.set_fairness_weights(fairness_weights);
     let snapshot_cache = Arc::new(crate::reapi::SnapshotCache::new(
         config.snapshot_cache_max_bytes,
     ));
@@ -198,10 +207,12 @@ async fn run_with_config(
         replication_backoff: tokio::sync::Mutex::new(std::collections::HashMap::new()),
         backfill_bodies_peer_slots: Arc::new(crate::state::BackfillBodiesPeerSlots::default()),
         backfill: crate::backfill::lifecycle::BackfillLifecycle::new(),
+        inflight_uploads: Arc::new(InflightUploads::default()),
     });
     state.sync_runtime_metrics().await;
     let drain_completion_timeout = Duration::from_millis(state.config.drain_completion_timeout_ms);
 
+    spawn_warm_restart_task(state.clone());
     spawn_membership_task(state.clone());
     spawn_outbox_task(state.clone());
     Usage::spawn_tasks(state.clone());
@@ -215,6 +226,7 @@ async fn run_with_config(
     spawn_snapshot_task(state.clone());
     spawn_memory_pressure_tasks(state.clone());
     spawn_runtime_metrics_task(state.clone());
+    spawn_scheduler_metrics_task(state.clone());
     spawn_drain_signal_task(state.clone());
     spawn_multipart_janitor_task(state.clone());
     if state.config.action_cache_eviction_cascade_enabled {
@@ -222,8 +234,11 @@ async fn run_with_config(
     }
     spawn_action_cache_expiry_task(state.clone());
     spawn_backfill_index_task(state.clone());
+    spawn_backfill_reconcile_task(state.clone());
     spawn_tmp_dir_metrics_task(state.clone());
     spawn_segment_promotion_task(state.clone());
+    spawn_namespace_reaper_task(state.clone());
+    spawn_namespace_usage_task(state.clone());
 
     // When the node enrolled on boot, keep its peer certificate fresh in-process
     // so a short leaf does not require a restart, and prove mesh-membership
@@ -351,7 +366,9 @@ async fn run_with_config(
             shutdown_signal().await;
             let budget = ShutdownBudget::new(drain_completion_timeout);
             let _ = shutdown_budget_tx.send(budget);
-            let _ = public_shutdown_state.enter_draining();
+            if public_shutdown_state.enter_draining() {
+                crate::warm_restart::persist_hot_set(&public_shutdown_state).await;
+            }
             public_shutdown_state.sync_runtime_metrics().await;
             let _ = public_shutdown_tx.send(true);
         }
@@ -395,20 +412,34 @@ async fn run_with_config(
     // sendfile/splice fast path while gRPC (h2c) and other non-accelerable
     // requests fall through to hyper — with the fixed gRPC-sized HTTP/2 windows
     // so co-hosted REAPI uploads run at full speed. When acceleration is
-    // disabled every connection takes the hyper path of the same loop.
-    let public_listener = tokio::net::TcpListener::bind(address)
+    // disabled every connection takes the hyper path of the same loop. In
+    // thread-per-core mode the same loop runs once per core, each on its own
+    // SO_REUSEPORT listener and pinned runtime.
+    let served = if state.config.accelerated_file_serving.thread_per_core {
+        accelerated_file_serving::serve_public_http_per_core(
+            address,
+            router,
+            state.clone(),
+            state.config.accelerated_file_serving.clone(),
+            public_shutdown_rx,
+            configure_http_builder,
+        )
         .await
-        .map_err(|error| format!("failed to bind public HTTP listener: {error}"))?;
-    accelerated_file_serving::serve_public_http(
-        public_listener,
-        router,
-        state.clone(),
-        state.config.accelerated_file_serving.clone(),
-        public_shutdown_rx,
-        configure_http_builder,
-    )
-    .await
-    .map_err(|error| format!("server error: {error}"))?;
+    } else {
+        let public_listener = tokio::net::TcpListener::bind(address)
+            .await
+            .map_err(|error| format!("failed to bind public HTTP listener: {error}"))?;
+        accelerated_file_serving::serve_public_http(
+            public_listener,
+            router,
+            state.clone(),
+            state.config.accelerated_file_serving.clone(),
+            public_shutdown_rx,
+            configure_http_builder,
+        )
+        .await
+    };
+    served.map_err(|error| format!("server error: {error}"))?;
     let shutdown_budget = shutdown_budget_rx.await.unwrap_or_else(|_| {
         warn!("shutdown budget channel closed before graceful shutdown completed");
         ShutdownBudget::new(drain_completion_timeout)
@@ -544,12 +575,41 @@ fn spawn_segment_promotion_task(state: Arc<AppState>) {
     );
 }
 
+// Purges tombstoned namespaces in bounded batches behind the deletes that
+// committed their tombstones (see Store::run_namespace_reaper). Supervised so
+// a panic cannot strand deleted entries on disk, hidden from reads but never
+// reclaimed, for the life of the process; a respawn resumes from the
+// persisted reap records.
+fn spawn_namespace_reaper_task(state: Arc<AppState>) {
+    spawn_supervised("namespace_reaper", state, |state| async move {
+        state.store.run_namespace_reaper().await;
+    });
+}
+
+// Re-sums per-namespace usage for fair-share promotion (see namespace_share).
+// The first scan runs at boot; until it lands no namespace is over its share,
+// which is the pre-quota behavior.
+fn spawn_namespace_usage_task(state: Arc<AppState>) {
+    spawn_supervised("namespace_usage", state, |state| async move {
+        let interval = Duration::from_millis(crate::constants::NAMESPACE_USAGE_SCAN_INTERVAL_MS);
+        loop {
+            let scan_state = state.clone();
+            match tasks::spawn_blocking(move || scan_state.store.refresh_namespace_shares()).await {
+                Ok(Ok(_)) => {}
+                Ok(Err(error)) => warn!("namespace usage scan failed: {error}"),
+                Err(error) => warn!("namespace usage scan task panicked: {error}"),
+            }
+            tokio::time::sleep(interval).await;
+        }
+    });
+}
+
 fn spawn_snapshot_task(state: Arc<AppState>) {
     tokio::spawn(
         async move {
             loop {
                 let worker_state = state.clone();
-                match tokio::task::spawn_blocking(move || {
+                match tasks::spawn_blocking(move || {
                     let snapshot = worker_state.store.snapshot();
                     let jemalloc = jemalloc_stats_snapshot();
                     (snapshot, jemalloc)
@@ -582,6 +642,11 @@ fn spawn_snapshot_task(state: Arc<AppState>) {
                             snapshot.rocksdb_write_buffer_usage_bytes,
                             snapshot.rocksdb_write_buffer_capacity_bytes,
                         );
+                        state.metrics.update_rocksdb_bytes_written(
+                            snapshot.rocksdb_user_bytes_written,
+                            snapshot.rocksdb_flush_bytes_written,
+                            snapshot.rocksdb_compaction_bytes_written,
+                        );
                         if let Some(jemalloc) = jemalloc {
                             state.metrics.update_jemalloc_stats(
                                 jemalloc.allocated_bytes,
@@ -850,6 +915,22 @@ fn spawn_runtime_metrics_task(state: Arc<AppState>) {
     );
 }
 
+// Samples Tokio worker busy time and the runtime and blocking-pool queues.
+// Kept apart from the snapshot task, which itself waits on the blocking pool
+// and so would stop reporting exactly when the pool backs up.
+fn spawn_scheduler_metrics_task(state: Arc<AppState>) {
+    tokio::spawn(
+        async move {
+            let mut sampler = tasks::RuntimeSampler::new(tokio::runtime::Handle::current());
+            loop {
+                tokio::time::sleep(Duration::from_secs(1)).await;
+                sampler.sample(&state.metrics);
+            }
+        }
+        .in_current_span(),
+    );
+}
+
 /// Expires REAPI action-cache entries whose write time predates the TTL.
 /// Clients publish new keys on every source change and nothing else removes
 /// the stale ones, so this recency sweep is what bounds a namespace's
@@ -872,7 +953,7 @@ fn spawn_action_cache_blob_refs_backfill_task(state: Arc<AppState>) {
             loop {
                 state.memory.wait_for_background_headroom().await;
                 let backfill_state = state.clone();
-                let result = tokio::task::spawn_blocking(move || {
+                let result = tasks::spawn_blocking(move || {
                     backfill_state.store.backfill_action_cache_blob_refs_step()
                 })
                 .await;
@@ -931,9 +1012,7 @@ async fn backfill_index_task_loop(state: SharedState) {
         .max(1);
     loop {
         let build_state = state.clone();
-        match tokio::task::spawn_blocking(move || build_state.store.run_backfill_index_build())
-            .await
-        {
+        match tasks::spawn_blocking(move || build_state.store.run_backfill_index_build()).await {
             Ok(Ok(_)) => break,
             Ok(Err(error)) => warn!("backfill index build failed: {error}"),
             Err(error) => warn!("backfill index build task panicked: {error}"),
@@ -963,6 +1042,41 @@ async fn backfill_index_task_loop(state: SharedState) {
     }
 }
 
+// Holds serving back while the previous process's hot set is re-warmed (see
+// warm_restart). The gate clears even if the warm panics, so a bad hot set
+// can cost a cold start but never keep the node out of rotation.
+fn spawn_warm_restart_task(state: Arc<AppState>) {
+    struct FinishWarming(Arc<AppState>);
+
+    impl Drop for FinishWarming {
+        fn drop(&mut self) {
+            self.0.runtime.finish_warming();
+        }
+    }
+
+    state.runtime.begin_warming();
+    tokio::spawn(
+        async move {
+            let _finish = FinishWarming(state.clone());
+            crate::warm_restart::warm_from_hot_set(&state).await;
+        }
+        .in_current_span(),
+    );
+}
+
+// Anti-entropy between peers (see backfill::tree): repairs divergence the
+// window-bounded passes never reach. Supervised like the index task; a
+// restart just waits out one interval before the next round.
+fn spawn_backfill_reconcile_task(state: Arc<AppState>) {
+    spawn_supervised("backfill_reconcile", state, |state| async move {
+        let interval = Duration::from_millis(crate::constants::BACKFILL_RECONCILE_INTERVAL_MS);
+        loop {
+            tokio::time::sleep(interval).await;
+            state.backfill.reconcile_round(&state).await;
+        }
+    });
+}
+
 fn spawn_action_cache_expiry_task(state: Arc<AppState>) {
     use crate::constants::{
         REAPI_ACTION_CACHE_EXPIRY_INTERVAL_MS, REAPI_ACTION_CACHE_EXPIRY_MAX_DELETES,
@@ -975,7 +1089,7 @@ fn spawn_action_cache_expiry_task(state: Arc<AppState>) {
                 tokio::time::sleep(interval).await;
                 let sweep_state = state.clone();
                 let cutoff_ms = crate::utils::now_ms().saturating_sub(REAPI_ACTION_CACHE_TTL_MS);
-                let expired = tokio::task::spawn_blocking(move || {
+                let expired = tasks::spawn_blocking(move || {
                     sweep_state.store.expire_stale_action_cache_entries(
                         cutoff_ms,
                         REAPI_ACTION_CACHE_EXPIRY_MAX_DELETES,
@@ -1010,7 +1124,7 @@ fn spawn_multipart_janitor_task(state: Arc<AppState>) {
                 let cutoff_ms = now.saturating_sub(ttl_ms);
                 let scan_state = state.clone();
                 let scan_cursor = cursor.clone();
-                let page = tokio::task::spawn_blocking(move || {
+                let page = tasks::spawn_blocking(move || {
                     scan_state.store.multipart_uploads_older_than_bounded(
                         cutoff_ms,
                         scan_cursor.as_deref(),
@@ -1058,7 +1172,7 @@ fn spawn_tmp_dir_metrics_task(state: Arc<AppState>) {
             loop {
                 tokio::time::sleep(Duration::from_secs(30)).await;
                 let tmp_dir = state.config.tmp_dir.clone();
-                let bytes = tokio::task::spawn_blocking(move || directory_size_bytes(&tmp_dir))
+                let bytes = tasks::spawn_blocking(move || directory_size_bytes(&tmp_dir))
                     .await
                     .unwrap_or(0);
                 state.metrics.update_tmp_dir_bytes(bytes);
@@ -1180,6 +1294,7 @@ fn spawn_drain_signal_task(state: Arc<AppState>) {
                 if state.enter_draining() {
                     state.sync_runtime_metrics().await;
                     info!("received SIGUSR1, entering draining state");
+                    crate::warm_restart::persist_hot_set(&state).await;
                 }
             }
         }
@@ -1529,6 +1644,67 @@ mod tests {
         let _ = server.await;
     }
 
+    // Plaintext uploads with a Content-Length are spliced off the socket by
+    // the accelerated listener and land exactly as a Hyper upload would; a
+    // re-upload answers without reading its body.
+    #[cfg(target_os = "linux")]
+    #[tokio::test]
+    async fn accelerated_listener_splices_plaintext_uploads() {
+        let context = test_context(|_| {}).await;
+        let state = context.state.clone();
+        let listener = tokio::net::TcpListener::bind(SocketAddr::from((Ipv4Addr::LOCALHOST, 0)))
+            .await
+            .expect("bind accelerated test listener");
+        let addr = listener.local_addr().expect("accelerated listener address");
+        let (shutdown_tx, shutdown_rx) = watch::channel(false);
+        let server = tokio::spawn(accelerated_file_serving::serve_public_http(
+            listener,
+            cohosted_router(state.clone()),
+            state.clone(),
+            state.config.accelerated_file_serving.clone(),
+            shutdown_rx,
+            configure_http_builder,
+        ));
+        let url = format!(
+            "http://{addr}/api/cache/gradle/spliced-entry?tenant_id=test-tenant&namespace_id=android"
+        );
+        let body = (0..256 * 1024).map(|index| index as u8).collect::<Vec<_>>();
+        let client = reqwest::Client::new();
+
+        let uploaded = client
+            .put(&url)
+            .body(body.clone())
+            .send()
+            .await
+            .expect("spliced upload should complete");
+        assert_eq!(uploaded.status(), reqwest::StatusCode::CREATED);
+        let downloaded = client
+            .get(&url)
+            .send()
+            .await
+            .expect("download should complete");
+        assert_eq!(downloaded.status(), reqwest::StatusCode::OK);
+        assert_eq!(
+            downloaded.bytes().await.expect("download body").as_ref(),
+            body
+        );
+        let reuploaded = client
+            .put(&url)
+            .body(body.clone())
+            .send()
+            .await
+            .expect("re-upload should complete");
+        assert_eq!(reuploaded.status(), reqwest::StatusCode::OK);
+        assert!(
+            state.metrics.render().contains(
+                "kura_upload_body_bytes_total{producer=\"gradle\",path=\"spliced\"} 262144"
+            )
+        );
+
+        shutdown_tx.send(true).expect("signal shutdown");
+        let _ = server.await;
+    }
+
     // Same as above but over TLS (reusing the public cert): both HTTPS and REAPI
     // gRPC ride one TLS port, ALPN-negotiated (http/1.1 for HTTP, h2 for gRPC).
     #[tokio::test]
@@ -2,6 +2,7 @@ use serde::{Deserialize, Serialize};
 
 use crate::artifact::{
     metadata::ArtifactMetadata, producer::ArtifactProducer, storage_kind::StorageKind,
+    stored_encoding::StoredEncoding,
 };
 
 #[derive(Clone, Debug, Serialize, Deserialize, PartialEq, Eq)]
@@ -24,6 +25,8 @@ pub struct ArtifactManifest {
     pub created_at_ms: u64,
     #[serde(default, skip_serializing_if = "Option::is_none")]
     pub branch: Option<String>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub stored_encoding: Option<StoredEncoding>,
 }
 
 impl ArtifactManifest {
@@ -31,6 +34,12 @@ impl ArtifactManifest {
         self.segment_id.is_some()
     }
 
+    /// Bytes the body occupies in its segment or blob file.
+    pub fn stored_size(&self) -> u64 {
+        self.stored_encoding
+            .map_or(self.size, StoredEncoding::stored_size)
+    }
+
     pub fn logical_key(&self) -> &str {
         &self.key
     }
@@ -81,6 +90,8 @@ pub struct PersistedManifestRecord {
     pub created_at_ms: u64,
     #[serde(default, skip_serializing_if = "Option::is_none")]
     pub branch: Option<String>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub stored_encoding: Option<StoredEncoding>,
 }
 
 impl PersistedManifestRecord {
@@ -98,6 +109,7 @@ impl PersistedManifestRecord {
             version_ms: manifest.version_ms,
             created_at_ms: manifest.created_at_ms,
             branch: manifest.branch.clone(),
+            stored_encoding: manifest.stored_encoding,
         }
     }
 
@@ -116,6 +128,7 @@ impl PersistedManifestRecord {
             version_ms: self.version_ms,
             created_at_ms: self.created_at_ms,
             branch: self.branch,
+            stored_encoding: self.stored_encoding,
         })
     }
 }
@@ -142,6 +155,7 @@ mod tests {
             version_ms: 100,
             created_at_ms: 90,
             branch: None,
+            stored_encoding: None,
         };
 
         let metadata = manifest.metadata("acme");
@@ -172,6 +186,7 @@ mod tests {
             version_ms: 200,
             created_at_ms: 150,
             branch: None,
+            stored_encoding: None,
         };
 
         let restored = PersistedManifestRecord::from_manifest(&manifest)
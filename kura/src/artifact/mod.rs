@@ -3,3 +3,4 @@ pub mod metadata;
 pub mod producer;
 pub mod segment_location_record;
 pub mod storage_kind;
+pub mod stored_encoding;
@@ -1,6 +1,12 @@
-use crate::artifact::{manifest::ArtifactManifest, producer::ArtifactProducer};
+use crate::artifact::{
+    manifest::ArtifactManifest, producer::ArtifactProducer, stored_encoding::StoredEncoding,
+};
 
 const SEGMENT_LOCATION_RECORD_VERSION: u8 = 2;
+/// Version 2 followed by the stored encoding. Only written for bodies stored
+/// encoded, so every other record stays readable by binaries that predate it.
+const ENCODED_SEGMENT_LOCATION_RECORD_VERSION: u8 = 3;
+const ZSTD_ENCODING_CODE: u8 = 1;
 
 #[derive(Clone, Debug, PartialEq, Eq)]
 pub struct SegmentLocationRecord {
@@ -13,6 +19,7 @@ pub struct SegmentLocationRecord {
     pub size: u64,
     pub version_ms: u64,
     pub created_at_ms: u64,
+    pub stored_encoding: Option<StoredEncoding>,
 }
 
 impl SegmentLocationRecord {
@@ -35,6 +42,7 @@ impl SegmentLocationRecord {
             size: manifest.size,
             version_ms: manifest.version_ms,
             created_at_ms: manifest.created_at_ms,
+            stored_encoding: manifest.stored_encoding,
         })
     }
 
@@ -53,6 +61,7 @@ impl SegmentLocationRecord {
             version_ms: self.version_ms,
             created_at_ms: self.created_at_ms,
             branch: None,
+            stored_encoding: self.stored_encoding,
         })
     }
 
@@ -65,9 +74,14 @@ impl SegmentLocationRecord {
                 + self.key.len()
                 + self.content_type.len()
                 + self.segment_id.len()
-                + 16,
+                + 16
+                + 9,
         );
-        bytes.push(SEGMENT_LOCATION_RECORD_VERSION);
+        bytes.push(if self.stored_encoding.is_some() {
+            ENCODED_SEGMENT_LOCATION_RECORD_VERSION
+        } else {
+            SEGMENT_LOCATION_RECORD_VERSION
+        });
         bytes.push(producer_code(self.producer));
         bytes.extend_from_slice(&self.segment_offset.to_le_bytes());
         bytes.extend_from_slice(&self.size.to_le_bytes());
@@ -77,6 +91,10 @@ impl SegmentLocationRecord {
         push_string(&mut bytes, &self.key);
         push_string(&mut bytes, &self.content_type);
         push_string(&mut bytes, &self.segment_id);
+        if let Some(StoredEncoding::Zstd { stored_size }) = self.stored_encoding {
+            bytes.push(ZSTD_ENCODING_CODE);
+            bytes.extend_from_slice(&stored_size.to_le_bytes());
+        }
         bytes
     }
 
@@ -84,7 +102,9 @@ impl SegmentLocationRecord {
         let Some(version) = bytes.first().copied() else {
             return Ok(None);
         };
-        if version != SEGMENT_LOCATION_RECORD_VERSION {
+        if version != SEGMENT_LOCATION_RECORD_VERSION
+            && version != ENCODED_SEGMENT_LOCATION_RECORD_VERSION
+        {
             return Ok(None);
         }
         let mut cursor = 1;
@@ -97,6 +117,16 @@ impl SegmentLocationRecord {
         let key = read_string(bytes, &mut cursor)?;
         let content_type = read_string(bytes, &mut cursor)?;
         let segment_id = read_string(bytes, &mut cursor)?;
+        let stored_encoding = if version == ENCODED_SEGMENT_LOCATION_RECORD_VERSION {
+            match read_u8(bytes, &mut cursor)? {
+                ZSTD_ENCODING_CODE => Some(StoredEncoding::Zstd {
+                    stored_size: read_u64(bytes, &mut cursor)?,
+                }),
+                code => return Err(format!("invalid stored encoding code {code}")),
+            }
+        } else {
+            None
+        };
 
         Ok(Some(
             Self {
@@ -109,6 +139,7 @@ impl SegmentLocationRecord {
                 size,
                 version_ms,
                 created_at_ms,
+                stored_encoding,
             }
             .into_manifest(artifact_id)?,
         ))
@@ -192,7 +223,9 @@ fn read_string(bytes: &[u8], cursor: &mut usize) -> Result<String, String> {
 #[cfg(test)]
 mod tests {
     use super::SegmentLocationRecord;
-    use crate::artifact::{manifest::ArtifactManifest, producer::ArtifactProducer};
+    use crate::artifact::{
+        manifest::ArtifactManifest, producer::ArtifactProducer, stored_encoding::StoredEncoding,
+    };
 
     #[test]
     fn round_trips_segment_backed_manifest() {
@@ -210,6 +243,7 @@ mod tests {
             version_ms: 5678,
             created_at_ms: 1234,
             branch: None,
+            stored_encoding: None,
         };
 
         let record = SegmentLocationRecord::from_manifest(&manifest)
@@ -221,6 +255,41 @@ mod tests {
         assert_eq!(decoded, manifest);
     }
 
+    #[test]
+    fn only_encoded_bodies_use_the_encoded_record_version() {
+        let mut manifest = ArtifactManifest {
+            artifact_id: "artifact".into(),
+            producer: ArtifactProducer::Metro,
+            namespace_id: "metro".into(),
+            key: "bundle".into(),
+            content_type: "application/javascript".into(),
+            inline: false,
+            blob_path: None,
+            segment_id: Some("segment-1".into()),
+            segment_offset: Some(42),
+            size: 512,
+            version_ms: 5678,
+            created_at_ms: 1234,
+            branch: None,
+            stored_encoding: None,
+        };
+        let plain = SegmentLocationRecord::from_manifest(&manifest)
+            .expect("segment-backed manifest should encode")
+            .encode();
+        assert_eq!(plain[0], 2);
+
+        manifest.stored_encoding = Some(StoredEncoding::Zstd { stored_size: 100 });
+        let encoded = SegmentLocationRecord::from_manifest(&manifest)
+            .expect("segment-backed manifest should encode")
+            .encode();
+        assert_eq!(encoded[0], 3);
+        let decoded = SegmentLocationRecord::decode(&encoded, &manifest.artifact_id)
+            .expect("record should decode")
+            .expect("record should be present");
+        assert_eq!(decoded, manifest);
+        assert_eq!(decoded.stored_size(), 100);
+    }
+
     #[test]
     fn ignores_non_record_payloads() {
         assert!(
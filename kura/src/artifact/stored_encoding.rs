@@ -0,0 +1,24 @@
+use serde::{Deserialize, Serialize};
+
+/// How a segment-backed body is encoded at rest. A manifest without one
+/// stores its body as is; `size` is always the size of the decoded body.
+#[derive(Clone, Copy, Debug, Eq, PartialEq, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum StoredEncoding {
+    Zstd { stored_size: u64 },
+}
+
+impl StoredEncoding {
+    pub fn stored_size(self) -> u64 {
+        match self {
+            Self::Zstd { stored_size } => stored_size,
+        }
+    }
+
+    /// The `Content-Encoding` token of the stored bytes.
+    pub fn content_encoding(self) -> &'static str {
+        match self {
+            Self::Zstd { .. } => "zstd",
+        }
+    }
+}
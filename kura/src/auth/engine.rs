@@ -4,8 +4,14 @@
 //! Tuist's server has to be asked, so what the server (or the token) settles is
 //! held per credential and target as one access level, and concurrent requests
 //! for a level that is not held collapse into one consultation.
+//!
+//! A long-lived channel repeats the same question thousands of times, so a
+//! connection also keeps the levels it has already been allowed (see
+//! [`ConnectionAuth`]) and answers those without touching the shared caches.
 
-use std::sync::Arc;
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex as StdMutex};
 use std::time::{Duration, Instant};
 
 use moka::Expiry;
@@ -50,6 +56,11 @@ const CONFIRMED_TTL: Duration = Duration::from_secs(25 * 60);
 /// paying the full timeout.
 const UNAVAILABLE_BACKOFF: Duration = Duration::from_secs(3);
 
+/// How many targets one connection remembers. A build talks to one project,
+/// occasionally a handful; past this the connection starts over rather than
+/// growing with whatever a misbehaving client names.
+const CONNECTION_MAX_TARGETS: usize = 64;
+
 const _: () = assert!(REFUSAL_TTL.as_secs() <= REVALIDATE_AFTER.as_secs());
 const _: () = assert!(REVALIDATE_AFTER.as_secs() < CONFIRMED_TTL.as_secs());
 
@@ -80,6 +91,78 @@ impl AccessEntry {
     fn settles_refusals(&self, now: Instant) -> bool {
         now < self.settled_until
     }
+
+    /// Until when a connection may go on allowing what this entry allows: the
+    /// serving deadline, or the entry's own end of life if that comes first.
+    fn connection_deadline(&self) -> Instant {
+        self.serve_until.min(self.evaluated_at + self.lifetime)
+    }
+}
+
+/// The levels one connection has been allowed, so the requests a long-lived
+/// channel repeats skip the fingerprint, the shared caches and the policy.
+///
+/// Only allows are held, each until its entry would have stopped serving it,
+/// and each stamped with the engine's generation: a revocation, a stored
+/// refusal, or a cleared cache moves the generation on and every connection
+/// falls back to the full path, which re-checks the marker. A grant therefore
+/// never outlives what the shared entry would have answered.
+///
+/// Created per accepted connection and handed to the transports as a request
+/// extension.
+#[derive(Default)]
+pub struct ConnectionAuth {
+    grants: StdMutex<HashMap<String, ConnectionGrant>>,
+}
+
+struct ConnectionGrant {
+    /// The raw authorization header, compared rather than hashed: a client may
+    /// change credentials mid-connection, and that must miss.
+    credential: String,
+    access: Access,
+    valid_until: Instant,
+    generation: u64,
+}
+
+impl ConnectionAuth {
+    fn allows(
+        &self,
+        credential: &str,
+        target_key: &str,
+        required: Access,
+        generation: u64,
+        now: Instant,
+    ) -> bool {
+        let grants = self
+            .grants
+            .lock()
+            .unwrap_or_else(|error| error.into_inner());
+        grants.get(target_key).is_some_and(|grant| {
+            grant.generation == generation
+                && grant.access >= required
+                && now < grant.valid_until
+                && grant.credential == credential
+        })
+    }
+
+    fn grant(&self, credential: &str, target_key: String, entry: &AccessEntry, generation: u64) {
+        let mut grants = self
+            .grants
+            .lock()
+            .unwrap_or_else(|error| error.into_inner());
+        if grants.len() >= CONNECTION_MAX_TARGETS && !grants.contains_key(&target_key) {
+            grants.clear();
+        }
+        grants.insert(
+            target_key,
+            ConnectionGrant {
+                credential: credential.to_owned(),
+                access: entry.access,
+                valid_until: entry.connection_deadline(),
+                generation,
+            },
+        );
+    }
 }
 
 struct EntryExpiry;
@@ -204,6 +287,11 @@ pub struct AuthEngine {
     /// Presence holds the next attempt off, so an outage costs one probe per
     /// credential per backoff window rather than one per cold target.
     unreachable: Cache<String, ()>,
+    /// Moves on whenever something held might have been voided — a
+    /// revocation, a stored refusal, a cleared cache — so connection grants
+    /// stamped with an older value are not trusted. Coarse on purpose: those
+    /// events are rare next to the requests a grant answers.
+    generation: AtomicU64,
     metrics: Metrics,
 }
 
@@ -254,11 +342,23 @@ impl AuthEngine {
                 .eviction_policy(EvictionPolicy::lru())
                 .time_to_live(UNAVAILABLE_BACKOFF)
                 .build(),
+            generation: AtomicU64::new(0),
             metrics,
         })
     }
 
     pub async fn evaluate_access(&self, ctx: &RequestContext) -> AccessDecision {
+        self.evaluate_access_on_connection(ctx, None).await
+    }
+
+    /// [`Self::evaluate_access`], first asking what the connection the request
+    /// arrived on has already been allowed, and recording what it is allowed
+    /// now for the next request on it.
+    pub async fn evaluate_access_on_connection(
+        &self,
+        ctx: &RequestContext,
+        connection: Option<&ConnectionAuth>,
+    ) -> AccessDecision {
         // Resolved once, then read by the key, the entry check, and the policy
         // alike. Resolving it separately in each is how the key and the policy
         // came to disagree about which project a request named.
@@ -267,18 +367,90 @@ impl AuthEngine {
             Err(deny) => return AccessDecision::Deny(deny),
         };
         let required = Access::required(&request.action);
-        let credential_key = fingerprint(&credentials(ctx));
+        // Read before anything shared is consulted, so a revocation that lands
+        // while this request is in flight leaves its grant already stale.
+        let generation = self.generation.load(Ordering::Acquire);
+        let connection = connection.map(|connection| (connection, target_key(&request.target)));
+        if let Some((connection, target_key)) = &connection
+            && connection.allows(
+                credential(ctx),
+                target_key,
+                required,
+                generation,
+                Instant::now(),
+            )
+        {
+            self.metrics.record_auth_cache("connection", "hit");
+            return AccessDecision::Allow;
+        }
+
+        let credential_key = fingerprint(&credential(ctx));
         let entry_key = entry_key(&credential_key, &request.target);
 
         let start = Instant::now();
-        let outcome = self
-            .answer(ctx, &request, required, credential_key, entry_key)
-            .await;
+        let outcome = match connection {
+            Some((connection, target_key)) => {
+                let outcome = self
+                    .answer(
+                        ctx,
+                        &request,
+                        required,
+                        credential_key.clone(),
+                        entry_key.clone(),
+                    )
+                    .await;
+                if matches!(outcome, Outcome::Allow) {
+                    self.grant_connection(
+                        connection,
+                        ctx,
+                        target_key,
+                        &entry_key,
+                        &credential_key,
+                        required,
+                        generation,
+                    )
+                    .await;
+                }
+                outcome
+            }
+            None => {
+                self.answer(ctx, &request, required, credential_key, entry_key)
+                    .await
+            }
+        };
         self.metrics
             .record_auth_decision("decide", outcome.label(), start.elapsed());
         outcome.into_access()
     }
 
+    /// Hands the connection the entry that just allowed its request, if that
+    /// entry is still serving — an allow answered stale during an outage, or
+    /// one that was not held at all, is not something to repeat unasked.
+    #[allow(clippy::too_many_arguments)]
+    async fn grant_connection(
+        &self,
+        connection: &ConnectionAuth,
+        ctx: &RequestContext,
+        target_key: String,
+        entry_key: &str,
+        credential_key: &str,
+        required: Access,
+        generation: u64,
+    ) {
+        let Some(entry) = self.valid_entry(entry_key, credential_key).await else {
+            return;
+        };
+        if entry.access >= required && entry.serves(Instant::now()) {
+            connection.grant(credential(ctx), target_key, &entry, generation);
+            self.metrics.record_auth_cache("connection", "miss");
+        }
+    }
+
+    /// Voids every connection grant handed out so far.
+    fn advance_generation(&self) {
+        self.generation.fetch_add(1, Ordering::AcqRel);
+    }
+
     async fn answer(
         &self,
         ctx: &RequestContext,
@@ -357,6 +529,9 @@ impl AuthEngine {
                         .insert(credential_key, Instant::now())
                         .await;
                 }
+                if access < Access::Read {
+                    self.advance_generation();
+                }
                 self.remember(entry_key, access, ctx).await;
                 respond(access, required, request)
             }
@@ -433,6 +608,7 @@ impl AuthEngine {
         // Approximate, and only used to decide whether anything was worth
         // reporting; the caches are performance state, not correctness state.
         let held = self.entries.entry_count();
+        self.advance_generation();
         self.entries.invalidate_all();
         self.consultations.invalidate_all();
         self.revocations.invalidate_all();
@@ -449,7 +625,7 @@ impl AuthEngine {
         ctx: &RequestContext,
     ) -> tokio::sync::OwnedMutexGuard<()> {
         let request = policy::resolve_request(ctx).expect("a resolvable request");
-        let credential_key = fingerprint(&credentials(ctx));
+        let credential_key = fingerprint(&credential(ctx));
         self.consultations
             .get_with(entry_key(&credential_key, &request.target), async {
                 Arc::new(Mutex::new(()))
@@ -464,7 +640,7 @@ impl AuthEngine {
     #[cfg(test)]
     pub(crate) async fn clear_unavailable_backoff(&self, ctx: &RequestContext) {
         self.unreachable
-            .invalidate(&fingerprint(&credentials(ctx)))
+            .invalidate(&fingerprint(&credential(ctx)))
             .await;
     }
 
@@ -474,8 +650,9 @@ impl AuthEngine {
     #[cfg(test)]
     pub(crate) async fn expire_serving_deadline(&self, ctx: &RequestContext) {
         let request = policy::resolve_request(ctx).expect("a resolvable request");
-        let credential_key = fingerprint(&credentials(ctx));
+        let credential_key = fingerprint(&credential(ctx));
         let key = entry_key(&credential_key, &request.target);
+        self.advance_generation();
 
         if let Some(entry) = self.entries.get(&key).await {
             let now = Instant::now();
@@ -522,12 +699,17 @@ fn entry_key(credential_key: &str, target: &crate::auth::target::RequestTarget)
     )
 }
 
-fn credentials(ctx: &RequestContext) -> String {
+/// The target half of [`entry_key`], which is all a connection needs: the
+/// credential is compared as it arrived.
+fn target_key(target: &crate::auth::target::RequestTarget) -> String {
+    format!("{}:{}", target.scope.key(), target.identifier)
+}
+
+fn credential(ctx: &RequestContext) -> &str {
     ctx.headers
         .get("authorization")
         .or_else(|| ctx.headers.get("Authorization"))
-        .cloned()
-        .unwrap_or_default()
+        .map_or("", String::as_str)
 }
 
 fn fingerprint<T: Serialize>(value: &T) -> String {
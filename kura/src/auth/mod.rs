@@ -17,7 +17,7 @@ mod policy_tests;
 pub mod target;
 pub mod tuist;
 
-pub use engine::{AuthEngine, SharedAuth};
+pub use engine::{AuthEngine, ConnectionAuth, SharedAuth};
 
 /// What a credential may do to one target, as one ordered level.
 ///
@@ -25,7 +25,7 @@ use super::tuist::test_keys::{
     PUBLIC_KEY as CACHE_TOKEN_PUBLIC_KEY, ROTATED_SIGNING_KEY, SIGNING_KEY,
 };
 use super::tuist::{IntrospectionCredentials, JwtVerifier};
-use super::{AccessDecision, AuthEngine, DenyDecision, RequestContext, SharedAuth};
+use super::{AccessDecision, AuthEngine, ConnectionAuth, DenyDecision, RequestContext, SharedAuth};
 use crate::metrics::Metrics;
 
 const GUARDIAN_SECRET: &str = "tuist-guardian-secret";
@@ -2005,3 +2005,166 @@ async fn a_settled_target_is_answered_while_another_is_being_consulted() {
 
     drop(consulting);
 }
+
+fn opaque_project_request(name: &str) -> RequestContext {
+    let mut context = ctx();
+    context.tenant_id = Some("acme".into());
+    context.namespace_id = Some(name.into());
+    context
+        .headers
+        .insert("authorization".into(), "Bearer opaque-token".into());
+    context
+}
+
+// A gRPC channel asks the same question for every blob of a build. Once the
+// connection has been allowed, the repeats are answered from it; a cleared
+// cache or a different credential on the same connection goes back through
+// the shared path and, from there, to the server.
+#[tokio::test]
+async fn a_connection_answers_its_repeats_until_the_caches_are_cleared() {
+    let calls = Arc::new(Mutex::new(0usize));
+    let calls_for_handler = calls.clone();
+    let base = spawn_tuist_auth_mock(
+        move |_headers, _payload| {
+            *calls_for_handler.lock().unwrap() += 1;
+            (
+                StatusCode::OK,
+                introspection_payload(cache_grants_payload(&[], &[], &["acme/ios"], &[])),
+            )
+        },
+        |_| (StatusCode::OK, cache_access_payload(&[], &[])),
+    )
+    .await;
+    let metrics = Metrics::new("test".into(), "tenant".into());
+    let engine = engine_with_metrics(
+        AuthConfig {
+            base_url: base.clone(),
+            connect_timeout: Duration::from_millis(500),
+            request_timeout: Duration::from_millis(4000),
+            verifier: None,
+            introspection: Some(introspection_credentials()),
+            cache_max_entries: 1000,
+        },
+        metrics.clone(),
+    );
+    let connection = ConnectionAuth::default();
+    let context = opaque_project_request("ios");
+
+    for _ in 0..3 {
+        assert!(matches!(
+            engine
+                .evaluate_access_on_connection(&context, Some(&connection))
+                .await,
+            AccessDecision::Allow
+        ));
+    }
+    assert_eq!(*calls.lock().unwrap(), 1);
+    let rendered = metrics.render();
+    assert!(
+        rendered
+            .lines()
+            .any(|line| line.starts_with("kura_auth_cache_total")
+                && line.contains("cache=\"connection\"")
+                && line.contains("result=\"hit\"")
+                && line.ends_with(" 2")),
+        "expected two connection hits, got:\n{rendered}"
+    );
+
+    // A read-only level does not answer a write, on the connection or off it.
+    let mut write = context.clone();
+    write.method = "PUT".into();
+    write.operation = "artifact.write".into();
+    let deny = expect_deny(
+        engine
+            .evaluate_access_on_connection(&write, Some(&connection))
+            .await,
+    );
+    assert_eq!(deny.status, 403);
+
+    engine.clear_caches().await;
+    assert!(matches!(
+        engine
+            .evaluate_access_on_connection(&context, Some(&connection))
+            .await,
+        AccessDecision::Allow
+    ));
+    assert_eq!(*calls.lock().unwrap(), 2);
+
+    let mut other_credential = context.clone();
+    other_credential
+        .headers
+        .insert("authorization".into(), "Bearer another-token".into());
+    assert!(matches!(
+        engine
+            .evaluate_access_on_connection(&other_credential, Some(&connection))
+            .await,
+        AccessDecision::Allow
+    ));
+    assert_eq!(*calls.lock().unwrap(), 3);
+}
+
+// The connection counterpart of the revocation above: a 401 for any target
+// voids what every connection was allowed, not only the shared entries.
+#[tokio::test]
+async fn a_revoked_credential_stops_being_served_by_its_connection() {
+    let revoked = Arc::new(AtomicBool::new(false));
+    let revoked_for_introspect = revoked.clone();
+    let revoked_for_cache = revoked.clone();
+    let base = spawn_tuist_auth_mock(
+        move |_headers, _payload| {
+            if revoked_for_introspect.load(Ordering::SeqCst) {
+                (StatusCode::OK, json!({ "active": false }))
+            } else {
+                (
+                    StatusCode::OK,
+                    introspection_payload(cache_grants_payload(
+                        &[],
+                        &[],
+                        &["acme/ios"],
+                        &["acme/ios"],
+                    )),
+                )
+            }
+        },
+        move |_| {
+            if revoked_for_cache.load(Ordering::SeqCst) {
+                (StatusCode::UNAUTHORIZED, json!({}))
+            } else {
+                (StatusCode::OK, cache_access_payload(&[], &[]))
+            }
+        },
+    )
+    .await;
+    let engine = engine_pointing_at(&base, true);
+    let connection = ConnectionAuth::default();
+
+    for _ in 0..2 {
+        assert!(matches!(
+            engine
+                .evaluate_access_on_connection(&opaque_project_request("ios"), Some(&connection))
+                .await,
+            AccessDecision::Allow
+        ));
+    }
+    revoked.store(true, Ordering::SeqCst);
+
+    // Asked about on another connection entirely.
+    assert_eq!(
+        expect_deny(
+            engine
+                .evaluate_access(&opaque_project_request("android"))
+                .await
+        )
+        .status,
+        401
+    );
+    assert_eq!(
+        expect_deny(
+            engine
+                .evaluate_access_on_connection(&opaque_project_request("ios"), Some(&connection))
+                .await
+        )
+        .status,
+        401
+    );
+}
@@ -29,14 +29,18 @@ use tracing::{Instrument, info, warn};
 use crate::{
     backfill::{
         claims::ClaimSet,
-        pass::{BackfillPassOutcome, BackfillPassTuning, run_backfill_pass_with_tuning},
-        window::{advance_watermark, compute_window},
+        pass::{
+            BackfillPassEnd, BackfillPassOutcome, BackfillPassTuning,
+            run_backfill_pass_with_tuning, run_reconcile_pass_with_tuning,
+        },
+        tree::{BackfillTree, BackfillTreeCache, TreeBounds, settled_bound_ms},
+        window::{advance_watermark, compute_window, horizon_version_ms},
     },
     constants::{
         BACKFILL_CAP_POLL_INTERVAL_MS, BACKFILL_INITIAL_CYCLE_FAILURE_BUDGET,
         BACKFILL_NOT_CAPABLE_WAIT_CAP_MS, BACKFILL_PASS_RETRY_BACKOFF_BASE_MS,
-        BACKFILL_PASS_RETRY_BACKOFF_MAX_MS, BACKFILL_RETRYABLE_WAIT_CAP_MS,
-        BACKFILL_SEAM_FOLLOWUP_DELAY_MS,
+        BACKFILL_PASS_RETRY_BACKOFF_MAX_MS, BACKFILL_RECONCILE_PASS_CAP_MS,
+        BACKFILL_RETRYABLE_WAIT_CAP_MS, BACKFILL_SEAM_FOLLOWUP_DELAY_MS,
     },
     state::{MembershipUpdate, SharedState},
     utils::now_ms,
@@ -578,6 +582,9 @@ pub struct BackfillLifecycle {
     /// Whether the last tick had scheduled work blocked by memory admission,
     /// so the transition is logged once instead of at membership cadence.
     admission_gated: AtomicBool,
+    /// This node's anti-entropy tree, shared by its own reconciles and the
+    /// tree endpoints peers reconcile against.
+    tree: BackfillTreeCache,
 }
 
 impl BackfillLifecycle {
@@ -588,9 +595,69 @@ impl BackfillLifecycle {
             claims: ClaimSet::new(),
             watermark_gauge_peers: Mutex::new(BTreeSet::new()),
             admission_gated: AtomicBool::new(false),
+            tree: BackfillTreeCache::default(),
         })
     }
 
+    pub fn tree(&self) -> &BackfillTreeCache {
+        &self.tree
+    }
+
+    /// One anti-entropy round, at `BACKFILL_RECONCILE_INTERVAL_MS` cadence:
+    /// reconciles this node's tree against each peer in view, one peer at a
+    /// time. Rounds sit out the initial cycle (the window passes are already
+    /// walking every peer) and memory pressure, and skip a peer whose window
+    /// pass is running; reconciles register on the same claim set, so one
+    /// racing a newly spawned pass still never fetches a tuple twice.
+    pub async fn reconcile_round(self: &Arc<Self>, app: &SharedState) {
+        if self.cycle_snapshot().is_backfilling() || !app.memory.allow_background_admission() {
+            return;
+        }
+        let peers = self.lock_machine().present_peers();
+        if peers.is_empty() {
+            return;
+        }
+        for peer in peers {
+            if self.lock_passes().contains_key(&peer) {
+                app.metrics
+                    .record_backfill_reconcile("skipped_pass_running");
+                continue;
+            }
+            // Fetched per peer so a long round does not compare against a
+            // tree older than the TTL; within the TTL this is a cache hit.
+            // Bounded below by this node's ring horizon and above by the
+            // settle bound, which the peer's tree then uses too.
+            let bounds = TreeBounds {
+                min_version_ms: horizon_version_ms(
+                    &app.store.backfill_age_ordered_stats(),
+                    app.store.backfill_capacity_inputs().ring_total_segments,
+                    app.config.backfill_margin_percent,
+                ),
+                max_version_ms: Some(settled_bound_ms(now_ms())),
+            };
+            let local = match self.tree.current(app, bounds).await {
+                Ok(tree) => tree,
+                Err(error) => {
+                    warn!(
+                        error,
+                        "failed to build backfill tree; skipping reconcile round"
+                    );
+                    app.metrics.record_backfill_reconcile("tree_failed");
+                    return;
+                }
+            };
+            let result = run_capped_reconcile_pass(
+                app,
+                &peer,
+                local,
+                &self.claims,
+                Duration::from_millis(BACKFILL_RECONCILE_PASS_CAP_MS),
+            )
+            .await;
+            app.metrics.record_backfill_reconcile(result);
+        }
+    }
+
     // The three lock helpers below recover from poisoning instead of
     // propagating it: `evaluate` runs inside the supervised membership loop,
     // so a poisoned lock would panic every restart and take peer discovery
@@ -930,6 +997,56 @@ async fn run_managed_pass_with_cap(
     }
 }
 
+/// Runs one reconcile pass under a wall-clock cap and returns its metric
+/// result. Reconcile outcomes never touch the failure budget or the
+/// watermark: the next round simply tries again.
+async fn run_capped_reconcile_pass(
+    app: &SharedState,
+    peer: &str,
+    local: Arc<BackfillTree>,
+    claims: &Arc<ClaimSet>,
+    cap: Duration,
+) -> &'static str {
+    let cancel = CancellationToken::new();
+    let guard = claims.register_pass();
+    let tuning = BackfillPassTuning::from_config(&app.config);
+    let mut pass = pin!(run_reconcile_pass_with_tuning(
+        app, peer, local, guard, &cancel, tuning
+    ));
+    let outcome = tokio::select! {
+        outcome = &mut pass => outcome,
+        () = tokio::time::sleep(cap) => {
+            cancel.cancel();
+            pass.as_mut().await
+        }
+    };
+    match outcome {
+        BackfillPassOutcome::Completed {
+            end: BackfillPassEnd::TreeUnavailable,
+            ..
+        } => "unavailable",
+        BackfillPassOutcome::Completed { stats, .. } if stats.leaves_mismatched == 0 => "converged",
+        BackfillPassOutcome::Completed { stats, .. } => {
+            info!(
+                peer,
+                leaves_mismatched = stats.leaves_mismatched,
+                applied = stats.bodies_applied,
+                tombstones = stats.tombstones_applied,
+                "backfill reconcile repaired divergence"
+            );
+            "repaired"
+        }
+        BackfillPassOutcome::Failed { error, .. } => {
+            warn!(peer, error, "backfill reconcile pass failed");
+            "failed"
+        }
+        BackfillPassOutcome::Cancelled { .. } => {
+            warn!(peer, "backfill reconcile pass exceeded its wall-clock cap");
+            "cancelled"
+        }
+    }
+}
+
 /// Resolves when the pass's cumulative budget-exempt backoff crosses the cap.
 async fn watch_retryable_wait_cap(waited_ms: &AtomicU64, cap: Duration, poll: Duration) {
     loop {
@@ -5,4 +5,5 @@
 pub mod claims;
 pub mod lifecycle;
 pub mod pass;
+pub mod tree;
 pub mod window;
@@ -27,12 +27,14 @@ use crate::{
     artifact::producer::ArtifactProducer,
     backfill::{
         claims::{ClaimKey, ListDecision, PassClaimGuard},
+        tree::{BackfillTree, TREE_FANOUT, TreeBounds, children, decode_digest},
         window::{BackfillWindow, capacity_complete},
     },
     config::Config,
     constants::{
         BACKFILL_BATCH_FLUSH_INTERVAL_MS, BACKFILL_BODIES_BATCH_BYTES, BACKFILL_FETCH_QUEUE_TUPLES,
-        BACKFILL_RETRY_BACKOFF_BASE_MS, BACKFILL_RETRY_BACKOFF_MAX_MS, MAX_BACKFILL_BODIES_ENTRIES,
+        BACKFILL_RETRY_BACKOFF_BASE_MS, BACKFILL_RETRY_BACKOFF_MAX_MS,
+        BACKFILL_TREE_LEAVES_PER_REQUEST, MAX_BACKFILL_BODIES_ENTRIES,
         MAX_INLINE_REPLICATION_BODY_BYTES, MAX_PEER_PAGE_BYTES, MAX_PEER_PAGE_ITEMS,
         MAX_REPLICATION_BODY_BYTES,
     },
@@ -41,7 +43,8 @@ use crate::{
     http::{
         BACKFILL_ERROR_INDEX_BUILDING, BACKFILL_ERROR_PEER_BUSY,
         BACKFILL_ERROR_TMP_BUDGET_EXHAUSTED, BackfillBodiesRequest, BackfillBodyDisposition,
-        BackfillBodyFramePrelude, BackfillEntriesPage, BackfillEntry, BackfillUnavailable,
+        BackfillBodyFramePrelude, BackfillEntriesPage, BackfillEntry, BackfillTreeEntriesRequest,
+        BackfillTreeNodes, BackfillTreeNodesRequest, BackfillUnavailable,
         read_backfill_body_frame_prelude,
     },
     replication::{read_bounded_body, stream_response_to_temp},
@@ -71,6 +74,11 @@ pub enum BackfillPassEnd {
     /// The peer's listing ran out before the bound (unbounded window, or a
     /// peer holding nothing older than the bound).
     PeerExhausted,
+    /// A reconcile pass compared trees and listed every mismatched leaf.
+    TreeReconciled,
+    /// A reconcile pass found the peer without the tree routes (404) and
+    /// stopped without listing; the window pass still covers it.
+    TreeUnavailable,
 }
 
 /// Cumulative counters of one pass, returned with every outcome. The
@@ -96,6 +104,8 @@ pub struct BackfillPassStats {
     pub individual_fetches: u64,
     pub tombstones_applied: u64,
     pub bytes_applied: u64,
+    /// Leaves whose digests disagreed in a reconcile pass.
+    pub leaves_mismatched: u64,
     /// Total time slept in budget-exempt retry backoffs.
     pub retryable_wait: Duration,
     /// The share of `retryable_wait` spent in the capability classes
@@ -194,10 +204,44 @@ pub async fn run_backfill_pass_with_tuning(
         min_version_ms = window.min_version_ms,
         "backfill pass started"
     );
+    run_pass(state, peer, Listing::Window(window), guard, cancel, tuning).await
+}
+
+/// Runs one anti-entropy reconcile over `peer`: instead of walking the
+/// peer's listing inside a window, the lister compares `local` against the
+/// peer's tree top-down and lists only the rows of leaves that disagree.
+/// Everything past listing (presence pre-check, claims, bodies, apply) is
+/// the window pass's, so a reconcile and a window pass over the same peer
+/// share one claim set and never fetch a tuple twice.
+pub async fn run_reconcile_pass_with_tuning(
+    state: &SharedState,
+    peer: &str,
+    local: Arc<BackfillTree>,
+    guard: PassClaimGuard,
+    cancel: &CancellationToken,
+    tuning: BackfillPassTuning,
+) -> BackfillPassOutcome {
+    tracing::info!(peer, "backfill reconcile pass started");
+    run_pass(state, peer, Listing::Tree(local), guard, cancel, tuning).await
+}
+
+/// Where a pass's listing comes from.
+enum Listing {
+    Window(BackfillWindow),
+    Tree(Arc<BackfillTree>),
+}
+
+async fn run_pass(
+    state: &SharedState,
+    peer: &str,
+    listing: Listing,
+    guard: PassClaimGuard,
+    cancel: &CancellationToken,
+    tuning: BackfillPassTuning,
+) -> BackfillPassOutcome {
     let context = PassContext {
         state,
         peer,
-        window,
         guard: &guard,
         cancel,
         tuning: &tuning,
@@ -221,8 +265,14 @@ pub async fn run_backfill_pass_with_tuning(
     // never blocks sending while the fetcher is blocked handing off a batch
     // (a bounded bounce channel could deadlock that cycle).
     let (bounce_tx, bounce_rx) = mpsc::unbounded_channel();
+    let listed = async {
+        match &listing {
+            Listing::Window(window) => list_entries(&context, window, queue_tx).await,
+            Listing::Tree(local) => reconcile_entries(&context, local, queue_tx).await,
+        }
+    };
     let result = tokio::try_join!(
-        list_entries(&context, queue_tx),
+        listed,
         fetch_bodies(&context, queue_rx, apply_tx, bounce_rx),
         apply_batches(&context, apply_rx, bounce_tx),
     );
@@ -241,6 +291,7 @@ pub async fn run_backfill_pass_with_tuning(
                 absent = stats.bodies_absent,
                 tombstones = stats.tombstones_applied,
                 bytes = stats.bytes_applied,
+                leaves_mismatched = stats.leaves_mismatched,
                 "backfill pass completed"
             );
             BackfillPassOutcome::Completed {
@@ -273,7 +324,6 @@ enum PassAbort {
 struct PassContext<'a> {
     state: &'a SharedState,
     peer: &'a str,
-    window: BackfillWindow,
     guard: &'a PassClaimGuard,
     cancel: &'a CancellationToken,
     tuning: &'a BackfillPassTuning,
@@ -343,6 +393,7 @@ struct QueuedFetch {
 
 async fn list_entries(
     context: &PassContext<'_>,
+    window: &BackfillWindow,
     queue: mpsc::Sender<QueuedFetch>,
 ) -> Result<BackfillPassEnd, PassAbort> {
     let mut after: Option<String> = None;
@@ -358,7 +409,7 @@ async fn list_entries(
             // version-ordered stream, so exempting a kind means walking to the
             // peer's oldest entry every pass. See `compute_window` for why the
             // residual is acceptable.
-            if let Some(min_version_ms) = context.window.min_version_ms
+            if let Some(min_version_ms) = window.min_version_ms
                 && entry.version_ms < min_version_ms
             {
                 return Ok(BackfillPassEnd::WindowBound);
@@ -382,6 +433,187 @@ async fn list_entries(
     }
 }
 
+/// The reconcile lister: descends both trees from the root to the depth
+/// `local` is sized for, asking the peer only for the children of nodes that
+/// disagreed, then lists the rows of every mismatched leaf through
+/// [`list_entry`]. Rows the two sides share are listed too (a leaf is the
+/// unit of exchange) and fall out at the presence pre-check, as do rows this
+/// node holds newer.
+async fn reconcile_entries(
+    context: &PassContext<'_>,
+    local: &BackfillTree,
+    queue: mpsc::Sender<QueuedFetch>,
+) -> Result<BackfillPassEnd, PassAbort> {
+    let depth = local.depth();
+    let TreeBounds {
+        min_version_ms,
+        max_version_ms,
+    } = local.bounds();
+    let mut frontier = vec![0_usize];
+    for level in 0..=depth {
+        let request = BackfillTreeNodesRequest {
+            level,
+            indices: frontier,
+            min_version_ms,
+            max_version_ms,
+            depth: Some(depth),
+        };
+        let Some(remote) = post_tree_request::<_, BackfillTreeNodes>(
+            context,
+            "/_internal/backfill/tree/nodes",
+            "backfill_tree_nodes",
+            &request,
+        )
+        .await?
+        else {
+            return Ok(BackfillPassEnd::TreeUnavailable);
+        };
+        if remote.fanout != TREE_FANOUT
+            || remote.depth != depth
+            || remote.digests.len() != request.indices.len()
+        {
+            return Err(PassAbort::Hard(format!(
+                "peer backfill tree has a different shape (fanout {}, depth {}, {} digests for {} nodes)",
+                remote.fanout,
+                remote.depth,
+                remote.digests.len(),
+                request.indices.len()
+            )));
+        }
+        let mut mismatched = Vec::new();
+        for (&index, digest) in request.indices.iter().zip(&remote.digests) {
+            let digest = decode_digest(digest).map_err(PassAbort::Hard)?;
+            if local.node(level, index) != Some(digest) {
+                mismatched.push(index);
+            }
+        }
+        frontier = if level == depth {
+            mismatched
+        } else {
+            mismatched.into_iter().flat_map(children).collect()
+        };
+        if frontier.is_empty() {
+            return Ok(BackfillPassEnd::TreeReconciled);
+        }
+    }
+
+    let leaves = frontier;
+    context
+        .state
+        .metrics
+        .record_backfill_reconcile_leaves(leaves.len() as u64);
+    context.update_stats(|stats| stats.leaves_mismatched += leaves.len() as u64);
+    for chunk in leaves.chunks(BACKFILL_TREE_LEAVES_PER_REQUEST) {
+        let mut after: Option<String> = None;
+        loop {
+            let request = BackfillTreeEntriesRequest {
+                leaves: chunk.to_vec(),
+                min_version_ms,
+                max_version_ms,
+                depth: Some(depth),
+                after: after.take(),
+                limit: Some(context.tuning.page_limit),
+            };
+            let Some(page) = post_tree_request::<_, BackfillEntriesPage>(
+                context,
+                "/_internal/backfill/tree/entries",
+                "backfill_tree_entries",
+                &request,
+            )
+            .await?
+            else {
+                return Ok(BackfillPassEnd::TreeUnavailable);
+            };
+            context.state.metrics.record_backfill_listing_page();
+            context.update_stats(|stats| stats.pages_listed += 1);
+            for entry in &page.entries {
+                if context.cancel.is_cancelled() {
+                    return Err(PassAbort::Cancelled);
+                }
+                let Some(kind) = BackfillRecordKind::from_wire_name(&entry.record_kind) else {
+                    continue;
+                };
+                list_entry(context, &queue, kind, entry).await?;
+            }
+            match page.next_after {
+                Some(next) => after = Some(next),
+                None => break,
+            }
+        }
+    }
+    Ok(BackfillPassEnd::TreeReconciled)
+}
+
+/// POSTs one tree request with the pass's retry classes. `None` when the
+/// peer answers 404: it predates the tree routes, and unlike the window
+/// listing there is nothing to wait out, so the reconcile just ends.
+async fn post_tree_request<Req, Resp>(
+    context: &PassContext<'_>,
+    path: &str,
+    label: &'static str,
+    request: &Req,
+) -> Result<Option<Resp>, PassAbort>
+where
+    Req: serde::Serialize,
+    Resp: serde::de::DeserializeOwned,
+{
+    let body = serde_json::to_vec(request)
+        .map_err(|error| PassAbort::Hard(format!("failed to encode {label} request: {error}")))?;
+    let url = format!("{}{path}", context.peer);
+    let mut attempt = 0_u32;
+    loop {
+        let started = Instant::now();
+        let response = cancellable(
+            context,
+            context
+                .state
+                .client()
+                .post(&url)
+                .header(reqwest::header::CONTENT_TYPE, "application/json")
+                .body(body.clone())
+                .send(),
+        )
+        .await?
+        .map_err(|error| PassAbort::Hard(format!("{label} request failed: {error:?}")))?;
+        match classify_backfill_response(response, label)
+            .await
+            .map_err(PassAbort::Hard)?
+        {
+            RequestDisposition::Success(response) => {
+                let bytes = read_bounded_body(response, MAX_PEER_PAGE_BYTES, label)
+                    .await
+                    .map_err(PassAbort::Hard)?;
+                let decoded = serde_json::from_slice(&bytes).map_err(|error| {
+                    PassAbort::Hard(format!("failed to decode {label} response: {error}"))
+                })?;
+                context.state.metrics.record_replication(
+                    context.peer,
+                    label,
+                    "ok",
+                    started.elapsed(),
+                );
+                return Ok(Some(decoded));
+            }
+            RequestDisposition::Retry {
+                class,
+                retry_after_ms,
+            } => {
+                context.state.metrics.record_replication(
+                    context.peer,
+                    label,
+                    class,
+                    started.elapsed(),
+                );
+                if class == "not_capable" {
+                    return Ok(None);
+                }
+                retry_backoff(context, attempt, class, retry_after_ms).await?;
+                attempt = attempt.saturating_add(1);
+            }
+        }
+    }
+}
+
 async fn list_entry(
     context: &PassContext<'_>,
     queue: &mpsc::Sender<QueuedFetch>,
@@ -2829,4 +3061,79 @@ mod tests {
             assert_eq!(read_body(&local, &manifest).await, b"bounced-body");
         }
     }
+
+    #[tokio::test]
+    async fn reconcile_lists_only_mismatched_leaves_and_converges_the_trees() {
+        let peer = test_context(|_| {}).await;
+        let local = test_context(|_| {}).await;
+        for index in 0..8_u64 {
+            seed_inline(
+                &peer,
+                &format!("shared-{index}"),
+                b"shared-body",
+                500 + index,
+            )
+            .await;
+            seed_inline(
+                &local,
+                &format!("shared-{index}"),
+                b"shared-body",
+                500 + index,
+            )
+            .await;
+        }
+        // Older than any window a pass would walk: only a reconcile finds it.
+        seed_inline(&peer, "old-missing", b"old-body", 10).await;
+        seed_segmented(&peer, "seg-missing", b"segment-body", 20).await;
+        build_index(&peer);
+        build_index(&local);
+        let (peer_url, _server) = spawn_server(router(peer.state.clone())).await;
+
+        let tree = Arc::new(
+            BackfillTree::build(&local.state.store, TreeBounds::default())
+                .expect("tree should build"),
+        );
+        let claim_set = ClaimSet::new();
+        let outcome = run_reconcile_pass_with_tuning(
+            &local.state,
+            &peer_url,
+            tree,
+            claim_set.register_pass(),
+            &CancellationToken::new(),
+            tuning(),
+        )
+        .await;
+
+        let BackfillPassOutcome::Completed { end, stats, .. } = outcome else {
+            panic!("expected completion, got {outcome:?}");
+        };
+        assert_eq!(end, BackfillPassEnd::TreeReconciled);
+        assert!((1..=2).contains(&stats.leaves_mismatched));
+        assert_eq!(stats.bodies_applied, 2);
+        assert!(stats.tuples_listed < 10);
+        assert!(claim_set.is_empty());
+        let old = fetch_manifest(&local, ArtifactProducer::Xcode, "old-missing")
+            .await
+            .expect("out-of-window artifact should land");
+        assert_eq!(old.version_ms, 10);
+
+        let converged = Arc::new(
+            BackfillTree::build(&local.state.store, TreeBounds::default())
+                .expect("tree should build"),
+        );
+        let outcome = run_reconcile_pass_with_tuning(
+            &local.state,
+            &peer_url,
+            converged,
+            claim_set.register_pass(),
+            &CancellationToken::new(),
+            tuning(),
+        )
+        .await;
+        let BackfillPassOutcome::Completed { stats, .. } = outcome else {
+            panic!("expected completion, got {outcome:?}");
+        };
+        assert_eq!(stats.leaves_mismatched, 0);
+        assert_eq!(stats.pages_listed, 0);
+    }
 }
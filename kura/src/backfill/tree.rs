@@ -0,0 +1,335 @@
+//! Anti-entropy over the backfill index: a hash tree whose leaves bucket
+//! index rows by record id, so two nodes find where their indexes differ by
+//! comparing a handful of digests top-down and then list only the rows of
+//! the leaves that disagree.
+//!
+//! The window-bounded pass repairs what is newer than its watermark-shallowed
+//! window and nothing else; a divergence older than that (an outbox delivery
+//! lost while a peer was down past its window) stays until the record is
+//! rewritten. A tree reconcile covers everything above the requester's ring
+//! horizon, and a converged pair costs one root comparison. Rows below the
+//! horizon are left out on both sides: the requester's ring has turned over
+//! past them, so they are mostly evicted there, and a tree that counted them
+//! would never converge and would re-list them every round. Rows newer than
+//! the settle bound ([`settled_bound_ms`]) are left out on both sides too:
+//! they are still in outbox delivery and inside every window pass, and
+//! counting them would only re-list in-flight writes.
+//!
+//! Leaves bucket by the leading bits of `sha256(record_id)` rather than by
+//! namespace and key range: artifact record ids are already hashes over
+//! (producer, tenant, namespace, key), so neither is recoverable from the
+//! index, and hashing the id spreads namespace tombstones (whose id is the
+//! namespace) across the leaves too. A leaf digest is the XOR of its rows'
+//! digests, so it does not depend on scan order and the tree over the same
+//! rows is bit-identical on every node; inner nodes XOR their children.
+//!
+//! A tree is always built [`TREE_MAX_DEPTH`] levels deep, but a comparison
+//! stops at the depth the requester sizes from its row count
+//! ([`depth_for_rows`]) and sends with every request. A node at a shallower
+//! level is exactly the leaf of a shallower tree (its index is the leading
+//! bits of the same hash), so both sides answer any depth from one build and
+//! a mismatched leaf holds about [`BACKFILL_TREE_ROWS_PER_LEAF`] rows whether
+//! the index is small or large.
+
+use std::{
+    ops::Range,
+    sync::Arc,
+    time::{Duration, Instant},
+};
+
+use sha2::{Digest, Sha256};
+
+use crate::{
+    constants::{
+        BACKFILL_TREE_CACHED_BOUNDS, BACKFILL_TREE_ROWS_PER_LEAF, BACKFILL_TREE_SETTLE_MS,
+        BACKFILL_TREE_TTL_MS,
+    },
+    state::SharedState,
+    store::Store,
+    tasks,
+    utils::BackfillIndexRow,
+};
+
+/// Children per inner node, as a bit count so node indexes split on nibbles.
+pub const TREE_FANOUT_BITS: u32 = 4;
+/// Shallowest comparison depth a requester may ask for.
+pub const TREE_MIN_DEPTH: u32 = 1;
+/// Levels below the root of a built tree, and so the deepest comparison.
+pub const TREE_MAX_DEPTH: u32 = 4;
+/// Comparison depth of a requester that predates sized trees and sends none.
+pub const TREE_LEGACY_DEPTH: u32 = 3;
+pub const TREE_FANOUT: usize = 1 << TREE_FANOUT_BITS;
+
+/// Number of nodes at `level` (the root level has one).
+pub const fn level_width(level: u32) -> usize {
+    1 << (TREE_FANOUT_BITS * level)
+}
+
+/// The node indexes one level down from `index`.
+pub fn children(index: usize) -> Range<usize> {
+    index * TREE_FANOUT..(index + 1) * TREE_FANOUT
+}
+
+/// The leaf a record id falls in when the tree is compared `depth` levels
+/// deep (`TREE_MIN_DEPTH..=TREE_MAX_DEPTH`).
+pub fn leaf_of(record_id: &str, depth: u32) -> usize {
+    let digest = Sha256::digest(record_id.as_bytes());
+    let prefix = u32::from_be_bytes(digest[..4].try_into().expect("sha256 is 32 bytes"));
+    (prefix >> (u32::BITS - TREE_FANOUT_BITS * depth)) as usize
+}
+
+/// Comparison depth for an index of `rows` rows: the shallowest level whose
+/// nodes hold at most [`BACKFILL_TREE_ROWS_PER_LEAF`] rows each on average,
+/// or the built depth when none does.
+pub fn depth_for_rows(rows: u64) -> u32 {
+    (TREE_MIN_DEPTH..TREE_MAX_DEPTH)
+        .find(|&depth| rows <= level_width(depth) as u64 * BACKFILL_TREE_ROWS_PER_LEAF)
+        .unwrap_or(TREE_MAX_DEPTH)
+}
+
+/// Exclusive upper version bound of a reconcile started at `now_ms`:
+/// [`BACKFILL_TREE_SETTLE_MS`] back, rounded down to [`BACKFILL_TREE_TTL_MS`]
+/// so every request of a round lands on the same cached build.
+pub fn settled_bound_ms(now_ms: u64) -> u64 {
+    let bound = now_ms.saturating_sub(BACKFILL_TREE_SETTLE_MS);
+    bound - bound % BACKFILL_TREE_TTL_MS
+}
+
+fn row_digest(row: &BackfillIndexRow) -> u128 {
+    let mut hasher = Sha256::new();
+    hasher.update([row.kind.as_byte()]);
+    hasher.update(row.version_ms.to_be_bytes());
+    hasher.update(row.record_id.as_bytes());
+    u128::from_be_bytes(
+        hasher.finalize()[..16]
+            .try_into()
+            .expect("sha256 is 32 bytes"),
+    )
+}
+
+/// Wire form of a node digest.
+pub fn encode_digest(digest: u128) -> String {
+    format!("{digest:032x}")
+}
+
+pub fn decode_digest(digest: &str) -> Result<u128, String> {
+    u128::from_str_radix(digest, 16).map_err(|error| format!("invalid tree digest: {error}"))
+}
+
+/// Version bounds of a tree: rows at or above `min_version_ms` and below
+/// `max_version_ms`. Absent bounds are open.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct TreeBounds {
+    pub min_version_ms: Option<u64>,
+    pub max_version_ms: Option<u64>,
+}
+
+/// One node's tree over the rows of its backfill index inside `bounds`, at
+/// build time.
+pub struct BackfillTree {
+    /// `levels[0]` is the root, `levels[TREE_MAX_DEPTH]` the leaves.
+    levels: Vec<Vec<u128>>,
+    rows: u64,
+    bounds: TreeBounds,
+    built_at: Instant,
+}
+
+impl BackfillTree {
+    /// Builds the tree with one scan of the index rows inside `bounds`.
+    /// Blocking.
+    pub fn build(store: &Store, bounds: TreeBounds) -> Result<Self, String> {
+        let mut leaves = vec![0_u128; level_width(TREE_MAX_DEPTH)];
+        let mut rows = 0_u64;
+        store.for_each_backfill_index_row(bounds.min_version_ms, bounds.max_version_ms, |row| {
+            leaves[leaf_of(&row.record_id, TREE_MAX_DEPTH)] ^= row_digest(&row);
+            rows += 1;
+        })?;
+        Ok(Self::from_leaves(leaves, rows, bounds))
+    }
+
+    fn from_leaves(leaves: Vec<u128>, rows: u64, bounds: TreeBounds) -> Self {
+        let mut levels = vec![leaves];
+        while levels[0].len() > 1 {
+            let parents = levels[0]
+                .chunks(TREE_FANOUT)
+                .map(|siblings| siblings.iter().fold(0, |parent, child| parent ^ child))
+                .collect();
+            levels.insert(0, parents);
+        }
+        Self {
+            levels,
+            rows,
+            bounds,
+            built_at: Instant::now(),
+        }
+    }
+
+    pub fn node(&self, level: u32, index: usize) -> Option<u128> {
+        self.levels.get(level as usize)?.get(index).copied()
+    }
+
+    pub fn rows(&self) -> u64 {
+        self.rows
+    }
+
+    pub fn bounds(&self) -> TreeBounds {
+        self.bounds
+    }
+
+    /// How deep a reconcile that starts from this tree compares.
+    pub fn depth(&self) -> u32 {
+        depth_for_rows(self.rows)
+    }
+
+    fn fresh(&self) -> bool {
+        self.built_at.elapsed() < Duration::from_millis(BACKFILL_TREE_TTL_MS)
+    }
+}
+
+/// The most recent tree per pair of bounds, rebuilt on demand once it is
+/// older than [`BACKFILL_TREE_TTL_MS`]. Both sides of a reconcile and every
+/// peer reconciling against this node with the same bounds share it, so a
+/// round costs one index scan per node and bounds rather than one per
+/// request; the depth a request compares at does not need a build of its
+/// own. The TTL is the staleness bound: writes landing below the upper bound
+/// after a build show up as mismatches on one side, which the presence
+/// pre-check of the reconcile pass turns into no-ops.
+#[derive(Default)]
+pub struct BackfillTreeCache {
+    // A Tokio mutex held across the build: concurrent callers wait for the
+    // one in flight instead of each scanning the index.
+    current: tokio::sync::Mutex<Vec<Arc<BackfillTree>>>,
+}
+
+impl BackfillTreeCache {
+    pub async fn current(
+        &self,
+        state: &SharedState,
+        bounds: TreeBounds,
+    ) -> Result<Arc<BackfillTree>, String> {
+        let mut current = self.current.lock().await;
+        if let Some(tree) = current
+            .iter()
+            .find(|tree| tree.bounds == bounds && tree.fresh())
+        {
+            return Ok(tree.clone());
+        }
+        let build_state = state.clone();
+        let started = Instant::now();
+        let tree = tasks::spawn_blocking(move || BackfillTree::build(&build_state.store, bounds))
+            .await
+            .map_err(|error| format!("backfill tree build task failed: {error}"))??;
+        state
+            .metrics
+            .observe_backfill_tree_build(tree.rows, started.elapsed());
+        let tree = Arc::new(tree);
+        current.retain(|cached| cached.bounds != bounds && cached.fresh());
+        if current.len() == BACKFILL_TREE_CACHED_BOUNDS {
+            current.remove(0);
+        }
+        current.push(tree.clone());
+        Ok(tree)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::utils::BackfillRecordKind;
+
+    fn row(record_id: &str, version_ms: u64) -> BackfillIndexRow {
+        BackfillIndexRow {
+            version_ms,
+            kind: BackfillRecordKind::InlineArtifact,
+            record_id: record_id.to_owned(),
+            size: Some(7),
+        }
+    }
+
+    fn tree(rows: &[BackfillIndexRow]) -> BackfillTree {
+        let mut leaves = vec![0_u128; level_width(TREE_MAX_DEPTH)];
+        for row in rows {
+            leaves[leaf_of(&row.record_id, TREE_MAX_DEPTH)] ^= row_digest(row);
+        }
+        BackfillTree::from_leaves(leaves, rows.len() as u64, TreeBounds::default())
+    }
+
+    #[test]
+    fn trees_over_the_same_rows_match_in_any_order() {
+        let rows = [row("a", 1), row("b", 2), row("c", 3)];
+        let reversed = [row("c", 3), row("b", 2), row("a", 1)];
+
+        assert_eq!(tree(&rows).node(0, 0), tree(&reversed).node(0, 0));
+        assert_eq!(tree(&[]).node(0, 0), Some(0));
+    }
+
+    #[test]
+    fn a_newer_version_differs_only_along_its_leaf_path() {
+        let local = tree(&[row("a", 1), row("b", 2)]);
+        let remote = tree(&[row("a", 1), row("b", 3)]);
+        let leaf = leaf_of("b", TREE_MAX_DEPTH);
+
+        assert_ne!(local.node(0, 0), remote.node(0, 0));
+        assert_ne!(
+            local.node(TREE_MAX_DEPTH, leaf),
+            remote.node(TREE_MAX_DEPTH, leaf)
+        );
+        let mismatched_leaves = (0..level_width(TREE_MAX_DEPTH))
+            .filter(|&index| {
+                local.node(TREE_MAX_DEPTH, index) != remote.node(TREE_MAX_DEPTH, index)
+            })
+            .count();
+        assert_eq!(mismatched_leaves, 1);
+        let mut index = leaf;
+        for level in (0..TREE_MAX_DEPTH).rev() {
+            let parent = index / TREE_FANOUT;
+            assert!(children(parent).contains(&index));
+            assert_ne!(local.node(level, parent), remote.node(level, parent));
+            index = parent;
+        }
+    }
+
+    #[test]
+    fn a_shallower_level_is_the_leaf_level_of_a_shallower_tree() {
+        let rows = [row("a", 1), row("b", 2), row("c", 3), row("d", 4)];
+        let built = tree(&rows);
+
+        for depth in TREE_MIN_DEPTH..=TREE_MAX_DEPTH {
+            let mut leaves = vec![0_u128; level_width(depth)];
+            for row in &rows {
+                leaves[leaf_of(&row.record_id, depth)] ^= row_digest(row);
+            }
+            for (index, &leaf) in leaves.iter().enumerate() {
+                assert_eq!(built.node(depth, index), Some(leaf));
+            }
+        }
+    }
+
+    #[test]
+    fn comparison_depth_grows_with_the_index() {
+        assert_eq!(depth_for_rows(0), TREE_MIN_DEPTH);
+        assert_eq!(depth_for_rows(16 * BACKFILL_TREE_ROWS_PER_LEAF), 1);
+        assert_eq!(depth_for_rows(16 * BACKFILL_TREE_ROWS_PER_LEAF + 1), 2);
+        assert_eq!(depth_for_rows(4096 * BACKFILL_TREE_ROWS_PER_LEAF), 3);
+        assert_eq!(depth_for_rows(u64::MAX), TREE_MAX_DEPTH);
+    }
+
+    #[test]
+    fn the_settled_bound_trails_now_on_ttl_boundaries() {
+        let now = 10 * BACKFILL_TREE_SETTLE_MS + BACKFILL_TREE_TTL_MS / 2;
+        let bound = settled_bound_ms(now);
+
+        assert_eq!(bound % BACKFILL_TREE_TTL_MS, 0);
+        assert!(bound <= now - BACKFILL_TREE_SETTLE_MS);
+        assert!(now - BACKFILL_TREE_SETTLE_MS - bound < BACKFILL_TREE_TTL_MS);
+        assert_eq!(settled_bound_ms(now + 1), bound);
+        assert_eq!(settled_bound_ms(0), 0);
+    }
+
+    #[test]
+    fn digests_round_trip_on_the_wire() {
+        let digest = row_digest(&row("a", 1));
+        assert_eq!(decode_digest(&encode_digest(digest)), Ok(digest));
+        assert!(decode_digest("not-hex").is_err());
+    }
+}
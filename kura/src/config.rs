@@ -4,15 +4,18 @@ use tokio::fs;
 
 use crate::{
     constants::{
-        BACKFILL_BODIES_BATCH_BYTES, DEFAULT_BACKFILL_BATCH_BYTES, DEFAULT_BACKFILL_MARGIN_PERCENT,
-        DEFAULT_MULTIPART_JANITOR_INTERVAL_MS, DEFAULT_MULTIPART_MAX_ACTIVE_UPLOADS,
-        DEFAULT_MULTIPART_UPLOAD_TTL_MS, DEFAULT_OUTBOX_MAX_DEPTH,
+        BACKFILL_BODIES_BATCH_BYTES, DEFAULT_ADMISSION_READ_WEIGHT, DEFAULT_BACKFILL_BATCH_BYTES,
+        DEFAULT_BACKFILL_MARGIN_PERCENT, DEFAULT_MULTIPART_JANITOR_INTERVAL_MS,
+        DEFAULT_MULTIPART_MAX_ACTIVE_UPLOADS, DEFAULT_MULTIPART_UPLOAD_TTL_MS,
+        DEFAULT_OUTBOX_MAX_DEPTH, DEFAULT_READAHEAD_BUDGET_BYTES,
         DEFAULT_REPLICATION_UPLOAD_STALL_MS, DEFAULT_TMP_DIR_MAX_BYTES, DEFAULT_USAGE_BATCH_SIZE,
         DEFAULT_USAGE_DELIVERY_INTERVAL_MS, DEFAULT_USAGE_FLUSH_INTERVAL_MS,
         DEFAULT_USAGE_MAX_BUCKETS, DEFAULT_USAGE_OUTBOX_MAX_DEPTH, DEFAULT_USAGE_WINDOW_SECS,
         MAX_INLINE_REPLICATION_BODY_BYTES, default_backfill_ready_ring_percent,
     },
+    namespace_share::NamespaceShareConfig,
     runtime::DataDirLock,
+    segment::compression::SegmentCompressionConfig,
 };
 
 const KURA_PORT: &str = "KURA_PORT";
@@ -22,6 +25,12 @@ const KURA_TMP_DIR: &str = "KURA_TMP_DIR";
 const KURA_DATA_DIR: &str = "KURA_DATA_DIR";
 const KURA_TMP_DIR_MAX_BYTES: &str = "KURA_TMP_DIR_MAX_BYTES";
 const KURA_CAS_CAPACITY_BYTES: &str = "KURA_CAS_CAPACITY_BYTES";
+const KURA_NAMESPACE_WEIGHTS: &str = "KURA_NAMESPACE_WEIGHTS";
+const KURA_NAMESPACE_QUOTA_BYTES: &str = "KURA_NAMESPACE_QUOTA_BYTES";
+const KURA_ADMISSION_READ_WEIGHT: &str = "KURA_ADMISSION_READ_WEIGHT";
+const KURA_READAHEAD_BUDGET_BYTES: &str = "KURA_READAHEAD_BUDGET_BYTES";
+const KURA_SEGMENT_COMPRESSION_PRODUCERS: &str = "KURA_SEGMENT_COMPRESSION_PRODUCERS";
+const KURA_SEGMENT_DIRECT_IO: &str = "KURA_SEGMENT_DIRECT_IO";
 const KURA_NODE_URL: &str = "KURA_NODE_URL";
 const KURA_PEER_GATEWAY_URL: &str = "KURA_PEER_GATEWAY_URL";
 const KURA_PEERS: &str = "KURA_PEERS";
@@ -34,11 +43,14 @@ const KURA_INTERNAL_TLS_KEY_PATH: &str = "KURA_INTERNAL_TLS_KEY_PATH";
 const KURA_PUBLIC_TLS_CERT_PATH: &str = "KURA_PUBLIC_TLS_CERT_PATH";
 const KURA_PUBLIC_TLS_KEY_PATH: &str = "KURA_PUBLIC_TLS_KEY_PATH";
 const KURA_HTTPS_PORT: &str = "KURA_HTTPS_PORT";
+const KURA_ALT_SVC: &str = "KURA_ALT_SVC";
 const KURA_ACCELERATED_FILE_SERVING_ENABLED: &str = "KURA_ACCELERATED_FILE_SERVING_ENABLED";
 const KURA_ACCELERATED_FILE_SERVING_MODE: &str = "KURA_ACCELERATED_FILE_SERVING_MODE";
 const KURA_ACCELERATED_FILE_SERVING_MAX_CONCURRENT: &str =
     "KURA_ACCELERATED_FILE_SERVING_MAX_CONCURRENT";
 const KURA_ACCELERATED_FILE_SERVING_CHUNK_BYTES: &str = "KURA_ACCELERATED_FILE_SERVING_CHUNK_BYTES";
+const KURA_ACCELERATED_FILE_SERVING_THREAD_PER_CORE: &str =
+    "KURA_ACCELERATED_FILE_SERVING_THREAD_PER_CORE";
 const KURA_ACTION_CACHE_EVICTION_CASCADE_ENABLED: &str =
     "KURA_ACTION_CACHE_EVICTION_CASCADE_ENABLED";
 
@@ -132,6 +144,21 @@ pub struct Config {
     /// Operator-provided CAS segment-ring budget. When unset, the store
     /// derives the budget from the data-dir filesystem size at startup.
     pub cas_capacity_bytes: Option<u64>,
+    /// Per-namespace weights and byte quotas splitting the CAS ring between
+    /// namespaces (see `namespace_share`).
+    pub namespace_shares: NamespaceShareConfig,
+    /// How much more often a contended read is admitted than a write from
+    /// the same namespace (see `fair_admission`).
+    pub admission_read_weight: u64,
+    /// Bytes of action-result and find-missing readahead that may await
+    /// their read at once; 0 disables readahead (see `readahead`).
+    pub readahead_budget_bytes: u64,
+    /// Producers whose segment bodies are zstd-compressed at rest (see
+    /// `segment::compression`). Empty by default.
+    pub segment_compression: SegmentCompressionConfig,
+    /// Write segment bodies with `O_DIRECT` (see `segment::direct`). Off by
+    /// default.
+    pub segment_direct_io: bool,
     pub node_url: String,
     pub peer_gateway_url: Option<String>,
     pub peers: Vec<String>,
@@ -141,6 +168,10 @@ pub struct Config {
     pub public_tls: Option<PublicTlsConfig>,
     /// TLS port for the co-hosted HTTP+gRPC surface, active when `public_tls` is set.
     pub https_port: u16,
+    /// `Alt-Svc` value advertised on public TLS responses, pointing clients at an
+    /// HTTP/3 endpoint that terminates QUIC in front of this node. Kura serves
+    /// no HTTP/3 of its own.
+    pub alt_svc: Option<String>,
     pub accelerated_file_serving: AcceleratedFileServingConfig,
     /// When true, evicting a CAS blob cascades: the action-cache entries that
     /// reference it are removed in the same atomic batch, so an entry never
@@ -231,6 +262,10 @@ pub struct AcceleratedFileServingConfig {
     pub mode: AcceleratedFileServingMode,
     pub max_concurrent: usize,
     pub chunk_bytes: usize,
+    /// Serve the plaintext port from one `SO_REUSEPORT` listener per core,
+    /// each on its own pinned current-thread runtime, instead of one listener
+    /// on the shared pool.
+    pub thread_per_core: bool,
 }
 
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
@@ -472,6 +507,58 @@ impl Config {
         if cas_capacity_bytes == Some(0) {
             invalid.push(format!("{KURA_CAS_CAPACITY_BYTES} must be greater than 0"));
         }
+        let namespace_shares = NamespaceShareConfig::parse(
+            KURA_NAMESPACE_WEIGHTS,
+            lookup(KURA_NAMESPACE_WEIGHTS).as_deref(),
+            KURA_NAMESPACE_QUOTA_BYTES,
+            lookup(KURA_NAMESPACE_QUOTA_BYTES).as_deref(),
+        )
+        .unwrap_or_else(|error| {
+            invalid.push(error);
+            NamespaceShareConfig::default()
+        });
+        let admission_read_weight = optional_parsed_value(
+            &mut lookup,
+            KURA_ADMISSION_READ_WEIGHT,
+            &mut invalid,
+            |value| {
+                value
+                    .parse::<u64>()
+                    .map_err(|_| format!("{KURA_ADMISSION_READ_WEIGHT} must be a valid u64"))
+            },
+        )
+        .unwrap_or(DEFAULT_ADMISSION_READ_WEIGHT);
+        if admission_read_weight == 0 {
+            invalid.push(format!(
+                "{KURA_ADMISSION_READ_WEIGHT} must be greater than 0"
+            ));
+        }
+        let readahead_budget_bytes = optional_parsed_value(
+            &mut lookup,
+            KURA_READAHEAD_BUDGET_BYTES,
+            &mut invalid,
+            |value| {
+                value
+                    .parse::<u64>()
+                    .map_err(|_| format!("{KURA_READAHEAD_BUDGET_BYTES} must be a valid u64"))
+            },
+        )
+        .unwrap_or(DEFAULT_READAHEAD_BUDGET_BYTES);
+        let segment_compression = SegmentCompressionConfig::parse(
+            KURA_SEGMENT_COMPRESSION_PRODUCERS,
+            lookup(KURA_SEGMENT_COMPRESSION_PRODUCERS).as_deref(),
+        )
+        .unwrap_or_else(|error| {
+            invalid.push(error);
+            SegmentCompressionConfig::default()
+        });
+        let segment_direct_io =
+            optional_parsed_value(&mut lookup, KURA_SEGMENT_DIRECT_IO, &mut invalid, |value| {
+                value
+                    .parse::<bool>()
+                    .map_err(|_| format!("{KURA_SEGMENT_DIRECT_IO} must be a valid bool"))
+            })
+            .unwrap_or(false);
         let node_url = required_value(&mut lookup, KURA_NODE_URL, &mut missing);
         let peer_gateway_url = lookup(KURA_PEER_GATEWAY_URL)
             .map(|value| value.trim().to_owned())
@@ -547,12 +634,24 @@ impl Config {
                 "{KURA_ACCELERATED_FILE_SERVING_CHUNK_BYTES} must be greater than 0"
             ));
         }
+        let accelerated_file_serving_thread_per_core = optional_parsed_value(
+            &mut lookup,
+            KURA_ACCELERATED_FILE_SERVING_THREAD_PER_CORE,
+            &mut invalid,
+            |value| {
+                value.parse::<bool>().map_err(|_| {
+                    format!("{KURA_ACCELERATED_FILE_SERVING_THREAD_PER_CORE} must be a valid bool")
+                })
+            },
+        )
+        .unwrap_or(false);
         let accelerated_file_serving =
             accelerated_file_serving_mode.map(|mode| AcceleratedFileServingConfig {
                 enabled: accelerated_file_serving_enabled,
                 mode,
                 max_concurrent: accelerated_file_serving_max_concurrent,
                 chunk_bytes: accelerated_file_serving_chunk_bytes,
+                thread_per_core: accelerated_file_serving_thread_per_core,
             });
         let action_cache_eviction_cascade_enabled = optional_parsed_value(
             &mut lookup,
@@ -618,6 +717,17 @@ impl Config {
                     .map_err(|_| format!("{KURA_HTTPS_PORT} must be a valid u16"))
             })
             .unwrap_or(DEFAULT_HTTPS_PORT);
+        let alt_svc = lookup(KURA_ALT_SVC)
+            .map(|value| value.trim().to_owned())
+            .filter(|value| !value.is_empty());
+        if let Some(alt_svc) = &alt_svc
+            && (axum::http::HeaderValue::from_str(alt_svc).is_err()
+                || alt_svc.eq_ignore_ascii_case("clear"))
+        {
+            invalid.push(format!(
+                "{KURA_ALT_SVC} must be an Alt-Svc alternative list such as h3=\":443\"; ma=86400"
+            ));
+        }
         let file_descriptor_pool_size = optional_parsed_value(
             &mut lookup,
             KURA_FILE_DESCRIPTOR_POOL_SIZE,
@@ -1480,6 +1590,11 @@ impl Config {
             data_dir: data_dir.expect("data_dir should be present when configuration is valid"),
             tmp_dir_max_bytes,
             cas_capacity_bytes,
+            namespace_shares,
+            admission_read_weight,
+            readahead_budget_bytes,
+            segment_compression,
+            segment_direct_io,
             node_url: node_url.expect("node_url should be present when configuration is valid"),
             peer_gateway_url,
             peers,
@@ -1488,6 +1603,7 @@ impl Config {
             peer_tls,
             public_tls,
             https_port,
+            alt_svc,
             accelerated_file_serving: accelerated_file_serving
                 .expect("accelerated_file_serving should be present when configuration is valid"),
             action_cache_eviction_cascade_enabled,
@@ -1900,6 +2016,7 @@ mod tests {
                 mode: AcceleratedFileServingMode::Splice,
                 max_concurrent: 32,
                 chunk_bytes: 1024 * 1024,
+                thread_per_core: false,
             }
         );
         assert_eq!(config.sentry_dsn, None);
@@ -2051,6 +2168,7 @@ mod tests {
             (KURA_ACCELERATED_FILE_SERVING_MODE, "sendfile"),
             (KURA_ACCELERATED_FILE_SERVING_MAX_CONCURRENT, "16"),
             (KURA_ACCELERATED_FILE_SERVING_CHUNK_BYTES, "2097152"),
+            (KURA_ACCELERATED_FILE_SERVING_THREAD_PER_CORE, "true"),
             (
                 KURA_REPLICATION_BANDWIDTH_LIMIT_BYTES_PER_SECOND,
                 "10485760",
@@ -2107,6 +2225,7 @@ mod tests {
                 mode: AcceleratedFileServingMode::Sendfile,
                 max_concurrent: 16,
                 chunk_bytes: 2 * 1024 * 1024,
+                thread_per_core: true,
             }
         );
         assert_eq!(
@@ -2223,6 +2342,84 @@ mod tests {
         assert!(error.contains(KURA_CAS_CAPACITY_BYTES));
     }
 
+    #[test]
+    fn from_lookup_parses_namespace_weights_and_quotas() {
+        let config = config_from(&[
+            (KURA_NAMESPACE_WEIGHTS, "ios=4"),
+            (KURA_NAMESPACE_QUOTA_BYTES, "*=1073741824"),
+        ])
+        .expect("expected namespace share config to parse");
+        assert_ne!(config.namespace_shares, NamespaceShareConfig::default());
+
+        let error = config_from(&[(KURA_NAMESPACE_WEIGHTS, "ios=0")])
+            .expect_err("expected a zero weight to be rejected");
+        assert!(error.contains(KURA_NAMESPACE_WEIGHTS));
+    }
+
+    #[test]
+    fn from_lookup_parses_segment_compression_producers() {
+        let config = config_from(&[(KURA_SEGMENT_COMPRESSION_PRODUCERS, "gradle,metro")])
+            .expect("expected segment compression producers to parse");
+        assert_ne!(
+            config.segment_compression,
+            SegmentCompressionConfig::default()
+        );
+
+        let error = config_from(&[(KURA_SEGMENT_COMPRESSION_PRODUCERS, "reapi")])
+            .expect_err("expected reapi to be rejected");
+        assert!(error.contains(KURA_SEGMENT_COMPRESSION_PRODUCERS));
+    }
+
+    #[test]
+    fn from_lookup_parses_segment_direct_io() {
+        let config = config_from(&[]).expect("expected default config to parse");
+        assert!(!config.segment_direct_io);
+
+        let config = config_from(&[(KURA_SEGMENT_DIRECT_IO, "true")])
+            .expect("expected segment direct io to parse");
+        assert!(config.segment_direct_io);
+
+        let error = config_from(&[(KURA_SEGMENT_DIRECT_IO, "sometimes")])
+            .expect_err("expected an invalid bool to be rejected");
+        assert!(error.contains(KURA_SEGMENT_DIRECT_IO));
+    }
+
+    #[test]
+    fn from_lookup_parses_admission_read_weight() {
+        let config = config_from(&[]).expect("expected default config to parse");
+        assert_eq!(config.admission_read_weight, DEFAULT_ADMISSION_READ_WEIGHT);
+
+        let config = config_from(&[(KURA_ADMISSION_READ_WEIGHT, "8")])
+            .expect("expected admission read weight to parse");
+        assert_eq!(config.admission_read_weight, 8);
+
+        let error = config_from(&[(KURA_ADMISSION_READ_WEIGHT, "0")])
+            .expect_err("expected a zero weight to be rejected");
+        assert!(error.contains(KURA_ADMISSION_READ_WEIGHT));
+    }
+
+    #[test]
+    fn from_lookup_parses_readahead_budget() {
+        let config = config_from(&[(KURA_READAHEAD_BUDGET_BYTES, "0")])
+            .expect("expected a zero readahead budget to parse");
+        assert_eq!(config.readahead_budget_bytes, 0);
+
+        let error = config_from(&[(KURA_READAHEAD_BUDGET_BYTES, "lots")])
+            .expect_err("expected an invalid budget to be rejected");
+        assert!(error.contains(KURA_READAHEAD_BUDGET_BYTES));
+    }
+
+    #[test]
+    fn from_lookup_parses_alt_svc() {
+        let config = config_from(&[(KURA_ALT_SVC, r#"h3=":443"; ma=86400"#)])
+            .expect("expected alt-svc to parse");
+        assert_eq!(config.alt_svc.as_deref(), Some(r#"h3=":443"; ma=86400"#));
+
+        let error =
+            config_from(&[(KURA_ALT_SVC, "clear")]).expect_err("expected clear to be rejected");
+        assert!(error.contains(KURA_ALT_SVC));
+    }
+
     #[test]
     fn from_lookup_parses_node_location_overrides() {
         let config = config_from(&[
@@ -2278,6 +2475,7 @@ mod tests {
             (KURA_ACCELERATED_FILE_SERVING_MODE, "uring"),
             (KURA_ACCELERATED_FILE_SERVING_MAX_CONCURRENT, "invalid"),
             (KURA_ACCELERATED_FILE_SERVING_CHUNK_BYTES, "invalid"),
+            (KURA_ACCELERATED_FILE_SERVING_THREAD_PER_CORE, "invalid"),
             (KURA_REPLICATION_BANDWIDTH_LIMIT_BYTES_PER_SECOND, "invalid"),
             (KURA_REPLICATION_PUBLIC_LATENCY_TARGET_MS, "invalid"),
             (KURA_REPLICATION_UPLOAD_STALL_MS, "invalid"),
@@ -2312,6 +2510,7 @@ mod tests {
         assert!(error.contains(KURA_ACCELERATED_FILE_SERVING_MODE));
         assert!(error.contains(KURA_ACCELERATED_FILE_SERVING_MAX_CONCURRENT));
         assert!(error.contains(KURA_ACCELERATED_FILE_SERVING_CHUNK_BYTES));
+        assert!(error.contains(KURA_ACCELERATED_FILE_SERVING_THREAD_PER_CORE));
         assert!(error.contains(KURA_REPLICATION_BANDWIDTH_LIMIT_BYTES_PER_SECOND));
         assert!(error.contains(KURA_REPLICATION_PUBLIC_LATENCY_TARGET_MS));
         assert!(error.contains(KURA_REPLICATION_UPLOAD_STALL_MS));
@@ -5,6 +5,11 @@
 // Uploads stream to the budgeted tmp dir (never RAM), so the binding ceiling
 // is MAX_SEGMENT_BYTES; 256 MiB stays well under it.
 pub const MAX_XCODE_BYTES: u64 = 256 * 1024 * 1024;
+// Xcode multi-get: a warm incremental build looks up thousands of small CAS
+// objects and keyvalue entries; one batch carries up to this many ids. The
+// request body only holds ids, so its cap stays small.
+pub const MAX_BATCH_GET_ITEMS: usize = 1_024;
+pub const MAX_BATCH_GET_REQUEST_BYTES: usize = 256 * 1024;
 pub const MAX_GRADLE_BYTES: u64 = 100 * 1024 * 1024;
 pub const MAX_MODULE_PART_BYTES: u64 = 10 * 1024 * 1024;
 pub const MAX_MODULE_TOTAL_BYTES: u64 = 2 * 1024 * 1024 * 1024;
@@ -49,8 +54,22 @@ pub const ROCKSDB_SOFT_PENDING_COMPACTION_BYTES: u64 = 64 * 1024 * 1024 * 1024;
 pub const ROCKSDB_HARD_PENDING_COMPACTION_BYTES: u64 = 256 * 1024 * 1024 * 1024;
 
 pub const DEFAULT_OUTBOX_MAX_DEPTH: usize = 100_000;
+/// A contended read is admitted four times as often as a write from the same
+/// namespace unless `KURA_ADMISSION_READ_WEIGHT` says otherwise.
+pub const DEFAULT_ADMISSION_READ_WEIGHT: u64 = 4;
+/// Bytes of readahead that may await their read at once unless
+/// `KURA_READAHEAD_BUDGET_BYTES` says otherwise.
+pub const DEFAULT_READAHEAD_BUDGET_BYTES: u64 = 64 * 1024 * 1024;
 pub const DEFAULT_MULTIPART_UPLOAD_TTL_MS: u64 = 24 * 60 * 60 * 1000;
 pub const DEFAULT_MULTIPART_JANITOR_INTERVAL_MS: u64 = 10 * 60 * 1000;
+// A named task whose single poll holds a runtime worker this long is counted
+// and logged as a slow poll: every other task queued on that worker waited
+// at least as long.
+pub const RUNTIME_SLOW_POLL_THRESHOLD_MS: u64 = 10;
+// Tasks spawned per connection record one poll in this many, counted per
+// worker thread, into their shared poll-time histogram. Slow polls are all
+// counted.
+pub const RUNTIME_SAMPLED_POLL_EVERY: u64 = 16;
 pub const DEFAULT_MULTIPART_MAX_ACTIVE_UPLOADS: usize = 128;
 // REAPI action-cache entries are append-only from the client's perspective
 // (every source change publishes new keys), so a recency sweep is what bounds
@@ -292,6 +311,67 @@ pub const BACKFILL_WATERMARK_RETENTION_MS: u64 = 90 * 24 * 60 * 60 * 1000;
 // also runs once at startup). The keyspace is tens of tiny rows, so daily is
 // generous.
 pub const BACKFILL_WATERMARK_GC_INTERVAL_MS: u64 = 24 * 60 * 60 * 1000;
+// Anti-entropy cadence: how often a node reconciles its backfill tree
+// against each peer in view (see backfill::tree). A converged pair costs one
+// root comparison, so the interval bounds how long an out-of-window
+// divergence survives rather than how much the mesh pays for checking.
+pub const BACKFILL_RECONCILE_INTERVAL_MS: u64 = 15 * 60 * 1000;
+// How long a built backfill tree is served before the next request rebuilds
+// it with a full index scan. Peers reconciling against this node in the same
+// round share one build; the few writes that land below the settle bound
+// after a build read as mismatches that the reconcile's presence pre-check
+// discards.
+pub const BACKFILL_TREE_TTL_MS: u64 = 60 * 1000;
+// Rows newer than this are left out of both trees of a reconcile. They are
+// still in outbox delivery and inside every window pass, so counting them
+// would only re-list in-flight writes each round. The bound is rounded down
+// to the tree TTL so peers in the same round share one build.
+pub const BACKFILL_TREE_SETTLE_MS: u64 = 5 * 60 * 1000;
+// Rows a reconcile aims to list per mismatched leaf: the requester descends
+// to the shallowest tree level whose nodes hold about this many of its rows.
+pub const BACKFILL_TREE_ROWS_PER_LEAF: u64 = 64;
+// Wall-clock cap on one reconcile pass. Reconciles are not driven by the
+// membership lifecycle, so a peer that leaves mid-pass or sheds every request
+// is bounded here rather than by peer-loss cancellation.
+pub const BACKFILL_RECONCILE_PASS_CAP_MS: u64 = 10 * 60 * 1000;
+// Leaves listed per tree-entries request. The serving side walks its whole
+// index once per leaf set (paged by cursor), so the cap trades request size
+// against scans on a badly diverged pair.
+pub const BACKFILL_TREE_LEAVES_PER_REQUEST: usize = 512;
+// Rows one tree-entries page may reject before it returns early with a cursor
+// at the last rejected row, so a sparse leaf set pages through the index
+// instead of walking all of it in one request.
+pub const BACKFILL_TREE_REJECTED_ROWS_PER_PAGE: usize = 64 * 1024;
+// Trees kept at once, one per window bound: each reconciling peer asks for
+// the tree above its own horizon, and horizons move only as rings turn over.
+pub const BACKFILL_TREE_CACHED_BOUNDS: usize = 8;
+
+// Namespace fair shares (see namespace_share): how often manifest usage is
+// re-summed per namespace (one scan of the manifests column family on the
+// blocking pool), and how many of the largest namespaces get their own label
+// on the per-namespace metrics; the rest are reported together.
+pub const NAMESPACE_USAGE_SCAN_INTERVAL_MS: u64 = 5 * 60 * 1_000;
+pub const NAMESPACE_METRICS_MAX_LABELS: usize = 32;
+
+// Warm restart (see warm_restart): the hot set a draining node leaves for its
+// successor. Entries come from the manifest cache, most recent first; a file
+// older than the max age describes a workload that has moved on and is
+// ignored. Warming holds /ready back, so it stops at whichever budget runs
+// out first.
+pub const WARM_RESTART_HOT_SET_MAX_ENTRIES: usize = 65_536;
+pub const WARM_RESTART_HOT_SET_MAX_AGE_MS: u64 = 60 * 60 * 1_000;
+pub const WARM_RESTART_TIME_BUDGET_MS: u64 = 20_000;
+pub const WARM_RESTART_READAHEAD_BUDGET_BYTES: u64 = 1024 * 1024 * 1024;
+
+// At-rest segment compression (see segment::compression): the body size window
+// (bodies are compressed and decoded in memory, so the upper bound is also the
+// most a decoded read materializes), the zstd level, the sample tried before a
+// full pass, and the largest stored/original ratio still worth decoding.
+pub const SEGMENT_COMPRESSION_MIN_BYTES: u64 = 4 * 1024;
+pub const SEGMENT_COMPRESSION_MAX_BYTES: u64 = 16 * 1024 * 1024;
+pub const SEGMENT_COMPRESSION_LEVEL: i32 = 3;
+pub const SEGMENT_COMPRESSION_SAMPLE_BYTES: usize = 64 * 1024;
+pub const SEGMENT_COMPRESSION_MAX_RATIO_PERCENT: u64 = 90;
 
 pub const ROCKSDB_CF_MANIFESTS: &str = "manifests";
 
@@ -0,0 +1,449 @@
+//! Weighted fair admission for contended node resources.
+//!
+//! The file-descriptor pool and the memory budgets hand out capacity first
+//! come, first served, so one namespace's clean-build upload of thousands of
+//! artifacts can fill every queue and leave another team's interactive reads
+//! waiting behind it. Each public request therefore carries an
+//! [`AdmissionFlow`] in a task-local (tenant, namespace and traffic class,
+//! filled in by the HTTP middleware and by REAPI authorization), and the
+//! contended waits go through a [`FairQueue`] first.
+//!
+//! A fair queue lets one waiter at a time, the holder of the turn, wait on
+//! the underlying FIFO resource. Everyone else waits in a queue per flow,
+//! and a released turn goes to the next flow by deficit round robin: each
+//! visit credits a flow `quantum × weight`, and its oldest waiter is admitted
+//! once the credit covers its cost (one descriptor, or the bytes it
+//! reserves). A flow's weight is its class weight (`KURA_ADMISSION_READ_WEIGHT`
+//! for reads, 1 for writes and background work) times its namespace weight
+//! from `KURA_NAMESPACE_WEIGHTS`. An uncontended acquisition takes the turn
+//! and hands it back without queueing.
+
+use std::{
+    collections::{HashMap, VecDeque},
+    future::Future,
+    sync::{Arc, Mutex},
+    time::Instant,
+};
+
+use arc_swap::ArcSwap;
+use axum::http::Method;
+use tokio::sync::oneshot;
+
+use crate::{
+    constants::DEFAULT_ADMISSION_READ_WEIGHT, metrics::Metrics,
+    namespace_share::NamespaceShareConfig,
+};
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub enum TrafficClass {
+    Read,
+    Write,
+    /// Replication, backfill and maintenance: anything outside a public
+    /// request scope.
+    Background,
+}
+
+impl TrafficClass {
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Self::Read => "read",
+            Self::Write => "write",
+            Self::Background => "background",
+        }
+    }
+
+    /// The class of a public HTTP request by method.
+    pub fn for_http_method(method: &Method) -> Self {
+        if *method == Method::GET || *method == Method::HEAD {
+            Self::Read
+        } else {
+            Self::Write
+        }
+    }
+}
+
+#[derive(Clone, Debug, PartialEq, Eq, Hash)]
+struct FlowKey {
+    tenant_id: String,
+    namespace_id: String,
+    class: TrafficClass,
+}
+
+/// Who a request is, as far as admission is concerned. REAPI learns the
+/// namespace only once the request (or its first stream chunk) is decoded,
+/// so the key can be filled in after the scope starts.
+pub struct AdmissionFlow {
+    key: Mutex<FlowKey>,
+}
+
+impl AdmissionFlow {
+    pub fn new(tenant_id: &str, namespace_id: Option<&str>, class: TrafficClass) -> Self {
+        Self {
+            key: Mutex::new(FlowKey {
+                tenant_id: tenant_id.to_owned(),
+                namespace_id: namespace_id.unwrap_or_default().to_owned(),
+                class,
+            }),
+        }
+    }
+}
+
+tokio::task_local! {
+    static CURRENT: Arc<AdmissionFlow>;
+}
+
+/// Runs `future` as a request of `flow`.
+pub async fn scope<F: Future>(flow: Arc<AdmissionFlow>, future: F) -> F::Output {
+    CURRENT.scope(flow, future).await
+}
+
+/// Fills in the namespace and class of the request in scope, if any.
+pub fn note_request(namespace_id: &str, class: TrafficClass) {
+    let _ = CURRENT.try_with(|flow| {
+        let mut key = flow.key.lock().expect("admission flow lock poisoned");
+        key.namespace_id = namespace_id.to_owned();
+        key.class = class;
+    });
+}
+
+fn current_key() -> FlowKey {
+    CURRENT
+        .try_with(|flow| {
+            flow.key
+                .lock()
+                .expect("admission flow lock poisoned")
+                .clone()
+        })
+        .unwrap_or(FlowKey {
+            tenant_id: String::new(),
+            namespace_id: String::new(),
+            class: TrafficClass::Background,
+        })
+}
+
+/// Class and namespace weights shared by every fair queue on the node.
+#[derive(Clone, Debug)]
+pub struct FairnessWeights {
+    read_weight: u64,
+    namespaces: NamespaceShareConfig,
+}
+
+impl Default for FairnessWeights {
+    fn default() -> Self {
+        Self {
+            read_weight: DEFAULT_ADMISSION_READ_WEIGHT,
+            namespaces: NamespaceShareConfig::default(),
+        }
+    }
+}
+
+impl FairnessWeights {
+    pub fn new(read_weight: u64, namespaces: NamespaceShareConfig) -> Self {
+        Self {
+            read_weight: read_weight.max(1),
+            namespaces,
+        }
+    }
+
+    fn weight(&self, key: &FlowKey) -> u64 {
+        let class_weight = match key.class {
+            TrafficClass::Read => self.read_weight,
+            TrafficClass::Write | TrafficClass::Background => 1,
+        };
+        class_weight.saturating_mul(self.namespaces.weight(&key.namespace_id))
+    }
+}
+
+#[derive(Clone)]
+pub struct FairQueue {
+    inner: Arc<FairQueueInner>,
+}
+
+struct FairQueueInner {
+    resource: &'static str,
+    quantum: u64,
+    weights: ArcSwap<FairnessWeights>,
+    state: Mutex<QueueState>,
+    metrics: Metrics,
+}
+
+#[derive(Default)]
+struct QueueState {
+    turn_taken: bool,
+    flows: HashMap<FlowKey, FlowQueue>,
+    /// Flows with waiters, in round-robin order; the front is being served.
+    round: VecDeque<FlowKey>,
+}
+
+struct FlowQueue {
+    weight: u64,
+    deficit: u64,
+    credited: bool,
+    waiters: VecDeque<Waiter>,
+}
+
+struct Waiter {
+    cost: u64,
+    grant: oneshot::Sender<FairTurn>,
+}
+
+impl QueueState {
+    fn enqueue(&mut self, key: FlowKey, weight: u64, waiter: Waiter) {
+        let flow = self.flows.entry(key.clone()).or_insert_with(|| FlowQueue {
+            weight,
+            deficit: 0,
+            credited: false,
+            waiters: VecDeque::new(),
+        });
+        if flow.waiters.is_empty() {
+            self.round.push_back(key);
+        }
+        flow.waiters.push_back(waiter);
+    }
+
+    /// Picks the next waiter by deficit round robin, skipping waiters that
+    /// gave up. A flow that runs out of waiters leaves the round and forfeits
+    /// its credit.
+    fn next_waiter(&mut self, quantum: u64) -> Option<oneshot::Sender<FairTurn>> {
+        loop {
+            let key = self.round.front()?;
+            let flow = self
+                .flows
+                .get_mut(key)
+                .expect("every flow in the round has a queue");
+            while flow
+                .waiters
+                .front()
+                .is_some_and(|waiter| waiter.grant.is_closed())
+            {
+                flow.waiters.pop_front();
+            }
+            let Some(cost) = flow.waiters.front().map(|waiter| waiter.cost) else {
+                let key = self.round.pop_front().expect("front flow exists");
+                self.flows.remove(&key);
+                continue;
+            };
+            if !flow.credited {
+                flow.deficit = flow
+                    .deficit
+                    .saturating_add(quantum.saturating_mul(flow.weight));
+                flow.credited = true;
+            }
+            if cost <= flow.deficit {
+                flow.deficit -= cost;
+                let waiter = flow.waiters.pop_front().expect("front waiter exists");
+                if flow.waiters.is_empty() {
+                    let key = self.round.pop_front().expect("front flow exists");
+                    self.flows.remove(&key);
+                }
+                return Some(waiter.grant);
+            }
+            flow.credited = false;
+            self.round.rotate_left(1);
+        }
+    }
+}
+
+impl FairQueue {
+    /// `quantum` is the cost a weight-1 flow is credited per round: one for
+    /// descriptor slots, a typical reservation for byte budgets.
+    pub fn new(resource: &'static str, quantum: u64, metrics: Metrics) -> Self {
+        Self {
+            inner: Arc::new(FairQueueInner {
+                resource,
+                quantum: quantum.max(1),
+                weights: ArcSwap::from_pointee(FairnessWeights::default()),
+                state: Mutex::new(QueueState::default()),
+                metrics,
+            }),
+        }
+    }
+
+    pub fn set_weights(&self, weights: Arc<FairnessWeights>) {
+        self.inner.weights.store(weights);
+    }
+
+    /// Waits for the turn to acquire `cost` of the underlying resource. Hold
+    /// the turn only while waiting on that resource: dropping it passes the
+    /// turn on and records the wait.
+    pub async fn turn(&self, cost: u64) -> FairTurn {
+        let key = current_key();
+        let started_at = Instant::now();
+        let receiver = {
+            let mut state = self.inner.state.lock().expect("fair queue lock poisoned");
+            if !state.turn_taken {
+                state.turn_taken = true;
+                return FairTurn {
+                    queue: Some(self.inner.clone()),
+                    class: Some(key.class),
+                    started_at,
+                };
+            }
+            let (grant, receiver) = oneshot::channel();
+            let weight = self.inner.weights.load().weight(&key);
+            state.enqueue(key.clone(), weight, Waiter { cost, grant });
+            receiver
+        };
+        match receiver.await {
+            Ok(mut turn) => {
+                turn.class = Some(key.class);
+                turn.started_at = started_at;
+                turn
+            }
+            // The queue was torn down under us; nothing left to be fair to.
+            Err(_) => FairTurn {
+                queue: None,
+                class: None,
+                started_at,
+            },
+        }
+    }
+}
+
+/// The right to wait on a resource next.
+pub struct FairTurn {
+    queue: Option<Arc<FairQueueInner>>,
+    /// Unset while the turn sits undelivered in a waiter's channel.
+    class: Option<TrafficClass>,
+    started_at: Instant,
+}
+
+impl Drop for FairTurn {
+    fn drop(&mut self) {
+        let Some(queue) = self.queue.take() else {
+            return;
+        };
+        if let Some(class) = self.class {
+            queue.metrics.observe_admission_wait(
+                queue.resource,
+                class.as_str(),
+                self.started_at.elapsed(),
+            );
+        }
+        hand_off(&queue);
+    }
+}
+
+fn hand_off(queue: &Arc<FairQueueInner>) {
+    loop {
+        let grant = {
+            let mut state = queue.state.lock().expect("fair queue lock poisoned");
+            match state.next_waiter(queue.quantum) {
+                Some(grant) => grant,
+                None => {
+                    state.turn_taken = false;
+                    return;
+                }
+            }
+        };
+        let turn = FairTurn {
+            queue: Some(queue.clone()),
+            class: None,
+            started_at: Instant::now(),
+        };
+        // A waiter that gave up between being picked and the send hands the
+        // turn back here rather than through its drop.
+        match grant.send(turn) {
+            Ok(()) => return,
+            Err(mut turn) => turn.queue = None,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn key(namespace_id: &str, class: TrafficClass) -> FlowKey {
+        FlowKey {
+            tenant_id: "tenant".to_owned(),
+            namespace_id: namespace_id.to_owned(),
+            class,
+        }
+    }
+
+    fn enqueue(
+        state: &mut QueueState,
+        weights: &FairnessWeights,
+        flow: FlowKey,
+    ) -> oneshot::Receiver<FairTurn> {
+        let (grant, receiver) = oneshot::channel();
+        let weight = weights.weight(&flow);
+        state.enqueue(flow, weight, Waiter { cost: 1, grant });
+        receiver
+    }
+
+    fn unarmed_turn() -> FairTurn {
+        FairTurn {
+            queue: None,
+            class: None,
+            started_at: Instant::now(),
+        }
+    }
+
+    #[test]
+    fn a_bulk_writer_cannot_starve_reads_from_another_namespace() {
+        let weights = FairnessWeights::default();
+        let mut state = QueueState::default();
+        let mut waiters = Vec::new();
+        for _ in 0..6 {
+            waiters.push((
+                "write",
+                enqueue(&mut state, &weights, key("bulk", TrafficClass::Write)),
+            ));
+        }
+        for _ in 0..4 {
+            waiters.push((
+                "read",
+                enqueue(&mut state, &weights, key("interactive", TrafficClass::Read)),
+            ));
+        }
+
+        let mut order = Vec::new();
+        while let Some(grant) = state.next_waiter(1) {
+            assert!(grant.send(unarmed_turn()).is_ok());
+            let class = waiters
+                .iter_mut()
+                .find_map(|(class, receiver)| receiver.try_recv().is_ok().then_some(*class))
+                .expect("the grant reached a waiter");
+            order.push(class);
+        }
+
+        // The write flow gets its one slot per round, the read flow its four.
+        assert_eq!(&order[..5], ["write", "read", "read", "read", "read"]);
+        assert_eq!(order.len(), 10);
+        assert!(state.round.is_empty() && state.flows.is_empty());
+    }
+
+    #[test]
+    fn waiters_that_gave_up_are_skipped() {
+        let weights = FairnessWeights::default();
+        let mut state = QueueState::default();
+        let gone = enqueue(&mut state, &weights, key("ns", TrafficClass::Read));
+        let mut kept = enqueue(&mut state, &weights, key("ns", TrafficClass::Read));
+        drop(gone);
+
+        let grant = state.next_waiter(1).expect("one waiter is still there");
+        assert!(grant.send(unarmed_turn()).is_ok());
+
+        assert!(kept.try_recv().is_ok());
+        assert!(state.next_waiter(1).is_none());
+    }
+
+    #[tokio::test]
+    async fn the_turn_passes_to_the_next_waiter_when_dropped() {
+        let queue = FairQueue::new("test", 1, Metrics::new("region".into(), "tenant".into()));
+        let first = queue.turn(1).await;
+        let waiting = tokio::spawn({
+            let queue = queue.clone();
+            async move { drop(queue.turn(1).await) }
+        });
+        tokio::task::yield_now().await;
+        assert!(!waiting.is_finished());
+
+        drop(first);
+
+        waiting.await.expect("second waiter gets the turn");
+        assert!(!queue.inner.state.lock().unwrap().turn_taken);
+    }
+}
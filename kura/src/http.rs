@@ -25,15 +25,21 @@ use tracing::{Instrument, field};
 
 use crate::{
     artifact::{manifest::ArtifactManifest, producer::ArtifactProducer},
-    auth::{AccessDecision, RequestContext},
+    auth::{AccessDecision, ConnectionAuth, RequestContext},
+    backfill::tree::{
+        TREE_FANOUT, TREE_LEGACY_DEPTH, TREE_MAX_DEPTH, TREE_MIN_DEPTH, TreeBounds, encode_digest,
+        leaf_of, level_width,
+    },
     bandwidth::BandwidthLimiter,
     constants::{
-        BACKFILL_BODIES_BATCH_BYTES, MAX_BACKFILL_BODIES_ENTRIES,
-        MAX_BACKFILL_BODIES_REQUEST_BYTES, MAX_GRADLE_BYTES, MAX_INLINE_REPLICATION_BODY_BYTES,
-        MAX_MODULE_PART_BYTES, MAX_MODULE_TOTAL_BYTES, MAX_PEER_PAGE_ITEMS,
-        MAX_REPLICATION_BODY_BYTES, MAX_XCODE_BYTES, RESPONSE_STREAM_MIN_CHUNK_BYTES,
-        response_stream_chunk_bytes,
+        BACKFILL_BODIES_BATCH_BYTES, BACKFILL_TREE_LEAVES_PER_REQUEST, MAX_BACKFILL_BODIES_ENTRIES,
+        MAX_BACKFILL_BODIES_REQUEST_BYTES, MAX_BATCH_GET_ITEMS, MAX_BATCH_GET_REQUEST_BYTES,
+        MAX_GRADLE_BYTES, MAX_INLINE_REPLICATION_BODY_BYTES, MAX_MODULE_PART_BYTES,
+        MAX_MODULE_TOTAL_BYTES, MAX_PEER_PAGE_ITEMS, MAX_REPLICATION_BODY_BYTES, MAX_XCODE_BYTES,
+        RESPONSE_STREAM_CHUNK_BYTES, RESPONSE_STREAM_MIN_CHUNK_BYTES, response_stream_chunk_bytes,
     },
+    fair_admission,
+    inflight_uploads::{FollowOutcome, FollowRange, OpenUpload},
     io::is_fd_pool_exhausted_error,
     memory::{
         MemoryPressure, ResponseStreamAdmissionPatience, ResponseStreamMemoryPermit,
@@ -42,18 +48,21 @@ use crate::{
     metrics::Metrics,
     multipart::error::MultipartError,
     peer_tls::InternalPeerIdentity,
+    profiling,
     replication::replication_targets,
     runtime::{HttpTrafficClass, InflightGuard},
+    stage_timing::{self, Stage},
     state::SharedState,
     store::{
         BACKFILL_STALE_RETIRE_BATCH, BackfillIndexPage, StagedArtifactPath, backfill_record_kind,
         is_disk_full_error, is_multipart_capacity_error, is_outbox_full_error, manifest_version_ms,
     },
+    tasks,
     telemetry::{attach_parent_context, record_trace_context},
     utils::{
         BACKFILL_IDX_PREFIX, BackfillRecordKind, BodyReadError, RequestBodyStaging,
-        TempFileCleanup, TmpReservation, action_cache_key, blob_key, module_key,
-        read_request_to_temp, temp_file_path,
+        SplicedRequestBody, TempFileCleanup, TmpReservation, action_cache_key, blob_key,
+        module_key, read_request_to_temp, splice_request_to_temp, temp_file_path,
     },
 };
 
@@ -71,6 +80,7 @@ const ROUTE_API_METRO_CACHE: &str = "/api/metro/cache/{cache_key}";
 const ROUTE_API_CACHE_KEYVALUE_ID: &str = "/api/cache/keyvalue/{cas_id}";
 const ROUTE_API_CACHE_KEYVALUE: &str = "/api/cache/keyvalue";
 const ROUTE_API_CACHE_CAS: &str = "/api/cache/cas/{id}";
+const ROUTE_API_CACHE_BATCH: &str = "/api/cache/batch";
 const ROUTE_API_CACHE_MODULE: &str = "/api/cache/module/{id}";
 const ROUTE_API_CACHE_MODULE_START: &str = "/api/cache/module/start";
 const ROUTE_API_CACHE_MODULE_PART: &str = "/api/cache/module/part";
@@ -80,19 +90,27 @@ const ROUTE_API_CACHE_GRADLE: &str = "/api/cache/gradle/{cache_key}";
 const ROUTE_INTERNAL_STATUS: &str = "/_internal/status";
 const ROUTE_INTERNAL_BACKFILL_ENTRIES: &str = "/_internal/backfill/entries";
 const ROUTE_INTERNAL_BACKFILL_BODIES: &str = "/_internal/backfill/bodies";
+// The anti-entropy reconcile routes (see `backfill::tree`).
+const ROUTE_INTERNAL_BACKFILL_TREE_NODES: &str = "/_internal/backfill/tree/nodes";
+const ROUTE_INTERNAL_BACKFILL_TREE_ENTRIES: &str = "/_internal/backfill/tree/entries";
 // The oversized-entry path of the backfill protocol.
 const ROUTE_INTERNAL_BACKFILL_ARTIFACT: &str = "/_internal/backfill/artifacts/{artifact_id}";
 const ROUTE_INTERNAL_REPLICATE_ARTIFACT: &str = "/_internal/replicate/artifact";
+const ROUTE_INTERNAL_REPLICATE_LINK: &str = "/_internal/replicate/link";
 const ROUTE_INTERNAL_REPLICATE_NAMESPACE: &str = "/_internal/replicate/namespace";
+const ROUTE_INTERNAL_PROFILE_CPU: &str = "/_internal/profile/cpu";
+const ROUTE_INTERNAL_PROFILE_HEAP: &str = "/_internal/profile/heap";
+const ROUTE_INTERNAL_MRC: &str = "/_internal/mrc";
 const UNMATCHED_ROUTE: &str = "/_unmatched";
 
-const EXACT_ROUTE_TEMPLATES: [&str; 15] = [
+const EXACT_ROUTE_TEMPLATES: [&str; 22] = [
     ROUTE_UP,
     ROUTE_READY,
     ROUTE_ROLLOUT_STATUS,
     ROUTE_STATUS_CLUSTER,
     ROUTE_METRICS,
     ROUTE_API_CACHE_KEYVALUE,
+    ROUTE_API_CACHE_BATCH,
     ROUTE_API_CACHE_MODULE_START,
     ROUTE_API_CACHE_MODULE_PART,
     ROUTE_API_CACHE_MODULE_COMPLETE,
@@ -100,8 +118,14 @@ const EXACT_ROUTE_TEMPLATES: [&str; 15] = [
     ROUTE_INTERNAL_STATUS,
     ROUTE_INTERNAL_BACKFILL_ENTRIES,
     ROUTE_INTERNAL_BACKFILL_BODIES,
+    ROUTE_INTERNAL_BACKFILL_TREE_NODES,
+    ROUTE_INTERNAL_BACKFILL_TREE_ENTRIES,
     ROUTE_INTERNAL_REPLICATE_ARTIFACT,
+    ROUTE_INTERNAL_REPLICATE_LINK,
     ROUTE_INTERNAL_REPLICATE_NAMESPACE,
+    ROUTE_INTERNAL_PROFILE_CPU,
+    ROUTE_INTERNAL_PROFILE_HEAP,
+    ROUTE_INTERNAL_MRC,
 ];
 
 const DYNAMIC_ROUTE_TEMPLATES: [&str; 7] = [
@@ -256,6 +280,7 @@ fn public_routes() -> Router<SharedState> {
         .route(ROUTE_API_CACHE_KEYVALUE_ID, get(get_keyvalue))
         .route(ROUTE_API_CACHE_KEYVALUE, put(put_keyvalue))
         .route(ROUTE_API_CACHE_CAS, get(get_xcode).post(put_xcode))
+        .route(ROUTE_API_CACHE_BATCH, post(batch_get_xcode))
         .route(ROUTE_API_CACHE_MODULE, head(head_module).get(get_module))
         .route(ROUTE_API_CACHE_MODULE_START, post(start_module_upload))
         .route(ROUTE_API_CACHE_MODULE_PART, post(upload_module_part))
@@ -278,6 +303,14 @@ fn internal_routes() -> Router<SharedState> {
             ROUTE_INTERNAL_BACKFILL_BODIES,
             post(internal_backfill_bodies),
         )
+        .route(
+            ROUTE_INTERNAL_BACKFILL_TREE_NODES,
+            post(internal_backfill_tree_nodes),
+        )
+        .route(
+            ROUTE_INTERNAL_BACKFILL_TREE_ENTRIES,
+            post(internal_backfill_tree_entries),
+        )
         .route(
             ROUTE_INTERNAL_BACKFILL_ARTIFACT,
             get(internal_backfill_artifact),
@@ -286,10 +319,14 @@ fn internal_routes() -> Router<SharedState> {
             ROUTE_INTERNAL_REPLICATE_ARTIFACT,
             put(internal_replicate_artifact),
         )
+        .route(ROUTE_INTERNAL_REPLICATE_LINK, post(internal_replicate_link))
         .route(
             ROUTE_INTERNAL_REPLICATE_NAMESPACE,
             delete(internal_delete_namespace),
         )
+        .route(ROUTE_INTERNAL_PROFILE_CPU, get(internal_profile_cpu))
+        .route(ROUTE_INTERNAL_PROFILE_HEAP, get(internal_profile_heap))
+        .route(ROUTE_INTERNAL_MRC, get(internal_miss_ratio_curve))
 }
 
 const NX_NAMESPACE_ID: &str = "nx";
@@ -447,6 +484,13 @@ struct UsageContext {
     namespace_id: String,
 }
 
+/// Where an upload's body comes from: a Hyper request, or a plaintext HTTP/1
+/// connection the accelerator handed over with the body still unread.
+enum UploadBody<'a> {
+    Request(Request),
+    Spliced(&'a mut SplicedRequestBody),
+}
+
 #[derive(Clone)]
 struct BlobPutSpec<'a> {
     namespace_id: &'a str,
@@ -470,13 +514,7 @@ impl BackfillEntriesQuery {
         let after = params
             .get("after")
             .filter(|value| !value.is_empty())
-            .map(|value| {
-                let key = hex::decode(value).map_err(|error| format!("Invalid after: {error}"))?;
-                if !key.starts_with(BACKFILL_IDX_PREFIX.as_bytes()) {
-                    return Err("Invalid after: not a backfill index cursor".to_owned());
-                }
-                Ok(key)
-            })
+            .map(|value| decode_backfill_cursor(value))
             .transpose()?;
         let limit = params
             .get("limit")
@@ -499,6 +537,14 @@ impl BackfillEntriesQuery {
     }
 }
 
+fn decode_backfill_cursor(value: &str) -> Result<Vec<u8>, String> {
+    let key = hex::decode(value).map_err(|error| format!("Invalid after: {error}"))?;
+    if !key.starts_with(BACKFILL_IDX_PREFIX.as_bytes()) {
+        return Err("Invalid after: not a backfill index cursor".to_owned());
+    }
+    Ok(key)
+}
+
 /// Wire page of the backfill listing endpoint (the `ManifestPage` shape).
 /// `next_after` is the hex-encoded raw index key of the last returned row,
 /// opaque to requesters and fed back as the next request's `after`; `None`
@@ -575,6 +621,62 @@ pub struct BackfillBodiesRequest {
     pub entries: Vec<BackfillEntry>,
 }
 
+/// Request body of `POST /_internal/backfill/tree/nodes`: the nodes of one
+/// tree level whose digests the requester wants to compare against its own.
+/// A reconcile asks for the root, then for the children of every node that
+/// disagreed, down to the leaves.
+#[derive(Clone, Debug, PartialEq, Eq, Serialize, Deserialize)]
+pub struct BackfillTreeNodesRequest {
+    pub level: u32,
+    pub indices: Vec<usize>,
+    /// The requester's ring horizon; both trees cover only rows at or above
+    /// it. Absent from a requester that predates it, which compares whole
+    /// indexes.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub min_version_ms: Option<u64>,
+    /// The requester's settle bound; both trees cover only rows below it.
+    /// Absent from a requester that predates it.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub max_version_ms: Option<u64>,
+    /// How deep the requester compares, sized from its row count. Absent
+    /// from a requester that predates sized trees, which compares at
+    /// `TREE_LEGACY_DEPTH`.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub depth: Option<u32>,
+}
+
+/// Response of the tree nodes endpoint: hex digests in request order, plus
+/// the tree shape they were read at. A requester that gets back a shape
+/// other than the one it asked for (a peer that predates sized trees) cannot
+/// compare digests and stops instead of treating every node as mismatched.
+#[derive(Clone, Debug, PartialEq, Eq, Serialize, Deserialize)]
+pub struct BackfillTreeNodes {
+    pub fanout: usize,
+    pub depth: u32,
+    pub digests: Vec<String>,
+}
+
+/// Request body of `POST /_internal/backfill/tree/entries`: the mismatched
+/// leaves whose rows the requester wants listed. Answered with a
+/// [`BackfillEntriesPage`] whose cursor pages the same way as the window
+/// listing.
+#[derive(Clone, Debug, PartialEq, Eq, Serialize, Deserialize)]
+pub struct BackfillTreeEntriesRequest {
+    pub leaves: Vec<usize>,
+    /// Same bounds and depth as the nodes requests the leaves were found
+    /// with.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub min_version_ms: Option<u64>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub max_version_ms: Option<u64>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub depth: Option<u32>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub after: Option<String>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub limit: Option<usize>,
+}
+
 /// How a requested tuple resolved in a bodies response frame.
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
 pub enum BackfillBodyDisposition {
@@ -976,6 +1078,7 @@ async fn track_http_metrics(
     let _request_guard = state.start_http_request(traffic_class);
     let method = req.method().to_string();
     let uri_path = req.uri().path().to_owned();
+    let server_timing_requested = stage_timing::server_timing_requested(req.headers());
 
     let request_span = tracing::info_span!(
         "http.request",
@@ -988,11 +1091,36 @@ async fn track_http_metrics(
         otel.status_code = field::Empty,
         trace_id = field::Empty,
         span_id = field::Empty,
+        kura.stage.auth_ms = field::Empty,
+        kura.stage.admission_ms = field::Empty,
+        kura.stage.manifest_ms = field::Empty,
+        kura.stage.segment_open_ms = field::Empty,
+        kura.stage.first_read_ms = field::Empty,
+        kura.stage.transfer_ms = field::Empty,
     );
     attach_parent_context(&request_span, req.headers());
     record_trace_context(&request_span);
 
-    let response = next.run(req).instrument(request_span.clone()).await;
+    let stage_timings = (traffic_class == HttpTrafficClass::Public)
+        .then(|| Arc::new(stage_timing::StageTimings::default()));
+    let admission_flow = (traffic_class == HttpTrafficClass::Public).then(|| {
+        public_admission_flow(
+            &state,
+            &parse_query_map(req.uri().query()),
+            fair_admission::TrafficClass::for_http_method(req.method()),
+        )
+    });
+    let serve = next.run(req).instrument(request_span.clone());
+    let serve = async {
+        match admission_flow {
+            Some(flow) => fair_admission::scope(flow, serve).await,
+            None => serve.await,
+        }
+    };
+    let mut response = match &stage_timings {
+        Some(timings) => stage_timing::scope(timings.clone(), serve).await,
+        None => serve.await,
+    };
     request_span.record("http.response.status_code", response.status().as_u16());
     if response.status().is_server_error() {
         request_span.record("otel.status_code", "ERROR");
@@ -1006,9 +1134,34 @@ async fn track_http_metrics(
     }
     state.metrics.record_http(route, response.status(), elapsed);
 
+    if let Some(timings) = stage_timings {
+        if server_timing_requested
+            && let Ok(value) = HeaderValue::from_str(&timings.server_timing(elapsed))
+        {
+            response.headers_mut().insert("server-timing", value);
+        }
+        let stages = stage_timing::RequestStages::new(timings, state.clone(), "http", request_span);
+        response = response.map(|body| Body::new(stage_timing::StageTimedBody::new(body, stages)));
+    }
     response
 }
 
+/// The admission flow of a public request. The accelerated upload path
+/// builds the same one, since it never reaches this middleware. The tenant
+/// is the node's own, as for REAPI; a client-supplied one would let a
+/// request pick a fresh queue.
+pub(crate) fn public_admission_flow(
+    state: &SharedState,
+    query: &HashMap<String, String>,
+    class: fair_admission::TrafficClass,
+) -> Arc<fair_admission::AdmissionFlow> {
+    Arc::new(fair_admission::AdmissionFlow::new(
+        &state.config.tenant_id,
+        param_value(query, "namespace_id").map(String::as_str),
+        class,
+    ))
+}
+
 fn is_public_load_route(route: &str) -> bool {
     !is_probe_route(route) && !route.starts_with("/_internal/") && route != UNMATCHED_ROUTE
 }
@@ -1020,9 +1173,15 @@ async fn reject_draining_public_requests(
 ) -> Response {
     let route = request_route(&req);
     let version = req.version();
+    let advertises_alt_svc =
+        !is_probe_route(&route) && req.extensions().get::<TlsConnection>().is_some();
 
     if !is_probe_route(&route) && state.runtime.is_draining() {
-        return draining_response(version);
+        let mut response = draining_response(version);
+        if advertises_alt_svc {
+            advertise_alt_svc(&state, &mut response);
+        }
+        return response;
     }
 
     let mut response = next.run(req).await;
@@ -1032,9 +1191,38 @@ async fn reject_draining_public_requests(
             HeaderValue::from_static("close"),
         );
     }
+    if advertises_alt_svc {
+        advertise_alt_svc(&state, &mut response);
+    }
     response
 }
 
+/// Marks a request that arrived over the public TLS listener. HTTP/3 needs
+/// TLS, and an alternative advertised over plaintext could be set by anyone
+/// on the path, so only these requests get `Alt-Svc`.
+#[derive(Clone, Copy)]
+pub(crate) struct TlsConnection;
+
+/// Points clients at the configured HTTP/3 endpoint, and tells them to drop
+/// it once this node drains so they do not come back over QUIC to a node
+/// that is going away.
+fn advertise_alt_svc(state: &SharedState, response: &mut Response) {
+    let Some(alt_svc) = state.config.alt_svc.as_deref() else {
+        return;
+    };
+    let value = if state.runtime.is_draining() {
+        HeaderValue::from_static("clear")
+    } else {
+        match HeaderValue::from_str(alt_svc) {
+            Ok(value) => value,
+            Err(_) => return,
+        }
+    };
+    response
+        .headers_mut()
+        .insert(axum::http::header::ALT_SVC, value);
+}
+
 async fn reject_overloaded_public_writes(
     State(state): State<SharedState>,
     req: Request,
@@ -1043,24 +1231,40 @@ async fn reject_overloaded_public_writes(
     let method = req.method().clone();
     let route = request_route(&req);
 
-    if is_write_method(&method) && !is_probe_route(&route) {
-        if state.memory.pressure() == MemoryPressure::Critical {
-            state
-                .metrics
-                .record_memory_action("write_rejected_critical");
-            return overloaded_response("server is shedding writes due to memory pressure");
-        }
-        if state.store.outbox_depth() >= state.config.outbox_max_depth {
-            state.metrics.record_memory_action("write_rejected_outbox");
-            return overloaded_response("server is shedding writes while replication catches up");
-        }
+    if is_write_method(&method)
+        && !is_probe_route(&route)
+        && let Some((action, message)) = public_write_shed_reason(&state)
+    {
+        state.metrics.record_memory_action(action);
+        return overloaded_response(message);
     }
 
     next.run(req).await
 }
 
+/// Why public writes are being shed, if they are: the memory action to record
+/// and the message to answer with. The accelerated upload path checks this
+/// before consuming a request so a shed upload is answered here.
+pub(crate) fn public_write_shed_reason(
+    state: &SharedState,
+) -> Option<(&'static str, &'static str)> {
+    if state.memory.pressure() == MemoryPressure::Critical {
+        return Some((
+            "write_rejected_critical",
+            "server is shedding writes due to memory pressure",
+        ));
+    }
+    if state.store.outbox_depth() >= state.config.outbox_max_depth {
+        return Some((
+            "write_rejected_outbox",
+            "server is shedding writes while replication catches up",
+        ));
+    }
+    None
+}
+
 /// Fast-fails peer replication writes (PUT /_internal/replicate/artifact,
-/// DELETE /_internal/replicate/namespace) when the pod is under Critical
+/// POST /_internal/replicate/link, DELETE /_internal/replicate/namespace) when the pod is under Critical
 /// memory pressure. Without this guard the pod accepts the TCP connection but
 /// stalls while processing the body, so the source peer sees no progress and
 /// abandons the attempt only when its upload stall watchdog expires
@@ -1152,7 +1356,13 @@ async fn authorize_request(State(state): State<SharedState>, req: Request, next:
     )
     .await;
 
-    if let AccessDecision::Deny(deny) = auth.evaluate_access(&context).await {
+    let connection = req.extensions().get::<Arc<ConnectionAuth>>().cloned();
+    let decision = {
+        let _auth = stage_timing::enter(Stage::Auth);
+        auth.evaluate_access_on_connection(&context, connection.as_deref())
+            .await
+    };
+    if let AccessDecision::Deny(deny) = decision {
         return error_response(status_from_u16(deny.status), deny.message);
     }
 
@@ -1274,6 +1484,14 @@ async fn http_request_metadata(
             artifact_key: last_path_segment.as_deref().map(blob_key),
             artifact_hash: last_path_segment.clone(),
         },
+        ROUTE_API_CACHE_BATCH => HttpRequestMetadata {
+            operation: "artifact.read".into(),
+            tenant_id,
+            namespace_id,
+            producer: Some("xcode".into()),
+            artifact_key: None,
+            artifact_hash: None,
+        },
         ROUTE_API_CACHE_GRADLE => HttpRequestMetadata {
             operation: if method.eq_ignore_ascii_case("GET") {
                 "artifact.read"
@@ -1607,7 +1825,369 @@ async fn get_keyvalue(
     }
 }
 
-async fn get_nx(AxumPath(hash): AxumPath<String>, State(state): State<SharedState>) -> Response {
+/// Ids of one Xcode multi-get request. CAS ids are answered first, then
+/// keyvalue ids, each in request order.
+#[derive(Debug, Default, Deserialize, Serialize)]
+struct BatchGetRequest {
+    #[serde(default)]
+    cas: Vec<String>,
+    #[serde(default)]
+    keyvalue: Vec<String>,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum BatchGetItemKind {
+    Cas,
+    KeyValue,
+}
+
+impl BatchGetItemKind {
+    fn as_byte(self) -> u8 {
+        match self {
+            Self::Cas => 0,
+            Self::KeyValue => 1,
+        }
+    }
+
+    fn as_str(self) -> &'static str {
+        match self {
+            Self::Cas => "cas",
+            Self::KeyValue => "keyvalue",
+        }
+    }
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum BatchGetItemStatus {
+    Hit,
+    Miss,
+    /// Not answered in the batch (no memory for it, an upload still in
+    /// flight, a storage error); the client asks for it with a single GET.
+    FetchIndividually,
+}
+
+impl BatchGetItemStatus {
+    fn as_byte(self) -> u8 {
+        match self {
+            Self::Hit => 0,
+            Self::Miss => 1,
+            Self::FetchIndividually => 2,
+        }
+    }
+
+    fn as_str(self) -> &'static str {
+        match self {
+            Self::Hit => "hit",
+            Self::Miss => "miss",
+            Self::FetchIndividually => "fetch_individually",
+        }
+    }
+}
+
+const BATCH_GET_CONTENT_TYPE: &str = "application/vnd.kura.batch-get";
+const BATCH_GET_FRAME_HEADER_BYTES: usize = 12;
+
+/// Encodes the header of one multi-get response frame. Every requested id
+/// gets exactly one frame (integers big-endian):
+///
+/// | field      | width          | contents                                |
+/// |------------|----------------|-----------------------------------------|
+/// | `kind`     | 1 byte         | 0 CAS, 1 keyvalue                       |
+/// | `status`   | 1 byte         | 0 hit, 1 miss, 2 fetch individually     |
+/// | `id_len`   | 2 bytes        | length of `id`                          |
+/// | `body_len` | 8 bytes        | body bytes following; 0 unless hit      |
+/// | `id`       | `id_len` bytes | the id as requested                     |
+/// | body       | `body_len`     | the same bytes a single GET returns     |
+fn encode_batch_get_frame_header(
+    kind: BatchGetItemKind,
+    status: BatchGetItemStatus,
+    id: &str,
+    body_len: u64,
+) -> Bytes {
+    let mut header = Vec::with_capacity(BATCH_GET_FRAME_HEADER_BYTES + id.len());
+    header.push(kind.as_byte());
+    header.push(status.as_byte());
+    // Ids are validated to fit before the response starts.
+    header.extend_from_slice(&(id.len() as u16).to_be_bytes());
+    header.extend_from_slice(&body_len.to_be_bytes());
+    header.extend_from_slice(id.as_bytes());
+    Bytes::from(header)
+}
+
+type BatchGetItemStream = futures_util::stream::BoxStream<'static, Result<Bytes, std::io::Error>>;
+
+/// Answers many Xcode CAS and keyvalue lookups in one streamed response of
+/// length-prefixed frames (see [`encode_batch_get_frame_header`]). Items are
+/// resolved one at a time as the client reads, so a batch holds one segment
+/// reader and at most one materialized body at once; bodies that need
+/// materializing go through the same budget as single GETs and come back as
+/// "fetch individually" rather than queueing when it is spent. Each item is
+/// booked in read, usage and analytics accounting like its single GET.
+async fn batch_get_xcode(
+    Query(params): Query<HashMap<String, String>>,
+    State(state): State<SharedState>,
+    request: Request,
+) -> Response {
+    let namespace = match NamespaceQuery::from_params(&params) {
+        Ok(namespace) => namespace,
+        Err(message) => return error_response(StatusCode::BAD_REQUEST, message),
+    };
+    let body = match to_bytes(request.into_body(), MAX_BATCH_GET_REQUEST_BYTES).await {
+        Ok(body) => body,
+        Err(error) => {
+            return error_response(
+                StatusCode::PAYLOAD_TOO_LARGE,
+                format!("Failed to read batch request: {error}"),
+            );
+        }
+    };
+    let batch: BatchGetRequest = match serde_json::from_slice(&body) {
+        Ok(batch) => batch,
+        Err(error) => {
+            return error_response(
+                StatusCode::BAD_REQUEST,
+                format!("Invalid batch request: {error}"),
+            );
+        }
+    };
+    let items = batch
+        .cas
+        .into_iter()
+        .map(|id| (BatchGetItemKind::Cas, id))
+        .chain(
+            batch
+                .keyvalue
+                .into_iter()
+                .map(|id| (BatchGetItemKind::KeyValue, id)),
+        )
+        .collect::<Vec<_>>();
+    if items.len() > MAX_BATCH_GET_ITEMS {
+        return error_response(
+            StatusCode::BAD_REQUEST,
+            format!("A batch may request at most {MAX_BATCH_GET_ITEMS} ids"),
+        );
+    }
+    if items
+        .iter()
+        .any(|(_, id)| id.is_empty() || id.len() > usize::from(u16::MAX))
+    {
+        return error_response(
+            StatusCode::BAD_REQUEST,
+            "Batch ids must be non-empty and at most 65535 bytes",
+        );
+    }
+    state.metrics.observe_batch_get_request(items.len());
+
+    let permit = match state
+        .memory
+        .acquire_response_stream_memory(
+            RESPONSE_STREAM_MIN_CHUNK_BYTES.saturating_mul(4),
+            "http",
+            ResponseStreamAdmissionPatience::Degradable,
+        )
+        .await
+    {
+        Ok(permit) => permit,
+        Err(_) => return response_stream_unavailable(),
+    };
+    let request_guard = state.start_http_request(HttpTrafficClass::Public);
+    let metrics = state.metrics.clone();
+    let namespace = Arc::new(namespace);
+    let stream = futures_util::stream::iter(items)
+        .then(move |(kind, id)| {
+            let state = state.clone();
+            let namespace = namespace.clone();
+            async move {
+                match kind {
+                    BatchGetItemKind::Cas => batch_get_cas_item(&state, &namespace, id).await,
+                    BatchGetItemKind::KeyValue => batch_get_keyvalue_item(&state, &namespace, id),
+                }
+            }
+        })
+        .flatten();
+    let stream = InstrumentedArtifactStream::new(
+        metrics,
+        ArtifactProducer::Xcode,
+        stream,
+        Some(request_guard),
+    );
+    let mut response = Response::new(Body::from_stream(stream));
+    response.headers_mut().insert(
+        axum::http::header::CONTENT_TYPE,
+        HeaderValue::from_static(BATCH_GET_CONTENT_TYPE),
+    );
+    attach_response_stream_permit(&mut response, permit);
+    response
+}
+
+fn batch_get_frame(
+    state: &SharedState,
+    kind: BatchGetItemKind,
+    status: BatchGetItemStatus,
+    id: &str,
+) -> BatchGetItemStream {
+    state
+        .metrics
+        .record_batch_get_item(kind.as_str(), status.as_str());
+    let result = match status {
+        BatchGetItemStatus::Hit => "ok",
+        BatchGetItemStatus::Miss => "not_found",
+        BatchGetItemStatus::FetchIndividually => "deferred",
+    };
+    state
+        .metrics
+        .record_artifact_read(ArtifactProducer::Xcode, result, 0);
+    futures_util::stream::once(std::future::ready(Ok(encode_batch_get_frame_header(
+        kind, status, id, 0,
+    ))))
+    .boxed()
+}
+
+async fn batch_get_cas_item(
+    state: &SharedState,
+    namespace: &NamespaceQuery,
+    id: String,
+) -> BatchGetItemStream {
+    let kind = BatchGetItemKind::Cas;
+    let key = blob_key(&id);
+    let manifest = match state
+        .store
+        .fetch_artifact_for_serving(ArtifactProducer::Xcode, &namespace.namespace_id, &key)
+        .await
+    {
+        Ok(Some(manifest)) => manifest,
+        Ok(None)
+            if state
+                .inflight_uploads
+                .follow(ArtifactProducer::Xcode, &namespace.namespace_id, &key)
+                .is_some() =>
+        {
+            return batch_get_frame(state, kind, BatchGetItemStatus::FetchIndividually, &id);
+        }
+        Ok(None) => return batch_get_frame(state, kind, BatchGetItemStatus::Miss, &id),
+        Err(_) => {
+            return batch_get_frame(state, kind, BatchGetItemStatus::FetchIndividually, &id);
+        }
+    };
+    // Inline and compressed bodies are read into memory before they stream.
+    let materialization = if manifest.inline || manifest.stored_encoding.is_some() {
+        match state
+            .memory
+            .try_acquire_response_materialization(manifest.size as usize)
+        {
+            Ok(permit) => permit,
+            Err(()) => {
+                state
+                    .metrics
+                    .record_memory_action("batch_response_materialization_rejected");
+                return batch_get_frame(state, kind, BatchGetItemStatus::FetchIndividually, &id);
+            }
+        }
+    } else {
+        None
+    };
+    let (manifest, reader) = match state
+        .store
+        .open_artifact_reader_range_tolerating_promotion(&manifest, 0, None)
+        .await
+    {
+        Ok(Some(opened)) => opened,
+        Ok(None) => return batch_get_frame(state, kind, BatchGetItemStatus::Miss, &id),
+        Err(_) => {
+            return batch_get_frame(state, kind, BatchGetItemStatus::FetchIndividually, &id);
+        }
+    };
+    state
+        .metrics
+        .record_batch_get_item(kind.as_str(), BatchGetItemStatus::Hit.as_str());
+    state
+        .metrics
+        .record_artifact_read(ArtifactProducer::Xcode, "ok", manifest.size);
+    record_usage_event(
+        state,
+        ArtifactProducer::Xcode,
+        "download",
+        Some(&namespace.usage_context()),
+        manifest.size,
+    );
+    record_project_scoped_cache_event(
+        state,
+        ArtifactProducer::Xcode,
+        "download",
+        namespace.project_analytics_context(),
+        &id,
+        manifest.size,
+    );
+    let header = encode_batch_get_frame_header(kind, BatchGetItemStatus::Hit, &id, manifest.size);
+    futures_util::stream::once(std::future::ready(Ok(header)))
+        .chain(
+            ReaderStream::with_capacity(reader, RESPONSE_STREAM_MIN_CHUNK_BYTES).map(
+                move |chunk| {
+                    let _materialization = &materialization;
+                    chunk
+                },
+            ),
+        )
+        .boxed()
+}
+
+fn batch_get_keyvalue_item(
+    state: &SharedState,
+    namespace: &NamespaceQuery,
+    id: String,
+) -> BatchGetItemStream {
+    let kind = BatchGetItemKind::KeyValue;
+    let bytes = match state.store.fetch_inline_artifact_bytes(
+        ArtifactProducer::Xcode,
+        &namespace.namespace_id,
+        &action_cache_key(&id),
+    ) {
+        Ok(Some(bytes)) => bytes,
+        Ok(None) => return batch_get_frame(state, kind, BatchGetItemStatus::Miss, &id),
+        Err(_) => {
+            return batch_get_frame(state, kind, BatchGetItemStatus::FetchIndividually, &id);
+        }
+    };
+    let materialization = match state
+        .memory
+        .try_acquire_response_materialization(bytes.len())
+    {
+        Ok(permit) => permit,
+        Err(()) => {
+            state
+                .metrics
+                .record_memory_action("batch_response_materialization_rejected");
+            return batch_get_frame(state, kind, BatchGetItemStatus::FetchIndividually, &id);
+        }
+    };
+    let size = bytes.len() as u64;
+    state
+        .metrics
+        .record_batch_get_item(kind.as_str(), BatchGetItemStatus::Hit.as_str());
+    state
+        .metrics
+        .record_artifact_read(ArtifactProducer::Xcode, "ok", size);
+    record_usage_event(
+        state,
+        ArtifactProducer::Xcode,
+        "download",
+        Some(&namespace.usage_context()),
+        size,
+    );
+    let header = encode_batch_get_frame_header(kind, BatchGetItemStatus::Hit, &id, size);
+    futures_util::stream::iter([header, Bytes::from(bytes)])
+        .map(move |chunk| {
+            let _materialization = &materialization;
+            Ok(chunk)
+        })
+        .boxed()
+}
+
+async fn get_nx(
+    AxumPath(hash): AxumPath<String>,
+    State(state): State<SharedState>,
+    headers: HeaderMap,
+) -> Response {
     let usage = UsageContext {
         tenant_id: state.config.tenant_id.clone(),
         namespace_id: NX_NAMESPACE_ID.to_owned(),
@@ -1621,6 +2201,7 @@ async fn get_nx(AxumPath(hash): AxumPath<String>, State(state): State<SharedStat
         None,
         None,
         Some(usage),
+        accepts_zstd(&headers),
     )
     .await
 }
@@ -1630,6 +2211,10 @@ async fn put_nx(
     State(state): State<SharedState>,
     request: Request,
 ) -> Response {
+    put_nx_body(state, &hash, UploadBody::Request(request)).await
+}
+
+async fn put_nx_body(state: SharedState, hash: &str, body: UploadBody<'_>) -> Response {
     let usage = UsageContext {
         tenant_id: state.config.tenant_id.clone(),
         namespace_id: NX_NAMESPACE_ID.to_owned(),
@@ -1638,10 +2223,10 @@ async fn put_nx(
     put_blob_artifact(
         state,
         ArtifactProducer::Nx,
-        request,
+        body,
         BlobPutSpec {
             namespace_id: NX_NAMESPACE_ID,
-            key: &hash,
+            key: hash,
             analytics_key: None,
             max_bytes: MAX_MODULE_TOTAL_BYTES,
             success_status: StatusCode::OK,
@@ -1656,6 +2241,7 @@ async fn put_nx(
 async fn get_metro(
     AxumPath(cache_key): AxumPath<String>,
     State(state): State<SharedState>,
+    headers: HeaderMap,
 ) -> Response {
     let usage = UsageContext {
         tenant_id: state.config.tenant_id.clone(),
@@ -1670,6 +2256,7 @@ async fn get_metro(
         None,
         None,
         Some(usage),
+        accepts_zstd(&headers),
     )
     .await
 }
@@ -1679,6 +2266,10 @@ async fn put_metro(
     State(state): State<SharedState>,
     request: Request,
 ) -> Response {
+    put_metro_body(state, &cache_key, UploadBody::Request(request)).await
+}
+
+async fn put_metro_body(state: SharedState, cache_key: &str, body: UploadBody<'_>) -> Response {
     let usage = UsageContext {
         tenant_id: state.config.tenant_id.clone(),
         namespace_id: METRO_NAMESPACE_ID.to_owned(),
@@ -1687,10 +2278,10 @@ async fn put_metro(
     put_blob_artifact(
         state,
         ArtifactProducer::Metro,
-        request,
+        body,
         BlobPutSpec {
             namespace_id: METRO_NAMESPACE_ID,
-            key: &cache_key,
+            key: cache_key,
             analytics_key: None,
             max_bytes: MAX_MODULE_TOTAL_BYTES,
             success_status: StatusCode::OK,
@@ -1794,6 +2385,7 @@ async fn get_xcode(
     AxumPath(id): AxumPath<String>,
     Query(params): Query<HashMap<String, String>>,
     State(state): State<SharedState>,
+    headers: HeaderMap,
 ) -> Response {
     let namespace = match NamespaceQuery::from_params(&params) {
         Ok(namespace) => namespace,
@@ -1811,6 +2403,7 @@ async fn get_xcode(
         Some(&id),
         analytics,
         Some(usage),
+        accepts_zstd(&headers),
     )
     .await
 }
@@ -1821,7 +2414,16 @@ async fn put_xcode(
     State(state): State<SharedState>,
     request: Request,
 ) -> Response {
-    let namespace = match NamespaceQuery::from_params(&params) {
+    put_xcode_body(state, &id, &params, UploadBody::Request(request)).await
+}
+
+async fn put_xcode_body(
+    state: SharedState,
+    id: &str,
+    params: &HashMap<String, String>,
+    body: UploadBody<'_>,
+) -> Response {
+    let namespace = match NamespaceQuery::from_params(params) {
         Ok(namespace) => namespace,
         Err(message) => return error_response(StatusCode::BAD_REQUEST, message),
     };
@@ -1832,11 +2434,11 @@ async fn put_xcode(
     put_blob_artifact(
         state,
         ArtifactProducer::Xcode,
-        request,
+        body,
         BlobPutSpec {
             namespace_id: &namespace.namespace_id,
-            key: &blob_key(&id),
-            analytics_key: Some(&id),
+            key: &blob_key(id),
+            analytics_key: Some(id),
             max_bytes: MAX_XCODE_BYTES,
             success_status: StatusCode::NO_CONTENT,
             existing_status: StatusCode::NO_CONTENT,
@@ -1851,6 +2453,7 @@ async fn get_gradle(
     AxumPath(cache_key): AxumPath<String>,
     Query(params): Query<HashMap<String, String>>,
     State(state): State<SharedState>,
+    headers: HeaderMap,
 ) -> Response {
     let namespace = match NamespaceQuery::from_params(&params) {
         Ok(namespace) => namespace,
@@ -1868,6 +2471,7 @@ async fn get_gradle(
         Some(&cache_key),
         analytics,
         Some(usage),
+        accepts_zstd(&headers),
     )
     .await
 }
@@ -1878,7 +2482,16 @@ async fn put_gradle(
     State(state): State<SharedState>,
     request: Request,
 ) -> Response {
-    let namespace = match NamespaceQuery::from_params(&params) {
+    put_gradle_body(state, &cache_key, &params, UploadBody::Request(request)).await
+}
+
+async fn put_gradle_body(
+    state: SharedState,
+    cache_key: &str,
+    params: &HashMap<String, String>,
+    body: UploadBody<'_>,
+) -> Response {
+    let namespace = match NamespaceQuery::from_params(params) {
         Ok(namespace) => namespace,
         Err(message) => return error_response(StatusCode::BAD_REQUEST, message),
     };
@@ -1889,11 +2502,11 @@ async fn put_gradle(
     put_blob_artifact(
         state,
         ArtifactProducer::Gradle,
-        request,
+        body,
         BlobPutSpec {
             namespace_id: &namespace.namespace_id,
-            key: &cache_key,
-            analytics_key: Some(&cache_key),
+            key: cache_key,
+            analytics_key: Some(cache_key),
             max_bytes: MAX_GRADLE_BYTES,
             success_status: StatusCode::CREATED,
             existing_status: StatusCode::OK,
@@ -1934,6 +2547,7 @@ async fn head_module(
 async fn get_module(
     Query(params): Query<HashMap<String, String>>,
     State(state): State<SharedState>,
+    headers: HeaderMap,
 ) -> Response {
     let query = match ModuleQuery::from_params(&params) {
         Ok(query) => query,
@@ -1949,6 +2563,7 @@ async fn get_module(
         None,
         None,
         Some(usage),
+        accepts_zstd(&headers),
     )
     .await
 }
@@ -2016,6 +2631,7 @@ async fn upload_module_part(
             io: &state.io,
             memory: &state.memory,
             bandwidth_limiter: None,
+            inflight: None,
         },
     )
     .await
@@ -2227,6 +2843,88 @@ async fn internal_status(
     }))
 }
 
+/// Expected segment-ring hit ratios at 0.5x, 1x, 2x and 4x its capacity, per
+/// producer and namespace (see `mrc`).
+async fn internal_miss_ratio_curve(State(state): State<SharedState>) -> impl IntoResponse {
+    Json(state.store.miss_ratio_report())
+}
+
+/// Samples on-CPU stacks for `seconds` (default 10, at most 30) at `hz`
+/// (default 99) and answers folded stacks. See `profiling` for the caps.
+async fn internal_profile_cpu(
+    Query(params): Query<HashMap<String, String>>,
+    State(state): State<SharedState>,
+) -> Response {
+    let duration = profiling::clamp_duration(profile_seconds(&params));
+    let hz = profiling::clamp_cpu_hz(params.get("hz").and_then(|hz| hz.parse().ok()));
+    profile_response(&state, "cpu", profiling::capture_cpu(duration, hz).await)
+}
+
+/// Samples allocations for `seconds` and answers a jemalloc heap profile of
+/// what was sampled and is still live, for `jeprof`.
+async fn internal_profile_heap(
+    Query(params): Query<HashMap<String, String>>,
+    State(state): State<SharedState>,
+) -> Response {
+    let duration = profiling::clamp_duration(profile_seconds(&params));
+    let result = profiling::capture_heap(duration, &state.config.tmp_dir).await;
+    profile_response(&state, "heap", result)
+}
+
+fn profile_seconds(params: &HashMap<String, String>) -> Option<std::time::Duration> {
+    params
+        .get("seconds")
+        .and_then(|seconds| seconds.parse().ok())
+        .map(std::time::Duration::from_secs)
+}
+
+fn profile_response(
+    state: &SharedState,
+    kind: &str,
+    result: Result<profiling::Profile, profiling::ProfileError>,
+) -> Response {
+    match result {
+        Ok(profile) => {
+            state.metrics.record_profile_capture(kind, "captured");
+            let mut response = (
+                [
+                    (axum::http::header::CONTENT_TYPE, profile.content_type),
+                    (axum::http::header::CACHE_CONTROL, "no-store"),
+                ],
+                profile.body,
+            )
+                .into_response();
+            if kind == "cpu" {
+                let headers = response.headers_mut();
+                headers.insert("x-kura-profile-samples", HeaderValue::from(profile.samples));
+                headers.insert("x-kura-profile-dropped", HeaderValue::from(profile.dropped));
+            }
+            response
+        }
+        Err(profiling::ProfileError::Busy { retry_after }) => {
+            state.metrics.record_profile_capture(kind, "busy");
+            let mut response = error_response(
+                StatusCode::TOO_MANY_REQUESTS,
+                "a profile was captured recently; retry later",
+            );
+            response.headers_mut().insert(
+                axum::http::header::RETRY_AFTER,
+                HeaderValue::from(retry_after.as_secs().max(1)),
+            );
+            response
+        }
+        Err(profiling::ProfileError::Unsupported(message)) => {
+            state.metrics.record_profile_capture(kind, "unsupported");
+            error_response(StatusCode::NOT_IMPLEMENTED, &message)
+        }
+        Err(profiling::ProfileError::Failed(message)) => {
+            state.metrics.record_profile_capture(kind, "error");
+            tracing::warn!(kind, error = %message, "profile capture failed");
+            error_response(StatusCode::INTERNAL_SERVER_ERROR, &message)
+        }
+    }
+}
+
 /// The per-artifact backfill endpoint (R11's oversized path). The response is
 /// a single bodies-stream frame: the requester needs the manifest meta to
 /// apply, and framing it with the same codec keeps one wire definition and the
@@ -2324,14 +3022,7 @@ async fn internal_backfill_entries(
     };
 
     if !state.store.backfill_index_built() {
-        return (
-            StatusCode::SERVICE_UNAVAILABLE,
-            Json(BackfillUnavailable {
-                error: BACKFILL_ERROR_INDEX_BUILDING.to_owned(),
-                message: "backfill index is building; retry later".to_owned(),
-            }),
-        )
-            .into_response();
+        return backfill_index_building_response();
     }
 
     match state
@@ -2346,6 +3037,189 @@ async fn internal_backfill_entries(
     }
 }
 
+fn backfill_index_building_response() -> Response {
+    (
+        StatusCode::SERVICE_UNAVAILABLE,
+        Json(BackfillUnavailable {
+            error: BACKFILL_ERROR_INDEX_BUILDING.to_owned(),
+            message: "backfill index is building; retry later".to_owned(),
+        }),
+    )
+        .into_response()
+}
+
+/// Ceiling for a tree request body: a full leaf level of indexes at
+/// `TREE_MAX_DEPTH` is under 512 KiB of JSON.
+const MAX_BACKFILL_TREE_REQUEST_BYTES: usize = 1024 * 1024;
+
+async fn read_backfill_tree_request<T: serde::de::DeserializeOwned>(
+    request: Request,
+) -> Result<T, Response> {
+    let body = to_bytes(request.into_body(), MAX_BACKFILL_TREE_REQUEST_BYTES)
+        .await
+        .map_err(|error| {
+            error_response(
+                StatusCode::PAYLOAD_TOO_LARGE,
+                format!("Failed to read backfill tree request: {error}"),
+            )
+        })?;
+    serde_json::from_slice(&body).map_err(|error| {
+        error_response(
+            StatusCode::BAD_REQUEST,
+            format!("Invalid backfill tree request: {error}"),
+        )
+    })
+}
+
+/// The comparison depth a tree request asked for, or a 400 when it is
+/// outside the depths this node builds.
+fn backfill_tree_depth(depth: Option<u32>) -> Result<u32, Response> {
+    let depth = depth.unwrap_or(TREE_LEGACY_DEPTH);
+    if !(TREE_MIN_DEPTH..=TREE_MAX_DEPTH).contains(&depth) {
+        return Err(error_response(
+            StatusCode::BAD_REQUEST,
+            format!("Invalid depth: expected {TREE_MIN_DEPTH} to {TREE_MAX_DEPTH}"),
+        ));
+    }
+    Ok(depth)
+}
+
+async fn internal_backfill_tree_nodes(
+    State(state): State<SharedState>,
+    request: Request,
+) -> Response {
+    let request: BackfillTreeNodesRequest = match read_backfill_tree_request(request).await {
+        Ok(request) => request,
+        Err(response) => return response,
+    };
+    let depth = match backfill_tree_depth(request.depth) {
+        Ok(depth) => depth,
+        Err(response) => return response,
+    };
+    if request.level > depth {
+        return error_response(
+            StatusCode::BAD_REQUEST,
+            format!("Invalid level: the tree is compared {depth} levels below the root"),
+        );
+    }
+    let width = level_width(request.level);
+    if request.indices.len() > width || request.indices.iter().any(|&index| index >= width) {
+        return error_response(
+            StatusCode::BAD_REQUEST,
+            format!("Invalid indices: level {} has {width} nodes", request.level),
+        );
+    }
+    if !state.store.backfill_index_built() {
+        return backfill_index_building_response();
+    }
+
+    let tree = match state
+        .backfill
+        .tree()
+        .current(
+            &state,
+            TreeBounds {
+                min_version_ms: request.min_version_ms,
+                max_version_ms: request.max_version_ms,
+            },
+        )
+        .await
+    {
+        Ok(tree) => tree,
+        Err(error) => {
+            return error_response(
+                StatusCode::INTERNAL_SERVER_ERROR,
+                format!("Failed to build backfill tree: {error}"),
+            );
+        }
+    };
+    let digests = request
+        .indices
+        .iter()
+        .map(|&index| encode_digest(tree.node(request.level, index).unwrap_or_default()))
+        .collect();
+    Json(BackfillTreeNodes {
+        fanout: TREE_FANOUT,
+        depth,
+        digests,
+    })
+    .into_response()
+}
+
+async fn internal_backfill_tree_entries(
+    State(state): State<SharedState>,
+    request: Request,
+) -> Response {
+    let request: BackfillTreeEntriesRequest = match read_backfill_tree_request(request).await {
+        Ok(request) => request,
+        Err(response) => return response,
+    };
+    let depth = match backfill_tree_depth(request.depth) {
+        Ok(depth) => depth,
+        Err(response) => return response,
+    };
+    let leaf_count = level_width(depth);
+    if request.leaves.is_empty()
+        || request.leaves.len() > BACKFILL_TREE_LEAVES_PER_REQUEST
+        || request.leaves.iter().any(|&leaf| leaf >= leaf_count)
+    {
+        return error_response(
+            StatusCode::BAD_REQUEST,
+            format!(
+                "Invalid leaves: expected 1 to {BACKFILL_TREE_LEAVES_PER_REQUEST} leaves below {leaf_count}"
+            ),
+        );
+    }
+    let after = match request
+        .after
+        .as_deref()
+        .filter(|value| !value.is_empty())
+        .map(decode_backfill_cursor)
+        .transpose()
+    {
+        Ok(after) => after,
+        Err(message) => return error_response(StatusCode::BAD_REQUEST, message),
+    };
+    let limit = request.limit.unwrap_or(256).min(MAX_PEER_PAGE_ITEMS);
+    if limit == 0 {
+        return error_response(
+            StatusCode::BAD_REQUEST,
+            "Invalid limit: must be greater than 0",
+        );
+    }
+    if !state.store.backfill_index_built() {
+        return backfill_index_building_response();
+    }
+
+    let mut wanted = vec![false; leaf_count];
+    for leaf in request.leaves {
+        wanted[leaf] = true;
+    }
+    // A sparse leaf set can reject many rows for one page; the store caps
+    // how many before it answers with a cursor past them.
+    let scan_state = state.clone();
+    let min_version_ms = request.min_version_ms;
+    let max_version_ms = request.max_version_ms;
+    let page = tasks::spawn_blocking(move || {
+        scan_state.store.backfill_index_page_matching(
+            after.as_deref(),
+            limit,
+            min_version_ms,
+            max_version_ms,
+            |row| wanted[leaf_of(&row.record_id, depth)],
+        )
+    })
+    .await
+    .unwrap_or_else(|error| Err(format!("backfill tree listing task failed: {error}")));
+    match page {
+        Ok(page) => Json(BackfillEntriesPage::from(page)).into_response(),
+        Err(error) => error_response(
+            StatusCode::INTERNAL_SERVER_ERROR,
+            format!("Failed to list backfill tree entries: {error}"),
+        ),
+    }
+}
+
 /// Metric label for bodies requests arriving without a client-certificate
 /// identity (the plain-HTTP internal listener inside the trusted cluster
 /// network). Such requests are not concurrency-capped: the cap exists to
@@ -2723,6 +3597,59 @@ async fn spool_backfill_bodies_inner(
     })
 }
 
+/// Replicates a REAPI CAS blob without its body: the receiver links the
+/// manifest to a body with the same content address it already stores. A 404
+/// tells the sender to upload the body through the artifact route instead.
+async fn internal_replicate_link(
+    Query(params): Query<HashMap<String, String>>,
+    State(state): State<SharedState>,
+) -> Response {
+    let query = match ReplicateArtifactQuery::from_params(&params) {
+        Ok(query) => query,
+        Err(message) => return error_response(StatusCode::BAD_REQUEST, message),
+    };
+    let producer = match ArtifactProducer::from_str(&query.producer) {
+        Some(producer) => producer,
+        None => return error_response(StatusCode::BAD_REQUEST, "Invalid artifact producer"),
+    };
+
+    match state
+        .store
+        .apply_replicated_content_link(
+            producer,
+            &query.namespace_id,
+            &query.key,
+            &query.content_type,
+            query.version_ms,
+            query.branch.as_deref(),
+            query.trunk.as_deref(),
+        )
+        .await
+    {
+        Ok(Some(outcome)) => {
+            state
+                .metrics
+                .record_replication_apply("replication", "link", outcome.as_str());
+            StatusCode::NO_CONTENT.into_response()
+        }
+        Ok(None) => {
+            state
+                .metrics
+                .record_replication_apply("replication", "link", "content_missing");
+            error_response(StatusCode::NOT_FOUND, "Content is not stored on this node")
+        }
+        Err(error) => {
+            state
+                .metrics
+                .record_replication_apply("replication", "link", "error");
+            io_error_response(
+                format!("Failed to link replicated artifact: {error}"),
+                StatusCode::INTERNAL_SERVER_ERROR,
+            )
+        }
+    }
+}
+
 async fn internal_replicate_artifact(
     Query(params): Query<HashMap<String, String>>,
     State(state): State<SharedState>,
@@ -2831,6 +3758,7 @@ async fn internal_replicate_artifact(
             io: &state.io,
             memory: &state.memory,
             bandwidth_limiter: state.replication_bandwidth_limiter.as_deref(),
+            inflight: None,
         },
     )
     .await
@@ -2949,6 +3877,7 @@ async fn get_artifact(
     analytics_key: Option<&str>,
     analytics: Option<ProjectAnalyticsContext<'_>>,
     usage: Option<UsageContext>,
+    accepts_zstd: bool,
 ) -> Response {
     match state
         .store
@@ -2956,7 +3885,11 @@ async fn get_artifact(
         .await
     {
         Ok(Some(manifest)) => {
-            let response = serve_file(&state, StatusCode::OK, &manifest).await;
+            let response = if accepts_zstd && manifest.stored_encoding.is_some() {
+                serve_stored_body(&state, StatusCode::OK, &manifest).await
+            } else {
+                serve_file(&state, StatusCode::OK, &manifest).await
+            };
             if response.status().is_success() {
                 state
                     .metrics
@@ -2978,6 +3911,20 @@ async fn get_artifact(
             response
         }
         Ok(None) => {
+            if let Some(follower) = state.inflight_uploads.follow(producer, namespace_id, key)
+                && let Ok(upload) = follower.open(&state.io).await
+            {
+                return serve_inflight_upload(
+                    &state,
+                    producer,
+                    upload,
+                    key,
+                    analytics_key,
+                    analytics,
+                    usage,
+                )
+                .await;
+            }
             state.metrics.record_artifact_read(producer, "not_found", 0);
             error_response(StatusCode::NOT_FOUND, "Artifact not found")
         }
@@ -2991,10 +3938,93 @@ async fn get_artifact(
     }
 }
 
+/// Answers a miss for an artifact this node is still receiving by streaming
+/// the upload as it stages. The size is unknown until the upload finishes, so
+/// the body is chunked, and read metrics and usage are booked once it ends.
+async fn serve_inflight_upload(
+    state: &SharedState,
+    producer: ArtifactProducer,
+    upload: OpenUpload,
+    key: &str,
+    analytics_key: Option<&str>,
+    analytics: Option<ProjectAnalyticsContext<'_>>,
+    usage: Option<UsageContext>,
+) -> Response {
+    let (permit, stream_chunk_bytes) = match state
+        .memory
+        .acquire_response_stream_memory(
+            RESPONSE_STREAM_CHUNK_BYTES.saturating_mul(4),
+            "http",
+            ResponseStreamAdmissionPatience::Degradable,
+        )
+        .await
+    {
+        Ok(permit) => (permit, RESPONSE_STREAM_CHUNK_BYTES),
+        Err(_) => match state
+            .memory
+            .acquire_degraded_response_stream_memory(
+                RESPONSE_STREAM_MIN_CHUNK_BYTES.saturating_mul(4),
+                "http",
+            )
+            .await
+        {
+            Ok(permit) => (permit, RESPONSE_STREAM_MIN_CHUNK_BYTES),
+            Err(_) => return response_stream_unavailable(),
+        },
+    };
+    state
+        .metrics
+        .record_artifact_serving_path("inflight_upload");
+    let analytics = analytics.map(|context| {
+        (
+            context.tenant_id.to_owned(),
+            context.namespace_id.to_owned(),
+        )
+    });
+    let analytics_key = analytics_key.unwrap_or(key).to_owned();
+    let done_state = state.clone();
+    let stream = upload.into_stream(
+        FollowRange::whole(),
+        stream_chunk_bytes,
+        move |outcome, bytes| {
+            let state = done_state;
+            state
+                .metrics
+                .record_inflight_upload_follow(producer, outcome.as_str());
+            if outcome != FollowOutcome::Completed {
+                state.metrics.record_artifact_read(producer, "error", 0);
+                return;
+            }
+            state.metrics.record_artifact_read(producer, "ok", bytes);
+            record_usage_event(&state, producer, "download", usage.as_ref(), bytes);
+            record_project_scoped_cache_event(
+                &state,
+                producer,
+                "download",
+                analytics
+                    .as_ref()
+                    .map(|(tenant_id, namespace_id)| ProjectAnalyticsContext {
+                        tenant_id,
+                        namespace_id,
+                    }),
+                &analytics_key,
+                bytes,
+            );
+        },
+    );
+    let mut response = Response::new(Body::from_stream(stream));
+    response.headers_mut().insert(
+        axum::http::header::CONTENT_TYPE,
+        HeaderValue::from_static("application/octet-stream"),
+    );
+    attach_response_stream_permit(&mut response, permit);
+    response
+}
+
 async fn put_blob_artifact(
     state: SharedState,
     producer: ArtifactProducer,
-    request: Request,
+    body: UploadBody<'_>,
     spec: BlobPutSpec<'_>,
 ) -> Response {
     match state
@@ -3012,20 +4042,60 @@ async fn put_blob_artifact(
         }
     }
 
-    let mut temp = match read_request_to_temp(
-        request,
-        &state.config.tmp_dir.join("uploads"),
-        spec.max_bytes,
-        RequestBodyStaging {
-            tmp_budget: &state.tmp_staging_budget,
-            io: &state.io,
-            memory: &state.memory,
-            bandwidth_limiter: None,
-        },
-    )
-    .await
+    // Identical uploads racing for a missing key stage one body between
+    // them: the rest wait for the first and, once it commits, answer as a
+    // re-upload would without reading their own.
+    let mut inflight = match state
+        .inflight_uploads
+        .begin(producer, spec.namespace_id, spec.key)
     {
-        Ok(temp) => temp,
+        Some(inflight) => Some(inflight),
+        None => {
+            if let Some(first) =
+                state
+                    .inflight_uploads
+                    .follow(producer, spec.namespace_id, spec.key)
+                && first.committed().await
+            {
+                state
+                    .metrics
+                    .record_upload_single_flight(producer, "deduplicated");
+                return spec.existing_status.into_response();
+            }
+            state
+                .metrics
+                .record_upload_single_flight(producer, "restaged");
+            state
+                .inflight_uploads
+                .begin(producer, spec.namespace_id, spec.key)
+        }
+    };
+    let directory = state.config.tmp_dir.join("uploads");
+    let staging = RequestBodyStaging {
+        tmp_budget: &state.tmp_staging_budget,
+        io: &state.io,
+        memory: &state.memory,
+        bandwidth_limiter: None,
+        inflight: inflight.as_ref(),
+    };
+    let (path, staged) = match body {
+        UploadBody::Request(request) => (
+            "streamed",
+            read_request_to_temp(request, &directory, spec.max_bytes, staging).await,
+        ),
+        UploadBody::Spliced(body) => (
+            "spliced",
+            splice_request_to_temp(body, &directory, spec.max_bytes, staging).await,
+        ),
+    };
+    let mut temp = match staged {
+        Ok(temp) => {
+            state.metrics.record_upload_body(producer, path, temp.size);
+            if let Some(inflight) = inflight.as_mut() {
+                inflight.staged(temp.size);
+            }
+            temp
+        }
         Err(BodyReadError::TooLarge) => {
             return error_response(
                 StatusCode::PAYLOAD_TOO_LARGE,
@@ -3061,6 +4131,12 @@ async fn put_blob_artifact(
             &targets,
         )
         .await;
+    // Reads from here on find the committed artifact; followers already
+    // streaming hold their own descriptor on the staging file.
+    if let (Ok(_), Some(inflight)) = (&result, inflight.as_mut()) {
+        inflight.committed();
+    }
+    drop(inflight);
     temp.remove_and_disarm(&state.io).await;
     match result {
         Ok(persisted) => {
@@ -3102,6 +4178,27 @@ async fn put_blob_artifact(
     }
 }
 
+/// Stores an upload the plaintext accelerator took off its connection with
+/// the body unread, through the same handler path as the Axum route would.
+/// `id` is the route's last path segment. Only the single-request blob
+/// uploads are handed over; anything else is answered 404.
+pub(crate) async fn put_spliced_artifact(
+    state: SharedState,
+    producer: ArtifactProducer,
+    id: &str,
+    params: &HashMap<String, String>,
+    body: &mut SplicedRequestBody,
+) -> Response {
+    let body = UploadBody::Spliced(body);
+    match producer {
+        ArtifactProducer::Xcode => put_xcode_body(state, id, params, body).await,
+        ArtifactProducer::Gradle => put_gradle_body(state, id, params, body).await,
+        ArtifactProducer::Nx => put_nx_body(state, id, body).await,
+        ArtifactProducer::Metro => put_metro_body(state, id, body).await,
+        ArtifactProducer::Module | ArtifactProducer::Reapi => StatusCode::NOT_FOUND.into_response(),
+    }
+}
+
 fn record_usage_event(
     state: &SharedState,
     producer: ArtifactProducer,
@@ -3218,6 +4315,76 @@ async fn serve_file(
     }
 }
 
+/// Whether the request lists `zstd` in `Accept-Encoding` (with a non-zero
+/// q-value).
+fn accepts_zstd(headers: &HeaderMap) -> bool {
+    headers
+        .get_all(axum::http::header::ACCEPT_ENCODING)
+        .iter()
+        .filter_map(|value| value.to_str().ok())
+        .flat_map(|value| value.split(','))
+        .any(|coding| {
+            let mut params = coding.split(';').map(str::trim);
+            params
+                .next()
+                .is_some_and(|name| name.eq_ignore_ascii_case("zstd"))
+                && params.all(|param| {
+                    param
+                        .strip_prefix("q=")
+                        .and_then(|q| q.parse::<f32>().ok())
+                        .is_none_or(|q| q > 0.0)
+                })
+        })
+}
+
+/// Serves a compressed body as stored, with `Content-Encoding: zstd`, to a
+/// client that accepts it. Falls back to decoding on the streaming path when
+/// the stored bytes cannot be opened (a promotion moved them).
+async fn serve_stored_body(
+    state: &SharedState,
+    status: StatusCode,
+    manifest: &ArtifactManifest,
+) -> Response {
+    let stored_size = manifest.stored_size();
+    let stream_chunk_bytes = response_stream_chunk_bytes(stored_size);
+    let Ok(permit) = state
+        .memory
+        .acquire_response_stream_memory(
+            stream_chunk_bytes.saturating_mul(4),
+            "http",
+            ResponseStreamAdmissionPatience::Degradable,
+        )
+        .await
+    else {
+        return serve_file_reader(state, status, manifest).await;
+    };
+    let reader = match state.store.open_stored_body_reader(manifest).await {
+        Ok(reader) => reader,
+        Err(_) => return serve_file_reader(state, status, manifest).await,
+    };
+    state
+        .metrics
+        .record_artifact_serving_path("zstd_passthrough");
+    let stream = ReaderStream::with_capacity(reader, stream_chunk_bytes);
+    let stream = instrument_artifact_stream(state, manifest, stream, true);
+    let mut response = Response::new(Body::from_stream(stream));
+    *response.status_mut() = status;
+    apply_artifact_response_headers(&mut response, manifest);
+    let headers = response.headers_mut();
+    headers.insert(
+        axum::http::header::CONTENT_LENGTH,
+        HeaderValue::from(stored_size),
+    );
+    if let Some(encoding) = &manifest.stored_encoding {
+        headers.insert(
+            axum::http::header::CONTENT_ENCODING,
+            HeaderValue::from_static(encoding.content_encoding()),
+        );
+    }
+    attach_response_stream_permit(&mut response, permit);
+    response
+}
+
 /// Streams an artifact from a reader to a public cache response.
 ///
 /// Public-only since the legacy bootstrap serving plane was retired: peer
@@ -3232,7 +4399,12 @@ async fn serve_file_reader(
     manifest: &ArtifactManifest,
 ) -> Response {
     state.metrics.record_artifact_serving_path("streaming");
-    let inline_bytes = if manifest.inline { manifest.size } else { 0 };
+    // Compressed bodies are decoded into memory before they stream.
+    let inline_bytes = if manifest.inline || manifest.stored_encoding.is_some() {
+        manifest.size
+    } else {
+        0
+    };
     let stream_chunk_bytes = response_stream_chunk_bytes(manifest.size);
     let requested_bytes = usize::try_from(
         u64::try_from(stream_chunk_bytes.saturating_mul(4))
@@ -3465,6 +4637,12 @@ fn apply_artifact_response_headers(response: &mut Response, manifest: &ArtifactM
         HeaderValue::from_str(&manifest.size.to_string())
             .unwrap_or_else(|_| HeaderValue::from_static("0")),
     );
+    if manifest.stored_encoding.is_some() {
+        response.headers_mut().insert(
+            axum::http::header::VARY,
+            HeaderValue::from_static("accept-encoding"),
+        );
+    }
 }
 
 fn draining_response(version: Version) -> Response {
@@ -4347,6 +5525,51 @@ mod tests {
         );
     }
 
+    #[tokio::test]
+    async fn tls_responses_advertise_alt_svc_until_the_node_drains() {
+        let context = test_context(|config| {
+            config.alt_svc = Some(r#"h3=":443"; ma=86400"#.to_owned());
+        })
+        .await;
+        let request = || {
+            Request::builder()
+                .uri("/v1/cache/some-hash")
+                .extension(TlsConnection)
+                .body(Body::empty())
+                .expect("failed to build request")
+        };
+
+        let plaintext = public_router(context.state.clone())
+            .oneshot(
+                Request::builder()
+                    .uri("/v1/cache/some-hash")
+                    .body(Body::empty())
+                    .expect("failed to build request"),
+            )
+            .await
+            .expect("public route should respond");
+        assert_eq!(plaintext.headers().get(axum::http::header::ALT_SVC), None);
+
+        let response = public_router(context.state.clone())
+            .oneshot(request())
+            .await
+            .expect("public route should respond");
+        assert_eq!(
+            response.headers().get(axum::http::header::ALT_SVC),
+            Some(&HeaderValue::from_static(r#"h3=":443"; ma=86400"#))
+        );
+
+        context.state.enter_draining();
+        let response = public_router(context.state.clone())
+            .oneshot(request())
+            .await
+            .expect("public route should respond");
+        assert_eq!(
+            response.headers().get(axum::http::header::ALT_SVC),
+            Some(&HeaderValue::from_static("clear"))
+        );
+    }
+
     #[tokio::test]
     async fn public_router_does_not_serve_internal_routes() {
         let context = test_context(|_| {}).await;
@@ -5484,6 +6707,45 @@ mod tests {
         assert!(error.contains("manifest meta"), "unexpected error: {error}");
     }
 
+    #[tokio::test]
+    async fn internal_mrc_reports_hit_ratios_of_segment_reads() {
+        let context = test_context(|_| {}).await;
+        let store = &context.state.store;
+        let manifest = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Xcode,
+                "ios",
+                &blob_key("mrc"),
+                "application/octet-stream",
+                &vec![7_u8; 64 * 1024],
+            )
+            .await
+            .expect("failed to persist CAS object");
+        for _ in 0..2 {
+            store
+                .read_artifact_bytes(&manifest)
+                .await
+                .expect("failed to read CAS object");
+        }
+
+        let response = internal_router(context.state.clone())
+            .oneshot(
+                Request::builder()
+                    .uri("/_internal/mrc")
+                    .body(Body::empty())
+                    .expect("failed to build request"),
+            )
+            .await
+            .expect("request failed");
+        assert_eq!(response.status(), StatusCode::OK);
+        let body: Value = serde_json::from_str(&response_text(response).await)
+            .expect("failed to decode miss ratio curve");
+        let xcode = &body["producers"]["xcode"];
+        assert_eq!(xcode["sampled_reads"], 2);
+        assert_eq!(xcode["hit_ratio"]["1x"], 0.5, "the first read is cold");
+        assert_eq!(body["namespaces"]["ios"]["hit_ratio"]["0.5x"], 0.5);
+    }
+
     #[tokio::test]
     async fn internal_status_advertises_gateway_url_for_global_discovery() {
         let context = test_context(|config| {
@@ -5642,6 +6904,113 @@ mod tests {
         assert_eq!(context.state.memory.transient_reserved_bytes(), 0);
     }
 
+    fn decode_batch_get_frames(mut stream: &[u8]) -> Vec<(u8, u8, String, Vec<u8>)> {
+        let mut frames = Vec::new();
+        while !stream.is_empty() {
+            let id_len = usize::from(u16::from_be_bytes([stream[2], stream[3]]));
+            let body_len = u64::from_be_bytes(stream[4..12].try_into().expect("8 bytes")) as usize;
+            let id_end = BATCH_GET_FRAME_HEADER_BYTES + id_len;
+            frames.push((
+                stream[0],
+                stream[1],
+                String::from_utf8(stream[BATCH_GET_FRAME_HEADER_BYTES..id_end].to_vec())
+                    .expect("id should be UTF-8"),
+                stream[id_end..id_end + body_len].to_vec(),
+            ));
+            stream = &stream[id_end + body_len..];
+        }
+        frames
+    }
+
+    #[tokio::test]
+    async fn batch_get_answers_every_id_with_one_frame_in_order() {
+        let context = test_context(|_| {}).await;
+        context
+            .state
+            .store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Xcode,
+                "ios",
+                &blob_key("cas-hit"),
+                "application/octet-stream",
+                b"object",
+            )
+            .await
+            .expect("failed to persist CAS object");
+        let app = router(context.state.clone());
+        let put_response = app
+            .clone()
+            .oneshot(
+                Request::builder()
+                    .method("PUT")
+                    .uri("/api/cache/keyvalue?tenant_id=acme&namespace_id=ios")
+                    .header("content-type", "application/json")
+                    .body(Body::from(
+                        r#"{"cas_id":"cas-1","entries":[{"value":"hello"}]}"#,
+                    ))
+                    .expect("failed to build put request"),
+            )
+            .await
+            .expect("put request failed");
+        assert_eq!(put_response.status(), StatusCode::NO_CONTENT);
+
+        let response = app
+            .oneshot(
+                Request::builder()
+                    .method("POST")
+                    .uri("/api/cache/batch?tenant_id=acme&namespace_id=ios")
+                    .header("content-type", "application/json")
+                    .body(Body::from(
+                        r#"{"cas":["cas-hit","cas-miss"],"keyvalue":["cas-1","kv-miss"]}"#,
+                    ))
+                    .expect("failed to build batch request"),
+            )
+            .await
+            .expect("batch request failed");
+        assert_eq!(response.status(), StatusCode::OK);
+        assert_eq!(
+            response.headers().get(axum::http::header::CONTENT_TYPE),
+            Some(&HeaderValue::from_static(BATCH_GET_CONTENT_TYPE))
+        );
+
+        let frames = decode_batch_get_frames(&response_bytes(response).await);
+        assert_eq!(frames.len(), 4);
+        assert_eq!(frames[0], (0, 0, "cas-hit".to_owned(), b"object".to_vec()));
+        assert_eq!(frames[1], (0, 1, "cas-miss".to_owned(), Vec::new()));
+        assert_eq!(
+            (frames[2].0, frames[2].1, frames[2].2.as_str()),
+            (1, 0, "cas-1")
+        );
+        let entry: Value = serde_json::from_slice(&frames[2].3).expect("keyvalue body is JSON");
+        assert_eq!(entry["entries"][0]["value"], "hello");
+        assert_eq!(frames[3], (1, 1, "kv-miss".to_owned(), Vec::new()));
+        assert_eq!(context.state.memory.transient_reserved_bytes(), 0);
+    }
+
+    #[tokio::test]
+    async fn batch_get_rejects_oversized_batches() {
+        let context = test_context(|_| {}).await;
+        let batch = BatchGetRequest {
+            cas: vec!["id".to_owned(); MAX_BATCH_GET_ITEMS + 1],
+            keyvalue: Vec::new(),
+        };
+
+        let response = router(context.state.clone())
+            .oneshot(
+                Request::builder()
+                    .method("POST")
+                    .uri("/api/cache/batch?tenant_id=acme&namespace_id=ios")
+                    .body(Body::from(
+                        serde_json::to_vec(&batch).expect("failed to encode batch"),
+                    ))
+                    .expect("failed to build batch request"),
+            )
+            .await
+            .expect("batch request failed");
+
+        assert_eq!(response.status(), StatusCode::BAD_REQUEST);
+    }
+
     #[tokio::test]
     async fn keyvalue_misses_return_json_not_found_errors() {
         let context = test_context(|_| {}).await;
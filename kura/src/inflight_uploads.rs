@@ -0,0 +1,585 @@
+//! Serving artifacts that are still being uploaded.
+//!
+//! CI fan-out asks for an artifact while the job producing it is still
+//! uploading it: every other job misses, builds the artifact itself and
+//! uploads it again. An upload therefore registers its key while it stages
+//! the body, and a read that misses the store follows it, streaming the staged
+//! bytes as they land and waiting on the writer for more.
+//!
+//! A second upload of a key that is already staging does not stage a copy of
+//! its own: it waits for the first to settle and, once that one commits,
+//! answers as a re-upload of a present artifact would, without reading its
+//! body. Only if the first fails does it stage its own body.
+//!
+//! The follower opens its own descriptor on the staging file before it answers,
+//! so the writer unlinking the file after the commit does not cut the stream
+//! short. An upload that
+//! fails ends its followers with an error rather than a short body, and where
+//! the key is a content digest the follower hashes what it streamed and fails
+//! on a mismatch.
+
+use std::{
+    collections::HashMap,
+    path::{Path, PathBuf},
+    sync::{Arc, Mutex, OnceLock},
+};
+
+use bytes::Bytes;
+use futures_util::{Stream, stream};
+use sha2::{Digest as _, Sha256};
+use tokio::sync::watch;
+
+use crate::{
+    artifact::producer::ArtifactProducer,
+    io::{IoController, PersistentFile},
+    store::read_bytes_at,
+};
+
+/// How far an upload has got, as seen by its followers. `Staging` counts only
+/// bytes that have reached the staging file, not those still in the writer's
+/// buffer. Once staged, the body is whole whether or not the commit that
+/// follows succeeds, so followers finish on any of the last three states.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum Progress {
+    Opening,
+    Staging(u64),
+    Aborted,
+    Staged(u64),
+    Committed(u64),
+    Uncommitted(u64),
+}
+
+#[derive(Clone, Debug, PartialEq, Eq, Hash)]
+struct UploadKey {
+    producer: ArtifactProducer,
+    namespace_id: String,
+    key: String,
+}
+
+struct Upload {
+    path: OnceLock<PathBuf>,
+    progress: watch::Sender<Progress>,
+}
+
+/// The uploads of this node that are staging a body right now.
+#[derive(Default)]
+pub struct InflightUploads {
+    uploads: Mutex<HashMap<UploadKey, Arc<Upload>>>,
+}
+
+impl InflightUploads {
+    /// Registers an upload of `key`. `None` when another upload of the same
+    /// key already holds the registration; that one serves the followers and
+    /// this one stages unobserved.
+    pub fn begin(
+        self: &Arc<Self>,
+        producer: ArtifactProducer,
+        namespace_id: &str,
+        key: &str,
+    ) -> Option<StagingUpload> {
+        let key = UploadKey {
+            producer,
+            namespace_id: namespace_id.to_owned(),
+            key: key.to_owned(),
+        };
+        let mut uploads = self.uploads.lock().expect("inflight uploads lock");
+        if uploads.contains_key(&key) {
+            return None;
+        }
+        let upload = Arc::new(Upload {
+            path: OnceLock::new(),
+            progress: watch::Sender::new(Progress::Opening),
+        });
+        uploads.insert(key.clone(), upload.clone());
+        Some(StagingUpload {
+            uploads: self.clone(),
+            key,
+            upload,
+            staged: None,
+            committed: false,
+        })
+    }
+
+    /// Attaches to the upload of `key`, if one is staging.
+    pub fn follow(
+        &self,
+        producer: ArtifactProducer,
+        namespace_id: &str,
+        key: &str,
+    ) -> Option<UploadFollower> {
+        let key = UploadKey {
+            producer,
+            namespace_id: namespace_id.to_owned(),
+            key: key.to_owned(),
+        };
+        let upload = self
+            .uploads
+            .lock()
+            .expect("inflight uploads lock")
+            .get(&key)?
+            .clone();
+        let progress = upload.progress.subscribe();
+        Some(UploadFollower { upload, progress })
+    }
+}
+
+/// The writer's side of a registered upload. Dropping it before
+/// [`StagingUpload::staged`] fails every follower; dropping it before
+/// [`StagingUpload::committed`] sends duplicate uploads off to stage their own
+/// bodies.
+pub struct StagingUpload {
+    uploads: Arc<InflightUploads>,
+    key: UploadKey,
+    upload: Arc<Upload>,
+    staged: Option<u64>,
+    committed: bool,
+}
+
+impl StagingUpload {
+    /// The staging file exists at `path`; followers can open it.
+    pub fn opened(&self, path: &Path) {
+        let _ = self.upload.path.set(path.to_path_buf());
+        self.upload.progress.send_replace(Progress::Staging(0));
+    }
+
+    /// The first `bytes` of the body are in the staging file.
+    pub fn staging(&self, bytes: u64) {
+        self.upload.staging(bytes);
+    }
+
+    /// A handle for reporting [`StagingUpload::staging`] from a thread that
+    /// cannot borrow the registration, such as a blocking pool closure.
+    pub fn progress(&self) -> StagingProgress {
+        StagingProgress {
+            upload: self.upload.clone(),
+        }
+    }
+
+    /// The whole body, `size` bytes, is in the staging file and has passed
+    /// the writer's checks.
+    pub fn staged(&mut self, size: u64) {
+        self.staged = Some(size);
+        self.upload.progress.send_replace(Progress::Staged(size));
+    }
+
+    /// The artifact is in the store; duplicates of this upload can report
+    /// success.
+    pub fn committed(&mut self) {
+        if let Some(size) = self.staged {
+            self.committed = true;
+            self.upload.progress.send_replace(Progress::Committed(size));
+        }
+    }
+}
+
+/// See [`StagingUpload::progress`].
+#[derive(Clone)]
+pub struct StagingProgress {
+    upload: Arc<Upload>,
+}
+
+impl StagingProgress {
+    pub fn staging(&self, bytes: u64) {
+        self.upload.staging(bytes);
+    }
+}
+
+impl Upload {
+    fn staging(&self, bytes: u64) {
+        self.progress.send_if_modified(|progress| {
+            if *progress == Progress::Staging(bytes) {
+                return false;
+            }
+            *progress = Progress::Staging(bytes);
+            true
+        });
+    }
+}
+
+impl Drop for StagingUpload {
+    fn drop(&mut self) {
+        if !self.committed {
+            self.upload
+                .progress
+                .send_replace(self.staged.map_or(Progress::Aborted, Progress::Uncommitted));
+        }
+        let mut uploads = self.uploads.uploads.lock().expect("inflight uploads lock");
+        if uploads
+            .get(&self.key)
+            .is_some_and(|upload| Arc::ptr_eq(upload, &self.upload))
+        {
+            uploads.remove(&self.key);
+        }
+    }
+}
+
+/// How a follower's stream ended.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum FollowOutcome {
+    Completed,
+    Aborted,
+    DigestMismatch,
+    Failed,
+}
+
+impl FollowOutcome {
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Self::Completed => "completed",
+            Self::Aborted => "aborted",
+            Self::DigestMismatch => "digest_mismatch",
+            Self::Failed => "failed",
+        }
+    }
+}
+
+/// The byte range a follower streams, and what it checks once done.
+pub struct FollowRange {
+    pub offset: u64,
+    pub limit: Option<u64>,
+    /// Hex SHA-256 of the whole body, checked when the range covers it.
+    pub sha256: Option<String>,
+}
+
+impl FollowRange {
+    pub fn whole() -> Self {
+        Self {
+            offset: 0,
+            limit: None,
+            sha256: None,
+        }
+    }
+}
+
+pub struct UploadFollower {
+    upload: Arc<Upload>,
+    progress: watch::Receiver<Progress>,
+}
+
+impl UploadFollower {
+    /// Waits for the upload to settle: `true` once it committed, `false` if
+    /// it failed before or during the commit.
+    pub async fn committed(mut self) -> bool {
+        self.progress
+            .wait_for(|progress| {
+                matches!(
+                    progress,
+                    Progress::Committed(_) | Progress::Uncommitted(_) | Progress::Aborted
+                )
+            })
+            .await
+            .is_ok_and(|progress| matches!(*progress, Progress::Committed(_)))
+    }
+
+    /// Opens the staging file once the writer has created it. Fails when the
+    /// upload is aborted first, or is already committed and its staging file
+    /// gone; either way the caller answers as if nothing had been in flight.
+    pub async fn open(mut self, io: &IoController) -> Result<OpenUpload, String> {
+        let progress = *self
+            .progress
+            .wait_for(|progress| *progress != Progress::Opening)
+            .await
+            .map_err(|_| "the upload being followed went away".to_owned())?;
+        if progress == Progress::Aborted {
+            return Err("the upload being followed was aborted".into());
+        }
+        let path = self
+            .upload
+            .path
+            .get()
+            .ok_or_else(|| "followed upload has no staging file".to_owned())?;
+        let file = io.open_persistent_read_file(path).await?;
+        Ok(OpenUpload {
+            progress: self.progress,
+            file: Arc::new(file),
+        })
+    }
+}
+
+/// A followed upload with its staging file open.
+pub struct OpenUpload {
+    progress: watch::Receiver<Progress>,
+    file: Arc<PersistentFile>,
+}
+
+struct Following<F> {
+    progress: watch::Receiver<Progress>,
+    file: Arc<PersistentFile>,
+    chunk_bytes: u64,
+    offset: u64,
+    end: Option<u64>,
+    hasher: Option<Sha256>,
+    expected_sha256: Option<String>,
+    streamed: u64,
+    on_done: Option<F>,
+}
+
+impl<F: FnOnce(FollowOutcome, u64)> Following<F> {
+    fn done(&mut self, outcome: FollowOutcome) {
+        if let Some(on_done) = self.on_done.take() {
+            on_done(outcome, self.streamed);
+        }
+    }
+
+    fn fail(&mut self, outcome: FollowOutcome, message: String) -> std::io::Error {
+        self.done(outcome);
+        std::io::Error::other(message)
+    }
+
+    /// Waits until there is something past `offset` to read, returning how
+    /// many bytes are readable, or `None` once the range is done.
+    async fn readable(&mut self) -> Result<Option<u64>, std::io::Error> {
+        loop {
+            let progress = *self.progress.borrow_and_update();
+            let (available, complete) = match progress {
+                Progress::Opening => (0, false),
+                Progress::Staging(bytes) => (bytes, false),
+                Progress::Staged(size)
+                | Progress::Committed(size)
+                | Progress::Uncommitted(size) => (size, true),
+                Progress::Aborted => {
+                    return Err(self.fail(
+                        FollowOutcome::Aborted,
+                        "the upload being followed was aborted".into(),
+                    ));
+                }
+            };
+            if complete {
+                self.end = Some(self.end.map_or(available, |end| end.min(available)));
+            }
+            let until = self.end.map_or(available, |end| end.min(available));
+            if until > self.offset {
+                return Ok(Some(until - self.offset));
+            }
+            if self.end.is_some_and(|end| self.offset >= end) {
+                return Ok(None);
+            }
+            if self.progress.changed().await.is_err() {
+                // The writer is gone without a final state; treat it as lost.
+                return Err(self.fail(
+                    FollowOutcome::Aborted,
+                    "the upload being followed went away".into(),
+                ));
+            }
+        }
+    }
+
+    async fn next_chunk(&mut self) -> Option<Result<Bytes, std::io::Error>> {
+        self.on_done.as_ref()?;
+        let readable = match self.readable().await {
+            Ok(Some(readable)) => readable,
+            Ok(None) => {
+                if let (Some(hasher), Some(expected)) =
+                    (self.hasher.take(), self.expected_sha256.as_deref())
+                    && hex::encode(hasher.finalize()) != expected
+                {
+                    return Some(Err(self.fail(
+                        FollowOutcome::DigestMismatch,
+                        "followed upload did not match its digest".into(),
+                    )));
+                }
+                self.done(FollowOutcome::Completed);
+                return None;
+            }
+            Err(error) => return Some(Err(error)),
+        };
+        let file = self.file.clone();
+        let offset = self.offset;
+        let length = readable.min(self.chunk_bytes);
+        let read =
+            crate::tasks::spawn_blocking(move || read_bytes_at(file.as_std(), offset, length))
+                .await
+                .map_err(|error| error.to_string())
+                .and_then(|read| read);
+        match read {
+            Ok(bytes) => {
+                if let Some(hasher) = self.hasher.as_mut() {
+                    hasher.update(&bytes);
+                }
+                self.offset += length;
+                self.streamed += length;
+                Some(Ok(Bytes::from(bytes)))
+            }
+            Err(error) => Some(Err(self.fail(FollowOutcome::Failed, error))),
+        }
+    }
+}
+
+impl OpenUpload {
+    /// Streams `range` of the upload in chunks of up to `chunk_bytes`,
+    /// calling `on_done` with the outcome and the bytes streamed once it ends.
+    pub fn into_stream<F>(
+        self,
+        range: FollowRange,
+        chunk_bytes: usize,
+        on_done: F,
+    ) -> impl Stream<Item = Result<Bytes, std::io::Error>> + Send + 'static
+    where
+        F: FnOnce(FollowOutcome, u64) + Send + 'static,
+    {
+        let whole_body = range.offset == 0 && range.limit.is_none();
+        let following = Following {
+            progress: self.progress,
+            file: self.file,
+            chunk_bytes: (chunk_bytes as u64).max(1),
+            offset: range.offset,
+            end: range.limit.map(|limit| range.offset.saturating_add(limit)),
+            hasher: (whole_body && range.sha256.is_some()).then(Sha256::new),
+            expected_sha256: range.sha256,
+            streamed: 0,
+            on_done: Some(on_done),
+        };
+        stream::unfold(following, |mut following| async move {
+            let item = following.next_chunk().await?;
+            Some((item, following))
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::Duration;
+
+    use futures_util::StreamExt;
+    use tempfile::tempdir;
+
+    use super::*;
+    use crate::metrics::Metrics;
+
+    fn io_for(root: &Path) -> IoController {
+        IoController::new(
+            Metrics::new("region".into(), "tenant".into()),
+            8,
+            Duration::from_secs(1),
+            vec![root.to_path_buf()],
+        )
+        .expect("io controller")
+    }
+
+    #[tokio::test]
+    async fn a_follower_streams_bytes_as_they_are_staged() {
+        let directory = tempdir().expect("temp dir");
+        let path = directory.path().join("upload");
+        let body = b"staged while followed".to_vec();
+        let uploads = Arc::new(InflightUploads::default());
+        let mut upload = uploads
+            .begin(ArtifactProducer::Reapi, "ns", "key")
+            .expect("first upload registers");
+        assert!(
+            uploads
+                .begin(ArtifactProducer::Reapi, "ns", "key")
+                .is_none()
+        );
+
+        let follower = uploads
+            .follow(ArtifactProducer::Reapi, "ns", "key")
+            .expect("upload is followable");
+        let io = io_for(directory.path());
+        let opening = tokio::spawn(async move { follower.open(&io).await });
+
+        std::fs::write(&path, &body[..6]).expect("first half");
+        upload.opened(&path);
+        upload.staging(6);
+        let (done, outcome) = tokio::sync::oneshot::channel();
+        let stream = opening
+            .await
+            .expect("open task")
+            .expect("staging file opens")
+            .into_stream(
+                FollowRange {
+                    offset: 0,
+                    limit: None,
+                    sha256: Some(hex::encode(Sha256::digest(&body))),
+                },
+                4,
+                move |outcome, bytes| {
+                    let _ = done.send((outcome, bytes));
+                },
+            );
+        let reader = tokio::spawn(async move {
+            stream
+                .map(|chunk| chunk.expect("chunk"))
+                .collect::<Vec<_>>()
+                .await
+                .concat()
+        });
+
+        tokio::task::yield_now().await;
+        std::io::Write::write_all(
+            &mut std::fs::OpenOptions::new()
+                .append(true)
+                .open(&path)
+                .expect("staging file"),
+            &body[6..],
+        )
+        .expect("second half");
+        upload.staged(body.len() as u64);
+        drop(upload);
+
+        assert_eq!(reader.await.expect("reader"), body);
+        assert_eq!(
+            outcome.await.expect("outcome"),
+            (FollowOutcome::Completed, body.len() as u64)
+        );
+        assert!(
+            uploads
+                .follow(ArtifactProducer::Reapi, "ns", "key")
+                .is_none()
+        );
+    }
+
+    #[tokio::test]
+    async fn an_aborted_upload_fails_its_followers() {
+        let directory = tempdir().expect("temp dir");
+        let path = directory.path().join("upload");
+        std::fs::write(&path, b"part").expect("partial body");
+        let uploads = Arc::new(InflightUploads::default());
+        let upload = uploads
+            .begin(ArtifactProducer::Xcode, "ns", "key")
+            .expect("upload registers");
+        upload.opened(&path);
+        upload.staging(4);
+
+        let follower = uploads
+            .follow(ArtifactProducer::Xcode, "ns", "key")
+            .expect("upload is followable");
+        let opened = follower
+            .open(&io_for(directory.path()))
+            .await
+            .expect("staging file opens");
+        let mut stream = Box::pin(opened.into_stream(FollowRange::whole(), 64, |_, _| {}));
+        assert_eq!(
+            stream.next().await.expect("first chunk").expect("bytes"),
+            Bytes::from_static(b"part")
+        );
+        drop(upload);
+        assert!(stream.next().await.expect("terminal item").is_err());
+        assert!(stream.next().await.is_none());
+    }
+
+    #[tokio::test]
+    async fn a_duplicate_upload_learns_whether_the_first_committed() {
+        let uploads = Arc::new(InflightUploads::default());
+        let mut first = uploads
+            .begin(ArtifactProducer::Reapi, "ns", "key")
+            .expect("first upload registers");
+        let duplicate = uploads
+            .follow(ArtifactProducer::Reapi, "ns", "key")
+            .expect("first upload is in flight");
+        let waiting = tokio::spawn(duplicate.committed());
+        first.staged(3);
+        first.committed();
+        drop(first);
+        assert!(waiting.await.expect("duplicate"));
+
+        let mut failed = uploads
+            .begin(ArtifactProducer::Reapi, "ns", "key")
+            .expect("key is free again");
+        let duplicate = uploads
+            .follow(ArtifactProducer::Reapi, "ns", "key")
+            .expect("upload is in flight");
+        failed.staged(3);
+        drop(failed);
+        assert!(!duplicate.committed().await);
+    }
+}
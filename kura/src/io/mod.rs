@@ -13,7 +13,10 @@ use tokio::{
     time::timeout,
 };
 
-use crate::metrics::Metrics;
+use crate::{
+    fair_admission::{FairQueue, FairnessWeights},
+    metrics::Metrics,
+};
 
 pub const FD_POOL_EXHAUSTED_MARKER: &str = "fd_pool_exhausted";
 
@@ -28,6 +31,8 @@ pub struct IoController {
 
 struct IoControllerInner {
     pool: Pool<FileDescriptorToken>,
+    /// Orders waiters for a permit once the pool runs dry.
+    admission: FairQueue,
     acquire_timeout: Duration,
     metrics: Metrics,
     cwd: PathBuf,
@@ -71,6 +76,7 @@ impl IoController {
         let controller = Self {
             inner: Arc::new(IoControllerInner {
                 pool,
+                admission: FairQueue::new("fd", 1, metrics.clone()),
                 acquire_timeout,
                 metrics,
                 cwd,
@@ -81,6 +87,10 @@ impl IoController {
         Ok(controller)
     }
 
+    pub fn set_fairness_weights(&self, weights: Arc<FairnessWeights>) {
+        self.inner.admission.set_weights(weights);
+    }
+
     pub async fn create_file(&self, path: &Path) -> Result<TrackedFile, String> {
         let path = self.validate_path(path)?;
         let lease = self.acquire("create_file").await?;
@@ -181,7 +191,7 @@ impl IoController {
         let path = self.validate_path(path)?;
         let lease = self.acquire("open_persistent_read_file").await?;
         let started_at = Instant::now();
-        match tokio::task::spawn_blocking({
+        match crate::tasks::spawn_blocking({
             let path = path.clone();
             move || std::fs::File::open(&path)
         })
@@ -226,6 +236,43 @@ impl IoController {
         }
     }
 
+    /// Opens a segment for `O_DIRECT` writes at explicit offsets (see
+    /// `segment::direct`).
+    pub async fn open_direct_write_file(&self, path: &Path) -> Result<PersistentFile, String> {
+        let path = self.validate_path(path)?;
+        let lease = self.acquire("open_direct_write_file").await?;
+        let started_at = Instant::now();
+        let opened = crate::tasks::spawn_blocking({
+            let path = path.clone();
+            move || crate::segment::direct::open_direct(&path)
+        })
+        .await
+        .map_err(|error| {
+            format!(
+                "failed to join direct file open task for {}: {error}",
+                path.display()
+            )
+        })
+        .and_then(|opened| {
+            opened.map_err(|error| {
+                format!(
+                    "failed to open direct write file {}: {error}",
+                    path.display()
+                )
+            })
+        });
+        self.inner.metrics.record_file_operation(
+            "open_direct_write_file",
+            if opened.is_ok() { "ok" } else { "error" },
+            started_at.elapsed(),
+            0,
+        );
+        opened.map(|file| PersistentFile {
+            file,
+            _lease: lease,
+        })
+    }
+
     pub async fn drop_cached_pages(
         &self,
         path: &Path,
@@ -269,7 +316,7 @@ impl IoController {
         let path = self.validate_path(path)?;
         let lease = self.acquire("sync_dir").await?;
         let started_at = Instant::now();
-        let result = tokio::task::spawn_blocking({
+        let result = crate::tasks::spawn_blocking({
             let path = path.clone();
             move || {
                 let directory = std::fs::File::open(&path).map_err(|error| {
@@ -441,8 +488,15 @@ impl IoController {
 
     async fn acquire(&self, operation: &'static str) -> Result<FileDescriptorLease, String> {
         let started_at = Instant::now();
-        let permit = timeout(self.inner.acquire_timeout, self.inner.pool.get())
-            .await
+        // A free permit is taken directly; the fair queue only orders waiters.
+        let permit = timeout(self.inner.acquire_timeout, async {
+            if let Ok(permit) = self.inner.pool.try_get() {
+                return Ok(permit);
+            }
+            let _turn = self.inner.admission.turn(1).await;
+            self.inner.pool.get().await
+        })
+        .await
             .map_err(|_| {
                 self.inner
                     .metrics
@@ -571,12 +625,47 @@ impl PersistentFile {
             Ok(())
         }
     }
+
+    /// Asks the kernel to start reading `length` bytes at `offset` into the
+    /// page cache. Advisory: it returns once the readahead is queued.
+    pub fn will_need(&self, offset: u64, length: u64) -> Result<(), io::Error> {
+        #[cfg(target_os = "linux")]
+        {
+            let Some((aligned_offset, aligned_length)) =
+                aligned_advice_range(offset, length, rustix::param::page_size() as u64)
+            else {
+                return Ok(());
+            };
+            rustix::fs::fadvise(
+                &self.file,
+                aligned_offset,
+                Some(aligned_length),
+                rustix::fs::Advice::WillNeed,
+            )
+            .map_err(io::Error::from)
+        }
+
+        #[cfg(not(target_os = "linux"))]
+        {
+            let _ = (offset, length);
+            Ok(())
+        }
+    }
 }
 
 impl TrackedFile {
     pub async fn sync_data(&self) -> Result<(), io::Error> {
         self.file.sync_data().await
     }
+
+    /// The same descriptor, and its lease, as a blocking file, for work that
+    /// drives it with raw syscalls. Waits for any write still in flight.
+    pub async fn into_persistent(self) -> PersistentFile {
+        PersistentFile {
+            file: self.file.into_std().await,
+            _lease: self._lease,
+        }
+    }
 }
 
 #[cfg(target_os = "linux")]
@@ -617,7 +706,7 @@ impl IoController {
         #[cfg(unix)]
         {
             self.run("sync_directory", 0, async move {
-                tokio::task::spawn_blocking({
+                crate::tasks::spawn_blocking({
                     let path = path.clone();
                     move || -> Result<(), String> {
                         let directory = std::fs::File::open(&path).map_err(|error| {
@@ -10,28 +10,42 @@ mod config;
 mod constants;
 mod enrollment;
 mod failpoints;
+mod fair_admission;
 mod file_cache;
 mod http;
+mod inflight_uploads;
 mod io;
 mod memory;
 mod mesh_heartbeat;
 mod metrics;
 mod mmap;
+mod mrc;
 mod multipart;
+mod namespace_share;
 mod node_location;
 mod peer_tls;
+mod profiling;
+mod readahead;
 mod reapi;
 mod registration;
 mod replication;
 mod runtime;
 mod segment;
+mod shards;
+mod stage_timing;
 mod state;
 mod store;
+mod tasks;
 mod telemetry;
 mod usage;
 mod utils;
+mod warm_restart;
 
 #[cfg(test)]
 mod test_support;
 
+#[cfg(test)]
+#[global_allocator]
+static TEST_ALLOCATOR: test_support::CountingAllocator = test_support::CountingAllocator;
+
 pub use app::run;
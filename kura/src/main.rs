@@ -12,12 +12,15 @@ union JemallocConfigPointer {
 // traffic so a burst can return memory while the service is otherwise idle.
 // tikv-jemallocator uses a prefixed jemalloc build by default and documents
 // this exact symbol for setting its boot-time configuration.
+//
+// Heap profiling is compiled in but idle: `prof_active:false` keeps sampling
+// off until an internal profile request turns it on for its window.
 #[cfg(target_os = "linux")]
 #[used]
 #[unsafe(export_name = "_rjem_malloc_conf")]
 static JEMALLOC_MALLOC_CONF: Option<&'static std::ffi::c_char> = Some(unsafe {
     JemallocConfigPointer {
-        bytes: &b"background_thread:true,max_background_threads:1,dirty_decay_ms:4000,muzzy_decay_ms:4000\0"[0],
+        bytes: &b"background_thread:true,max_background_threads:1,dirty_decay_ms:4000,muzzy_decay_ms:4000,prof:true,prof_active:false,lg_prof_sample:19\0"[0],
     }
     .c_char
 });
@@ -0,0 +1,333 @@
+//! Reusable read buffers for REAPI materialization.
+//!
+//! Reading a blob to decode it (an action result, an output directory's
+//! tree), to decompress it, or to serve it in a batch read response
+//! allocates a buffer the size of the blob and frees it a moment later;
+//! under high batch rates that churn shows up as allocator time and page
+//! faults. Those reads take a buffer from a small
+//! size-classed pool instead and hand it back when it drops. A buffer turned
+//! into [`Bytes`] goes back when the last clone drops, so a response body
+//! cut from it returns it once the body is sent.
+//!
+//! A taker claims the bytes it asked for from its own budget, as for any
+//! read. Everything else the pool holds (the rest of the size class under a
+//! taken buffer, and every idle buffer) is charged to the memory
+//! controller's transient budget, so pooling never hides memory from
+//! admission. When that budget is exhausted a read allocates exactly and a
+//! returned buffer is freed. Idle buffers are also bounded in bytes and all
+//! dropped once the node leaves normal memory pressure.
+
+use std::sync::{
+    Arc, Mutex,
+    atomic::{AtomicBool, AtomicUsize, Ordering},
+};
+
+use bytes::Bytes;
+use tokio::sync::{OwnedSemaphorePermit, Semaphore};
+
+use crate::metrics::Metrics;
+
+/// Smaller reads are cheap to allocate and not worth pooling.
+const MIN_CLASS_BYTES: usize = 64 * 1024;
+/// Classes double from [`MIN_CLASS_BYTES`] up to 8 MiB; larger reads
+/// allocate exactly.
+const CLASS_COUNT: usize = 8;
+const MAX_IDLE_PER_CLASS: usize = 8;
+/// Upper bound on idle pooled bytes, before the limit derived from the
+/// memory budget.
+const MAX_IDLE_BYTES: usize = 32 * 1024 * 1024;
+
+pub struct BufferPool {
+    classes: [Mutex<Vec<IdleBuffer>>; CLASS_COUNT],
+    idle_bytes: AtomicUsize,
+    max_idle_bytes: usize,
+    /// Cleared outside normal memory pressure: returned buffers are freed.
+    accepting: AtomicBool,
+    /// The memory controller's transient budget, one permit per byte.
+    transient: Arc<Semaphore>,
+    metrics: Metrics,
+}
+
+/// An idle buffer and the transient charge for all of it.
+struct IdleBuffer {
+    buffer: Vec<u8>,
+    charge: OwnedSemaphorePermit,
+}
+
+impl BufferPool {
+    pub(super) fn new(
+        transient_budget_bytes: u64,
+        transient: Arc<Semaphore>,
+        metrics: Metrics,
+    ) -> Self {
+        let max_idle_bytes = usize::try_from(transient_budget_bytes / 8)
+            .unwrap_or(usize::MAX)
+            .min(MAX_IDLE_BYTES);
+        Self {
+            classes: std::array::from_fn(|_| Mutex::new(Vec::new())),
+            idle_bytes: AtomicUsize::new(0),
+            max_idle_bytes,
+            accepting: AtomicBool::new(true),
+            transient,
+            metrics,
+        }
+    }
+
+    /// A buffer of `len` bytes. Reused buffers keep their old contents, so
+    /// the caller overwrites all of it (a full read does).
+    pub fn take(self: &Arc<Self>, len: usize) -> PooledBuffer {
+        let Some(class) = class_of(len) else {
+            return self.unpooled(len);
+        };
+        let reused = self.classes[class]
+            .lock()
+            .expect("buffer pool lock poisoned")
+            .pop();
+        let (buffer, charge) = match reused {
+            Some(IdleBuffer { buffer, mut charge }) => {
+                self.idle_bytes.fetch_sub(buffer.len(), Ordering::Relaxed);
+                // The taker's claim covers `len` now; the slack stays charged.
+                drop(charge.split(len));
+                self.metrics.record_buffer_pool_take("reused");
+                (buffer, charge)
+            }
+            None => {
+                let Ok(charge) = self.try_charge(class_bytes(class) - len) else {
+                    return self.unpooled(len);
+                };
+                self.metrics.record_buffer_pool_take("allocated");
+                (vec![0; class_bytes(class)], charge)
+            }
+        };
+        PooledBuffer {
+            buffer,
+            len,
+            pool: Some((self.clone(), charge)),
+        }
+    }
+
+    fn unpooled(&self, len: usize) -> PooledBuffer {
+        self.metrics.record_buffer_pool_take("unpooled");
+        PooledBuffer {
+            buffer: vec![0; len],
+            len,
+            pool: None,
+        }
+    }
+
+    fn try_charge(&self, bytes: usize) -> Result<OwnedSemaphorePermit, ()> {
+        let permits = u32::try_from(bytes).map_err(|_| ())?;
+        self.transient
+            .clone()
+            .try_acquire_many_owned(permits)
+            .map_err(|_| ())
+    }
+
+    pub(super) fn set_accepting(&self, accepting: bool) {
+        self.accepting.store(accepting, Ordering::Relaxed);
+        if !accepting {
+            for class in &self.classes {
+                let freed = std::mem::take(&mut *class.lock().expect("buffer pool lock poisoned"));
+                let bytes = freed.iter().map(Vec::len).sum::<usize>();
+                self.idle_bytes.fetch_sub(bytes, Ordering::Relaxed);
+            }
+        }
+    }
+
+    /// Keeps a dropped buffer if the pool has room and the transient budget
+    /// can take back the bytes its taker held; `charge` covers the rest.
+    fn give_back(&self, buffer: Vec<u8>, mut charge: OwnedSemaphorePermit) {
+        if !self.accepting.load(Ordering::Relaxed) {
+            return;
+        }
+        let Some(class) =
+            class_of(buffer.len()).filter(|&class| class_bytes(class) == buffer.len())
+        else {
+            return;
+        };
+        if self.idle_bytes.load(Ordering::Relaxed) + buffer.len() > self.max_idle_bytes {
+            return;
+        }
+        let Ok(rest) = self.try_charge(buffer.len() - charge.num_permits()) else {
+            return;
+        };
+        charge.merge(rest);
+        let mut idle = self.classes[class]
+            .lock()
+            .expect("buffer pool lock poisoned");
+        if idle.len() < MAX_IDLE_PER_CLASS {
+            self.idle_bytes.fetch_add(buffer.len(), Ordering::Relaxed);
+            idle.push(IdleBuffer { buffer, charge });
+        }
+    }
+
+    #[cfg(test)]
+    pub(crate) fn idle_bytes(&self) -> usize {
+        self.idle_bytes.load(Ordering::Relaxed)
+    }
+}
+
+fn class_of(len: usize) -> Option<usize> {
+    if len < MIN_CLASS_BYTES {
+        return None;
+    }
+    let class =
+        (len.next_power_of_two().trailing_zeros() - MIN_CLASS_BYTES.trailing_zeros()) as usize;
+    (class < CLASS_COUNT).then_some(class)
+}
+
+fn class_bytes(class: usize) -> usize {
+    MIN_CLASS_BYTES << class
+}
+
+/// A buffer from a [`BufferPool`], returned to it on drop.
+pub struct PooledBuffer {
+    /// Always a whole size class when pooled; only `..len` is meaningful.
+    buffer: Vec<u8>,
+    len: usize,
+    /// The owning pool and the transient charge for `buffer[len..]`.
+    pool: Option<(Arc<BufferPool>, OwnedSemaphorePermit)>,
+}
+
+impl PooledBuffer {
+    pub fn as_mut_slice(&mut self) -> &mut [u8] {
+        &mut self.buffer[..self.len]
+    }
+
+    /// The contents as `Bytes`; the buffer returns to the pool when the
+    /// last clone drops.
+    pub fn into_bytes(self) -> Bytes {
+        Bytes::from_owner(self)
+    }
+}
+
+impl From<Vec<u8>> for PooledBuffer {
+    fn from(buffer: Vec<u8>) -> Self {
+        Self {
+            len: buffer.len(),
+            buffer,
+            pool: None,
+        }
+    }
+}
+
+impl std::ops::Deref for PooledBuffer {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        &self.buffer[..self.len]
+    }
+}
+
+impl AsRef<[u8]> for PooledBuffer {
+    fn as_ref(&self) -> &[u8] {
+        self
+    }
+}
+
+impl Drop for PooledBuffer {
+    fn drop(&mut self) {
+        if let Some((pool, charge)) = self.pool.take() {
+            pool.give_back(std::mem::take(&mut self.buffer), charge);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const TRANSIENT_BYTES: usize = 1 << 30;
+
+    fn pool_with_transient(transient: Arc<Semaphore>) -> Arc<BufferPool> {
+        Arc::new(BufferPool::new(
+            TRANSIENT_BYTES as u64,
+            transient,
+            Metrics::new("region".into(), "tenant".into()),
+        ))
+    }
+
+    fn pool() -> Arc<BufferPool> {
+        pool_with_transient(Arc::new(Semaphore::new(TRANSIENT_BYTES)))
+    }
+
+    #[test]
+    fn sizes_map_to_doubling_classes() {
+        assert_eq!(class_of(0), None);
+        assert_eq!(class_of(1), None);
+        assert_eq!(class_of(MIN_CLASS_BYTES - 1), None);
+        assert_eq!(class_of(MIN_CLASS_BYTES), Some(0));
+        assert_eq!(class_of(MIN_CLASS_BYTES + 1), Some(1));
+        assert_eq!(class_of(8 * 1024 * 1024), Some(CLASS_COUNT - 1));
+        assert_eq!(class_of(8 * 1024 * 1024 + 1), None);
+    }
+
+    #[test]
+    fn dropped_buffers_and_bytes_are_reused() {
+        let pool = pool();
+        let mut first = pool.take(100_000);
+        first.as_mut_slice().fill(1);
+        assert_eq!(first.len(), 100_000);
+        drop(first);
+        assert_eq!(pool.idle_bytes(), class_bytes(1));
+
+        let bytes = pool.take(70_000).into_bytes();
+        assert_eq!(pool.idle_bytes(), 0);
+        let body = bytes.slice(10..20);
+        drop(bytes);
+        assert_eq!(pool.idle_bytes(), 0, "the slice still holds the buffer");
+        drop(body);
+        assert_eq!(pool.idle_bytes(), class_bytes(1));
+
+        pool.set_accepting(false);
+        assert_eq!(pool.idle_bytes(), 0);
+        drop(pool.take(100_000));
+        assert_eq!(pool.idle_bytes(), 0);
+    }
+
+    #[test]
+    fn bytes_beyond_the_takers_claim_are_charged_to_the_transient_budget() {
+        let transient = Arc::new(Semaphore::new(TRANSIENT_BYTES));
+        let pool = pool_with_transient(transient.clone());
+        let charged = || TRANSIENT_BYTES - transient.available_permits();
+
+        let taken = pool.take(100_000);
+        assert_eq!(charged(), class_bytes(1) - 100_000, "the class slack");
+        drop(taken);
+        assert_eq!(charged(), class_bytes(1), "the whole idle buffer");
+
+        let reused = pool.take(70_000);
+        assert_eq!(charged(), class_bytes(1) - 70_000);
+        drop(reused);
+        assert_eq!(charged(), class_bytes(1));
+
+        pool.set_accepting(false);
+        assert_eq!(charged(), 0);
+    }
+
+    #[test]
+    fn an_exhausted_transient_budget_allocates_exactly_and_frees_returns() {
+        let transient = Arc::new(Semaphore::new(TRANSIENT_BYTES));
+        let pool = pool_with_transient(transient.clone());
+        let exhaust = || {
+            transient
+                .clone()
+                .try_acquire_many_owned(transient.available_permits() as u32)
+                .expect("the rest of the budget should be free")
+        };
+
+        let held = exhaust();
+        let exact = pool.take(100_000);
+        assert_eq!(exact.buffer.len(), 100_000);
+        assert!(exact.pool.is_none());
+        drop(exact);
+        drop(held);
+
+        let taken = pool.take(100_000);
+        let held = exhaust();
+        drop(taken);
+        assert_eq!(pool.idle_bytes(), 0, "no budget left to keep it idle");
+        drop(held);
+        assert_eq!(transient.available_permits(), TRANSIENT_BYTES);
+    }
+}
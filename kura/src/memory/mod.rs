@@ -7,13 +7,17 @@ use tokio::sync::Notify;
 use tokio::time::timeout;
 
 use crate::constants::RESPONSE_STREAM_SEND_BUFFER_BYTES;
+use crate::fair_admission::{FairQueue, FairnessWeights};
 use crate::metrics::Metrics;
+use crate::stage_timing::{self, Stage};
 
+mod buffers;
 mod cgroup;
 mod pools;
 mod pressure;
 mod reservation;
 
+pub use buffers::{BufferPool, PooledBuffer};
 pub use cgroup::{
     ContainerMemoryPressureSample, ContainerMemorySnapshot, container_memory_pressure_sample,
     container_memory_protection, container_memory_snapshot,
@@ -32,6 +36,10 @@ use reservation::{
     ForegroundWaiter, ResponseStreamWaiter,
 };
 
+/// Credit per round of the fair admission queues in front of the byte
+/// budgets: about one typical upload buffer or streamed chunk.
+const FAIR_ADMISSION_QUANTUM_BYTES: u64 = 1024 * 1024;
+
 /// Coordinates deterministic admission for memory that Kura allocates on behalf of a request.
 ///
 /// Live transient permits never exceed `hard_limit_bytes - soft_limit_bytes`. Waiting
@@ -87,6 +95,11 @@ struct MemoryControllerInner {
     state: AtomicU8,
     pressure_changed: Notify,
     pools: MemoryPools,
+    /// Order foreground reservations and response streams that have to wait
+    /// for memory, across tenants, namespaces and traffic classes.
+    foreground_admission: FairQueue,
+    response_stream_admission: FairQueue,
+    buffers: Arc<BufferPool>,
     metrics: Metrics,
 }
 
@@ -190,6 +203,11 @@ impl MemoryController {
             pools.foreground_response_streaming_bytes(),
             pools.degraded_response_stream_slots(),
         );
+        let buffers = Arc::new(BufferPool::new(
+            hard_limit_bytes.saturating_sub(soft_limit_bytes),
+            pools.transient(),
+            metrics.clone(),
+        ));
         Self {
             inner: Arc::new(MemoryControllerInner {
                 runtime_limit_bytes,
@@ -205,11 +223,33 @@ impl MemoryController {
                 state: AtomicU8::new(MemoryPressure::Normal.as_u8()),
                 pressure_changed: Notify::new(),
                 pools,
+                foreground_admission: FairQueue::new(
+                    "foreground_memory",
+                    FAIR_ADMISSION_QUANTUM_BYTES,
+                    metrics.clone(),
+                ),
+                response_stream_admission: FairQueue::new(
+                    "response_stream",
+                    FAIR_ADMISSION_QUANTUM_BYTES,
+                    metrics.clone(),
+                ),
+                buffers,
                 metrics,
             }),
         }
     }
 
+    pub fn set_fairness_weights(&self, weights: Arc<FairnessWeights>) {
+        self.inner.foreground_admission.set_weights(weights.clone());
+        self.inner.response_stream_admission.set_weights(weights);
+    }
+
+    /// Size-classed buffers for reads that are decoded and dropped (see
+    /// [`buffers`]).
+    pub fn buffer_pool(&self) -> &Arc<BufferPool> {
+        &self.inner.buffers
+    }
+
     pub fn observe(&self, resident_bytes: u64) -> MemoryPressure {
         // A forced tier is the test override; ignore the resident-bytes sample
         // so the pin holds instead of flickering with the real reading. Still
@@ -224,6 +264,9 @@ impl MemoryController {
             self.inner
                 .metrics
                 .update_memory_pressure_state(forced.as_i64());
+            self.inner
+                .buffers
+                .set_accepting(forced == MemoryPressure::Normal);
             return forced;
         }
         self.inner
@@ -243,6 +286,9 @@ impl MemoryController {
             self.inner
                 .metrics
                 .record_memory_pressure_transition(current.as_str(), next.as_str());
+            self.inner
+                .buffers
+                .set_accepting(next == MemoryPressure::Normal);
         }
         self.inner
             .metrics
@@ -522,6 +568,7 @@ impl MemoryController {
         requested_bytes: usize,
         protocol: &'static str,
     ) -> Result<ResponseStreamMemoryPermit, ResponseStreamAdmissionError> {
+        let _admission = stage_timing::enter(Stage::Admission);
         let started_at = Instant::now();
         let queue = self
             .inner
@@ -622,10 +669,11 @@ impl MemoryController {
                     .metrics
                     .record_memory_action("foreground_upload_admission_wait");
                 let _waiter = ForegroundWaiter::new(self.inner.clone());
-                match timeout(
-                    FOREGROUND_ADMISSION_TIMEOUT,
-                    self.reserve_transient(requested_bytes, AdmissionClass::Foreground),
-                )
+                match timeout(FOREGROUND_ADMISSION_TIMEOUT, async {
+                    let _turn = self.inner.foreground_admission.turn(requested_bytes).await;
+                    self.reserve_transient(requested_bytes, AdmissionClass::Foreground)
+                        .await
+                })
                 .await
                 {
                     Ok(Ok(reservation)) => {
@@ -685,6 +733,7 @@ impl MemoryController {
         protocol: &'static str,
         patience: ResponseStreamAdmissionPatience,
     ) -> Result<ResponseStreamMemoryPermit, ResponseStreamAdmissionError> {
+        let _admission = stage_timing::enter(Stage::Admission);
         let started_at = Instant::now();
         if self.inner.response_stream_waiters.load(Ordering::Acquire) == 0
             && let Ok((permit, elastic)) =
@@ -723,8 +772,8 @@ impl MemoryController {
         let result = timeout(patience.timeout(), async {
             let _turn = self
                 .inner
-                .pools
-                .acquire_response_stream_admission_turn()
+                .response_stream_admission
+                .turn(requested_bytes as u64)
                 .await;
             loop {
                 let changed = self.inner.pressure_changed.notified();
@@ -1,6 +1,6 @@
 use std::sync::Arc;
 
-use tokio::sync::{Mutex, OwnedMutexGuard, OwnedSemaphorePermit, Semaphore};
+use tokio::sync::{OwnedSemaphorePermit, Semaphore};
 
 use crate::constants::{
     MAX_INLINE_REPLICATION_BODY_BYTES, RESPONSE_STREAM_CHUNK_BYTES,
@@ -31,7 +31,6 @@ pub(super) struct MemoryPools {
     elastic_foreground_response_streaming: Arc<Semaphore>,
     background_response_streaming: Arc<Semaphore>,
     response_stream_waiters: Arc<Semaphore>,
-    response_stream_admission: Arc<Mutex<()>>,
     degraded_response_streaming: Arc<Semaphore>,
     mmap_serving_bytes: usize,
     response_streaming_bytes: usize,
@@ -105,7 +104,6 @@ impl MemoryPools {
                 background_response_streaming_bytes,
             )),
             response_stream_waiters: Arc::new(Semaphore::new(response_stream_waiters)),
-            response_stream_admission: Arc::new(Mutex::new(())),
             degraded_response_streaming: Arc::new(Semaphore::new(degraded_response_stream_slots)),
             mmap_serving_bytes,
             response_streaming_bytes,
@@ -156,6 +154,11 @@ impl MemoryPools {
             .map_err(|_| ())
     }
 
+    /// The transient budget itself, for the buffer pool's charges.
+    pub(super) fn transient(&self) -> Arc<Semaphore> {
+        self.transient.clone()
+    }
+
     pub(super) fn try_acquire_transient(&self, permits: u32) -> Result<OwnedSemaphorePermit, ()> {
         self.transient
             .clone()
@@ -234,10 +237,6 @@ impl MemoryPools {
             .map_err(|_| ())
     }
 
-    pub(super) async fn acquire_response_stream_admission_turn(&self) -> OwnedMutexGuard<()> {
-        self.response_stream_admission.clone().lock_owned().await
-    }
-
     pub(super) fn degraded_response_stream_slots(&self) -> usize {
         self.degraded_response_stream_slots
     }
@@ -14,13 +14,13 @@ use prometheus_client::{
         counter::Counter,
         family::Family,
         gauge::Gauge,
-        histogram::{Histogram, exponential_buckets},
+        histogram::{Histogram, exponential_buckets, linear_buckets},
     },
     registry::Registry,
 };
 
 use crate::{
-    artifact::producer::ArtifactProducer, node_location::NodeLocation,
+    artifact::producer::ArtifactProducer, node_location::NodeLocation, tasks::TaskPollMetrics,
     utils::replication_target_label,
 };
 
@@ -190,6 +190,53 @@ pub struct Metrics {
     promotion_queue_depth: Gauge,
     promotion_failures: Counter,
     promotion_drops: Family<RefreshTriggerLabels, Counter>,
+    namespace_reaps_pending: Gauge,
+    namespace_reaped_entries: Counter,
+    rocksdb_bytes_written: Family<RocksdbBytesWrittenLabels, Gauge>,
+    profile_captures: Family<ProfileCaptureLabels, Counter>,
+    runtime_workers: Gauge,
+    runtime_alive_tasks: Gauge,
+    runtime_global_queue_depth: Gauge,
+    runtime_worker_busy_ratio: Family<RuntimeWorkerLabels, Histogram>,
+    runtime_blocking_tasks: Family<RuntimeBlockingLabels, Gauge>,
+    task_poll_duration: Family<TaskLabels, Histogram>,
+    task_slow_polls: Family<TaskLabels, Counter>,
+    request_stage_duration: Family<RequestStageLabels, Histogram>,
+    inflight_upload_follows: Family<ArtifactOpLabels, Counter>,
+    upload_single_flight: Family<ArtifactOpLabels, Counter>,
+    backfill_tree_build_duration: Histogram,
+    backfill_tree_rows: Gauge<i64>,
+    backfill_reconcile_mismatched_leaves: Counter,
+    backfill_reconcile_passes: Family<BackfillReconcileLabels, Counter>,
+    warm_restart_entries: Family<WarmRestartLabels, Counter>,
+    warm_restart_readahead_bytes: Counter,
+    warm_restart_hot_set_written: Gauge,
+    namespace_usage_bytes: Family<NamespaceLabels, Gauge>,
+    namespace_share_bytes: Family<NamespaceLabels, Gauge>,
+    namespace_lookups: Family<NamespaceResultLabels, Counter>,
+    namespace_evicted_bytes: Family<NamespaceLabels, Counter>,
+    namespace_promotions_deferred: Family<NamespaceLabels, Counter>,
+    content_dedup_bodies: Family<ContentDedupLabels, Counter>,
+    content_dedup_bytes_saved: Counter,
+    replication_content_links: Family<ContentDedupLabels, Counter>,
+    segment_compression_bodies: Family<ArtifactOpLabels, Counter>,
+    segment_compression_input_bytes: Family<ArtifactRouteLabels, Counter>,
+    segment_compression_output_bytes: Family<ArtifactRouteLabels, Counter>,
+    segment_compression_duration: Family<SegmentCompressionLabels, Histogram>,
+    batch_get_items: Family<BatchGetLabels, Counter>,
+    batch_get_request_items: Histogram,
+    accelerated_core_connections: Family<AcceleratedCoreLabels, Counter>,
+    accelerated_core_bytes: Family<AcceleratedCoreLabels, Counter>,
+    accelerated_core_imbalance_ratio: Histogram,
+    upload_body_bytes: Family<UploadBodyLabels, Counter>,
+    segment_direct_write_bytes: Family<SegmentDirectWriteLabels, Counter>,
+    segment_recent_append_hits: Family<SegmentRecentAppendLabels, Counter>,
+    admission_wait: Family<AdmissionWaitLabels, Histogram>,
+    readahead: Family<ReadaheadLabels, Counter>,
+    readahead_bytes: Family<ReadaheadBytesLabels, Counter>,
+    buffer_pool_takes: Family<BufferPoolTakeLabels, Counter>,
+    mrc_sampled_reads: Family<MrcLabels, Counter>,
+    mrc_sampled_hits: Family<MrcHitLabels, Counter>,
 }
 
 #[derive(Default)]
@@ -402,6 +449,66 @@ impl Metrics {
         let promotion_queue_depth = Gauge::default();
         let promotion_failures = Counter::default();
         let promotion_drops = Family::<RefreshTriggerLabels, Counter>::default();
+        let namespace_reaps_pending = Gauge::default();
+        let namespace_reaped_entries = Counter::default();
+        let rocksdb_bytes_written = Family::<RocksdbBytesWrittenLabels, Gauge>::default();
+        let profile_captures = Family::<ProfileCaptureLabels, Counter>::default();
+        let runtime_workers = Gauge::default();
+        let runtime_alive_tasks = Gauge::default();
+        let runtime_global_queue_depth = Gauge::default();
+        let runtime_worker_busy_ratio =
+            Family::<RuntimeWorkerLabels, Histogram>::new_with_constructor(|| {
+                Histogram::new(linear_buckets(0.1, 0.1, 10))
+            });
+        let runtime_blocking_tasks = Family::<RuntimeBlockingLabels, Gauge>::default();
+        let task_poll_duration = Family::<TaskLabels, Histogram>::new_with_constructor(|| {
+            Histogram::new(exponential_buckets(0.00001, 4.0, 10))
+        });
+        let task_slow_polls = Family::<TaskLabels, Counter>::default();
+        let request_stage_duration =
+            Family::<RequestStageLabels, Histogram>::new_with_constructor(|| {
+                Histogram::new(exponential_buckets(0.0001, 2.0, 18))
+            });
+        let inflight_upload_follows = Family::<ArtifactOpLabels, Counter>::default();
+        let upload_single_flight = Family::<ArtifactOpLabels, Counter>::default();
+        let backfill_tree_build_duration = Histogram::new(exponential_buckets(0.01, 2.0, 14));
+        let backfill_tree_rows = Gauge::<i64>::default();
+        let backfill_reconcile_mismatched_leaves = Counter::default();
+        let backfill_reconcile_passes = Family::<BackfillReconcileLabels, Counter>::default();
+        let warm_restart_entries = Family::<WarmRestartLabels, Counter>::default();
+        let warm_restart_readahead_bytes = Counter::default();
+        let warm_restart_hot_set_written = Gauge::default();
+        let namespace_usage_bytes = Family::<NamespaceLabels, Gauge>::default();
+        let namespace_share_bytes = Family::<NamespaceLabels, Gauge>::default();
+        let namespace_lookups = Family::<NamespaceResultLabels, Counter>::default();
+        let namespace_evicted_bytes = Family::<NamespaceLabels, Counter>::default();
+        let namespace_promotions_deferred = Family::<NamespaceLabels, Counter>::default();
+        let content_dedup_bodies = Family::<ContentDedupLabels, Counter>::default();
+        let content_dedup_bytes_saved = Counter::default();
+        let replication_content_links = Family::<ContentDedupLabels, Counter>::default();
+        let segment_compression_bodies = Family::<ArtifactOpLabels, Counter>::default();
+        let segment_compression_input_bytes = Family::<ArtifactRouteLabels, Counter>::default();
+        let segment_compression_output_bytes = Family::<ArtifactRouteLabels, Counter>::default();
+        let segment_compression_duration =
+            Family::<SegmentCompressionLabels, Histogram>::new_with_constructor(|| {
+                Histogram::new(exponential_buckets(0.0001, 2.0, 16))
+            });
+        let batch_get_items = Family::<BatchGetLabels, Counter>::default();
+        let batch_get_request_items = Histogram::new(exponential_buckets(1.0, 2.0, 11));
+        let accelerated_core_connections = Family::<AcceleratedCoreLabels, Counter>::default();
+        let accelerated_core_bytes = Family::<AcceleratedCoreLabels, Counter>::default();
+        let accelerated_core_imbalance_ratio = Histogram::new(linear_buckets(1.0, 0.25, 12));
+        let upload_body_bytes = Family::<UploadBodyLabels, Counter>::default();
+        let segment_direct_write_bytes = Family::<SegmentDirectWriteLabels, Counter>::default();
+        let segment_recent_append_hits = Family::<SegmentRecentAppendLabels, Counter>::default();
+        let admission_wait = Family::<AdmissionWaitLabels, Histogram>::new_with_constructor(|| {
+            Histogram::new(exponential_buckets(0.0001, 2.0, 18))
+        });
+        let readahead = Family::<ReadaheadLabels, Counter>::default();
+        let readahead_bytes = Family::<ReadaheadBytesLabels, Counter>::default();
+        let buffer_pool_takes = Family::<BufferPoolTakeLabels, Counter>::default();
+        let mrc_sampled_reads = Family::<MrcLabels, Counter>::default();
+        let mrc_sampled_hits = Family::<MrcHitLabels, Counter>::default();
         let process_start_time_seconds = Gauge::<i64>::default();
         process_start_time_seconds.set(
             SystemTime::now()
@@ -1175,6 +1282,241 @@ impl Metrics {
             "Unix timestamp when the current Kura process started",
             process_start_time_seconds.clone(),
         );
+        registry.register(
+            "kura_namespace_reaps_pending",
+            "Tombstoned namespaces whose entries the background reaper has not finished purging",
+            namespace_reaps_pending.clone(),
+        );
+        registry.register(
+            "kura_namespace_reaped_entries_total",
+            "Entries purged from tombstoned namespaces by the background reaper",
+            namespace_reaped_entries.clone(),
+        );
+        registry.register(
+            "kura_rocksdb_bytes_written",
+            "Cumulative bytes RocksDB has written since open, by kind (user, flush, compaction); (flush + compaction) / user is the write amplification",
+            rocksdb_bytes_written.clone(),
+        );
+        registry.register(
+            "kura_profile_captures",
+            "On-demand profile captures requested on the internal plane, by kind and result",
+            profile_captures.clone(),
+        );
+        registry.register(
+            "kura_runtime_workers",
+            "Tokio runtime worker threads",
+            runtime_workers.clone(),
+        );
+        registry.register(
+            "kura_runtime_alive_tasks",
+            "Tasks alive on the Tokio runtime",
+            runtime_alive_tasks.clone(),
+        );
+        registry.register(
+            "kura_runtime_global_queue_depth",
+            "Tasks waiting in the Tokio runtime's global injection queue",
+            runtime_global_queue_depth.clone(),
+        );
+        registry.register(
+            "kura_runtime_worker_busy_ratio",
+            "Share of each one-second sample a Tokio worker spent polling tasks rather than parked",
+            runtime_worker_busy_ratio.clone(),
+        );
+        registry.register(
+            "kura_runtime_blocking_tasks",
+            "Blocking-pool work waiting for a thread (queued, and its peak since the last sample) or running (active)",
+            runtime_blocking_tasks.clone(),
+        );
+        registry.register(
+            "kura_runtime_task_poll_duration_seconds",
+            "Time a named task held a runtime worker per poll",
+            task_poll_duration.clone(),
+        );
+        registry.register(
+            "kura_runtime_slow_polls_total",
+            "Polls of a named task that held a runtime worker past the slow-poll threshold",
+            task_slow_polls.clone(),
+        );
+        registry.register(
+            "kura_request_stage_duration_seconds",
+            "Time public requests spent per serving stage (auth, admission, manifest, segment_open, first_read, transfer), by transport",
+            request_stage_duration.clone(),
+        );
+        registry.register(
+            "kura_inflight_upload_follows",
+            "Reads served by following an upload still being staged, by how the stream ended",
+            inflight_upload_follows.clone(),
+        );
+        registry.register(
+            "kura_upload_single_flight",
+            "Uploads that found an identical upload already staging, by whether they waited it out (deduplicated) or staged after it failed (restaged)",
+            upload_single_flight.clone(),
+        );
+        registry.register(
+            "kura_backfill_tree_build_duration_seconds",
+            "Time to build the backfill anti-entropy tree with a full index scan.",
+            backfill_tree_build_duration.clone(),
+        );
+        registry.register(
+            "kura_backfill_tree_rows",
+            "Index rows covered by the most recently built backfill tree.",
+            backfill_tree_rows.clone(),
+        );
+        registry.register(
+            "kura_backfill_reconcile_mismatched_leaves",
+            "Backfill tree leaves whose digests disagreed with a peer's during a reconcile.",
+            backfill_reconcile_mismatched_leaves.clone(),
+        );
+        registry.register(
+            "kura_backfill_reconcile_passes",
+            "Anti-entropy reconcile passes by result.",
+            backfill_reconcile_passes.clone(),
+        );
+        registry.register(
+            "kura_warm_restart_entries",
+            "Hot-set entries re-warmed at boot, by result",
+            warm_restart_entries.clone(),
+        );
+        registry.register(
+            "kura_warm_restart_readahead_bytes",
+            "Bytes of readahead queued while re-warming the hot set at boot",
+            warm_restart_readahead_bytes.clone(),
+        );
+        registry.register(
+            "kura_warm_restart_hot_set_written_entries",
+            "Entries in the hot set written on the last drain",
+            warm_restart_hot_set_written.clone(),
+        );
+        registry.register(
+            "kura_namespace_usage_bytes",
+            "Artifact bytes held per namespace at the last usage scan",
+            namespace_usage_bytes.clone(),
+        );
+        registry.register(
+            "kura_namespace_share_bytes",
+            "Fair share of the CAS ring per namespace at the last usage scan",
+            namespace_share_bytes.clone(),
+        );
+        registry.register(
+            "kura_namespace_lookups",
+            "Artifact lookups for serving per namespace, by hit or miss",
+            namespace_lookups.clone(),
+        );
+        registry.register(
+            "kura_namespace_evicted_bytes",
+            "Artifact bytes removed by segment eviction per namespace",
+            namespace_evicted_bytes.clone(),
+        );
+        registry.register(
+            "kura_namespace_promotions_deferred",
+            "Serve-path promotions skipped because the namespace was over its share",
+            namespace_promotions_deferred.clone(),
+        );
+        registry.register(
+            "kura_content_dedup_bodies",
+            "REAPI CAS bodies persisted, by whether they were stored or linked to a body already on disk",
+            content_dedup_bodies.clone(),
+        );
+        registry.register(
+            "kura_content_dedup_bytes_saved",
+            "Segment bytes not written because an identical REAPI CAS body was already stored",
+            content_dedup_bytes_saved.clone(),
+        );
+        registry.register(
+            "kura_replication_content_links",
+            "Replication link attempts for REAPI CAS blobs, by whether the peer already held the body",
+            replication_content_links.clone(),
+        );
+        registry.register(
+            "kura_segment_compression_bodies",
+            "Segment bodies considered for at-rest compression, by producer and outcome",
+            segment_compression_bodies.clone(),
+        );
+        registry.register(
+            "kura_segment_compression_input_bytes",
+            "Decoded bytes of segment bodies stored compressed",
+            segment_compression_input_bytes.clone(),
+        );
+        registry.register(
+            "kura_segment_compression_output_bytes",
+            "Stored bytes of segment bodies stored compressed",
+            segment_compression_output_bytes.clone(),
+        );
+        registry.register(
+            "kura_segment_compression_duration_seconds",
+            "CPU time spent compressing and decoding segment bodies",
+            segment_compression_duration.clone(),
+        );
+        registry.register(
+            "kura_batch_get_items",
+            "Items answered by Xcode multi-get requests by kind and result",
+            batch_get_items.clone(),
+        );
+        registry.register(
+            "kura_batch_get_request_items",
+            "Ids per Xcode multi-get request",
+            batch_get_request_items.clone(),
+        );
+        registry.register(
+            "kura_accelerated_core_connections",
+            "Public HTTP connections accepted per core by the per-core listeners",
+            accelerated_core_connections.clone(),
+        );
+        registry.register(
+            "kura_accelerated_core_bytes",
+            "Artifact bytes sent by the accelerator per core of the per-core listeners",
+            accelerated_core_bytes.clone(),
+        );
+        registry.register(
+            "kura_accelerated_core_imbalance_ratio",
+            "Busiest core's share of newly accepted public HTTP connections over the even share, per sampling interval",
+            accelerated_core_imbalance_ratio.clone(),
+        );
+        registry.register(
+            "kura_upload_body_bytes",
+            "Upload body bytes staged by producer and path (streamed through Hyper or spliced by the accelerator)",
+            upload_body_bytes.clone(),
+        );
+        registry.register(
+            "kura_segment_direct_write_bytes",
+            "Bytes written to segments with direct I/O, split into body bytes and block padding",
+            segment_direct_write_bytes.clone(),
+        );
+        registry.register(
+            "kura_segment_recent_append_hits",
+            "Segment reads served from the buffer of recent direct appends, by read path",
+            segment_recent_append_hits.clone(),
+        );
+        registry.register(
+            "kura_admission_wait_seconds",
+            "Time requests waited in the fair admission queues by resource and traffic class",
+            admission_wait.clone(),
+        );
+        registry.register(
+            "kura_readahead_blobs",
+            "Blobs read ahead for an expected download, by trigger and outcome (issued, over_budget, hit, expired)",
+            readahead.clone(),
+        );
+        registry.register(
+            "kura_readahead_bytes",
+            "Bytes read ahead for an expected download, by trigger",
+            readahead_bytes.clone(),
+        );
+        registry.register(
+            "kura_buffer_pool_takes",
+            "Buffers taken for REAPI materialization reads, by whether a pooled buffer was reused, a pooled one allocated, or the read was outside the pooled sizes",
+            buffer_pool_takes.clone(),
+        );
+        registry.register(
+            "kura_mrc_sampled_reads",
+            "Segment-ring reads sampled for the miss ratio curve, by dimension (producer or namespace) and value",
+            mrc_sampled_reads.clone(),
+        );
+        registry.register(
+            "kura_mrc_sampled_hits",
+            "Sampled segment-ring reads whose reuse distance fits in a multiple of the ring capacity, by dimension, value and capacity",
+            mrc_sampled_hits.clone(),
+        );
 
         let metrics = Self {
             region: region.clone(),
@@ -1334,6 +1676,53 @@ impl Metrics {
             promotion_queue_depth,
             promotion_failures,
             promotion_drops,
+            namespace_reaps_pending,
+            namespace_reaped_entries,
+            rocksdb_bytes_written,
+            profile_captures,
+            runtime_workers,
+            runtime_alive_tasks,
+            runtime_global_queue_depth,
+            runtime_worker_busy_ratio,
+            runtime_blocking_tasks,
+            task_poll_duration,
+            task_slow_polls,
+            request_stage_duration,
+            inflight_upload_follows,
+            upload_single_flight,
+            backfill_tree_build_duration,
+            backfill_tree_rows,
+            backfill_reconcile_mismatched_leaves,
+            backfill_reconcile_passes,
+            warm_restart_entries,
+            warm_restart_readahead_bytes,
+            warm_restart_hot_set_written,
+            namespace_usage_bytes,
+            namespace_share_bytes,
+            namespace_lookups,
+            namespace_evicted_bytes,
+            namespace_promotions_deferred,
+            content_dedup_bodies,
+            content_dedup_bytes_saved,
+            replication_content_links,
+            segment_compression_bodies,
+            segment_compression_input_bytes,
+            segment_compression_output_bytes,
+            segment_compression_duration,
+            batch_get_items,
+            batch_get_request_items,
+            accelerated_core_connections,
+            accelerated_core_bytes,
+            accelerated_core_imbalance_ratio,
+            upload_body_bytes,
+            segment_direct_write_bytes,
+            segment_recent_append_hits,
+            admission_wait,
+            readahead,
+            readahead_bytes,
+            buffer_pool_takes,
+            mrc_sampled_reads,
+            mrc_sampled_hits,
         };
 
         metrics
@@ -2297,6 +2686,361 @@ impl Metrics {
         self.promotion_failures.inc();
     }
 
+    pub fn update_namespace_reaps_pending(&self, pending: usize) {
+        self.namespace_reaps_pending.set(pending as i64);
+    }
+
+    pub fn record_namespace_reaped_entries(&self, entries: u64) {
+        self.namespace_reaped_entries.inc_by(entries);
+    }
+
+    pub fn update_rocksdb_bytes_written(&self, user: u64, flush: u64, compaction: u64) {
+        for (kind, bytes) in [("user", user), ("flush", flush), ("compaction", compaction)] {
+            self.rocksdb_bytes_written
+                .get_or_create(&RocksdbBytesWrittenLabels {
+                    kind: kind.to_owned(),
+                })
+                .set(bytes as i64);
+        }
+    }
+
+    pub fn record_profile_capture(&self, kind: &str, result: &str) {
+        self.profile_captures
+            .get_or_create(&ProfileCaptureLabels {
+                kind: kind.to_owned(),
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn task_poll_metrics(&self, task: &'static str) -> TaskPollMetrics {
+        let labels = TaskLabels {
+            task: task.to_owned(),
+        };
+        TaskPollMetrics {
+            task,
+            poll_duration: self.task_poll_duration.get_or_create(&labels).clone(),
+            slow_polls: self.task_slow_polls.get_or_create(&labels).clone(),
+            observe_every: 1,
+        }
+    }
+
+    pub fn record_runtime_worker_busy_ratio(&self, worker: usize, ratio: f64) {
+        self.runtime_worker_busy_ratio
+            .get_or_create(&RuntimeWorkerLabels {
+                worker: worker.to_string(),
+            })
+            .observe(ratio);
+    }
+
+    pub fn update_runtime_scheduling(
+        &self,
+        workers: usize,
+        alive_tasks: usize,
+        global_queue_depth: usize,
+        blocking_queued: usize,
+        blocking_queued_peak: usize,
+        blocking_active: usize,
+    ) {
+        self.runtime_workers.set(workers as i64);
+        self.runtime_alive_tasks.set(alive_tasks as i64);
+        self.runtime_global_queue_depth
+            .set(global_queue_depth as i64);
+        for (state, count) in [
+            ("queued", blocking_queued),
+            ("queued_peak", blocking_queued_peak),
+            ("active", blocking_active),
+        ] {
+            self.runtime_blocking_tasks
+                .get_or_create(&RuntimeBlockingLabels {
+                    state: state.to_owned(),
+                })
+                .set(count as i64);
+        }
+    }
+
+    pub fn observe_request_stage(&self, transport: &str, stage: &str, duration: Duration) {
+        self.request_stage_duration
+            .get_or_create(&RequestStageLabels {
+                transport: transport.to_owned(),
+                stage: stage.to_owned(),
+            })
+            .observe(duration.as_secs_f64());
+    }
+
+    pub fn record_inflight_upload_follow(&self, producer: ArtifactProducer, result: &str) {
+        self.inflight_upload_follows
+            .get_or_create(&ArtifactOpLabels {
+                producer: producer.as_str().to_owned(),
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn record_upload_single_flight(&self, producer: ArtifactProducer, result: &str) {
+        self.upload_single_flight
+            .get_or_create(&ArtifactOpLabels {
+                producer: producer.as_str().to_owned(),
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn observe_backfill_tree_build(&self, rows: u64, elapsed: Duration) {
+        self.backfill_tree_build_duration
+            .observe(elapsed.as_secs_f64());
+        self.backfill_tree_rows.set(rows as i64);
+    }
+
+    pub fn record_backfill_reconcile_leaves(&self, mismatched: u64) {
+        self.backfill_reconcile_mismatched_leaves.inc_by(mismatched);
+    }
+
+    pub fn record_backfill_reconcile(&self, result: &str) {
+        self.backfill_reconcile_passes
+            .get_or_create(&BackfillReconcileLabels {
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn record_warm_restart_entry(&self, result: &str, readahead_bytes: u64) {
+        self.warm_restart_entries
+            .get_or_create(&WarmRestartLabels {
+                result: result.to_owned(),
+            })
+            .inc();
+        self.warm_restart_readahead_bytes.inc_by(readahead_bytes);
+    }
+
+    pub fn set_warm_restart_hot_set_written(&self, entries: usize) {
+        self.warm_restart_hot_set_written.set(entries as i64);
+    }
+
+    /// Replaces the per-namespace usage and share gauges, so namespaces that
+    /// left the labeled set do not keep reporting their last value.
+    pub fn update_namespace_shares<'a>(
+        &self,
+        shares: impl IntoIterator<Item = (&'a str, u64, u64)>,
+    ) {
+        self.namespace_usage_bytes.clear();
+        self.namespace_share_bytes.clear();
+        for (namespace, usage_bytes, share_bytes) in shares {
+            let labels = NamespaceLabels {
+                namespace: namespace.to_owned(),
+            };
+            self.namespace_usage_bytes
+                .get_or_create(&labels)
+                .set(usage_bytes as i64);
+            self.namespace_share_bytes
+                .get_or_create(&labels)
+                .set(share_bytes.min(i64::MAX as u64) as i64);
+        }
+    }
+
+    pub fn record_namespace_lookup(&self, namespace: &str, result: &str) {
+        self.namespace_lookups
+            .get_or_create(&NamespaceResultLabels {
+                namespace: namespace.to_owned(),
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn record_namespace_evicted_bytes(&self, namespace: &str, bytes: u64) {
+        self.namespace_evicted_bytes
+            .get_or_create(&NamespaceLabels {
+                namespace: namespace.to_owned(),
+            })
+            .inc_by(bytes);
+    }
+
+    pub fn record_namespace_promotion_deferred(&self, namespace: &str) {
+        self.namespace_promotions_deferred
+            .get_or_create(&NamespaceLabels {
+                namespace: namespace.to_owned(),
+            })
+            .inc();
+    }
+
+    /// `result` is `stored`, `linked` or `promotion_linked`; linked bodies
+    /// count toward the bytes saved.
+    pub fn record_content_dedup(&self, result: &str, bytes: u64) {
+        self.content_dedup_bodies
+            .get_or_create(&ContentDedupLabels {
+                result: result.to_owned(),
+            })
+            .inc();
+        if result != "stored" {
+            self.content_dedup_bytes_saved.inc_by(bytes);
+        }
+    }
+
+    pub fn record_replication_content_link(&self, result: &str) {
+        self.replication_content_links
+            .get_or_create(&ContentDedupLabels {
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    /// `result` is `compressed`, `incompressible`, `skipped_pressure` or
+    /// `error`; only compressed bodies count toward the byte totals.
+    pub fn record_segment_compression(
+        &self,
+        producer: ArtifactProducer,
+        result: &str,
+        input_bytes: u64,
+        output_bytes: u64,
+        elapsed: Option<Duration>,
+    ) {
+        self.segment_compression_bodies
+            .get_or_create(&ArtifactOpLabels {
+                producer: producer.as_str().to_owned(),
+                result: result.to_owned(),
+            })
+            .inc();
+        if result == "compressed" {
+            let labels = ArtifactRouteLabels {
+                producer: producer.as_str().to_owned(),
+            };
+            self.segment_compression_input_bytes
+                .get_or_create(&labels)
+                .inc_by(input_bytes);
+            self.segment_compression_output_bytes
+                .get_or_create(&labels)
+                .inc_by(output_bytes);
+        }
+        if let Some(elapsed) = elapsed {
+            self.observe_segment_compression_duration("compress", elapsed);
+        }
+    }
+
+    pub fn observe_segment_compression_duration(&self, operation: &str, elapsed: Duration) {
+        self.segment_compression_duration
+            .get_or_create(&SegmentCompressionLabels {
+                operation: operation.to_owned(),
+            })
+            .observe(elapsed.as_secs_f64());
+    }
+
+    pub fn record_batch_get_item(&self, kind: &str, result: &str) {
+        self.batch_get_items
+            .get_or_create(&BatchGetLabels {
+                kind: kind.to_owned(),
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn observe_batch_get_request(&self, items: usize) {
+        self.batch_get_request_items.observe(items as f64);
+    }
+
+    pub fn record_accelerated_core_connection(&self, core: usize) {
+        self.accelerated_core_connections
+            .get_or_create(&AcceleratedCoreLabels {
+                core: core.to_string(),
+            })
+            .inc();
+    }
+
+    pub fn record_accelerated_core_bytes(&self, core: usize, bytes: u64) {
+        self.accelerated_core_bytes
+            .get_or_create(&AcceleratedCoreLabels {
+                core: core.to_string(),
+            })
+            .inc_by(bytes);
+    }
+
+    pub fn observe_accelerated_core_imbalance(&self, ratio: f64) {
+        self.accelerated_core_imbalance_ratio.observe(ratio);
+    }
+
+    pub fn record_upload_body(&self, producer: ArtifactProducer, path: &str, bytes: u64) {
+        self.upload_body_bytes
+            .get_or_create(&UploadBodyLabels {
+                producer: producer.as_str().to_owned(),
+                path: path.to_owned(),
+            })
+            .inc_by(bytes);
+    }
+
+    pub fn record_segment_direct_write(&self, body_bytes: u64, padding_bytes: u64) {
+        for (kind, bytes) in [("body", body_bytes), ("padding", padding_bytes)] {
+            self.segment_direct_write_bytes
+                .get_or_create(&SegmentDirectWriteLabels {
+                    kind: kind.to_owned(),
+                })
+                .inc_by(bytes);
+        }
+    }
+
+    pub fn record_segment_recent_append_hit(&self, path: &str) {
+        self.segment_recent_append_hits
+            .get_or_create(&SegmentRecentAppendLabels {
+                path: path.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn observe_admission_wait(&self, resource: &str, class: &str, duration: Duration) {
+        self.admission_wait
+            .get_or_create(&AdmissionWaitLabels {
+                resource: resource.to_owned(),
+                class: class.to_owned(),
+            })
+            .observe(duration.as_secs_f64());
+    }
+
+    pub fn record_readahead(&self, trigger: &str, outcome: &str) {
+        self.readahead
+            .get_or_create(&ReadaheadLabels {
+                trigger: trigger.to_owned(),
+                outcome: outcome.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn record_readahead_bytes(&self, trigger: &str, bytes: u64) {
+        self.readahead_bytes
+            .get_or_create(&ReadaheadBytesLabels {
+                trigger: trigger.to_owned(),
+            })
+            .inc_by(bytes);
+    }
+
+    pub fn record_buffer_pool_take(&self, result: &str) {
+        self.buffer_pool_takes
+            .get_or_create(&BufferPoolTakeLabels {
+                result: result.to_owned(),
+            })
+            .inc();
+    }
+
+    pub fn record_mrc_sampled_read(
+        &self,
+        dimension: &str,
+        value: &str,
+        hit_capacities: impl IntoIterator<Item = &'static str>,
+    ) {
+        self.mrc_sampled_reads
+            .get_or_create(&MrcLabels {
+                dimension: dimension.to_owned(),
+                value: value.to_owned(),
+            })
+            .inc();
+        for capacity in hit_capacities {
+            self.mrc_sampled_hits
+                .get_or_create(&MrcHitLabels {
+                    dimension: dimension.to_owned(),
+                    value: value.to_owned(),
+                    capacity: capacity.to_owned(),
+                })
+                .inc();
+        }
+    }
+
     pub fn rollout_metrics_snapshot(&self) -> RolloutMetricsSnapshot {
         RolloutMetricsSnapshot {
             outbox_messages: self
@@ -2594,6 +3338,131 @@ struct MembershipChangeLabels {
     change: String,
 }
 
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct RocksdbBytesWrittenLabels {
+    kind: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct ProfileCaptureLabels {
+    kind: String,
+    result: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct RuntimeWorkerLabels {
+    worker: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct RuntimeBlockingLabels {
+    state: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct TaskLabels {
+    task: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct RequestStageLabels {
+    transport: String,
+    stage: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct BackfillReconcileLabels {
+    result: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct WarmRestartLabels {
+    result: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct NamespaceLabels {
+    namespace: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct NamespaceResultLabels {
+    namespace: String,
+    result: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct ContentDedupLabels {
+    result: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct SegmentCompressionLabels {
+    operation: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct BatchGetLabels {
+    kind: String,
+    result: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct AcceleratedCoreLabels {
+    core: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct UploadBodyLabels {
+    producer: String,
+    path: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct SegmentDirectWriteLabels {
+    kind: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct SegmentRecentAppendLabels {
+    path: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct AdmissionWaitLabels {
+    resource: String,
+    class: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct ReadaheadLabels {
+    trigger: String,
+    outcome: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct ReadaheadBytesLabels {
+    trigger: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct BufferPoolTakeLabels {
+    result: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct MrcLabels {
+    dimension: String,
+    value: String,
+}
+
+#[derive(Clone, Debug, Hash, PartialEq, Eq, EncodeLabelSet)]
+struct MrcHitLabels {
+    dimension: String,
+    value: String,
+    capacity: String,
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -0,0 +1,432 @@
+//! Online miss-ratio-curve estimation for the segment ring.
+//!
+//! Disk per node is sized from the hit ratio the ring would reach at other
+//! capacities, which only the read stream's reuse distances tell. Kura keeps
+//! SHARDS-style estimates of them: a blob is sampled when the hash of its
+//! artifact id falls under a threshold, so a blob is either always or never
+//! sampled, and an LRU stack over just the sampled blobs yields each sampled
+//! read's byte reuse distance, scaled back up by the sampling rate. A read hits
+//! at a capacity when that distance fits in it.
+//!
+//! The sample set is fixed-size: once it holds [`MRC_MAX_SAMPLED_BLOBS`], the
+//! blob with the largest hash is dropped and the threshold lowered to it, so a
+//! quiet node measures every blob and a busy one a small, constant-cost
+//! fraction. The threshold is also kept in an atomic, so an unsampled read
+//! returns without taking the lock. Distances are global; each sampled read is
+//! then counted under its producer and its namespace, and those counts halve
+//! every [`MRC_DECAY_READS`] so the curve follows the recent stream.
+//!
+//! A lookup that finds a blob already evicted is a reference too: it is the
+//! read a larger ring would have hit. Its size is the one last recorded for
+//! the blob, and a blob never seen before counts as a cold miss.
+
+use std::{
+    collections::{BTreeMap, HashMap},
+    hash::{Hash, Hasher},
+    sync::{
+        Mutex,
+        atomic::{AtomicU64, Ordering},
+    },
+};
+
+use serde::Serialize;
+
+use crate::{artifact::producer::ArtifactProducer, metrics::Metrics};
+
+/// Ring-capacity multiples the curve is evaluated at.
+pub const MRC_CAPACITY_FACTORS: [(&str, f64); 4] =
+    [("0.5x", 0.5), ("1x", 1.0), ("2x", 2.0), ("4x", 4.0)];
+/// Sampled blobs tracked at once, which bounds the memory.
+pub const MRC_MAX_SAMPLED_BLOBS: usize = 4_096;
+/// Read positions the recency tree holds before live blobs are renumbered,
+/// so renumbering runs at most once per [`MRC_MAX_SAMPLED_BLOBS`] reads.
+const RECENCY_SLOTS: usize = 2 * MRC_MAX_SAMPLED_BLOBS;
+/// Sampled reads a curve holds before its counts halve.
+pub const MRC_DECAY_READS: u64 = 1 << 16;
+/// Namespaces with their own curve; later ones share `_other`.
+const MRC_MAX_NAMESPACES: usize = 32;
+const OTHER_NAMESPACE: &str = "_other";
+
+pub struct MissRatioCurve {
+    capacity_bytes: u64,
+    /// A blob is sampled when its hash is below this. Only lowered, under
+    /// the state lock.
+    threshold: AtomicU64,
+    state: Mutex<CurveState>,
+    metrics: Metrics,
+}
+
+struct CurveState {
+    /// Sampled blobs by hash, with the position and size of their last read.
+    sampled: BTreeMap<u64, SampledBlob>,
+    /// Sizes of the sampled blobs by the position of their last read.
+    recency: RecencyTree,
+    next_position: usize,
+    producers: HashMap<&'static str, Tally>,
+    namespaces: HashMap<String, Tally>,
+}
+
+struct SampledBlob {
+    position: usize,
+    bytes: u64,
+}
+
+/// A Fenwick tree over read positions, so the bytes read since a position
+/// are one prefix sum rather than a walk over every newer blob.
+struct RecencyTree {
+    sums: Vec<u64>,
+    total: u64,
+}
+
+#[derive(Clone, Copy, Default)]
+struct Tally {
+    reads: u64,
+    hits: [u64; MRC_CAPACITY_FACTORS.len()],
+}
+
+#[derive(Debug, Serialize)]
+pub struct MissRatioReport {
+    pub ring_capacity_bytes: u64,
+    pub sample_rate: f64,
+    pub sampled_blobs: usize,
+    pub producers: BTreeMap<String, CurvePoints>,
+    pub namespaces: BTreeMap<String, CurvePoints>,
+}
+
+#[derive(Debug, Serialize)]
+pub struct CurvePoints {
+    pub sampled_reads: u64,
+    /// Expected hit ratio by ring-capacity multiple.
+    pub hit_ratio: BTreeMap<&'static str, f64>,
+}
+
+impl MissRatioCurve {
+    pub fn new(capacity_bytes: u64, metrics: Metrics) -> Self {
+        Self {
+            capacity_bytes,
+            metrics,
+            threshold: AtomicU64::new(u64::MAX),
+            state: Mutex::new(CurveState {
+                sampled: BTreeMap::new(),
+                recency: RecencyTree::new(),
+                next_position: 0,
+                producers: HashMap::new(),
+                namespaces: HashMap::new(),
+            }),
+        }
+    }
+
+    /// Records a read of a ring-resident body of `bytes`.
+    pub fn record(
+        &self,
+        artifact_id: &str,
+        producer: ArtifactProducer,
+        namespace_id: &str,
+        bytes: u64,
+    ) {
+        self.reference(artifact_id, producer, namespace_id, Some(bytes));
+    }
+
+    /// Records a lookup of a body the ring no longer (or never) held.
+    pub fn record_miss(&self, artifact_id: &str, producer: ArtifactProducer, namespace_id: &str) {
+        self.reference(artifact_id, producer, namespace_id, None);
+    }
+
+    fn reference(
+        &self,
+        artifact_id: &str,
+        producer: ArtifactProducer,
+        namespace_id: &str,
+        bytes: Option<u64>,
+    ) {
+        let hash = sample_hash(artifact_id);
+        if hash >= self.threshold.load(Ordering::Relaxed) {
+            return;
+        }
+        let mut state = self.state.lock().expect("miss ratio curve lock poisoned");
+        let threshold = self.threshold.load(Ordering::Relaxed);
+        if hash >= threshold {
+            return;
+        }
+        let scale = scale(threshold);
+        let previous = state.sampled.remove(&hash);
+        let distance = previous.as_ref().map(|previous| {
+            state
+                .recency
+                .add(previous.position, previous.bytes.wrapping_neg());
+            let between = state.recency.since(previous.position);
+            between as f64 * scale + bytes.unwrap_or(previous.bytes) as f64
+        });
+        if let Some(bytes) = bytes.or(previous.map(|previous| previous.bytes)) {
+            let position = state.next_position();
+            state.recency.add(position, bytes);
+            state.sampled.insert(hash, SampledBlob { position, bytes });
+            if let Some(threshold) = state.shrink() {
+                self.threshold.store(threshold, Ordering::Relaxed);
+            }
+        }
+
+        let hits = MRC_CAPACITY_FACTORS.map(|(_, factor)| {
+            distance.is_some_and(|distance| distance <= self.capacity_bytes as f64 * factor)
+        });
+        state
+            .producers
+            .entry(producer.as_str())
+            .or_default()
+            .add(hits);
+        let namespace = if state.namespaces.len() < MRC_MAX_NAMESPACES
+            || state.namespaces.contains_key(namespace_id)
+        {
+            namespace_id
+        } else {
+            OTHER_NAMESPACE
+        };
+        state
+            .namespaces
+            .entry(namespace.to_owned())
+            .or_default()
+            .add(hits);
+        drop(state);
+
+        let hit_capacities = || {
+            MRC_CAPACITY_FACTORS
+                .iter()
+                .zip(hits)
+                .filter(|(_, hit)| *hit)
+                .map(|((capacity, _), _)| *capacity)
+        };
+        self.metrics
+            .record_mrc_sampled_read("producer", producer.as_str(), hit_capacities());
+        self.metrics
+            .record_mrc_sampled_read("namespace", namespace, hit_capacities());
+    }
+
+    pub fn report(&self) -> MissRatioReport {
+        let state = self.state.lock().expect("miss ratio curve lock poisoned");
+        MissRatioReport {
+            ring_capacity_bytes: self.capacity_bytes,
+            sample_rate: 1.0 / scale(self.threshold.load(Ordering::Relaxed)),
+            sampled_blobs: state.sampled.len(),
+            producers: state
+                .producers
+                .iter()
+                .map(|(producer, tally)| ((*producer).to_owned(), tally.points()))
+                .collect(),
+            namespaces: state
+                .namespaces
+                .iter()
+                .map(|(namespace, tally)| (namespace.clone(), tally.points()))
+                .collect(),
+        }
+    }
+}
+
+/// Inverse of the sampling rate.
+fn scale(threshold: u64) -> f64 {
+    u64::MAX as f64 / threshold.max(1) as f64
+}
+
+impl CurveState {
+    /// The position of the read being recorded, renumbering the live blobs
+    /// in read order once the tree's slots run out.
+    fn next_position(&mut self) -> usize {
+        if self.next_position == RECENCY_SLOTS {
+            let mut live: Vec<&mut SampledBlob> = self.sampled.values_mut().collect();
+            live.sort_unstable_by_key(|blob| blob.position);
+            self.recency = RecencyTree::new();
+            for (position, blob) in live.into_iter().enumerate() {
+                blob.position = position;
+                self.recency.add(position, blob.bytes);
+            }
+            self.next_position = self.sampled.len();
+        }
+        self.next_position += 1;
+        self.next_position - 1
+    }
+
+    /// Drops the largest-hash blobs past the sample size. Returns the lowered
+    /// threshold, if it was.
+    fn shrink(&mut self) -> Option<u64> {
+        let mut threshold = None;
+        while self.sampled.len() > MRC_MAX_SAMPLED_BLOBS {
+            let Some((hash, blob)) = self.sampled.pop_last() else {
+                break;
+            };
+            self.recency.add(blob.position, blob.bytes.wrapping_neg());
+            threshold = Some(hash);
+        }
+        threshold
+    }
+}
+
+impl RecencyTree {
+    fn new() -> Self {
+        Self {
+            sums: vec![0; RECENCY_SLOTS + 1],
+            total: 0,
+        }
+    }
+
+    /// Adds `delta` (two's complement for a removal) at `position`.
+    fn add(&mut self, position: usize, delta: u64) {
+        self.total = self.total.wrapping_add(delta);
+        let mut index = position + 1;
+        while index < self.sums.len() {
+            self.sums[index] = self.sums[index].wrapping_add(delta);
+            index += index & index.wrapping_neg();
+        }
+    }
+
+    /// Bytes at positions after `position`.
+    fn since(&self, position: usize) -> u64 {
+        let mut through = 0_u64;
+        let mut index = position + 1;
+        while index > 0 {
+            through = through.wrapping_add(self.sums[index]);
+            index -= index & index.wrapping_neg();
+        }
+        self.total.wrapping_sub(through)
+    }
+}
+
+impl Tally {
+    fn add(&mut self, hits: [bool; MRC_CAPACITY_FACTORS.len()]) {
+        if self.reads >= MRC_DECAY_READS {
+            self.reads /= 2;
+            for count in &mut self.hits {
+                *count /= 2;
+            }
+        }
+        self.reads += 1;
+        for (count, hit) in self.hits.iter_mut().zip(hits) {
+            *count += u64::from(hit);
+        }
+    }
+
+    fn points(&self) -> CurvePoints {
+        CurvePoints {
+            sampled_reads: self.reads,
+            hit_ratio: MRC_CAPACITY_FACTORS
+                .iter()
+                .zip(self.hits)
+                .map(|((capacity, _), hits)| (*capacity, hits as f64 / self.reads.max(1) as f64))
+                .collect(),
+        }
+    }
+}
+
+/// A fixed-key hash, so a blob's sampling decision is the same on every read.
+fn sample_hash(artifact_id: &str) -> u64 {
+    let mut hasher = std::collections::hash_map::DefaultHasher::new();
+    artifact_id.hash(&mut hasher);
+    hasher.finish()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn curve(capacity_bytes: u64) -> MissRatioCurve {
+        MissRatioCurve::new(
+            capacity_bytes,
+            Metrics::new("region".into(), "tenant".into()),
+        )
+    }
+
+    #[test]
+    fn cyclic_reads_hit_only_where_the_loop_fits() {
+        let blob_bytes = 1024 * 1024;
+        let curve = curve(10 * blob_bytes);
+        for _ in 0..20 {
+            for blob in 0..15 {
+                curve.record(
+                    &format!("blob-{blob}"),
+                    ArtifactProducer::Xcode,
+                    "ios",
+                    blob_bytes,
+                );
+            }
+        }
+
+        let report = curve.report();
+        assert_eq!(report.sample_rate, 1.0);
+        let points = &report.producers["xcode"];
+        assert_eq!(points.sampled_reads, 300);
+        // The first pass is cold; every later read has fifteen blobs of
+        // reuse distance, which fits in twice the ring but not in it.
+        let warm = 285.0 / 300.0;
+        assert_eq!(points.hit_ratio["0.5x"], 0.0);
+        assert_eq!(points.hit_ratio["1x"], 0.0);
+        assert_eq!(points.hit_ratio["2x"], warm);
+        assert_eq!(points.hit_ratio["4x"], warm);
+        assert_eq!(report.namespaces["ios"].hit_ratio["2x"], warm);
+    }
+
+    #[test]
+    fn a_lookup_after_eviction_hits_only_in_a_larger_ring() {
+        let blob_bytes = 1024 * 1024;
+        let curve = curve(4 * blob_bytes);
+        curve.record("evicted", ArtifactProducer::Gradle, "android", blob_bytes);
+        for blob in 0..6 {
+            curve.record(
+                &format!("blob-{blob}"),
+                ArtifactProducer::Gradle,
+                "android",
+                blob_bytes,
+            );
+        }
+        curve.record_miss("evicted", ArtifactProducer::Gradle, "android");
+        curve.record_miss("never-stored", ArtifactProducer::Gradle, "android");
+
+        let points = &curve.report().producers["gradle"];
+        assert_eq!(points.sampled_reads, 9);
+        // The evicted blob's seven-blob distance fits in twice the ring.
+        assert_eq!(points.hit_ratio["1x"], 0.0);
+        assert_eq!(points.hit_ratio["2x"], 1.0 / 9.0);
+    }
+
+    #[test]
+    fn renumbering_keeps_reuse_distances() {
+        let curve = curve(1 << 40);
+        for read in 0..(3 * RECENCY_SLOTS) {
+            curve.record(
+                &format!("blob-{}", read % 3),
+                ArtifactProducer::Nx,
+                "web",
+                (read % 3 + 1) as u64,
+            );
+        }
+        let state = curve.state.lock().expect("lock");
+        assert_eq!(state.recency.total, 1 + 2 + 3);
+        for blob in state.sampled.values() {
+            assert_eq!(
+                state.recency.since(blob.position),
+                6 - state
+                    .sampled
+                    .values()
+                    .filter(|other| other.position <= blob.position)
+                    .map(|other| other.bytes)
+                    .sum::<u64>()
+            );
+        }
+    }
+
+    #[test]
+    fn sample_set_stays_bounded_by_lowering_the_rate() {
+        let curve = curve(1 << 30);
+        for blob in 0..(3 * MRC_MAX_SAMPLED_BLOBS) {
+            curve.record(
+                &format!("blob-{blob}"),
+                ArtifactProducer::Gradle,
+                &format!("namespace-{}", blob % 64),
+                4096,
+            );
+        }
+
+        let report = curve.report();
+        assert_eq!(report.sampled_blobs, MRC_MAX_SAMPLED_BLOBS);
+        assert!(report.sample_rate < 0.5);
+        assert_eq!(report.namespaces.len(), MRC_MAX_NAMESPACES + 1);
+        assert!(report.namespaces.contains_key(OTHER_NAMESPACE));
+    }
+}
@@ -0,0 +1,326 @@
+//! Fair shares of the CAS ring per namespace.
+//!
+//! The segment ring reclaims space oldest segment first, whatever it holds,
+//! so what decides whether an artifact outlives its segment is promotion:
+//! a read from an Old segment copies the artifact forward into a live one.
+//! One namespace with a large, low-reuse working set on a shared node turns
+//! the ring over fast and, through its own promotions, keeps it turning, and
+//! everyone else's hot artifacts age out between reads.
+//!
+//! The store therefore periodically sums manifest sizes per namespace and
+//! splits the ring capacity between the namespaces holding data by weighted
+//! max-min fairness: a namespace using less than its weighted slice keeps all
+//! of it and the remainder is split among the rest, with an optional byte
+//! quota capping any namespace's slice. A namespace over its share stops
+//! being promoted on the serve path, so eviction takes its old data first
+//! while namespaces within their share keep theirs alive. Promotions that
+//! back a `GetActionResult` or `FindMissingBlobs` answer are never deferred:
+//! they keep a promise the node has already made to a client.
+//!
+//! Shares only bite once the namespaces together want more than the ring
+//! holds; below that, only explicit quotas do.
+
+use std::collections::{BTreeMap, HashSet};
+
+use crate::constants::NAMESPACE_METRICS_MAX_LABELS;
+
+/// Label for namespaces outside the tracked set, so the per-namespace metric
+/// families stay bounded on nodes serving thousands of namespaces.
+pub const OTHER_NAMESPACES_LABEL: &str = "_other";
+
+/// Operator-configured weights and byte quotas. `*` sets the tenant-wide
+/// default for namespaces without an entry of their own.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct NamespaceShareConfig {
+    weights: BTreeMap<String, u64>,
+    default_weight: u64,
+    quotas: BTreeMap<String, u64>,
+    default_quota: Option<u64>,
+}
+
+impl Default for NamespaceShareConfig {
+    fn default() -> Self {
+        Self {
+            weights: BTreeMap::new(),
+            default_weight: 1,
+            quotas: BTreeMap::new(),
+            default_quota: None,
+        }
+    }
+}
+
+impl NamespaceShareConfig {
+    /// Parses the `namespace=value` lists of `KURA_NAMESPACE_WEIGHTS` and
+    /// `KURA_NAMESPACE_QUOTA_BYTES`.
+    pub fn parse(
+        weights_key: &str,
+        weights: Option<&str>,
+        quotas_key: &str,
+        quotas: Option<&str>,
+    ) -> Result<Self, String> {
+        let mut config = Self::default();
+        let (weights, default_weight) = parse_assignments(weights_key, weights.unwrap_or(""))?;
+        if weights
+            .values()
+            .chain(default_weight.iter())
+            .any(|&weight| weight == 0)
+        {
+            return Err(format!("{weights_key} weights must be greater than 0"));
+        }
+        config.weights = weights;
+        config.default_weight = default_weight.unwrap_or(1);
+        (config.quotas, config.default_quota) =
+            parse_assignments(quotas_key, quotas.unwrap_or(""))?;
+        Ok(config)
+    }
+
+    pub(crate) fn weight(&self, namespace_id: &str) -> u64 {
+        self.weights
+            .get(namespace_id)
+            .copied()
+            .unwrap_or(self.default_weight)
+    }
+
+    fn quota(&self, namespace_id: &str) -> Option<u64> {
+        self.quotas
+            .get(namespace_id)
+            .copied()
+            .or(self.default_quota)
+    }
+
+    fn configured_namespaces(&self) -> impl Iterator<Item = &String> {
+        self.weights.keys().chain(self.quotas.keys())
+    }
+}
+
+fn parse_assignments(
+    key: &str,
+    value: &str,
+) -> Result<(BTreeMap<String, u64>, Option<u64>), String> {
+    let mut assignments = BTreeMap::new();
+    let mut default = None;
+    for entry in value
+        .split(',')
+        .map(str::trim)
+        .filter(|entry| !entry.is_empty())
+    {
+        let Some((namespace_id, amount)) = entry.split_once('=') else {
+            return Err(format!("{key} entries must look like namespace=value"));
+        };
+        let amount = amount
+            .trim()
+            .parse::<u64>()
+            .map_err(|_| format!("{key} value for {namespace_id} must be a valid u64"))?;
+        match namespace_id.trim() {
+            "" => return Err(format!("{key} entries must name a namespace")),
+            "*" => default = Some(amount),
+            namespace_id => {
+                assignments.insert(namespace_id.to_owned(), amount);
+            }
+        }
+    }
+    Ok((assignments, default))
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct NamespaceShare {
+    pub usage_bytes: u64,
+    pub share_bytes: u64,
+}
+
+impl NamespaceShare {
+    pub fn over_share(&self) -> bool {
+        self.usage_bytes > self.share_bytes
+    }
+}
+
+/// Shares computed from one usage scan.
+#[derive(Debug, Default)]
+pub struct NamespaceShares {
+    shares: BTreeMap<String, NamespaceShare>,
+    /// Namespaces reported under their own metric label: the configured ones
+    /// and the largest by usage.
+    labeled: HashSet<String>,
+}
+
+impl NamespaceShares {
+    pub fn compute(
+        usage: BTreeMap<String, u64>,
+        capacity_bytes: u64,
+        config: &NamespaceShareConfig,
+    ) -> Self {
+        // Weighted water-filling: raise a common per-weight level until the
+        // capacity is spent; namespaces whose (quota-capped) usage sits below
+        // the level are satisfied and leave the pool.
+        let mut remaining = u128::from(capacity_bytes);
+        let mut pending: Vec<(u128, u128)> = usage
+            .iter()
+            .map(|(namespace_id, &bytes)| {
+                let demand = bytes.min(config.quota(namespace_id).unwrap_or(u64::MAX));
+                (u128::from(demand), u128::from(config.weight(namespace_id)))
+            })
+            .collect();
+        let level = loop {
+            let total_weight: u128 = pending.iter().map(|&(_, weight)| weight).sum();
+            if total_weight == 0 {
+                break None;
+            }
+            let level = remaining / total_weight;
+            let before = pending.len();
+            pending.retain(|&(demand, weight)| {
+                let satisfied = demand <= level * weight;
+                if satisfied {
+                    remaining -= demand;
+                }
+                !satisfied
+            });
+            if pending.len() == before {
+                break Some(level);
+            }
+        };
+
+        let shares = usage
+            .iter()
+            .map(|(namespace_id, &usage_bytes)| {
+                let fair = level.map_or(u64::MAX, |level| {
+                    u64::try_from(level * u128::from(config.weight(namespace_id)))
+                        .unwrap_or(u64::MAX)
+                });
+                let share_bytes = fair.min(config.quota(namespace_id).unwrap_or(u64::MAX));
+                (
+                    namespace_id.clone(),
+                    NamespaceShare {
+                        usage_bytes,
+                        share_bytes,
+                    },
+                )
+            })
+            .collect();
+
+        let mut by_usage: Vec<(&String, u64)> = usage
+            .iter()
+            .map(|(namespace_id, &bytes)| (namespace_id, bytes))
+            .collect();
+        by_usage.sort_by(|left, right| right.1.cmp(&left.1));
+        let labeled = config
+            .configured_namespaces()
+            .chain(
+                by_usage
+                    .into_iter()
+                    .take(NAMESPACE_METRICS_MAX_LABELS)
+                    .map(|(namespace_id, _)| namespace_id),
+            )
+            .cloned()
+            .collect();
+
+        Self { shares, labeled }
+    }
+
+    pub fn get(&self, namespace_id: &str) -> Option<NamespaceShare> {
+        self.shares.get(namespace_id).copied()
+    }
+
+    /// Whether the namespace held more than its share at the last scan. A
+    /// namespace without data at the last scan is never over.
+    pub fn over_share(&self, namespace_id: &str) -> bool {
+        self.get(namespace_id)
+            .is_some_and(|share| share.over_share())
+    }
+
+    pub fn metric_label<'a>(&self, namespace_id: &'a str) -> &'a str {
+        if self.labeled.contains(namespace_id) {
+            namespace_id
+        } else {
+            OTHER_NAMESPACES_LABEL
+        }
+    }
+
+    /// The labeled namespaces' shares, plus the rest summed under
+    /// [`OTHER_NAMESPACES_LABEL`] (whose share is the sum of theirs).
+    pub fn labeled_shares(&self) -> BTreeMap<&str, NamespaceShare> {
+        let mut labeled = BTreeMap::<&str, NamespaceShare>::new();
+        for (namespace_id, share) in &self.shares {
+            let entry = labeled
+                .entry(self.metric_label(namespace_id))
+                .or_insert(NamespaceShare {
+                    usage_bytes: 0,
+                    share_bytes: 0,
+                });
+            entry.usage_bytes = entry.usage_bytes.saturating_add(share.usage_bytes);
+            entry.share_bytes = entry.share_bytes.saturating_add(share.share_bytes);
+        }
+        labeled
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn usage(entries: &[(&str, u64)]) -> BTreeMap<String, u64> {
+        entries
+            .iter()
+            .map(|&(namespace_id, bytes)| (namespace_id.to_owned(), bytes))
+            .collect()
+    }
+
+    #[test]
+    fn a_noisy_namespace_is_over_share_and_small_ones_keep_what_they_use() {
+        let shares = NamespaceShares::compute(
+            usage(&[("noisy", 900), ("small", 100), ("medium", 300)]),
+            1_000,
+            &NamespaceShareConfig::default(),
+        );
+
+        assert!(shares.over_share("noisy"));
+        assert!(!shares.over_share("small"));
+        assert!(!shares.over_share("medium"));
+        assert_eq!(shares.get("noisy").unwrap().share_bytes, 600);
+    }
+
+    #[test]
+    fn only_quotas_bite_while_the_ring_has_room() {
+        let config = NamespaceShareConfig::parse(
+            "KURA_NAMESPACE_WEIGHTS",
+            None,
+            "KURA_NAMESPACE_QUOTA_BYTES",
+            Some("capped=100"),
+        )
+        .expect("quotas should parse");
+
+        let shares =
+            NamespaceShares::compute(usage(&[("capped", 150), ("free", 500)]), 10_000, &config);
+
+        assert!(shares.over_share("capped"));
+        assert!(!shares.over_share("free"));
+    }
+
+    #[test]
+    fn weights_skew_the_split() {
+        let config = NamespaceShareConfig::parse(
+            "KURA_NAMESPACE_WEIGHTS",
+            Some("heavy=3, *=1"),
+            "KURA_NAMESPACE_QUOTA_BYTES",
+            None,
+        )
+        .expect("weights should parse");
+
+        let shares =
+            NamespaceShares::compute(usage(&[("heavy", 1_000), ("light", 1_000)]), 800, &config);
+
+        assert_eq!(shares.get("heavy").unwrap().share_bytes, 600);
+        assert_eq!(shares.get("light").unwrap().share_bytes, 200);
+    }
+
+    #[test]
+    fn malformed_assignments_are_rejected() {
+        for (weights, quotas) in [
+            (Some("a"), None),
+            (Some("a=0"), None),
+            (None, Some("a=lots")),
+            (None, Some("=5")),
+        ] {
+            assert!(NamespaceShareConfig::parse("W", weights, "Q", quotas).is_err());
+        }
+    }
+}
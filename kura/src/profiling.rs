@@ -0,0 +1,589 @@
+//! On-demand CPU and heap profiles of a live node, served on the internal
+//! plane.
+//!
+//! Both are built for serving nodes rather than debug builds, so what they may
+//! cost is capped up front: one capture at a time node-wide, a cooldown after
+//! each, a bounded duration, and for the CPU sampler a bounded rate and sample
+//! buffer. A request over any of those is refused, not queued.
+//!
+//! The CPU profile is a SIGPROF sampler: the kernel's profiling timer fires in
+//! proportion to CPU time actually consumed, on whichever thread consumed it,
+//! and the handler records that thread's stack into a buffer allocated before
+//! the timer is armed. The handler walks frame pointers from the interrupted
+//! context, reading each frame with `process_vm_readv` so a bad pointer ends
+//! the walk instead of faulting; a stack through code built without frame
+//! pointers is cut short there. Stacks are symbolized once the capture ends
+//! and served as folded stacks, the input `flamegraph.pl`, inferno and
+//! speedscope take.
+//!
+//! A capture runs as its own task, so a client that disconnects mid-capture
+//! cannot drop the sample buffer while the timer still writes into it.
+//!
+//! The heap profile is jemalloc's own: the allocator is built with profiling
+//! support but boots with sampling off (`prof_active:false`), so a capture
+//! turns sampling on for its window and dumps what was sampled and is still
+//! live. The dump is jemalloc's heap profile format, which `jeprof` turns into
+//! pprof, SVG or collapsed stacks against the same binary.
+
+use std::{
+    sync::{
+        Mutex,
+        atomic::{AtomicBool, Ordering},
+    },
+    time::{Duration, Instant},
+};
+
+/// Default and ceiling for how long one capture runs.
+pub const PROFILE_DEFAULT_DURATION: Duration = Duration::from_secs(10);
+const PROFILE_MAX_DURATION: Duration = Duration::from_secs(30);
+/// How long after a capture ends the next one may start. With the duration
+/// ceiling this holds profiling to at most a third of wall time.
+const PROFILE_COOLDOWN: Duration = Duration::from_secs(60);
+/// Default and ceiling for the CPU sampling rate, per second of consumed CPU.
+/// 99 rather than 100 so sampling does not run in lockstep with periodic work.
+pub const PROFILE_DEFAULT_CPU_HZ: u32 = 99;
+const PROFILE_MAX_CPU_HZ: u32 = 199;
+
+static CAPTURE_IN_FLIGHT: AtomicBool = AtomicBool::new(false);
+static LAST_CAPTURE_ENDED: Mutex<Option<Instant>> = Mutex::new(None);
+
+#[derive(Debug)]
+pub enum ProfileError {
+    /// Another capture is running or one ended too recently.
+    Busy {
+        retry_after: Duration,
+    },
+    /// This build or platform cannot take this kind of profile.
+    Unsupported(String),
+    Failed(String),
+}
+
+pub struct Profile {
+    pub body: Vec<u8>,
+    pub content_type: &'static str,
+    /// Samples recorded, and samples lost to a full buffer.
+    pub samples: u64,
+    pub dropped: u64,
+}
+
+/// Holds the node-wide capture slot; releasing it starts the cooldown.
+struct CaptureSlot;
+
+impl CaptureSlot {
+    fn claim(now: Instant) -> Result<Self, ProfileError> {
+        if let Some(ended) = *LAST_CAPTURE_ENDED
+            .lock()
+            .unwrap_or_else(|error| error.into_inner())
+        {
+            let ready_at = ended + PROFILE_COOLDOWN;
+            if now < ready_at {
+                return Err(ProfileError::Busy {
+                    retry_after: ready_at - now,
+                });
+            }
+        }
+        if CAPTURE_IN_FLIGHT
+            .compare_exchange(false, true, Ordering::AcqRel, Ordering::Acquire)
+            .is_err()
+        {
+            return Err(ProfileError::Busy {
+                retry_after: PROFILE_MAX_DURATION + PROFILE_COOLDOWN,
+            });
+        }
+        Ok(Self)
+    }
+}
+
+impl Drop for CaptureSlot {
+    fn drop(&mut self) {
+        *LAST_CAPTURE_ENDED
+            .lock()
+            .unwrap_or_else(|error| error.into_inner()) = Some(Instant::now());
+        CAPTURE_IN_FLIGHT.store(false, Ordering::Release);
+    }
+}
+
+pub fn clamp_duration(requested: Option<Duration>) -> Duration {
+    requested
+        .unwrap_or(PROFILE_DEFAULT_DURATION)
+        .clamp(Duration::from_secs(1), PROFILE_MAX_DURATION)
+}
+
+pub fn clamp_cpu_hz(requested: Option<u32>) -> u32 {
+    requested
+        .unwrap_or(PROFILE_DEFAULT_CPU_HZ)
+        .clamp(1, PROFILE_MAX_CPU_HZ)
+}
+
+/// Samples on-CPU stacks for `duration` at `hz` per consumed CPU-second.
+pub async fn capture_cpu(duration: Duration, hz: u32) -> Result<Profile, ProfileError> {
+    let slot = CaptureSlot::claim(Instant::now())?;
+    run_detached(async move {
+        let _slot = slot;
+        cpu::capture(duration, hz).await
+    })
+    .await
+}
+
+/// Samples allocations for `duration` and dumps those still live, writing the
+/// dump through `scratch_dir` because that is the only way jemalloc emits it.
+pub async fn capture_heap(
+    duration: Duration,
+    scratch_dir: &std::path::Path,
+) -> Result<Profile, ProfileError> {
+    let slot = CaptureSlot::claim(Instant::now())?;
+    let scratch_dir = scratch_dir.to_path_buf();
+    run_detached(async move {
+        let _slot = slot;
+        heap::capture(duration, &scratch_dir).await
+    })
+    .await
+}
+
+/// Runs a capture to completion even if the request awaiting it goes away.
+async fn run_detached(
+    capture: impl std::future::Future<Output = Result<Profile, ProfileError>> + Send + 'static,
+) -> Result<Profile, ProfileError> {
+    tokio::spawn(capture)
+        .await
+        .map_err(|error| ProfileError::Failed(format!("capture task failed: {error}")))?
+}
+
+#[cfg(target_os = "linux")]
+mod cpu {
+    use std::{
+        collections::HashMap,
+        ffi::c_void,
+        sync::Once,
+        sync::atomic::{AtomicBool, AtomicPtr, AtomicU32, AtomicUsize, Ordering},
+        time::Duration,
+    };
+
+    use super::{Profile, ProfileError};
+
+    const MAX_FRAMES: usize = 48;
+    /// Samples one capture can hold, allocated before the timer is armed
+    /// (about 13 MiB). At the default rate that is 16 fully busy cores for
+    /// twenty seconds; past it, samples are counted as dropped and the
+    /// response says so.
+    const MAX_SAMPLES: usize = 32_768;
+
+    struct Sample {
+        tid: AtomicU32,
+        /// Written last, so a reader that sees a depth sees the frames.
+        depth: AtomicU32,
+        frames: [AtomicUsize; MAX_FRAMES],
+    }
+
+    static ACTIVE: AtomicBool = AtomicBool::new(false);
+    static SAMPLES: AtomicPtr<Sample> = AtomicPtr::new(std::ptr::null_mut());
+    static NEXT_SAMPLE: AtomicUsize = AtomicUsize::new(0);
+    static INSTALL_HANDLER: Once = Once::new();
+    static HANDLER_INSTALLED: AtomicBool = AtomicBool::new(false);
+
+    /// Runs on whichever thread the profiling timer caught. It only touches
+    /// atomics, the preallocated buffer and async-signal-safe syscalls; errno
+    /// is restored because the interrupted code may be about to read it.
+    extern "C" fn on_sigprof(
+        _signal: libc::c_int,
+        _info: *mut libc::siginfo_t,
+        context: *mut c_void,
+    ) {
+        let errno = unsafe { *libc::__errno_location() };
+        if ACTIVE.load(Ordering::Acquire) {
+            let samples = SAMPLES.load(Ordering::Acquire);
+            let index = NEXT_SAMPLE.fetch_add(1, Ordering::Relaxed);
+            if !samples.is_null() && index < MAX_SAMPLES {
+                let sample = unsafe { &*samples.add(index) };
+                let tid = unsafe { libc::syscall(libc::SYS_gettid) } as u32;
+                sample.tid.store(tid, Ordering::Relaxed);
+                let depth = unsafe { walk_frames(context.cast(), &sample.frames) };
+                sample.depth.store(depth as u32, Ordering::Release);
+            }
+        }
+        unsafe { *libc::__errno_location() = errno };
+    }
+
+    /// The interrupted program counter and frame pointer.
+    #[cfg(target_arch = "x86_64")]
+    unsafe fn interrupted_registers(context: *const libc::ucontext_t) -> (usize, usize) {
+        let registers = unsafe { &(*context).uc_mcontext.gregs };
+        (
+            registers[libc::REG_RIP as usize] as usize,
+            registers[libc::REG_RBP as usize] as usize,
+        )
+    }
+
+    #[cfg(target_arch = "aarch64")]
+    unsafe fn interrupted_registers(context: *const libc::ucontext_t) -> (usize, usize) {
+        let machine = unsafe { &(*context).uc_mcontext };
+        (machine.pc as usize, machine.regs[29] as usize)
+    }
+
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    unsafe fn interrupted_registers(_context: *const libc::ucontext_t) -> (usize, usize) {
+        (0, 0)
+    }
+
+    /// Records the interrupted pc and then each saved return address along
+    /// the frame-pointer chain, innermost first. Every frame record (saved
+    /// frame pointer, return address) is read with `process_vm_readv`, which
+    /// reports a bad address as `EFAULT` instead of faulting, and the chain
+    /// must move up the stack, so code without frame pointers only ends the
+    /// walk early.
+    unsafe fn walk_frames(
+        context: *const libc::ucontext_t,
+        frames: &[AtomicUsize; MAX_FRAMES],
+    ) -> usize {
+        let (pc, mut frame_pointer) = unsafe { interrupted_registers(context) };
+        if pc == 0 {
+            return 0;
+        }
+        frames[0].store(pc, Ordering::Relaxed);
+        let mut depth = 1;
+        let pid = unsafe { libc::getpid() };
+        while depth < MAX_FRAMES
+            && frame_pointer != 0
+            && frame_pointer % std::mem::align_of::<usize>() == 0
+        {
+            let mut record = [0_usize; 2];
+            let local = libc::iovec {
+                iov_base: record.as_mut_ptr().cast(),
+                iov_len: std::mem::size_of_val(&record),
+            };
+            let remote = libc::iovec {
+                iov_base: frame_pointer as *mut c_void,
+                iov_len: std::mem::size_of_val(&record),
+            };
+            let read = unsafe { libc::process_vm_readv(pid, &local, 1, &remote, 1, 0) };
+            if read != std::mem::size_of_val(&record) as isize {
+                break;
+            }
+            let [caller_frame_pointer, return_address] = record;
+            if return_address == 0 {
+                break;
+            }
+            frames[depth].store(return_address, Ordering::Relaxed);
+            depth += 1;
+            if caller_frame_pointer <= frame_pointer {
+                break;
+            }
+            frame_pointer = caller_frame_pointer;
+        }
+        depth
+    }
+
+    fn install_handler() -> Result<(), ProfileError> {
+        // Installed once and left in place: SIGPROF's default action ends the
+        // process, so a tick still pending when a capture stops must always
+        // find the (by then inert) handler. A failed install is remembered so
+        // no later capture arms the timer without one.
+        INSTALL_HANDLER.call_once(|| unsafe {
+            let mut action: libc::sigaction = std::mem::zeroed();
+            action.sa_sigaction = on_sigprof as libc::sighandler_t;
+            action.sa_flags = libc::SA_RESTART | libc::SA_SIGINFO;
+            libc::sigemptyset(&mut action.sa_mask);
+            if libc::sigaction(libc::SIGPROF, &action, std::ptr::null_mut()) == 0 {
+                HANDLER_INSTALLED.store(true, Ordering::Release);
+            }
+        });
+        if HANDLER_INSTALLED.load(Ordering::Acquire) {
+            Ok(())
+        } else {
+            Err(ProfileError::Failed(
+                "the SIGPROF handler could not be installed".into(),
+            ))
+        }
+    }
+
+    /// The timer period for `hz`, or a disarmed timer for 0. `tv_usec` must
+    /// stay under a second, which 1 Hz would otherwise reach.
+    pub(super) fn timer_interval(hz: u32) -> libc::timeval {
+        let interval_micros = match hz {
+            0 => 0,
+            hz => 1_000_000 / hz,
+        };
+        libc::timeval {
+            tv_sec: (interval_micros / 1_000_000) as libc::time_t,
+            tv_usec: (interval_micros % 1_000_000) as libc::suseconds_t,
+        }
+    }
+
+    fn set_timer(hz: u32) -> Result<(), ProfileError> {
+        let interval = timer_interval(hz);
+        let timer = libc::itimerval {
+            it_interval: interval,
+            it_value: interval,
+        };
+        if unsafe { libc::setitimer(libc::ITIMER_PROF, &timer, std::ptr::null_mut()) } != 0 {
+            return Err(ProfileError::Failed(format!(
+                "failed to arm the profiling timer: {}",
+                std::io::Error::last_os_error()
+            )));
+        }
+        Ok(())
+    }
+
+    pub async fn capture(duration: Duration, hz: u32) -> Result<Profile, ProfileError> {
+        install_handler()?;
+        let mut samples = (0..MAX_SAMPLES)
+            .map(|_| Sample {
+                tid: AtomicU32::new(0),
+                depth: AtomicU32::new(0),
+                frames: std::array::from_fn(|_| AtomicUsize::new(0)),
+            })
+            .collect::<Vec<_>>();
+        NEXT_SAMPLE.store(0, Ordering::Relaxed);
+        SAMPLES.store(samples.as_mut_ptr(), Ordering::Release);
+        ACTIVE.store(true, Ordering::Release);
+        let sampling = Sampling;
+        let armed = set_timer(hz);
+        if armed.is_ok() {
+            tokio::time::sleep(duration).await;
+        }
+        drop(sampling);
+        // A handler that loaded the buffer just before it was withdrawn may
+        // still be writing into it.
+        tokio::time::sleep(Duration::from_millis(50)).await;
+        armed?;
+
+        let taken = NEXT_SAMPLE.load(Ordering::Relaxed);
+        crate::tasks::spawn_blocking(move || fold(&samples, taken))
+            .await
+            .map_err(|error| ProfileError::Failed(format!("symbolization failed: {error}")))
+    }
+
+    /// Disarms the timer and withdraws the buffer however the capture ends,
+    /// including by panic, before `samples` is freed.
+    struct Sampling;
+
+    impl Drop for Sampling {
+        fn drop(&mut self) {
+            let _ = set_timer(0);
+            ACTIVE.store(false, Ordering::Release);
+            SAMPLES.store(std::ptr::null_mut(), Ordering::Release);
+        }
+    }
+
+    /// Symbolizes the recorded stacks into folded lines, one per distinct
+    /// stack: `thread;outermost;...;innermost count`.
+    fn fold(samples: &[Sample], taken: usize) -> Profile {
+        let mut symbols = HashMap::<usize, Vec<String>>::new();
+        let mut threads = HashMap::<u32, String>::new();
+        let mut stacks = HashMap::<String, u64>::new();
+        let mut recorded = 0_u64;
+
+        for sample in &samples[..taken.min(samples.len())] {
+            let depth = sample.depth.load(Ordering::Acquire) as usize;
+            if depth == 0 {
+                continue;
+            }
+            recorded += 1;
+            let tid = sample.tid.load(Ordering::Relaxed);
+            let thread = threads
+                .entry(tid)
+                .or_insert_with(|| thread_name(tid))
+                .clone();
+            // Innermost first, starting at the interrupted instruction, as the
+            // walker produced them.
+            let frames = sample.frames[..depth]
+                .iter()
+                .map(|ip| {
+                    let ip = ip.load(Ordering::Relaxed);
+                    symbols.entry(ip).or_insert_with(|| resolve(ip)).clone()
+                })
+                .collect::<Vec<_>>();
+
+            let mut line = thread;
+            for names in frames.iter().rev() {
+                for name in names.iter().rev() {
+                    line.push(';');
+                    line.push_str(&name.replace(';', ":"));
+                }
+            }
+            *stacks.entry(line).or_default() += 1;
+        }
+
+        let mut lines = stacks.into_iter().collect::<Vec<_>>();
+        lines.sort_by(|left, right| right.1.cmp(&left.1).then_with(|| left.0.cmp(&right.0)));
+        let mut body = String::new();
+        for (stack, count) in lines {
+            body.push_str(&stack);
+            body.push(' ');
+            body.push_str(&count.to_string());
+            body.push('\n');
+        }
+        Profile {
+            body: body.into_bytes(),
+            content_type: "text/plain; charset=utf-8",
+            samples: recorded,
+            dropped: taken.saturating_sub(samples.len()) as u64,
+        }
+    }
+
+    /// Every name at the address, inlined callees first.
+    fn resolve(ip: usize) -> Vec<String> {
+        let mut names = Vec::new();
+        backtrace::resolve(ip as *mut c_void, |symbol| {
+            if let Some(name) = symbol.name() {
+                names.push(format!("{name:#}"));
+            }
+        });
+        if names.is_empty() {
+            names.push(format!("{ip:#x}"));
+        }
+        names
+    }
+
+    fn thread_name(tid: u32) -> String {
+        std::fs::read_to_string(format!("/proc/self/task/{tid}/comm"))
+            .map(|name| name.trim().replace([';', ' '], "_"))
+            .unwrap_or_else(|_| format!("thread-{tid}"))
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+mod cpu {
+    use std::time::Duration;
+
+    use super::{Profile, ProfileError};
+
+    pub async fn capture(_duration: Duration, _hz: u32) -> Result<Profile, ProfileError> {
+        Err(ProfileError::Unsupported(
+            "CPU profiling is only available on Linux".into(),
+        ))
+    }
+}
+
+#[cfg(target_os = "linux")]
+mod heap {
+    use std::{ffi::CString, path::Path, time::Duration};
+
+    use tikv_jemalloc_ctl::raw;
+
+    use super::{Profile, ProfileError};
+
+    /// Average bytes between sampled allocations, as a power of two: 512 KiB,
+    /// jemalloc's own default, which keeps sampling overhead to a few
+    /// percent of allocation cost while active.
+    const HEAP_LG_SAMPLE: usize = 19;
+
+    fn set_active(active: bool) -> Result<(), ProfileError> {
+        unsafe { raw::write(b"prof.active\0", active) }
+            .map_err(|error| ProfileError::Failed(format!("failed to set prof.active: {error}")))
+    }
+
+    /// Turns allocation sampling back off however the capture ends.
+    struct HeapSampling;
+
+    impl Drop for HeapSampling {
+        fn drop(&mut self) {
+            let _ = set_active(false);
+        }
+    }
+
+    pub async fn capture(duration: Duration, scratch_dir: &Path) -> Result<Profile, ProfileError> {
+        let compiled_in = unsafe { raw::read::<bool>(b"opt.prof\0") }.unwrap_or(false);
+        if !compiled_in {
+            return Err(ProfileError::Unsupported(
+                "jemalloc heap profiling is not enabled in this build".into(),
+            ));
+        }
+        // Starts the window from nothing, at a known rate.
+        unsafe { raw::write(b"prof.reset\0", HEAP_LG_SAMPLE) }.map_err(|error| {
+            ProfileError::Failed(format!("failed to reset heap profile: {error}"))
+        })?;
+        set_active(true)?;
+        let sampling = HeapSampling;
+        tokio::time::sleep(duration).await;
+        std::mem::forget(sampling);
+        set_active(false)?;
+
+        let path = scratch_dir.join(format!(
+            "kura-heap-{}-{}.prof",
+            std::process::id(),
+            uuid::Uuid::now_v7()
+        ));
+        let dump_path = CString::new(path.to_string_lossy().into_owned())
+            .map_err(|_| ProfileError::Failed("scratch path contains a NUL byte".into()))?;
+        let dumped = crate::tasks::spawn_blocking(move || {
+            unsafe { raw::write(b"prof.dump\0", dump_path.as_ptr()) }
+                .map_err(|error| format!("failed to dump heap profile: {error}"))?;
+            let body = std::fs::read(&path)
+                .map_err(|error| format!("failed to read heap profile: {error}"));
+            let _ = std::fs::remove_file(&path);
+            body
+        })
+        .await
+        .map_err(|error| ProfileError::Failed(format!("heap dump task failed: {error}")))?
+        .map_err(ProfileError::Failed)?;
+
+        Ok(Profile {
+            body: dumped,
+            content_type: "application/octet-stream",
+            samples: 0,
+            dropped: 0,
+        })
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+mod heap {
+    use std::{path::Path, time::Duration};
+
+    use super::{Profile, ProfileError};
+
+    pub async fn capture(
+        _duration: Duration,
+        _scratch_dir: &Path,
+    ) -> Result<Profile, ProfileError> {
+        Err(ProfileError::Unsupported(
+            "heap profiling is only available on Linux".into(),
+        ))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn requests_are_clamped_to_the_overhead_caps() {
+        assert_eq!(clamp_duration(None), PROFILE_DEFAULT_DURATION);
+        assert_eq!(
+            clamp_duration(Some(Duration::from_secs(3_600))),
+            PROFILE_MAX_DURATION
+        );
+        assert_eq!(clamp_duration(Some(Duration::ZERO)), Duration::from_secs(1));
+        assert_eq!(clamp_cpu_hz(None), PROFILE_DEFAULT_CPU_HZ);
+        assert_eq!(clamp_cpu_hz(Some(10_000)), PROFILE_MAX_CPU_HZ);
+    }
+
+    #[cfg(target_os = "linux")]
+    #[test]
+    fn every_allowed_rate_is_a_valid_timer_interval() {
+        let slowest = cpu::timer_interval(clamp_cpu_hz(Some(1)));
+        assert_eq!((slowest.tv_sec, slowest.tv_usec), (1, 0));
+        let fastest = cpu::timer_interval(PROFILE_MAX_CPU_HZ);
+        assert_eq!((fastest.tv_sec, fastest.tv_usec), (0, 5_025));
+    }
+
+    // One test owns the process-wide slot, so the in-flight and cooldown
+    // checks cannot race another test's capture.
+    #[test]
+    fn a_capture_holds_the_slot_and_then_the_cooldown() {
+        let now = Instant::now();
+        let slot = CaptureSlot::claim(now).expect("the first capture starts");
+        assert!(matches!(
+            CaptureSlot::claim(now),
+            Err(ProfileError::Busy { .. })
+        ));
+        drop(slot);
+
+        let Err(ProfileError::Busy { retry_after }) = CaptureSlot::claim(Instant::now()) else {
+            panic!("a capture right after another must wait out the cooldown");
+        };
+        assert!(retry_after <= PROFILE_COOLDOWN);
+        assert!(CaptureSlot::claim(Instant::now() + PROFILE_COOLDOWN).is_ok());
+    }
+}
@@ -0,0 +1,273 @@
+//! Readahead of blobs a client is about to download.
+//!
+//! A served `GetActionResult` hit is followed within milliseconds by the
+//! client fetching the outputs it references, and blobs `FindMissingBlobs`
+//! reports present are often fetched next. The store already resolves those
+//! digests to answer, so it asks the kernel to start reading their segment
+//! ranges (`POSIX_FADV_WILLNEED`) as the response goes out: a cold-disk read
+//! then overlaps the client's round trip instead of following it.
+//!
+//! Readahead fills the page cache with bytes nobody may read, so it is
+//! bounded: only small blobs are advised, a node under memory pressure
+//! advises nothing, and advised bytes count against `KURA_READAHEAD_BUDGET_BYTES`
+//! until the blob is read or [`READAHEAD_WINDOW`] passes. The kernel reads
+//! whole pages, so a blob is charged every page its range touches, and at
+//! most [`READAHEAD_MAX_PENDING_BLOBS`] blobs are tracked. The tracker doubles
+//! as the hit-rate measurement: a read of a pending blob is a hit, a pending
+//! blob that ages out unread is expired.
+
+use std::{
+    collections::{HashMap, VecDeque},
+    sync::{
+        Mutex,
+        atomic::{AtomicUsize, Ordering},
+    },
+    time::{Duration, Instant},
+};
+
+/// Largest blob advised. Bigger outputs stream in chunks, and the kernel's
+/// own sequential readahead covers them after the first read.
+pub const READAHEAD_MAX_BLOB_BYTES: u64 = 1024 * 1024;
+/// Most blobs advised for one request, so a `FindMissingBlobs` over a whole
+/// build graph does not turn into thousands of advisories.
+pub const READAHEAD_MAX_BLOBS_PER_REQUEST: usize = 256;
+/// How long an advised blob waits for its read before it counts as expired.
+pub const READAHEAD_WINDOW: Duration = Duration::from_secs(10);
+/// Most blobs awaiting their read at once, which bounds the tracker's memory
+/// however small the blobs are.
+pub const READAHEAD_MAX_PENDING_BLOBS: usize = 16_384;
+/// Granularity of the page cache, which advised ranges are charged in.
+const READAHEAD_PAGE_BYTES: u64 = 4096;
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum ReadaheadTrigger {
+    ActionResult,
+    FindMissing,
+}
+
+impl ReadaheadTrigger {
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Self::ActionResult => "action_result",
+            Self::FindMissing => "find_missing",
+        }
+    }
+}
+
+#[derive(Debug, PartialEq, Eq)]
+pub enum ReadaheadClaim {
+    Claimed,
+    /// Already advised and not yet read.
+    Pending,
+    OverBudget,
+}
+
+/// Advised blobs awaiting their read, bounded by bytes.
+pub struct ReadaheadTracker {
+    budget_bytes: u64,
+    /// Mirrors `state.pending.len()` so reads skip the lock while nothing is
+    /// pending.
+    pending: AtomicUsize,
+    state: Mutex<TrackerState>,
+}
+
+#[derive(Default)]
+struct TrackerState {
+    pending: HashMap<String, PendingReadahead>,
+    order: VecDeque<(String, Instant)>,
+    bytes: u64,
+}
+
+struct PendingReadahead {
+    bytes: u64,
+    trigger: ReadaheadTrigger,
+    issued_at: Instant,
+}
+
+impl ReadaheadTracker {
+    pub fn new(budget_bytes: u64) -> Self {
+        Self {
+            budget_bytes,
+            pending: AtomicUsize::new(0),
+            state: Mutex::new(TrackerState::default()),
+        }
+    }
+
+    pub fn enabled(&self) -> bool {
+        self.budget_bytes > 0
+    }
+
+    /// Claims budget to advise the `bytes` at `offset` of `artifact_id`.
+    /// Returns the claim and the triggers of blobs that expired unread
+    /// meanwhile.
+    pub fn claim(
+        &self,
+        artifact_id: &str,
+        offset: u64,
+        bytes: u64,
+        trigger: ReadaheadTrigger,
+        now: Instant,
+    ) -> (ReadaheadClaim, Vec<ReadaheadTrigger>) {
+        let bytes = page_span(offset, bytes);
+        let mut state = self.state.lock().expect("readahead tracker lock poisoned");
+        let expired = state.expire(now);
+        let claim = if state.pending.contains_key(artifact_id) {
+            ReadaheadClaim::Pending
+        } else if state.bytes.saturating_add(bytes) > self.budget_bytes
+            || state.pending.len() >= READAHEAD_MAX_PENDING_BLOBS
+        {
+            ReadaheadClaim::OverBudget
+        } else {
+            state.compact();
+            state.bytes += bytes;
+            state.pending.insert(
+                artifact_id.to_owned(),
+                PendingReadahead {
+                    bytes,
+                    trigger,
+                    issued_at: now,
+                },
+            );
+            state.order.push_back((artifact_id.to_owned(), now));
+            ReadaheadClaim::Claimed
+        };
+        self.pending.store(state.pending.len(), Ordering::Relaxed);
+        (claim, expired)
+    }
+
+    /// Releases an advisory that did not go out (the file could not be
+    /// opened), without counting it either way.
+    pub fn release(&self, artifact_id: &str) {
+        let mut state = self.state.lock().expect("readahead tracker lock poisoned");
+        state.remove(artifact_id);
+        self.pending.store(state.pending.len(), Ordering::Relaxed);
+    }
+
+    /// Records a read of `artifact_id`: the trigger that advised it if it was
+    /// pending and inside the window.
+    pub fn consume(&self, artifact_id: &str, now: Instant) -> Option<ReadaheadTrigger> {
+        if self.pending.load(Ordering::Relaxed) == 0 {
+            return None;
+        }
+        let mut state = self.state.lock().expect("readahead tracker lock poisoned");
+        let hit = state
+            .remove(artifact_id)
+            .filter(|pending| now.duration_since(pending.issued_at) <= READAHEAD_WINDOW)
+            .map(|pending| pending.trigger);
+        self.pending.store(state.pending.len(), Ordering::Relaxed);
+        hit
+    }
+}
+
+/// Bytes of the pages the range `offset..offset + bytes` touches.
+pub(crate) fn page_span(offset: u64, bytes: u64) -> u64 {
+    let start = offset / READAHEAD_PAGE_BYTES * READAHEAD_PAGE_BYTES;
+    let end = offset.saturating_add(bytes).div_ceil(READAHEAD_PAGE_BYTES) * READAHEAD_PAGE_BYTES;
+    end - start
+}
+
+impl TrackerState {
+    /// Drops `order` entries of blobs already read or re-advised once they
+    /// outnumber the pending blobs twice over, so a blob read and advised
+    /// again within the window cannot grow it past the pending cap.
+    fn compact(&mut self) {
+        if self.order.len() < 2 * READAHEAD_MAX_PENDING_BLOBS {
+            return;
+        }
+        let pending = &self.pending;
+        self.order.retain(|(artifact_id, issued_at)| {
+            pending
+                .get(artifact_id)
+                .is_some_and(|pending| pending.issued_at == *issued_at)
+        });
+    }
+
+    fn remove(&mut self, artifact_id: &str) -> Option<PendingReadahead> {
+        let pending = self.pending.remove(artifact_id)?;
+        self.bytes -= pending.bytes;
+        Some(pending)
+    }
+
+    /// Drops advisories older than the window. `order` may hold stale
+    /// entries for blobs already read (or re-advised); those are skipped.
+    fn expire(&mut self, now: Instant) -> Vec<ReadaheadTrigger> {
+        let mut expired = Vec::new();
+        while let Some((artifact_id, issued_at)) = self.order.front() {
+            if now.duration_since(*issued_at) <= READAHEAD_WINDOW {
+                break;
+            }
+            if self
+                .pending
+                .get(artifact_id)
+                .is_some_and(|pending| pending.issued_at == *issued_at)
+            {
+                let artifact_id = artifact_id.clone();
+                let pending = self.remove(&artifact_id).expect("pending entry exists");
+                expired.push(pending.trigger);
+            }
+            self.order.pop_front();
+        }
+        expired
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn advised_bytes_are_bounded_until_read_or_expired() {
+        let tracker = ReadaheadTracker::new(100 * 1024);
+        let start = Instant::now();
+
+        let (claim, _) = tracker.claim("a", 0, 60 * 1024, ReadaheadTrigger::ActionResult, start);
+        assert_eq!(claim, ReadaheadClaim::Claimed);
+        let (claim, _) = tracker.claim("a", 0, 60 * 1024, ReadaheadTrigger::ActionResult, start);
+        assert_eq!(claim, ReadaheadClaim::Pending);
+        let (claim, _) = tracker.claim("b", 0, 60 * 1024, ReadaheadTrigger::FindMissing, start);
+        assert_eq!(claim, ReadaheadClaim::OverBudget);
+
+        assert_eq!(
+            tracker.consume("a", start + Duration::from_millis(5)),
+            Some(ReadaheadTrigger::ActionResult)
+        );
+        assert_eq!(tracker.consume("a", start), None);
+        let (claim, _) = tracker.claim("b", 0, 60 * 1024, ReadaheadTrigger::FindMissing, start);
+        assert_eq!(claim, ReadaheadClaim::Claimed);
+
+        let later = start + READAHEAD_WINDOW + Duration::from_secs(1);
+        let (claim, expired) =
+            tracker.claim("c", 0, 60 * 1024, ReadaheadTrigger::ActionResult, later);
+        assert_eq!(claim, ReadaheadClaim::Claimed);
+        assert_eq!(expired, vec![ReadaheadTrigger::FindMissing]);
+        assert_eq!(tracker.consume("b", later), None);
+    }
+
+    #[test]
+    fn claims_are_charged_whole_pages_and_capped_in_count() {
+        let tracker = ReadaheadTracker::new(3 * READAHEAD_PAGE_BYTES);
+        let start = Instant::now();
+
+        // Ten bytes straddling a page boundary hold two pages.
+        let (claim, _) = tracker.claim("a", 4090, 10, ReadaheadTrigger::ActionResult, start);
+        assert_eq!(claim, ReadaheadClaim::Claimed);
+        let (claim, _) = tracker.claim("b", 0, 10, ReadaheadTrigger::ActionResult, start);
+        assert_eq!(claim, ReadaheadClaim::Claimed);
+        let (claim, _) = tracker.claim("c", 0, 10, ReadaheadTrigger::ActionResult, start);
+        assert_eq!(claim, ReadaheadClaim::OverBudget);
+
+        let tracker = ReadaheadTracker::new(u64::MAX);
+        for blob in 0..READAHEAD_MAX_PENDING_BLOBS {
+            let (claim, _) = tracker.claim(
+                &format!("blob-{blob}"),
+                0,
+                1,
+                ReadaheadTrigger::FindMissing,
+                start,
+            );
+            assert_eq!(claim, ReadaheadClaim::Claimed);
+        }
+        let (claim, _) = tracker.claim("one-more", 0, 1, ReadaheadTrigger::FindMissing, start);
+        assert_eq!(claim, ReadaheadClaim::OverBudget);
+    }
+}
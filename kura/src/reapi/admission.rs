@@ -1,11 +1,12 @@
 use std::{
+    collections::VecDeque,
     error::Error,
     pin::Pin,
     task::{Context, Poll},
     time::Instant,
 };
 
-use bytes::Bytes;
+use bytes::{Bytes, BytesMut};
 use futures_util::future::BoxFuture;
 use http_body_util::{BodyExt, combinators::UnsyncBoxBody};
 use tonic::{
@@ -13,14 +14,18 @@ use tonic::{
     codegen::{Body as HttpBody, Service, http},
 };
 use tower::Layer;
+use tracing::{Instrument, field};
 
 use super::{protobuf_shape::*, service::REAPI_MAX_DECODING_MESSAGE_SIZE};
 use crate::{
+    fair_admission::{self, AdmissionFlow, TrafficClass},
     file_cache::{
         FOREGROUND_STAGING_WINDOW_BYTES, FileCachePolicy, ForegroundFileCacheReservation,
     },
     memory::{MemoryController, MemoryPressure},
+    stage_timing::{self, RequestStages, StageTimedBody, StageTimings},
     state::SharedState,
+    telemetry::{attach_parent_context, record_trace_context},
 };
 
 type BoxError = Box<dyn Error + Send + Sync + 'static>;
@@ -34,6 +39,9 @@ pub(super) const CAS_BATCH_UPDATE_PATH: &str =
 #[derive(Clone)]
 pub(super) struct GrpcWriteAdmission {
     reservation: std::sync::Arc<std::sync::Mutex<GrpcWriteReservation>>,
+    /// `BatchUpdateBlobs` blob data, split off the message before Tonic
+    /// decodes it (see [`split_batch_update_data`]).
+    batch_data: std::sync::Arc<std::sync::Mutex<Option<Vec<Bytes>>>>,
     metrics: crate::metrics::Metrics,
 }
 
@@ -122,10 +130,20 @@ impl GrpcWriteAdmission {
                 memory,
                 decode_copy_multiplier,
             )?)),
+            batch_data: std::sync::Arc::new(std::sync::Mutex::new(None)),
             metrics,
         })
     }
 
+    /// The blob data of each `BatchUpdateBlobs` request, in request order,
+    /// when the admission body split it off the decoded message.
+    pub(super) fn take_batch_data(&self) -> Option<Vec<Bytes>> {
+        self.batch_data
+            .lock()
+            .expect("gRPC write batch data lock poisoned")
+            .take()
+    }
+
     fn try_grow_decode(
         &self,
         encoded_message_bytes: u64,
@@ -175,6 +193,9 @@ pub(super) struct GrpcWriteAdmissionBody {
     payload_bytes_remaining: usize,
     validation_message_bytes: usize,
     validation_payload: Option<Vec<u8>>,
+    /// The `BatchUpdateBlobs` message without its blob data, forwarded to
+    /// Tonic in place of the frames it was assembled from.
+    forwarded_message: Option<Bytes>,
     messages_seen: usize,
     failed: bool,
 }
@@ -194,6 +215,7 @@ impl GrpcWriteAdmissionBody {
             payload_bytes_remaining: 0,
             validation_message_bytes: 0,
             validation_payload: None,
+            forwarded_message: None,
             messages_seen: 0,
             failed: false,
         }
@@ -236,8 +258,33 @@ impl GrpcWriteAdmissionBody {
             GrpcWriteShapePolicy::BatchUpdate => inspect_batch_update_wire(&payload)?,
             GrpcWriteShapePolicy::ActionUpdate => inspect_action_update_wire(&payload)?,
         };
-        self.admission
-            .try_grow_decode(self.validation_message_bytes as u64, shape.structural_bytes)?;
+        if self.policy != GrpcWriteShapePolicy::BatchUpdate {
+            self.admission
+                .try_grow_decode(self.validation_message_bytes as u64, shape.structural_bytes)?;
+            return Ok(());
+        }
+
+        // Blob data stays in the assembled payload and reaches the handler
+        // as slices of it; Tonic buffers and decodes only the remainder,
+        // which is charged on top of the structure it decodes into.
+        let payload = Bytes::from(payload);
+        let (remainder, data) = split_batch_update_data(&payload)?;
+        self.admission.try_grow_decode(
+            self.validation_message_bytes as u64,
+            shape
+                .structural_bytes
+                .saturating_add(remainder.len() as u64),
+        )?;
+        let mut message = Vec::with_capacity(GRPC_MESSAGE_HEADER_BYTES + remainder.len());
+        message.push(0);
+        message.extend_from_slice(&(remainder.len() as u32).to_be_bytes());
+        message.extend_from_slice(&remainder);
+        *self
+            .admission
+            .batch_data
+            .lock()
+            .map_err(|_| Status::internal("gRPC write batch data lock was poisoned"))? = Some(data);
+        self.forwarded_message = Some(Bytes::from(message));
         Ok(())
     }
 
@@ -301,21 +348,41 @@ impl HttpBody for GrpcWriteAdmissionBody {
         if this.failed {
             return Poll::Ready(None);
         }
-        match Pin::new(&mut this.inner).poll_frame(cx) {
-            Poll::Ready(Some(Ok(frame))) => {
-                if let Some(data) = frame.data_ref()
-                    && let Err(status) = this.inspect_data(data)
-                {
-                    this.failed = true;
-                    return Poll::Ready(Some(Err(status)));
+        // A `BatchUpdateBlobs` message is held back until it is complete and
+        // forwarded as one frame without its blob data.
+        let rewrites = this.policy == GrpcWriteShapePolicy::BatchUpdate;
+        loop {
+            match Pin::new(&mut this.inner).poll_frame(cx) {
+                Poll::Ready(Some(Ok(frame))) => {
+                    if let Some(data) = frame.data_ref()
+                        && let Err(status) = this.inspect_data(data)
+                    {
+                        this.failed = true;
+                        return Poll::Ready(Some(Err(status)));
+                    }
+                    if !rewrites || !frame.is_data() {
+                        return Poll::Ready(Some(Ok(frame)));
+                    }
+                    if let Some(message) = this.forwarded_message.take() {
+                        return Poll::Ready(Some(Ok(http_body::Frame::data(message))));
+                    }
                 }
-                Poll::Ready(Some(Ok(frame)))
+                Poll::Ready(Some(Err(error))) => {
+                    return Poll::Ready(Some(Err(Status::internal(format!(
+                        "failed to read remote-execution request body: {error}"
+                    )))));
+                }
+                Poll::Ready(None) => {
+                    if rewrites && (this.header_bytes > 0 || this.payload_bytes_remaining > 0) {
+                        this.failed = true;
+                        return Poll::Ready(Some(Err(Status::invalid_argument(
+                            "remote-execution write ended inside a message",
+                        ))));
+                    }
+                    return Poll::Ready(None);
+                }
+                Poll::Pending => return Poll::Pending,
             }
-            Poll::Ready(Some(Err(error))) => Poll::Ready(Some(Err(Status::internal(format!(
-                "failed to read remote-execution request body: {error}"
-            ))))),
-            Poll::Ready(None) => Poll::Ready(None),
-            Poll::Pending => Poll::Pending,
         }
     }
 
@@ -328,6 +395,149 @@ impl HttpBody for GrpcWriteAdmissionBody {
     }
 }
 
+/// Blob data a `BatchReadBlobs` handler leaves out of its response message,
+/// in response order, for [`splice_batch_read_response`] to put back.
+#[derive(Clone)]
+pub(super) struct BatchReadData(pub(super) Vec<Bytes>);
+
+/// Puts the blob data the `BatchReadBlobs` handler held back into the encoded
+/// response, so each blob reaches the transport as the buffer it was read
+/// into rather than as a copy in Prost's encode buffer.
+pub(super) async fn splice_batch_read_response(
+    mut response: axum::response::Response,
+) -> axum::response::Response {
+    let Some(BatchReadData(data)) = response.extensions_mut().remove::<BatchReadData>() else {
+        return response;
+    };
+    response.map(|body| axum::body::Body::new(BatchReadResponseBody::new(body, data)))
+}
+
+struct BatchReadResponseBody {
+    inner: axum::body::Body,
+    data: Option<Vec<Bytes>>,
+    message: BytesMut,
+    chunks: VecDeque<Bytes>,
+    failed: bool,
+}
+
+impl BatchReadResponseBody {
+    fn new(inner: axum::body::Body, data: Vec<Bytes>) -> Self {
+        Self {
+            inner,
+            data: Some(data),
+            message: BytesMut::new(),
+            chunks: VecDeque::new(),
+            failed: false,
+        }
+    }
+
+    /// Buffers Tonic's frames until the whole message is in, then queues it
+    /// with the blob data spliced in, behind a gRPC header for its new
+    /// length.
+    fn buffer(&mut self, frame: &Bytes) -> Result<(), Status> {
+        self.message.extend_from_slice(frame);
+        let Some(header) = self.message.get(..GRPC_MESSAGE_HEADER_BYTES) else {
+            return Ok(());
+        };
+        if header[0] != 0 {
+            return Err(Status::internal(
+                "compressed batch read responses are not supported",
+            ));
+        }
+        let message_bytes = GRPC_MESSAGE_HEADER_BYTES
+            + u32::from_be_bytes([header[1], header[2], header[3], header[4]]) as usize;
+        if self.message.len() < message_bytes {
+            return Ok(());
+        }
+        if self.message.len() > message_bytes {
+            return Err(Status::internal(
+                "batch read response carried more than one message",
+            ));
+        }
+        let data = self
+            .data
+            .take()
+            .ok_or_else(|| Status::internal("batch read response data was already spliced"))?;
+        let payload = self
+            .message
+            .split()
+            .freeze()
+            .split_off(GRPC_MESSAGE_HEADER_BYTES);
+        let chunks = splice_batch_read_data(&payload, data)?;
+        let encoded_bytes =
+            u32::try_from(chunks.iter().map(Bytes::len).sum::<usize>()).map_err(|_| {
+                Status::internal("batch read response exceeds the gRPC message size limit")
+            })?;
+        let mut header = Vec::with_capacity(GRPC_MESSAGE_HEADER_BYTES);
+        header.push(0);
+        header.extend_from_slice(&encoded_bytes.to_be_bytes());
+        self.chunks.push_back(Bytes::from(header));
+        self.chunks.extend(chunks);
+        Ok(())
+    }
+}
+
+impl HttpBody for BatchReadResponseBody {
+    type Data = Bytes;
+    type Error = Status;
+
+    fn poll_frame(
+        self: Pin<&mut Self>,
+        cx: &mut Context<'_>,
+    ) -> Poll<Option<Result<http_body::Frame<Self::Data>, Self::Error>>> {
+        let this = self.get_mut();
+        if let Some(chunk) = this.chunks.pop_front() {
+            return Poll::Ready(Some(Ok(http_body::Frame::data(chunk))));
+        }
+        if this.failed {
+            return Poll::Ready(None);
+        }
+        loop {
+            match Pin::new(&mut this.inner).poll_frame(cx) {
+                Poll::Ready(Some(Ok(frame))) => {
+                    // Frames after the message (trailers) pass through.
+                    let data = match frame.into_data() {
+                        Ok(data) if this.data.is_some() => data,
+                        Ok(data) => return Poll::Ready(Some(Ok(http_body::Frame::data(data)))),
+                        Err(frame) => return Poll::Ready(Some(Ok(frame))),
+                    };
+                    if let Err(status) = this.buffer(&data) {
+                        this.failed = true;
+                        return Poll::Ready(Some(Err(status)));
+                    }
+                    if let Some(chunk) = this.chunks.pop_front() {
+                        return Poll::Ready(Some(Ok(http_body::Frame::data(chunk))));
+                    }
+                }
+                Poll::Ready(Some(Err(error))) => {
+                    this.failed = true;
+                    return Poll::Ready(Some(Err(Status::internal(format!(
+                        "failed to encode batch read response: {error}"
+                    )))));
+                }
+                Poll::Ready(None) => {
+                    if !this.message.is_empty() {
+                        this.failed = true;
+                        return Poll::Ready(Some(Err(Status::internal(
+                            "batch read response ended inside a message",
+                        ))));
+                    }
+                    return Poll::Ready(None);
+                }
+                Poll::Pending => return Poll::Pending,
+            }
+        }
+    }
+
+    fn is_end_stream(&self) -> bool {
+        self.chunks.is_empty() && self.inner.is_end_stream()
+    }
+
+    fn size_hint(&self) -> http_body::SizeHint {
+        http_body::SizeHint::default()
+    }
+}
+
 pub(super) async fn reject_overloaded_grpc_writes(
     axum::extract::State(state): axum::extract::State<SharedState>,
     request: axum::extract::Request,
@@ -449,24 +659,63 @@ where
         let route = request.uri().path().to_owned();
         let guard = self.state.start_grpc_request();
         let state = self.state.clone();
-        let future = self.inner.call(request);
+        let server_timing_requested = stage_timing::server_timing_requested(request.headers());
+        let request_span = tracing::info_span!(
+            "grpc.request",
+            otel.name = %route,
+            otel.kind = "server",
+            rpc.system = "grpc",
+            rpc.method = %route,
+            trace_id = field::Empty,
+            span_id = field::Empty,
+            kura.stage.auth_ms = field::Empty,
+            kura.stage.admission_ms = field::Empty,
+            kura.stage.manifest_ms = field::Empty,
+            kura.stage.segment_open_ms = field::Empty,
+            kura.stage.first_read_ms = field::Empty,
+            kura.stage.transfer_ms = field::Empty,
+        );
+        attach_parent_context(&request_span, request.headers());
+        record_trace_context(&request_span);
+        let timings = std::sync::Arc::new(StageTimings::default());
+        let future = {
+            let _entered = request_span.enter();
+            self.inner.call(request)
+        };
+        // The namespace and whether this is a read or a write are filled in
+        // once the request is authorized.
+        let flow = std::sync::Arc::new(AdmissionFlow::new(
+            &self.state.config.tenant_id,
+            None,
+            TrafficClass::Read,
+        ));
+        let serve = stage_timing::scope(
+            timings.clone(),
+            fair_admission::scope(flow, future.instrument(request_span.clone())),
+        );
         Box::pin(async move {
-            let response = future.await?;
+            let mut response = serve.await?;
+            let elapsed = started_at.elapsed();
             // Sample latency once the response is ready, before the body
             // streams, so long ByteStream reads do not inflate the signal.
-            state.runtime.record_public_request_latency(
-                &state.metrics,
-                "grpc",
-                &route,
-                started_at.elapsed(),
-            );
+            state
+                .runtime
+                .record_public_request_latency(&state.metrics, "grpc", &route, elapsed);
+            if server_timing_requested
+                && let Ok(value) = http::HeaderValue::from_str(&timings.server_timing(elapsed))
+            {
+                response.headers_mut().insert("server-timing", value);
+            }
+            let stages = RequestStages::new(timings, state, "grpc", request_span);
             Ok(response.map(|body| {
-                body.map_frame(move |frame| {
-                    let _guard = &guard;
-                    frame
-                })
-                .map_err(|error| -> BoxError { error.into() })
-                .boxed_unsync()
+                let body = body
+                    .map_frame(move |frame| {
+                        let _guard = &guard;
+                        frame
+                    })
+                    .map_err(|error| -> BoxError { error.into() })
+                    .boxed_unsync();
+                StageTimedBody::new(body, stages).boxed_unsync()
             }))
         })
     }
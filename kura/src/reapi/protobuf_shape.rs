@@ -1,7 +1,11 @@
+use bytes::Bytes;
+use prost::encoding::{WireType, encode_key, encode_varint, encoded_len_varint, key_len};
 use tonic::Status;
 
 pub(super) const BYTESTREAM_WRITE_DECODE_COPIES: u64 = 2;
-pub(super) const CAS_BATCH_UPDATE_DECODE_COPIES: u64 = 3;
+// Blob data stays in the assembled wire message (see
+// `split_batch_update_data`); Tonic only buffers and decodes what is left.
+pub(super) const CAS_BATCH_UPDATE_DECODE_COPIES: u64 = 1;
 pub(super) const ACTION_CACHE_UPDATE_DECODE_COPIES: u64 = 4;
 pub(super) const REAPI_BATCH_REQUEST_STRUCTURAL_BYTES: u64 = 512;
 pub(super) const REAPI_ACTION_OUTPUT_STRUCTURAL_BYTES: u64 = 1_024;
@@ -293,6 +297,135 @@ pub(super) fn inspect_batch_update_wire(bytes: &[u8]) -> Result<DecodeShape, Sta
     Ok(shape)
 }
 
+/// Splits a validated `BatchUpdateBlobsRequest` into the message with every
+/// request's `data` removed and those payloads, in request order, as slices of
+/// `message`. Everything else is kept byte for byte, so Prost decodes the
+/// remainder into the same request with empty `data`.
+pub(super) fn split_batch_update_data(message: &Bytes) -> Result<(Vec<u8>, Vec<Bytes>), Status> {
+    let mut cursor = ProtoCursor::new(message);
+    let mut remainder = Vec::new();
+    let mut payloads = Vec::new();
+    loop {
+        let field_start = cursor.offset;
+        let Some(field) = cursor.next()? else {
+            break;
+        };
+        let ProtoField::Bytes {
+            number: 2,
+            value: request_bytes,
+        } = field
+        else {
+            remainder.extend_from_slice(&message[field_start..cursor.offset]);
+            continue;
+        };
+        let mut request = ProtoCursor::new(request_bytes);
+        let mut stripped = Vec::new();
+        let mut data = Bytes::new();
+        loop {
+            let field_start = request.offset;
+            let Some(field) = request.next()? else {
+                break;
+            };
+            match field {
+                // Like Prost, the last occurrence of a scalar field wins.
+                ProtoField::Bytes { number: 2, value } => data = message.slice_ref(value),
+                _ => stripped.extend_from_slice(&request_bytes[field_start..request.offset]),
+            }
+        }
+        encode_key(2, WireType::LengthDelimited, &mut remainder);
+        encode_varint(stripped.len() as u64, &mut remainder);
+        remainder.extend_from_slice(&stripped);
+        payloads.push(data);
+    }
+    Ok((remainder, payloads))
+}
+
+/// Splices blob data into a `BatchReadBlobsResponse` that Prost encoded with
+/// every response's `data` left empty: `data[i]` goes into the i-th
+/// response, where Prost would have put it. The result is the encoded
+/// message as a chain of chunks. Each blob's own `Bytes` sits between
+/// re-encoded framing (the response's key and length, its fields before
+/// `data`, and the `data` key and length) and a slice of `message`
+/// carrying everything after it, so no blob is copied.
+pub(super) fn splice_batch_read_data(
+    message: &Bytes,
+    data: Vec<Bytes>,
+) -> Result<Vec<Bytes>, Status> {
+    let mut cursor = ProtoCursor::new(message);
+    let mut chunks = Vec::with_capacity(data.len() * 3 + 1);
+    let mut data = data.into_iter();
+    // Start of the bytes of `message` that are kept as they are and not yet
+    // in `chunks`.
+    let mut kept_from = 0;
+    loop {
+        let field_start = cursor.offset;
+        let Some(field) = cursor.next()? else {
+            break;
+        };
+        let ProtoField::Bytes {
+            number: 1,
+            value: response,
+        } = field
+        else {
+            continue;
+        };
+        let blob = data.next().ok_or_else(|| {
+            Status::internal("batch read response has more entries than blob data")
+        })?;
+        if blob.is_empty() {
+            continue;
+        }
+        let response_start = cursor.offset - response.len();
+        let mut fields = ProtoCursor::new(response);
+        let mut split = response.len();
+        loop {
+            let start = fields.offset;
+            let number = match fields.next()? {
+                None => break,
+                Some(
+                    ProtoField::Varint { number }
+                    | ProtoField::Fixed { number }
+                    | ProtoField::Bytes { number, .. },
+                ) => number,
+            };
+            if number == 2 {
+                return Err(Status::internal(
+                    "batch read response already carries blob data",
+                ));
+            }
+            if number > 2 {
+                split = start;
+                break;
+            }
+        }
+        let data_header_bytes = key_len(2) + encoded_len_varint(blob.len() as u64);
+        let response_len = (response.len() + data_header_bytes + blob.len()) as u64;
+        let mut framing = Vec::with_capacity(
+            key_len(1) + encoded_len_varint(response_len) + split + data_header_bytes,
+        );
+        encode_key(1, WireType::LengthDelimited, &mut framing);
+        encode_varint(response_len, &mut framing);
+        framing.extend_from_slice(&response[..split]);
+        encode_key(2, WireType::LengthDelimited, &mut framing);
+        encode_varint(blob.len() as u64, &mut framing);
+        if kept_from < field_start {
+            chunks.push(message.slice(kept_from..field_start));
+        }
+        chunks.push(Bytes::from(framing));
+        chunks.push(blob);
+        kept_from = response_start + split;
+    }
+    if data.next().is_some() {
+        return Err(Status::internal(
+            "batch read response has fewer entries than blob data",
+        ));
+    }
+    if kept_from < message.len() {
+        chunks.push(message.slice(kept_from..));
+    }
+    Ok(chunks)
+}
+
 fn inspect_node_properties_wire(bytes: &[u8], shape: &mut DecodeShape) -> Result<(), Status> {
     let mut cursor = ProtoCursor::new(bytes);
     while let Some(field) = cursor.next()? {
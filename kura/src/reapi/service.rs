@@ -24,6 +24,7 @@ use bazel_remote_apis::{
         rpc::Status as RpcStatus,
     },
 };
+use bytes::Bytes;
 use futures_util::{FutureExt, StreamExt};
 use prost::Message;
 use sha2::{Digest as _, Sha256};
@@ -36,15 +37,20 @@ use super::protobuf_shape::*;
 use super::{admission::*, snapshot::*};
 
 use crate::{
+    action_cache_refs::action_result_blob_keys,
     artifact::{manifest::ArtifactManifest, producer::ArtifactProducer},
-    auth::{AccessDecision, RequestContext},
+    auth::{AccessDecision, ConnectionAuth, RequestContext},
     constants::{
         MAX_INLINE_REPLICATION_BODY_BYTES, MAX_MODULE_TOTAL_BYTES,
         encoded_response_stream_chunk_bytes, response_stream_chunk_bytes,
     },
+    fair_admission::{self, TrafficClass},
     file_cache::{FOREGROUND_FILE_CACHE_DROP_INTERVAL_BYTES, FileCachePolicy},
+    inflight_uploads::{FollowOutcome, FollowRange, OpenUpload, StagingUpload},
     io::is_fd_pool_exhausted_error,
+    readahead::{READAHEAD_MAX_BLOBS_PER_REQUEST, ReadaheadTrigger},
     replication::replication_targets,
+    stage_timing::{self, Stage},
     state::SharedState,
     store::{RefreshTrigger, StagedArtifactPath, is_outbox_full_error},
     utils::{
@@ -105,7 +111,9 @@ fn reapi_servers(service: ReapiService) -> ReapiServers {
 // those paths never collide with the HTTP cache routes, so the co-hosted router
 // dispatches gRPC and HTTP unambiguously by path. It carries the
 // [`GrpcRequestAccountingLayer`] so gRPC traffic still shows up in inflight and
-// latency metrics and counts toward the shutdown drain. Its `unimplemented`
+// latency metrics and counts toward the shutdown drain, and splices
+// `BatchReadBlobs` data into the encoded response (see
+// [`splice_batch_read_response`]). Its `unimplemented`
 // fallback (gRPC status 12) becomes the co-hosted router's fallback for
 // otherwise-unmatched paths.
 pub fn routes(state: SharedState) -> axum::Router {
@@ -120,6 +128,7 @@ pub fn routes(state: SharedState) -> axum::Router {
         .add_service(cas)
         .add_service(byte_stream)
         .into_axum_router()
+        .layer(axum::middleware::map_response(splice_batch_read_response))
         .layer(axum::middleware::from_fn_with_state(
             state.clone(),
             reject_overloaded_grpc_writes,
@@ -168,7 +177,13 @@ impl ReapiService {
         request: &Request<T>,
         spec: GrpcRequestSpec<'_>,
     ) -> Result<(), Status> {
-        self.authorize_metadata(request.metadata(), spec).await
+        let connection = request.extensions().get::<std::sync::Arc<ConnectionAuth>>();
+        self.authorize_metadata(
+            request.metadata(),
+            connection.map(std::sync::Arc::as_ref),
+            spec,
+        )
+        .await
     }
 
     // Authorize from already-extracted metadata. ByteStream Write consumes the
@@ -178,8 +193,17 @@ impl ReapiService {
     async fn authorize_metadata(
         &self,
         metadata: &tonic::metadata::MetadataMap,
+        connection: Option<&ConnectionAuth>,
         spec: GrpcRequestSpec<'_>,
     ) -> Result<(), Status> {
+        fair_admission::note_request(
+            spec.namespace_id.unwrap_or_default(),
+            if spec.operation == "artifact.write" {
+                TrafficClass::Write
+            } else {
+                TrafficClass::Read
+            },
+        );
         if self.state.runtime.is_draining() {
             return Err(Status::unavailable("server is draining"));
         }
@@ -187,7 +211,12 @@ impl ReapiService {
             return Ok(());
         };
         let context = grpc_request_context(&self.state.config.tenant_id, &spec, metadata, None);
-        match auth.evaluate_access(&context).await {
+        let decision = {
+            let _auth = stage_timing::enter(Stage::Auth);
+            auth.evaluate_access_on_connection(&context, connection)
+                .await
+        };
+        match decision {
             AccessDecision::Allow => Ok(()),
             AccessDecision::Deny(deny) => {
                 Err(grpc_status_from_http_status(deny.status, &deny.message))
@@ -195,6 +224,21 @@ impl ReapiService {
         }
     }
 
+    /// Reads ahead blobs the client was just told it can fetch, off the
+    /// request path (see [`crate::readahead`]).
+    fn spawn_readahead(&self, namespace_id: &str, keys: Vec<String>, trigger: ReadaheadTrigger) {
+        if keys.is_empty() {
+            return;
+        }
+        let store = self.state.store.clone();
+        let namespace_id = namespace_id.to_owned();
+        crate::tasks::spawn(&self.state.metrics, "reapi_readahead", async move {
+            store
+                .read_ahead(ArtifactProducer::Reapi, &namespace_id, &keys, trigger)
+                .await;
+        });
+    }
+
     fn retain_unary_response_materialization<T: Message>(
         &self,
         response: &mut Response<T>,
@@ -277,6 +321,10 @@ impl ReapiService {
         // project-scoped tokens authorize against the real project (not the
         // account) — matching the namespace the blob is ultimately stored under.
         let metadata = request.metadata().clone();
+        let connection_auth = request
+            .extensions()
+            .get::<std::sync::Arc<ConnectionAuth>>()
+            .cloned();
         let memory_admission = request
             .extensions()
             .get::<GrpcWriteAdmission>()
@@ -296,6 +344,7 @@ impl ReapiService {
         let mut advised_through = 0_u64;
         let mut hasher = Sha256::new();
         let mut finished = false;
+        let mut inflight = None::<StagingUpload>;
 
         // Stall deadline keyed on byte *progress*, not message arrival: it only
         // advances when a chunk delivers data. An upload that keeps making
@@ -341,7 +390,43 @@ impl ReapiService {
                     artifact_key: None,
                     artifact_hash: None,
                 };
-                self.authorize_metadata(&metadata, write_spec).await?;
+                self.authorize_metadata(&metadata, connection_auth.as_deref(), write_spec)
+                    .await?;
+                inflight = self.state.inflight_uploads.begin(
+                    ArtifactProducer::Reapi,
+                    &parsed_resource.namespace_id,
+                    &parsed_resource.key,
+                );
+                if inflight.is_none() {
+                    // Another client is writing the same digest. Wait for it
+                    // rather than staging a second copy; once it commits,
+                    // report the blob complete as the spec allows for a blob
+                    // that already exists, without reading the rest.
+                    if let Some(first) = self.state.inflight_uploads.follow(
+                        ArtifactProducer::Reapi,
+                        &parsed_resource.namespace_id,
+                        &parsed_resource.key,
+                    ) && first.committed().await
+                    {
+                        self.state
+                            .metrics
+                            .record_upload_single_flight(ArtifactProducer::Reapi, "deduplicated");
+                        return Ok(Response::new(bytestream::WriteResponse {
+                            committed_size: parsed_resource.size_bytes as i64,
+                        }));
+                    }
+                    self.state
+                        .metrics
+                        .record_upload_single_flight(ArtifactProducer::Reapi, "restaged");
+                    inflight = self.state.inflight_uploads.begin(
+                        ArtifactProducer::Reapi,
+                        &parsed_resource.namespace_id,
+                        &parsed_resource.key,
+                    );
+                }
+                if let Some(inflight) = &inflight {
+                    inflight.opened(temp_path);
+                }
                 file_cache_policy =
                     memory_admission.try_configure_staging(parsed_resource.size_bytes)?;
                 let disk_reservation = self
@@ -379,6 +464,11 @@ impl ReapiService {
                         .map_err(|error| {
                             Status::internal(format!("failed to write temp blob: {error}"))
                         })?;
+                    // The file writes in the background; once a write is
+                    // accepted, the one before it has reached the file.
+                    if let Some(inflight) = &inflight {
+                        inflight.staging(written);
+                    }
                     hasher.update(data);
                     written = written.saturating_add(data.len() as u64);
                     if file_cache_policy.should_drop(
@@ -439,6 +529,9 @@ impl ReapiService {
             .await
             .map_err(|error| Status::internal(format!("failed to flush temp blob: {error}")))?;
         drop(temp_file);
+        if let Some(inflight) = inflight.as_mut() {
+            inflight.staged(written);
+        }
 
         let targets = replication_targets(&self.state).await;
         // The persist reports `already_present` from under the store's
@@ -472,6 +565,12 @@ impl ReapiService {
                     Status::internal(format!("failed to persist CAS blob: {error}"))
                 }
             })?;
+        // Reads from here on find the committed blob; followers already
+        // streaming hold their own descriptor on the staging file.
+        if let Some(inflight) = inflight.as_mut() {
+            inflight.committed();
+        }
+        drop(inflight);
         self.state.notify.notify_one();
         self.state.metrics.record_artifact_write(
             ArtifactProducer::Reapi,
@@ -491,6 +590,97 @@ impl ReapiService {
         Ok(response)
     }
 
+    /// ByteStream Read of a blob this node is still receiving: streams the
+    /// upload as it stages and, for a whole-blob read, checks the streamed
+    /// bytes against the requested digest before ending the stream cleanly.
+    async fn read_inflight_upload(
+        &self,
+        request: &Request<bytestream::ReadRequest>,
+        resource: &BlobResource,
+        upload: OpenUpload,
+    ) -> Result<Response<<Self as ByteStream>::ReadStream>, Status> {
+        let read_offset = u64::try_from(request.get_ref().read_offset)
+            .map_err(|_| Status::invalid_argument("read_offset must be non-negative"))?;
+        if read_offset > resource.size_bytes {
+            return Err(Status::out_of_range("read_offset exceeds blob size"));
+        }
+        let read_limit = u64::try_from(request.get_ref().read_limit)
+            .map_err(|_| Status::invalid_argument("read_limit must be non-negative"))?;
+        let read_limit = (read_limit != 0).then_some(read_limit);
+        let bytes_to_read = read_limit
+            .unwrap_or(u64::MAX)
+            .min(resource.size_bytes - read_offset);
+        let requested_bytes = encoded_response_stream_chunk_bytes(bytes_to_read).saturating_mul(4);
+        let permit = self
+            .state
+            .memory
+            .acquire_response_stream_memory(
+                requested_bytes,
+                "bytestream",
+                crate::memory::ResponseStreamAdmissionPatience::Blocking,
+            )
+            .await
+            .map_err(|_| {
+                Status::resource_exhausted(
+                    "server is limiting concurrent ByteStream reads; retry shortly",
+                )
+            })?;
+        self.state
+            .metrics
+            .record_artifact_serving_path("inflight_upload");
+        // The read and the download are booked once the follow completes, as
+        // on the HTTP path: an abandoned upload serves the client nothing.
+        let done_state = self.state.clone();
+        let usage_tenant = usage_tenant_id(request.metadata(), &self.state.config.tenant_id);
+        let namespace_id = resource.namespace_id.clone();
+        let stream = upload
+            .into_stream(
+                FollowRange {
+                    offset: read_offset,
+                    limit: read_limit,
+                    sha256: Some(resource.hash.clone()),
+                },
+                response_stream_chunk_bytes(bytes_to_read),
+                move |outcome, bytes| {
+                    let state = done_state;
+                    state
+                        .metrics
+                        .record_inflight_upload_follow(ArtifactProducer::Reapi, outcome.as_str());
+                    if outcome != FollowOutcome::Completed {
+                        state
+                            .metrics
+                            .record_artifact_read(ArtifactProducer::Reapi, "error", 0);
+                        return;
+                    }
+                    state
+                        .metrics
+                        .record_artifact_read(ArtifactProducer::Reapi, "ok", bytes);
+                    if let Some(usage) = state.usage.as_ref() {
+                        usage.record_public_grpc_download(
+                            &usage_tenant,
+                            &namespace_id,
+                            REAPI_USAGE_ARTIFACT_KIND,
+                            bytes,
+                        );
+                    }
+                },
+            )
+            .map(|result| match result {
+                Ok(bytes) => Ok(bytestream::ReadResponse {
+                    data: bytes.to_vec(),
+                }),
+                Err(error) => Err(Status::unavailable(format!(
+                    "failed to stream in-flight blob: {error}"
+                ))),
+            });
+
+        let mut response = Response::new(Box::pin(stream) as <Self as ByteStream>::ReadStream);
+        response
+            .extensions_mut()
+            .insert(permit.into_transport_guard());
+        Ok(response)
+    }
+
     /// Serves the namespace's action-cache snapshot from the cached index:
     /// reconcile against the manifest keyspace (one index scan, no stored
     /// ActionResult reads), load only entries that are new or changed,
@@ -1181,6 +1371,12 @@ impl ActionCache for ReapiService {
             &presence.present,
             RefreshTrigger::ActionCache,
         );
+        // The client fetches these outputs next; start reading them now.
+        self.spawn_readahead(
+            namespace_id,
+            action_result_blob_keys(&action_result),
+            ReadaheadTrigger::ActionResult,
+        );
         // Everything this RPC returns is egress: the stored action result plus
         // any stdout/stderr/output-file blobs inlined below, so all of it is
         // accumulated for the usage rollup.
@@ -1437,6 +1633,7 @@ impl ContentAddressableStorage for ReapiService {
         // segment has aged there is nothing to promote, so the plain existence
         // check keeps its existence-cache short-circuit.
         let aging = self.state.store.segment_ring_is_aging();
+        let mut present = Vec::new();
         for digest in &request.get_ref().blob_digests {
             // The empty blob is present by REAPI convention even when it was
             // never uploaded; reporting it missing would push clients to upload
@@ -1464,8 +1661,11 @@ impl ContentAddressableStorage for ReapiService {
             .map_err(|error| Status::internal(format!("failed to inspect CAS blob: {error}")))?;
             if !exists {
                 missing.push(digest.clone());
+            } else if present.len() < READAHEAD_MAX_BLOBS_PER_REQUEST {
+                present.push(key);
             }
         }
+        self.spawn_readahead(namespace_id, present, ReadaheadTrigger::FindMissing);
 
         let mut response = Response::new(reapi::FindMissingBlobsResponse {
             missing_blob_digests: missing,
@@ -1478,11 +1678,14 @@ impl ContentAddressableStorage for ReapiService {
         &self,
         request: Request<reapi::BatchUpdateBlobsRequest>,
     ) -> Result<Response<reapi::BatchUpdateBlobsResponse>, Status> {
-        let _memory_admission = request
+        let memory_admission = request
             .extensions()
             .get::<GrpcWriteAdmission>()
             .cloned()
             .ok_or_else(|| Status::internal("write decode admission was not propagated"))?;
+        // Blob data arrives as slices of the received message rather than
+        // in the decoded requests (see `split_batch_update_data`).
+        let batch_data = memory_admission.take_batch_data();
         require_sha256(request.get_ref().digest_function)?;
         let namespace_id = namespace_from_instance(&request.get_ref().instance_name);
         let auth = GrpcRequestSpec {
@@ -1503,7 +1706,11 @@ impl ContentAddressableStorage for ReapiService {
         let mut stored_bytes = 0_u64;
         let mut stored_any = false;
 
-        for item in &request.get_ref().requests {
+        for (index, item) in request.get_ref().requests.iter().enumerate() {
+            let data = batch_data
+                .as_ref()
+                .and_then(|batch_data| batch_data.get(index))
+                .map_or(item.data.as_slice(), |data| &data[..]);
             let digest = match &item.digest {
                 Some(digest) => digest.clone(),
                 None => {
@@ -1521,10 +1728,10 @@ impl ContentAddressableStorage for ReapiService {
                 });
                 continue;
             }
-            match persist_cas_blob(&self.state, namespace_id, &digest, &item.data).await {
+            match persist_cas_blob(&self.state, namespace_id, &digest, data).await {
                 Ok(newly_stored) => {
                     if newly_stored {
-                        stored_bytes = stored_bytes.saturating_add(item.data.len() as u64);
+                        stored_bytes = stored_bytes.saturating_add(data.len() as u64);
                         stored_any = true;
                     }
                     responses.push(reapi::batch_update_blobs_response::Response {
@@ -1573,56 +1780,50 @@ impl ContentAddressableStorage for ReapiService {
         // unchanged and response order matches request order.
         let budget = std::sync::Mutex::new(MaterializationBudget::new(&self.state));
         let digests: Vec<reapi::Digest> = request.get_ref().digests.clone();
-        let responses: Vec<reapi::batch_read_blobs_response::Response> =
+        let (responses, data): (Vec<reapi::batch_read_blobs_response::Response>, Vec<Bytes>) =
             futures_util::stream::iter(digests.into_iter().map(|digest| {
                 let budget = &budget;
                 async move {
-                    match batch_read_one(&self.state, namespace_id, &digest, budget).await {
-                        Ok(Some(data)) => reapi::batch_read_blobs_response::Response {
-                            digest: Some(digest.clone()),
-                            data,
-                            compressor: 0,
-                            status: Some(rpc_status(0, "")),
-                        },
-                        Ok(None) => reapi::batch_read_blobs_response::Response {
-                            digest: Some(digest.clone()),
-                            data: Vec::new(),
-                            compressor: 0,
-                            status: Some(rpc_status(5, "blob not found")),
-                        },
-                        Err(status) => reapi::batch_read_blobs_response::Response {
-                            digest: Some(digest.clone()),
-                            data: Vec::new(),
-                            compressor: 0,
-                            status: Some(rpc_status_from_grpc_status(&status)),
-                        },
-                    }
+                    let (status, data) =
+                        match batch_read_one(&self.state, namespace_id, &digest, budget).await {
+                            Ok(Some(data)) => (rpc_status(0, ""), data),
+                            Ok(None) => (rpc_status(5, "blob not found"), Bytes::new()),
+                            Err(status) => (rpc_status_from_grpc_status(&status), Bytes::new()),
+                        };
+                    let response = reapi::batch_read_blobs_response::Response {
+                        digest: Some(digest.clone()),
+                        data: Vec::new(),
+                        compressor: 0,
+                        status: Some(status),
+                    };
+                    (response, data)
                 }
             }))
             .buffered(16)
-            .collect()
+            .unzip()
             .await;
         // Sum the bytes served so the whole batch books a single download usage
         // request, matching how ByteStream/HTTP count one request per call. A
         // successful read carries gRPC status code 0.
-        let served_bytes: u64 = responses
+        let served: Vec<u64> = responses
             .iter()
-            .filter(|response| {
+            .zip(&data)
+            .filter(|(response, _)| {
                 response
                     .status
                     .as_ref()
                     .is_some_and(|status| status.code == 0)
             })
-            .map(|response| response.data.len() as u64)
-            .sum();
-        let served_any = responses.iter().any(|response| {
-            response
-                .status
-                .as_ref()
-                .is_some_and(|status| status.code == 0)
-        });
-
+            .map(|(_, data)| data.len() as u64)
+            .collect();
+        let served_bytes: u64 = served.iter().sum();
+        let served_any = !served.is_empty();
+
+        // The message is encoded without blob data, which stays in the pooled
+        // buffers it was read into until `splice_batch_read_response` chains
+        // it into the encoded response; the budget only holds one copy.
         let mut response = Response::new(reapi::BatchReadBlobsResponse { responses });
+        response.extensions_mut().insert(BatchReadData(data));
         let response_memory = budget
             .into_inner()
             .expect("batch-read materialization budget lock poisoned")
@@ -1695,6 +1896,14 @@ impl ByteStream for ReapiService {
         {
             Ok(Some(manifest)) => manifest,
             Ok(None) => {
+                if let Some(follower) = self.state.inflight_uploads.follow(
+                    ArtifactProducer::Reapi,
+                    &resource.namespace_id,
+                    &resource.key,
+                ) && let Ok(upload) = follower.open(&self.state.io).await
+                {
+                    return self.read_inflight_upload(&request, &resource, upload).await;
+                }
                 self.state
                     .metrics
                     .record_artifact_read(ArtifactProducer::Reapi, "not_found", 0);
@@ -1902,7 +2111,7 @@ where
                 .record_artifact_read(ArtifactProducer::Reapi, "error", 0);
             Status::internal(format!("failed to load {label}: {error}"))
         })?;
-    let decoded = T::decode(bytes.as_slice()).map_err(|error| {
+    let decoded = T::decode(&bytes[..]).map_err(|error| {
         state
             .metrics
             .record_artifact_read(ArtifactProducer::Reapi, "error", 0);
@@ -1913,13 +2122,14 @@ where
 
 /// One blob of a batch read: identical semantics to maybe_read_cas_bytes,
 /// with the shared per-request budget claimed under a short synchronous lock
-/// so blobs can be read concurrently.
+/// so blobs can be read concurrently. The blob is read into a pooled buffer
+/// that the response splices in as is.
 async fn batch_read_one(
     state: &SharedState,
     namespace_id: &str,
     digest: &reapi::Digest,
     budget: &std::sync::Mutex<MaterializationBudget<'_>>,
-) -> Result<Option<Vec<u8>>, Status> {
+) -> Result<Option<Bytes>, Status> {
     let key = blob_key(&digest_key(digest)?);
     let Some(manifest) = state
         .store
@@ -1940,8 +2150,8 @@ async fn batch_read_one(
     budget
         .lock()
         .expect("budget lock")
-        .claim(manifest.size, "CAS response materialization")?;
-    let Some(bytes) = read_serving_bytes(state, &manifest)
+        .claim_spliced(manifest.size, "CAS response materialization")?;
+    let Some(buffer) = read_serving_buffer(state, &manifest)
         .await
         .inspect_err(|_| {
             state
@@ -1957,16 +2167,52 @@ async fn batch_read_one(
     };
     state
         .metrics
-        .record_artifact_read(ArtifactProducer::Reapi, "ok", bytes.len() as u64);
-    Ok(Some(bytes))
+        .record_artifact_read(ArtifactProducer::Reapi, "ok", buffer.len() as u64);
+    Ok(Some(buffer.into_bytes()))
 }
 
+/// Reads a CAS blob the response carries inline. The exact-size read moves
+/// straight into the message, where a pooled buffer would need a copy.
 async fn maybe_read_cas_bytes(
     state: &SharedState,
     namespace_id: &str,
     digest: &reapi::Digest,
     materialization_budget: Option<&mut MaterializationBudget<'_>>,
 ) -> Result<Option<Vec<u8>>, Status> {
+    maybe_read_cas(
+        state,
+        namespace_id,
+        digest,
+        materialization_budget,
+        read_serving_bytes,
+    )
+    .await
+}
+
+/// Reads a CAS blob that is decoded and dropped, into a pooled buffer.
+async fn maybe_read_cas_buffer(
+    state: &SharedState,
+    namespace_id: &str,
+    digest: &reapi::Digest,
+    materialization_budget: Option<&mut MaterializationBudget<'_>>,
+) -> Result<Option<crate::memory::PooledBuffer>, Status> {
+    maybe_read_cas(
+        state,
+        namespace_id,
+        digest,
+        materialization_budget,
+        read_serving_buffer,
+    )
+    .await
+}
+
+async fn maybe_read_cas<B: AsRef<[u8]>>(
+    state: &SharedState,
+    namespace_id: &str,
+    digest: &reapi::Digest,
+    materialization_budget: Option<&mut MaterializationBudget<'_>>,
+    read: impl AsyncFnOnce(&SharedState, &ArtifactManifest) -> Result<Option<B>, String>,
+) -> Result<Option<B>, Status> {
     let key = blob_key(&digest_key(digest)?);
     let Some(manifest) = state
         .store
@@ -1987,7 +2233,7 @@ async fn maybe_read_cas_bytes(
     if let Some(budget) = materialization_budget {
         budget.claim(manifest.size, "CAS response materialization")?;
     }
-    let Some(bytes) = read_serving_bytes(state, &manifest)
+    let Some(bytes) = read(state, &manifest)
         .await
         .inspect_err(|_| {
             state
@@ -2003,7 +2249,7 @@ async fn maybe_read_cas_bytes(
     };
     state
         .metrics
-        .record_artifact_read(ArtifactProducer::Reapi, "ok", bytes.len() as u64);
+        .record_artifact_read(ArtifactProducer::Reapi, "ok", bytes.as_ref().len() as u64);
     Ok(Some(bytes))
 }
 
@@ -2063,7 +2309,7 @@ async fn first_evicted_output(
         // read is the one non-manifest cost, paid only by directory-output
         // entries and only after their tree passed the cheap check above, and it
         // claims the shared budget so a large tree can't materialize unbounded.
-        let Ok(Some(bytes)) = maybe_read_cas_bytes(
+        let Ok(Some(bytes)) = maybe_read_cas_buffer(
             state,
             namespace_id,
             tree_digest,
@@ -2073,7 +2319,7 @@ async fn first_evicted_output(
         else {
             continue;
         };
-        let Ok(tree) = reapi::Tree::decode(bytes.as_slice()) else {
+        let Ok(tree) = reapi::Tree::decode(&bytes[..]) else {
             continue;
         };
         for digest in tree
@@ -2182,11 +2428,12 @@ async fn persist_cas_blob(
     Ok(!persisted.already_present)
 }
 
+/// Reads bytes that are decoded and dropped, into a pooled buffer.
 pub(super) async fn read_manifest_bytes(
     state: &SharedState,
     manifest: &ArtifactManifest,
-) -> Result<Vec<u8>, String> {
-    state.store.read_artifact_bytes(manifest).await
+) -> Result<crate::memory::PooledBuffer, String> {
+    state.store.read_artifact_buffer(manifest).await
 }
 
 /// Reads a CAS blob served to a client, tolerating a concurrent background
@@ -2204,6 +2451,18 @@ async fn read_serving_bytes(
         .await
 }
 
+/// [`read_serving_bytes`] into a pooled buffer, for blobs that are decoded or
+/// inlined rather than served whole.
+async fn read_serving_buffer(
+    state: &SharedState,
+    manifest: &ArtifactManifest,
+) -> Result<Option<crate::memory::PooledBuffer>, String> {
+    state
+        .store
+        .read_artifact_buffer_tolerating_promotion(manifest)
+        .await
+}
+
 struct MaterializationBudget<'a> {
     state: &'a SharedState,
     remaining_bytes: usize,
@@ -2284,6 +2543,16 @@ impl<'a> MaterializationBudget<'a> {
     }
 
     fn claim(&mut self, size_bytes: u64, label: &str) -> Result<(), Status> {
+        self.claim_copies(size_bytes, 2, label)
+    }
+
+    /// Claims a blob that reaches the transport as the buffer it was read
+    /// into, spliced into the encoded response, so only one copy is held.
+    fn claim_spliced(&mut self, size_bytes: u64, label: &str) -> Result<(), Status> {
+        self.claim_copies(size_bytes, 1, label)
+    }
+
+    fn claim_copies(&mut self, size_bytes: u64, copies: usize, label: &str) -> Result<(), Status> {
         let requested_bytes = usize::try_from(size_bytes).map_err(|_| {
             self.reject(format!(
                 "{label} exceeds the maximum addressable REAPI materialization size"
@@ -2304,7 +2573,7 @@ impl<'a> MaterializationBudget<'a> {
         let permit = self
             .state
             .memory
-            .try_acquire_response_materialization(requested_bytes)
+            .try_acquire_reapi_materialization(requested_bytes.saturating_mul(copies))
             .map_err(|_| {
                 self.reject(format!(
                     "{label} was rejected because the concurrent REAPI response materialization pool is exhausted"
@@ -2612,7 +2881,6 @@ mod tests {
         assert!(status.metadata().get(REFUSAL_REASON_KEY).is_none());
     }
     use super::*;
-    use bytes::Bytes;
     use http_body_util::BodyExt;
     use std::{convert::Infallible, time::Duration};
     use tonic::codegen::{Service, http};
@@ -2645,6 +2913,23 @@ mod tests {
             .expect("gRPC request should build")
     }
 
+    /// A direct `BatchReadBlobs` call's response with the blob data the
+    /// route would splice in put back into each entry.
+    fn batch_read_with_data(
+        response: Response<reapi::BatchReadBlobsResponse>,
+    ) -> reapi::BatchReadBlobsResponse {
+        let BatchReadData(data) = response
+            .extensions()
+            .get::<BatchReadData>()
+            .cloned()
+            .expect("batch read response should carry its blob data");
+        let mut response = response.into_inner();
+        for (entry, data) in response.responses.iter_mut().zip(data) {
+            entry.data = data.to_vec();
+        }
+        response
+    }
+
     #[test]
     fn grpc_write_admission_only_matches_mutating_methods() {
         assert!(is_reapi_write_path(BYTESTREAM_WRITE_PATH));
@@ -2936,15 +3221,73 @@ mod tests {
         while let Some(frame) = body.frame().await {
             frame.expect("fragment should pass validation");
         }
+        // Without blob data the forwarded remainder is the whole message.
         assert_eq!(
             memory.transient_reserved_bytes(),
             request.len() as u64 * CAS_BATCH_UPDATE_DECODE_COPIES
+                + request.len() as u64
                 + 2 * REAPI_BATCH_REQUEST_STRUCTURAL_BYTES
         );
         drop(body);
         assert_eq!(memory.transient_reserved_bytes(), 0);
     }
 
+    #[tokio::test]
+    async fn batch_update_blob_data_bypasses_the_decoded_message() {
+        let blob = |byte: u8, len: usize| reapi::batch_update_blobs_request::Request {
+            digest: Some(reapi::Digest {
+                hash: format!("{byte:02x}").repeat(32),
+                size_bytes: len as i64,
+            }),
+            data: vec![byte; len],
+            ..Default::default()
+        };
+        let request = reapi::BatchUpdateBlobsRequest {
+            instance_name: "ios".into(),
+            requests: vec![blob(1, 4_096), blob(2, 0), blob(3, 100_000)],
+            ..Default::default()
+        };
+        let encoded = request.encode_to_vec();
+        let mut framed = grpc_message(0, 0);
+        framed.truncate(GRPC_MESSAGE_HEADER_BYTES);
+        framed[1..].copy_from_slice(&(encoded.len() as u32).to_be_bytes());
+        framed.extend_from_slice(&encoded);
+        let frames = framed
+            .chunks(16 * 1024)
+            .map(|chunk| Ok::<_, Infallible>(Bytes::copy_from_slice(chunk)))
+            .collect::<Vec<_>>();
+        let (_memory, admission) =
+            grpc_write_admission(8 * 1024 * 1024, CAS_BATCH_UPDATE_DECODE_COPIES);
+        let mut body = GrpcWriteAdmissionBody::new(
+            axum::body::Body::from_stream(futures_util::stream::iter(frames)),
+            admission.clone(),
+            GrpcWriteShapePolicy::BatchUpdate,
+        );
+
+        let mut forwarded = Vec::new();
+        while let Some(frame) = body.frame().await {
+            let frame = frame.expect("the batch should pass validation");
+            forwarded.extend_from_slice(frame.data_ref().expect("data frame"));
+        }
+        let decoded =
+            reapi::BatchUpdateBlobsRequest::decode(&forwarded[GRPC_MESSAGE_HEADER_BYTES..])
+                .expect("the forwarded remainder should decode");
+        let mut stripped = request.clone();
+        for item in &mut stripped.requests {
+            item.data.clear();
+        }
+        assert_eq!(decoded, stripped);
+        let data = admission.take_batch_data().expect("split blob data");
+        assert_eq!(
+            data.iter().map(|data| data.to_vec()).collect::<Vec<_>>(),
+            request
+                .requests
+                .iter()
+                .map(|item| item.data.clone())
+                .collect::<Vec<_>>()
+        );
+    }
+
     #[tokio::test]
     async fn unary_admission_rejects_dense_structure_and_releases_its_reservation() {
         let request_count = 20_000;
@@ -4763,7 +5106,7 @@ mod tests {
     use crate::{
         artifact::producer::ArtifactProducer,
         failpoints::{FailpointAction, FailpointName},
-        test_support::{TestContext, test_context, test_context_with_auth},
+        test_support::{TestContext, allocations_during, test_context, test_context_with_auth},
     };
 
     // Serves the REAPI routes over a plaintext h2c listener for the tests
@@ -4940,29 +5283,89 @@ mod tests {
             .await
             .expect("BatchReadBlobs route should respond");
         assert_eq!(response.status(), http::StatusCode::OK);
+        // The blob is held once, in the pooled buffer spliced into the
+        // response; a 64 KiB read fills its size class, so there is no slack.
         let reserved_bytes = context.state.memory.transient_reserved_bytes();
-        assert_eq!(reserved_bytes, (blob.len() * 2) as u64);
+        assert_eq!(reserved_bytes, blob.len() as u64);
 
-        let frame = response
-            .body_mut()
-            .frame()
-            .await
-            .expect("BatchReadBlobs response should yield a frame")
-            .expect("BatchReadBlobs response frame should be valid");
-        let encoded = frame
-            .into_data()
-            .expect("BatchReadBlobs response frame should contain encoded data");
+        let mut frames = Vec::new();
+        while let Some(frame) = response.body_mut().frame().await {
+            let frame = frame.expect("BatchReadBlobs response frame should be valid");
+            if let Ok(data) = frame.into_data() {
+                frames.push(data);
+            }
+        }
         drop(response);
         assert_eq!(
             context.state.memory.transient_reserved_bytes(),
             reserved_bytes,
             "the encoded transport bytes must retain the materialization reservation"
         );
+        let encoded = frames.concat();
+        let decoded = reapi::BatchReadBlobsResponse::decode(&encoded[GRPC_MESSAGE_HEADER_BYTES..])
+            .expect("spliced BatchReadBlobs response should decode");
+        assert_eq!(decoded.responses.len(), 1);
+        assert_eq!(decoded.responses[0].data, blob);
 
-        drop(encoded);
+        drop(frames);
         #[cfg(target_os = "linux")]
         context.state.memory.observe(0);
-        assert_eq!(context.state.memory.transient_reserved_bytes(), 0);
+        // Only the idle pooled buffer the blob was read into stays charged.
+        assert_eq!(
+            context.state.memory.transient_reserved_bytes(),
+            context.state.memory.buffer_pool().idle_bytes() as u64
+        );
+    }
+
+    #[test]
+    fn spliced_batch_read_response_does_not_copy_blob_data() {
+        let blobs = (0..16u8)
+            .map(|index| Bytes::from(vec![index; 256 * 1024]))
+            .chain([Bytes::new()])
+            .collect::<Vec<_>>();
+        let blob_bytes = blobs.iter().map(Bytes::len).sum::<usize>() as u64;
+        let response = |with_data: bool| reapi::BatchReadBlobsResponse {
+            responses: blobs
+                .iter()
+                .enumerate()
+                .map(|(index, blob)| reapi::batch_read_blobs_response::Response {
+                    digest: Some(reapi::Digest {
+                        hash: format!("{index:064x}"),
+                        size_bytes: blob.len() as i64,
+                    }),
+                    data: if with_data { blob.to_vec() } else { Vec::new() },
+                    compressor: 0,
+                    status: Some(if blob.is_empty() {
+                        rpc_status(5, "blob not found")
+                    } else {
+                        rpc_status(0, "")
+                    }),
+                })
+                .collect(),
+        };
+        let full = response(true);
+        let stripped = response(false);
+
+        let (encoded, copied) = allocations_during(|| full.encode_to_vec());
+        assert!(
+            copied.bytes >= blob_bytes,
+            "Prost encodes a copy of every blob: {copied:?}"
+        );
+
+        let (chunks, spliced) = allocations_during(|| {
+            let message = Bytes::from(stripped.encode_to_vec());
+            splice_batch_read_data(&message, blobs.clone())
+                .expect("stripped response should splice")
+        });
+        assert!(
+            spliced.bytes < blob_bytes / 64,
+            "splicing must not copy blob data: {spliced:?}"
+        );
+        assert!(
+            spliced.count <= 2 * blobs.len() as u64,
+            "splicing allocates framing per blob, not per byte: {spliced:?}"
+        );
+        assert_eq!(chunks.concat(), encoded);
     }
 
     #[tokio::test]
@@ -5754,18 +6157,20 @@ mod tests {
             .await
             .expect("cas blob should persist");
 
-        let response = service
-            .batch_read_blobs(Request::new(reapi::BatchReadBlobsRequest {
-                instance_name: DEFAULT_INSTANCE_NAME.into(),
-                digests: vec![digest],
-                digest_function: reapi::digest_function::Value::Sha256 as i32,
-                ..Default::default()
-            }))
-            .await
-            .expect("batch read should succeed");
+        let response = batch_read_with_data(
+            service
+                .batch_read_blobs(Request::new(reapi::BatchReadBlobsRequest {
+                    instance_name: DEFAULT_INSTANCE_NAME.into(),
+                    digests: vec![digest],
+                    digest_function: reapi::digest_function::Value::Sha256 as i32,
+                    ..Default::default()
+                }))
+                .await
+                .expect("batch read should succeed"),
+        );
 
-        assert_eq!(response.get_ref().responses.len(), 1);
-        assert_eq!(response.get_ref().responses[0].data, bytes);
+        assert_eq!(response.responses.len(), 1);
+        assert_eq!(response.responses[0].data, bytes);
 
         let rendered = context.state.metrics.render();
         assert!(rendered.contains("kura_artifact_reads_total"));
@@ -5823,40 +6228,44 @@ mod tests {
             .await
             .expect("small cas blob should persist");
 
-        let response = service
-            .batch_read_blobs(Request::new(reapi::BatchReadBlobsRequest {
-                instance_name: DEFAULT_INSTANCE_NAME.into(),
-                digests: vec![oversized_digest, small_digest],
-                digest_function: reapi::digest_function::Value::Sha256 as i32,
-                ..Default::default()
-            }))
-            .await
-            .expect("batch read should succeed");
+        let response = batch_read_with_data(
+            service
+                .batch_read_blobs(Request::new(reapi::BatchReadBlobsRequest {
+                    instance_name: DEFAULT_INSTANCE_NAME.into(),
+                    digests: vec![oversized_digest, small_digest],
+                    digest_function: reapi::digest_function::Value::Sha256 as i32,
+                    ..Default::default()
+                }))
+                .await
+                .expect("batch read should succeed"),
+        );
 
-        assert_eq!(response.get_ref().responses.len(), 2);
+        assert_eq!(response.responses.len(), 2);
         assert_eq!(
-            response.get_ref().responses[0]
+            response.responses[0]
                 .status
                 .as_ref()
                 .map(|status| status.code),
             Some(tonic::Code::ResourceExhausted as i32)
         );
-        assert!(response.get_ref().responses[0].data.is_empty());
+        assert!(response.responses[0].data.is_empty());
         assert_eq!(
-            response.get_ref().responses[1]
+            response.responses[1]
                 .status
                 .as_ref()
                 .map(|status| status.code),
             Some(0)
         );
-        assert_eq!(response.get_ref().responses[1].data, small_bytes);
+        assert_eq!(response.responses[1].data, small_bytes);
     }
 
     #[tokio::test]
     async fn concurrent_cas_batch_reads_respect_the_shared_transient_budget() {
+        // 20 MiB of transient headroom holds two 8 MiB batch reads but not a
+        // third.
         let context = test_context(|config| {
             config.memory_soft_limit_bytes = 64 * 1024 * 1024;
-            config.memory_hard_limit_bytes = 96 * 1024 * 1024;
+            config.memory_hard_limit_bytes = 84 * 1024 * 1024;
         })
         .await;
         let first_service = ReapiService {
@@ -5948,18 +6357,20 @@ mod tests {
         );
 
         for handle in [first, second] {
-            let response = handle
-                .await
-                .expect("concurrent read task should join")
-                .expect("concurrent read should succeed");
+            let response = batch_read_with_data(
+                handle
+                    .await
+                    .expect("concurrent read task should join")
+                    .expect("concurrent read should succeed"),
+            );
             assert_eq!(
-                response.get_ref().responses[0]
+                response.responses[0]
                     .status
                     .as_ref()
                     .map(|status| status.code),
                 Some(0)
             );
-            assert_eq!(response.get_ref().responses[0].data, bytes);
+            assert_eq!(response.responses[0].data, bytes);
         }
     }
 
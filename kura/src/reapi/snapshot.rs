@@ -764,7 +764,7 @@ pub(super) async fn reconcile_snapshot_index(
     let store = state.store.clone();
     let scan_namespace_id = namespace_id.to_owned();
     let scan_trunk = trunk.map(str::to_owned);
-    let manifests = match tokio::task::spawn_blocking(move || {
+    let manifests = match crate::tasks::spawn_blocking(move || {
         store.action_cache_manifests_bounded(
             &scan_namespace_id,
             snapshot_index_max_entries(),
@@ -899,7 +899,7 @@ pub(super) async fn reconcile_snapshot_index(
                     .await
                     .expect("snapshot decoded load budget is never closed");
                 (
-                    reapi::ActionResult::decode(bytes.as_slice()).ok(),
+                    reapi::ActionResult::decode(&bytes[..]).ok(),
                     Some((encoded_permit, decoded_permit)),
                 )
             } else {
@@ -1,4 +1,5 @@
 pub mod operation;
+pub mod outbox_index;
 pub mod outbox_message;
 
 use std::{
@@ -23,6 +24,7 @@ use tokio_util::io::ReaderStream;
 use tracing::{Instrument, field, warn};
 
 use crate::{
+    artifact::producer::ArtifactProducer,
     bandwidth::BandwidthLimiter,
     config::Config,
     constants::{
@@ -31,7 +33,7 @@ use crate::{
     failpoints::FailpointName,
     state::SharedState,
     telemetry::{inject_current_trace_context, record_trace_context},
-    utils::{replication_target_label, url_encode},
+    utils::{cas_blob_content_address, replication_target_label, url_encode},
 };
 
 use self::{operation::ReplicationOperation, outbox_message::OutboxMessage};
@@ -85,6 +87,7 @@ pub async fn enqueue_replication_for_artifact(
                 inline: manifest.inline,
                 branch: manifest.branch.clone(),
                 trunk: None,
+                shared_body: false,
             },
         }) {
             warn!("failed to enqueue artifact replication for {peer}: {error}");
@@ -106,11 +109,15 @@ where
     F: Fn(SharedState) -> Fut + Send + Sync + 'static,
     Fut: std::future::Future<Output = ()> + Send + 'static,
 {
+    let polls = state.metrics.task_poll_metrics(name);
     tokio::spawn(
         async move {
             loop {
                 let task_state = state.clone();
-                let handle = tokio::spawn(work(task_state).in_current_span());
+                let handle = tokio::spawn(crate::tasks::timed(
+                    polls.clone(),
+                    work(task_state).in_current_span(),
+                ));
                 match handle.await {
                     Ok(()) => return,
                     Err(error) if error.is_panic() => {
@@ -556,7 +563,7 @@ pub async fn process_outbox(state: &SharedState) -> Result<(), String> {
             && !current_targets.contains(&message.target)
             && !discovered_history.contains(&message.target)
         {
-            state.store.delete_outbox_message(&message_key)?;
+            state.store.delete_outbox_message(&message_key, &message)?;
             state.metrics.record_replication(
                 &message.target,
                 message.operation.name(),
@@ -567,6 +574,25 @@ pub async fn process_outbox(state: &SharedState) -> Result<(), String> {
             continue;
         }
 
+        // A newer upsert of the same artifact, or a namespace delete covering
+        // it, is already queued for this target, so delivering this one would
+        // only earn an `ignored_stale`. Checked ahead of the backoff so a
+        // partitioned peer's backlog collapses to one message per key while
+        // it is unreachable rather than after it returns.
+        if state
+            .store
+            .outbox_message_superseded(&message_key, &message)?
+        {
+            state.store.delete_outbox_message(&message_key, &message)?;
+            state.metrics.record_replication(
+                &message.target,
+                message.operation.name(),
+                "coalesced",
+                Duration::ZERO,
+            );
+            continue;
+        }
+
         if state
             .replication_target_backed_off(&message.target, Instant::now())
             .await
@@ -589,7 +615,7 @@ pub async fn process_outbox(state: &SharedState) -> Result<(), String> {
                     "dropped_oversized",
                     started_at.elapsed(),
                 );
-                state.store.delete_outbox_message(&message_key)?;
+                state.store.delete_outbox_message(&message_key, &message)?;
                 rewind_to_priority_head(state, &mut after).await?;
             }
             Ok(ReplicationOutcome::Delivered) => {
@@ -606,7 +632,7 @@ pub async fn process_outbox(state: &SharedState) -> Result<(), String> {
                             "ok",
                             started_at.elapsed(),
                         );
-                        state.store.delete_outbox_message(&message_key)?;
+                        state.store.delete_outbox_message(&message_key, &message)?;
                         rewind_to_priority_head(state, &mut after).await?;
                     }
                     Err(error) => {
@@ -738,6 +764,57 @@ async fn upload_stalled(progress: &UploadProgress, stall: Duration) {
     }
 }
 
+/// Offers `target` a body-less link for a REAPI CAS blob. `Ok(false)` means the
+/// peer does not store the content (or predates the link route) and the body
+/// must be uploaded; server errors fail the attempt like an upload would.
+async fn replicate_content_link(
+    state: &SharedState,
+    target: &str,
+    query: &str,
+) -> Result<bool, String> {
+    let url = format!("{target}/_internal/replicate/link?{query}");
+    let request_span = tracing::info_span!(
+        "replication.request",
+        otel.name = "POST /_internal/replicate/link",
+        otel.kind = "client",
+        kura.operation = "link_artifact",
+        http.request.method = "POST",
+        url.full = %url,
+        peer.service = %replication_target_label(target),
+        http.response.status_code = field::Empty,
+        otel.status_code = field::Empty,
+        trace_id = field::Empty,
+        span_id = field::Empty,
+    );
+    record_trace_context(&request_span);
+    let response_span = request_span.clone();
+
+    async {
+        let mut headers = reqwest::header::HeaderMap::new();
+        inject_current_trace_context(&mut headers);
+        let response = state
+            .client()
+            .post(&url)
+            .headers(headers)
+            .send()
+            .await
+            .map_err(|error| format!("artifact link request failed: {error}"))?;
+        let status = response.status();
+        response_span.record("http.response.status_code", status.as_u16());
+        if status.is_server_error() {
+            response_span.record("otel.status_code", "ERROR");
+            return Err(format!("artifact link response failed: {status}"));
+        }
+        let linked = status.is_success();
+        state
+            .metrics
+            .record_replication_content_link(if linked { "linked" } else { "missing" });
+        Ok(linked)
+    }
+    .instrument(request_span)
+    .await
+}
+
 async fn replicate_message(
     state: &SharedState,
     message: &OutboxMessage,
@@ -753,6 +830,7 @@ async fn replicate_message(
             inline,
             branch,
             trunk,
+            shared_body,
         } => {
             let manifest = match state.store.manifest(artifact_id)? {
                 Some(manifest) => manifest,
@@ -775,17 +853,8 @@ async fn replicate_message(
                 return Ok(ReplicationOutcome::DroppedOversized);
             }
 
-            let file = state
-                .store
-                .open_artifact_reader(&manifest)
-                .await
-                .map_err(|error| {
-                    format!("failed to open local artifact for replication: {error}")
-                })?;
-
-            let mut url = format!(
-                "{}/_internal/replicate/artifact?producer={}&inline={}&namespace_id={}&key={}&content_type={}&version_ms={}",
-                message.target,
+            let mut query = format!(
+                "producer={}&inline={}&namespace_id={}&key={}&content_type={}&version_ms={}",
                 producer.as_str(),
                 inline,
                 url_encode(namespace_id),
@@ -798,14 +867,37 @@ async fn replicate_message(
             // not read, which leaves it applying the entry untagged — its
             // behavior before this field existed.
             if let Some(branch) = branch {
-                url.push_str("&branch=");
-                url.push_str(&url_encode(branch));
+                query.push_str("&branch=");
+                query.push_str(&url_encode(branch));
             }
             if let Some(trunk) = trunk {
-                url.push_str("&trunk=");
-                url.push_str(&url_encode(trunk));
+                query.push_str("&trunk=");
+                query.push_str(&url_encode(trunk));
+            }
+
+            // A REAPI CAS body is addressed by its digest, so the peer may
+            // already store it under another namespace. That is likely only
+            // when this node already did (the persist linked a stored body);
+            // otherwise the offer is a round-trip that almost always misses,
+            // so only then is a link offered before the upload.
+            if *shared_body
+                && !manifest.inline
+                && *producer == ArtifactProducer::Reapi
+                && cas_blob_content_address(key).is_some()
+                && replicate_content_link(state, &message.target, &query).await?
+            {
+                return Ok(ReplicationOutcome::Delivered);
             }
-            let url = url;
+
+            let file = state
+                .store
+                .open_artifact_reader(&manifest)
+                .await
+                .map_err(|error| {
+                    format!("failed to open local artifact for replication: {error}")
+                })?;
+
+            let url = format!("{}/_internal/replicate/artifact?{query}", message.target);
             let size = manifest.size;
             let bandwidth_limiter = state.replication_bandwidth_limiter.clone();
             let upload_stall = Duration::from_millis(state.config.replication_upload_stall_ms);
@@ -1308,6 +1400,7 @@ mod tests {
                     inline: false,
                     branch: None,
                     trunk: None,
+                    shared_body: false,
                 },
             })
             .expect("upsert should enqueue");
@@ -1662,6 +1755,7 @@ mod tests {
                     inline: false,
                     branch: None,
                     trunk: None,
+                    shared_body: false,
                 },
             })
             .expect("upsert should enqueue");
@@ -1736,6 +1830,7 @@ mod tests {
                     inline: false,
                     branch: None,
                     trunk: None,
+                    shared_body: false,
                 },
             })
             .expect("upsert should enqueue");
@@ -1831,6 +1926,7 @@ mod tests {
                     inline: false,
                     branch: None,
                     trunk: None,
+                    shared_body: false,
                 },
             })
             .expect("outbox message should enqueue");
@@ -1915,6 +2011,7 @@ mod tests {
                 inline: manifest.inline,
                 branch: None,
                 trunk: None,
+                shared_body: false,
             },
         };
 
@@ -27,6 +27,12 @@ pub enum ReplicationOperation {
         /// re-run the trunk-sticky rule against its own view of the key.
         #[serde(default, skip_serializing_if = "Option::is_none")]
         trunk: Option<String>,
+        /// The local persist linked a body this node already stored under
+        /// another key, so peers likely store it too and a body-less link is
+        /// worth offering before the upload. Additive like the tags: an old
+        /// peer's message decodes to `false` and just uploads.
+        #[serde(default, skip_serializing_if = "std::ops::Not::not")]
+        shared_body: bool,
     },
     DeleteNamespace {
         namespace_id: String,
@@ -96,6 +102,7 @@ mod tests {
             version_ms: 123,
             branch: Some("main".into()),
             trunk: Some("main".into()),
+            shared_body: false,
         };
         let encoded = serde_json::to_string(&tagged).expect("message should encode");
         assert_eq!(
@@ -114,6 +121,7 @@ mod tests {
             version_ms: 123,
             branch: None,
             trunk: None,
+            shared_body: false,
         };
         let encoded = serde_json::to_string(&untagged).expect("message should encode");
         assert!(
@@ -121,6 +129,7 @@ mod tests {
             "absent fields stay off the wire"
         );
         assert!(!encoded.contains("trunk"));
+        assert!(!encoded.contains("shared_body"));
     }
 
     #[test]
@@ -136,6 +145,7 @@ mod tests {
                 version_ms: 123,
                 branch: None,
                 trunk: None,
+                shared_body: false,
             }
             .name(),
             "upsert_artifact"
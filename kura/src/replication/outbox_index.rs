@@ -0,0 +1,295 @@
+use std::collections::HashMap;
+
+use crate::replication::{operation::ReplicationOperation, outbox_message::OutboxMessage};
+
+/// In-memory view of which queued outbox messages are the newest word on
+/// their subject, so the drain can retire superseded ones without a delivery.
+///
+/// A hot action-cache or keyvalue key rewritten while a peer is slow or
+/// partitioned used to queue every version, and each one was shipped in order
+/// only for the peer to answer `ignored_stale`. The index keeps, per target
+/// and namespace, the newest pending `UpsertArtifact` for each artifact and
+/// the latest pending `DeleteNamespace`; an older upsert for the same artifact,
+/// or an upsert queued ahead of a delete that covers it, is redundant.
+///
+/// Entries are noted when a message is staged into a WriteBatch, before it
+/// commits, so the index can name a key whose batch then failed. Callers must
+/// therefore confirm a superseding message is really queued before dropping
+/// the one it supersedes (see [`OutboxIndex::superseding_key`]).
+#[derive(Default)]
+pub struct OutboxIndex {
+    namespaces: HashMap<(String, String), NamespaceEntries>,
+}
+
+#[derive(Default)]
+struct NamespaceEntries {
+    upserts: HashMap<String, PendingMessage>,
+    delete: Option<PendingMessage>,
+}
+
+#[derive(Clone, Debug, PartialEq, Eq)]
+struct PendingMessage {
+    outbox_key: Vec<u8>,
+    version_ms: u64,
+}
+
+impl OutboxIndex {
+    /// Records a message staged (or found at boot) under `outbox_key`. An
+    /// upsert replaces the artifact's entry unless the entry is strictly
+    /// newer; a namespace delete replaces the pending delete when it sorts
+    /// later in the queue.
+    pub fn note(&mut self, outbox_key: &[u8], message: &OutboxMessage) {
+        match &message.operation {
+            ReplicationOperation::UpsertArtifact {
+                namespace_id,
+                artifact_id,
+                version_ms,
+                ..
+            } => {
+                let entries = self
+                    .namespaces
+                    .entry((message.target.clone(), namespace_id.clone()))
+                    .or_default();
+                let pending = PendingMessage {
+                    outbox_key: outbox_key.to_vec(),
+                    version_ms: *version_ms,
+                };
+                match entries.upserts.get_mut(artifact_id) {
+                    Some(existing) if supersedes(&pending, existing) => *existing = pending,
+                    Some(_) => {}
+                    None => {
+                        entries.upserts.insert(artifact_id.clone(), pending);
+                    }
+                }
+            }
+            ReplicationOperation::DeleteNamespace {
+                namespace_id,
+                version_ms,
+            } => {
+                let entries = self
+                    .namespaces
+                    .entry((message.target.clone(), namespace_id.clone()))
+                    .or_default();
+                if entries.delete.as_ref().is_none_or(|existing| {
+                    outbox_sequence(outbox_key) >= outbox_sequence(&existing.outbox_key)
+                }) {
+                    entries.delete = Some(PendingMessage {
+                        outbox_key: outbox_key.to_vec(),
+                        version_ms: *version_ms,
+                    });
+                }
+            }
+        }
+    }
+
+    /// The queued message that makes `message` (queued under `outbox_key`)
+    /// redundant, if the index knows one: a newer upsert of the same artifact
+    /// to the same target, or a namespace delete queued after the upsert that
+    /// covers its version (a version-0 delete purges without a tombstone, so
+    /// it covers everything queued before it). Namespace deletes are never
+    /// superseded.
+    pub fn superseding_key(&self, outbox_key: &[u8], message: &OutboxMessage) -> Option<Vec<u8>> {
+        let ReplicationOperation::UpsertArtifact {
+            namespace_id,
+            artifact_id,
+            version_ms,
+            ..
+        } = &message.operation
+        else {
+            return None;
+        };
+        let entries = self
+            .namespaces
+            .get(&(message.target.clone(), namespace_id.clone()))?;
+        let this = PendingMessage {
+            outbox_key: outbox_key.to_vec(),
+            version_ms: *version_ms,
+        };
+        if let Some(newest) = entries.upserts.get(artifact_id)
+            && newest.outbox_key != outbox_key
+            && supersedes(newest, &this)
+        {
+            return Some(newest.outbox_key.clone());
+        }
+        if let Some(delete) = &entries.delete
+            && outbox_sequence(&delete.outbox_key) > outbox_sequence(outbox_key)
+            && (delete.version_ms == 0 || *version_ms <= delete.version_ms)
+        {
+            return Some(delete.outbox_key.clone());
+        }
+        None
+    }
+
+    /// Drops whatever entry points at `outbox_key`, once its message left the
+    /// queue or turned out never to have committed.
+    pub fn forget(&mut self, outbox_key: &[u8], message: &OutboxMessage) {
+        let namespace_id = match &message.operation {
+            ReplicationOperation::UpsertArtifact { namespace_id, .. }
+            | ReplicationOperation::DeleteNamespace { namespace_id, .. } => namespace_id,
+        };
+        let slot = (message.target.clone(), namespace_id.clone());
+        let Some(entries) = self.namespaces.get_mut(&slot) else {
+            return;
+        };
+        entries
+            .upserts
+            .retain(|_, pending| pending.outbox_key != outbox_key);
+        if entries
+            .delete
+            .as_ref()
+            .is_some_and(|delete| delete.outbox_key == outbox_key)
+        {
+            entries.delete = None;
+        }
+        if entries.upserts.is_empty() && entries.delete.is_none() {
+            self.namespaces.remove(&slot);
+        }
+    }
+
+    /// Forgets the entry whose message could not be found under
+    /// `outbox_key`, wherever it is indexed.
+    pub fn forget_key(&mut self, outbox_key: &[u8]) {
+        self.namespaces.retain(|_, entries| {
+            entries
+                .upserts
+                .retain(|_, pending| pending.outbox_key != outbox_key);
+            if entries
+                .delete
+                .as_ref()
+                .is_some_and(|delete| delete.outbox_key == outbox_key)
+            {
+                entries.delete = None;
+            }
+            !entries.upserts.is_empty() || entries.delete.is_some()
+        });
+    }
+
+    #[cfg(test)]
+    pub fn len(&self) -> usize {
+        self.namespaces
+            .values()
+            .map(|entries| entries.upserts.len() + usize::from(entries.delete.is_some()))
+            .sum()
+    }
+}
+
+/// Newer version wins; an equal version goes to the later enqueue, which is
+/// what the receiver would keep too.
+fn supersedes(candidate: &PendingMessage, existing: &PendingMessage) -> bool {
+    candidate.version_ms > existing.version_ms
+        || (candidate.version_ms == existing.version_ms
+            && outbox_sequence(&candidate.outbox_key) > outbox_sequence(&existing.outbox_key))
+}
+
+/// The enqueue-order part of an outbox key. Keys carry a lane prefix
+/// (`"0-"`/`"1-"`) that orders draining, not enqueueing, so comparing two
+/// messages' age across lanes strips it first; legacy unprefixed keys are
+/// already just the timestamp and id.
+fn outbox_sequence(outbox_key: &[u8]) -> &[u8] {
+    match outbox_key {
+        [b'0' | b'1', b'-', rest @ ..] => rest,
+        _ => outbox_key,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use crate::{
+        artifact::producer::ArtifactProducer,
+        replication::{operation::ReplicationOperation, outbox_message::OutboxMessage},
+    };
+
+    use super::OutboxIndex;
+
+    fn upsert(target: &str, key: &str, version_ms: u64) -> OutboxMessage {
+        OutboxMessage {
+            target: target.into(),
+            operation: ReplicationOperation::UpsertArtifact {
+                producer: ArtifactProducer::Reapi,
+                namespace_id: "ios".into(),
+                key: key.into(),
+                content_type: "application/x-protobuf".into(),
+                artifact_id: format!("reapi/ios/{key}"),
+                inline: true,
+                version_ms,
+                branch: None,
+                trunk: None,
+                shared_body: false,
+            },
+        }
+    }
+
+    fn delete(target: &str, version_ms: u64) -> OutboxMessage {
+        OutboxMessage {
+            target: target.into(),
+            operation: ReplicationOperation::DeleteNamespace {
+                namespace_id: "ios".into(),
+                version_ms,
+            },
+        }
+    }
+
+    #[test]
+    fn only_the_newest_upsert_per_artifact_and_target_survives() {
+        let mut index = OutboxIndex::default();
+        let first = upsert("http://peer-a", "action_cache/1", 100);
+        let second = upsert("http://peer-a", "action_cache/1", 200);
+        let other_target = upsert("http://peer-b", "action_cache/1", 100);
+        index.note(b"0-001", &first);
+        index.note(b"0-002", &second);
+        index.note(b"0-003", &other_target);
+
+        assert_eq!(
+            index.superseding_key(b"0-001", &first),
+            Some(b"0-002".to_vec())
+        );
+        assert_eq!(index.superseding_key(b"0-002", &second), None);
+        assert_eq!(index.superseding_key(b"0-003", &other_target), None);
+
+        // A late, older version never displaces the newest one.
+        let stale = upsert("http://peer-a", "action_cache/1", 50);
+        index.note(b"0-004", &stale);
+        assert_eq!(
+            index.superseding_key(b"0-004", &stale),
+            Some(b"0-002".to_vec())
+        );
+    }
+
+    #[test]
+    fn a_queued_namespace_delete_covers_older_upserts_queued_before_it() {
+        let mut index = OutboxIndex::default();
+        let covered = upsert("http://peer", "artifact-1", 100);
+        let newer = upsert("http://peer", "artifact-2", 900);
+        let after_delete = upsert("http://peer", "artifact-3", 100);
+        index.note(b"1-001", &covered);
+        index.note(b"1-002", &newer);
+        index.note(b"0-003", &delete("http://peer", 500));
+        index.note(b"0-004", &after_delete);
+
+        // Lanes are ignored when comparing enqueue order.
+        assert_eq!(
+            index.superseding_key(b"1-001", &covered),
+            Some(b"0-003".to_vec())
+        );
+        assert_eq!(index.superseding_key(b"1-002", &newer), None);
+        assert_eq!(index.superseding_key(b"0-004", &after_delete), None);
+    }
+
+    #[test]
+    fn forgetting_delivered_messages_empties_the_index() {
+        let mut index = OutboxIndex::default();
+        let first = upsert("http://peer", "artifact-1", 100);
+        let namespace_delete = delete("http://peer", 0);
+        index.note(b"0-001", &first);
+        index.note(b"0-002", &namespace_delete);
+        assert_eq!(index.len(), 2);
+
+        // Forgetting a superseded key leaves the newer entry alone.
+        index.forget(b"0-000", &first);
+        assert_eq!(index.len(), 2);
+
+        index.forget(b"0-001", &first);
+        index.forget_key(b"0-002");
+        assert_eq!(index.len(), 0);
+    }
+}
@@ -56,6 +56,10 @@ pub struct RuntimeState {
     // under-replication.
     peer_view_required: AtomicBool,
     peer_view_ready: AtomicBool,
+    // Set while the hot set left by the previous process is being re-warmed;
+    // serving waits for it so the first requests after a restart do not all
+    // miss the caches at once. The warm is time-bounded.
+    warming: AtomicBool,
     writer_lock_owned: AtomicBool,
     http_inflight: AtomicUsize,
     public_http_inflight: AtomicUsize,
@@ -73,6 +77,7 @@ impl RuntimeState {
             serving: AtomicBool::new(false),
             peer_view_required: AtomicBool::new(false),
             peer_view_ready: AtomicBool::new(false),
+            warming: AtomicBool::new(false),
             writer_lock_owned: AtomicBool::new(true),
             http_inflight: AtomicUsize::new(0),
             public_http_inflight: AtomicUsize::new(0),
@@ -113,6 +118,18 @@ impl RuntimeState {
             && !self.peer_view_ready.load(Ordering::SeqCst)
     }
 
+    pub fn begin_warming(&self) {
+        self.warming.store(true, Ordering::SeqCst);
+    }
+
+    pub fn finish_warming(&self) {
+        self.warming.store(false, Ordering::SeqCst);
+    }
+
+    pub fn is_warming(&self) -> bool {
+        self.warming.load(Ordering::SeqCst)
+    }
+
     pub fn is_serving(&self) -> bool {
         self.serving.load(Ordering::SeqCst)
     }
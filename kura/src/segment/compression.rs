@@ -0,0 +1,174 @@
+//! At-rest compression of segment bodies.
+//!
+//! Gradle outputs, Xcode module caches and Metro bundles compress several times
+//! over with zstd, and how long an artifact survives in the segment ring is
+//! decided by the bytes it occupies there. Producers listed in
+//! `KURA_SEGMENT_COMPRESSION_PRODUCERS` therefore have their bodies compressed
+//! on persist when it looks worth it: the body is within the size window
+//! (compression and decoding both happen in memory), its content type is not
+//! an already-compressed format, and a sample of its first bytes compresses
+//! well. The whole body must then still come in under the ratio bailout, or it
+//! is stored as is.
+//!
+//! The manifest records the stored encoding. Reads decode in memory, except
+//! that an HTTP client accepting zstd gets the stored bytes passed through with
+//! `Content-Encoding: zstd`. REAPI blobs are never compressed: the protocol
+//! serves byte ranges of digest-addressed content and negotiates its own
+//! compressed-blobs encoding.
+
+use crate::{
+    artifact::producer::ArtifactProducer,
+    constants::{
+        SEGMENT_COMPRESSION_LEVEL, SEGMENT_COMPRESSION_MAX_BYTES,
+        SEGMENT_COMPRESSION_MAX_RATIO_PERCENT, SEGMENT_COMPRESSION_MIN_BYTES,
+        SEGMENT_COMPRESSION_SAMPLE_BYTES,
+    },
+};
+
+/// Content types that are compressed formats already.
+const COMPRESSED_CONTENT_TYPES: [&str; 12] = [
+    "zip",
+    "gzip",
+    "zstd",
+    "x-xz",
+    "x-bzip2",
+    "x-7z",
+    "x-brotli",
+    "x-lz4",
+    "image/",
+    "video/",
+    "audio/",
+    "font/woff",
+];
+
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct SegmentCompressionConfig {
+    producers: Vec<ArtifactProducer>,
+}
+
+impl SegmentCompressionConfig {
+    /// Parses the comma-separated producer list of
+    /// `KURA_SEGMENT_COMPRESSION_PRODUCERS`.
+    pub fn parse(key: &str, value: Option<&str>) -> Result<Self, String> {
+        let mut producers = Vec::new();
+        for name in value
+            .unwrap_or("")
+            .split(',')
+            .map(str::trim)
+            .filter(|name| !name.is_empty())
+        {
+            match ArtifactProducer::from_str(name) {
+                Some(ArtifactProducer::Reapi) => {
+                    return Err(format!("{key} cannot include reapi"));
+                }
+                Some(producer) => {
+                    if !producers.contains(&producer) {
+                        producers.push(producer);
+                    }
+                }
+                None => return Err(format!("{key} contains unknown producer {name}")),
+            }
+        }
+        Ok(Self { producers })
+    }
+
+    /// Whether a `producer` body of `size` bytes and `content_type` is a
+    /// candidate for compression.
+    pub fn should_compress(
+        &self,
+        producer: ArtifactProducer,
+        content_type: &str,
+        size: u64,
+    ) -> bool {
+        self.producers.contains(&producer)
+            && (SEGMENT_COMPRESSION_MIN_BYTES..=SEGMENT_COMPRESSION_MAX_BYTES).contains(&size)
+            && !COMPRESSED_CONTENT_TYPES
+                .iter()
+                .any(|compressed| content_type.contains(compressed))
+    }
+}
+
+fn worth_keeping(compressed: usize, original: usize) -> bool {
+    (compressed as u64).saturating_mul(100)
+        <= (original as u64).saturating_mul(SEGMENT_COMPRESSION_MAX_RATIO_PERCENT)
+}
+
+/// Compresses `body`, or returns `None` when it does not compress enough to be
+/// worth decoding on every read. A sample of the first bytes is tried first so
+/// an incompressible body costs a fraction of a full pass.
+pub fn compress(body: &[u8]) -> Result<Option<Vec<u8>>, String> {
+    let sample = &body[..body.len().min(SEGMENT_COMPRESSION_SAMPLE_BYTES)];
+    if sample.len() < body.len() {
+        let compressed_sample = zstd::bulk::compress(sample, SEGMENT_COMPRESSION_LEVEL)
+            .map_err(|error| format!("failed to compress body sample: {error}"))?;
+        if !worth_keeping(compressed_sample.len(), sample.len()) {
+            return Ok(None);
+        }
+    }
+    let compressed = zstd::bulk::compress(body, SEGMENT_COMPRESSION_LEVEL)
+        .map_err(|error| format!("failed to compress body: {error}"))?;
+    Ok(worth_keeping(compressed.len(), body.len()).then_some(compressed))
+}
+
+/// Decodes a stored body back to its `size` bytes.
+pub fn decompress(stored: &[u8], size: u64) -> Result<Vec<u8>, String> {
+    let capacity =
+        usize::try_from(size).map_err(|_| format!("decoded size {size} exceeds usize"))?;
+    let body = zstd::bulk::decompress(stored, capacity)
+        .map_err(|error| format!("failed to decompress stored body: {error}"))?;
+    if body.len() != capacity {
+        return Err(format!(
+            "stored body decoded to {} bytes, expected {size}",
+            body.len()
+        ));
+    }
+    Ok(body)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn compressible_bodies_round_trip_and_random_ones_bail_out() {
+        let text = b"module cache entry ".repeat(10_000);
+        let compressed = compress(&text)
+            .expect("compression should succeed")
+            .expect("repetitive text should compress");
+        assert!(compressed.len() < text.len() / 10);
+        assert_eq!(decompress(&compressed, text.len() as u64), Ok(text.clone()));
+        assert!(decompress(&compressed, text.len() as u64 + 1).is_err());
+
+        let mut state = 0x9e37_79b9_7f4a_7c15_u64;
+        let noise: Vec<u8> = (0..200_000)
+            .map(|_| {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                state as u8
+            })
+            .collect();
+        assert_eq!(compress(&noise), Ok(None));
+    }
+
+    #[test]
+    fn only_listed_producers_and_plain_content_types_are_candidates() {
+        let config = SegmentCompressionConfig::parse("P", Some("gradle, metro"))
+            .expect("producers should parse");
+
+        assert!(config.should_compress(
+            ArtifactProducer::Gradle,
+            "application/octet-stream",
+            1 << 20
+        ));
+        assert!(!config.should_compress(
+            ArtifactProducer::Xcode,
+            "application/octet-stream",
+            1 << 20
+        ));
+        assert!(!config.should_compress(ArtifactProducer::Gradle, "application/zip", 1 << 20));
+        assert!(!config.should_compress(ArtifactProducer::Gradle, "application/octet-stream", 16));
+        assert!(SegmentCompressionConfig::parse("P", Some("reapi")).is_err());
+        assert!(SegmentCompressionConfig::parse("P", Some("bazel")).is_err());
+    }
+}
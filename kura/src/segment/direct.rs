@@ -0,0 +1,292 @@
+//! Direct-I/O segment appends.
+//!
+//! Buffered appends leave every body in the page cache as dirty pages until
+//! writeback, so the store periodically syncs and drops the written range to
+//! keep write-once data from crowding out hot reads, and a burst of uploads
+//! still turns into a writeback storm. With `KURA_SEGMENT_DIRECT_IO` segment
+//! bodies are written with `O_DIRECT` from aligned buffers instead and never
+//! enter the page cache; reads keep going through it, so hot data is cached
+//! exactly as before.
+//!
+//! `O_DIRECT` needs block-aligned offsets and lengths. Each append therefore
+//! starts at a block boundary and zero-pads its last block: the padding is
+//! part of the segment's framing, invisible to readers because manifests
+//! carry an offset and a size. The padding also counts against the segment's
+//! size, so a body smaller than [`DIRECT_IO_MIN_BODY_BYTES`], where it could
+//! be most of the append, is written through the page cache instead; a
+//! direct append after it starts at the next block boundary. Buffers come
+//! from a small pool so steady-state appends allocate nothing.
+//!
+//! A body that was just written is often read right away (replication, a
+//! client checking its upload), and after a direct write it only exists on
+//! disk. Small bodies are kept in a bounded buffer of recent appends and
+//! served from memory until newer appends push them out.
+
+use std::{
+    alloc::{Layout, alloc_zeroed, dealloc},
+    collections::{HashMap, VecDeque},
+    path::Path,
+    ptr::NonNull,
+    sync::Mutex,
+};
+
+use bytes::Bytes;
+
+/// Block size every direct write is aligned to. 4 KiB covers the logical
+/// block size of the devices Kura runs on.
+pub const DIRECT_IO_ALIGNMENT: u64 = 4096;
+/// Smallest body written directly, which bounds the padding at 1/16 of the
+/// body.
+pub const DIRECT_IO_MIN_BODY_BYTES: u64 = 16 * DIRECT_IO_ALIGNMENT;
+/// Size of one pooled write buffer.
+pub const DIRECT_IO_BUFFER_BYTES: usize = 1024 * 1024;
+const DIRECT_IO_IDLE_BUFFERS: usize = 8;
+/// Bodies up to this size are kept for reads right after their append.
+pub const RECENT_APPEND_MAX_BODY_BYTES: u64 = 256 * 1024;
+const RECENT_APPENDS_MAX_BYTES: usize = 32 * 1024 * 1024;
+const PROBE_FILE: &str = ".kura.direct_io_probe";
+
+/// Rounds `value` up to the next block boundary.
+pub fn align_up(value: u64) -> u64 {
+    value.div_ceil(DIRECT_IO_ALIGNMENT) * DIRECT_IO_ALIGNMENT
+}
+
+/// A zeroed heap buffer aligned to [`DIRECT_IO_ALIGNMENT`].
+pub struct AlignedBuffer {
+    pointer: NonNull<u8>,
+    layout: Layout,
+}
+
+// The buffer owns its allocation outright, like a `Box<[u8]>`.
+unsafe impl Send for AlignedBuffer {}
+unsafe impl Sync for AlignedBuffer {}
+
+impl AlignedBuffer {
+    fn new(bytes: usize) -> Self {
+        let layout = Layout::from_size_align(bytes, DIRECT_IO_ALIGNMENT as usize)
+            .expect("direct I/O buffer layout is valid");
+        // SAFETY: the layout has a non-zero size.
+        let pointer = unsafe { alloc_zeroed(layout) };
+        let Some(pointer) = NonNull::new(pointer) else {
+            std::alloc::handle_alloc_error(layout);
+        };
+        Self { pointer, layout }
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.layout.size()
+    }
+
+    pub fn as_slice(&self) -> &[u8] {
+        // SAFETY: the allocation is `capacity` initialized bytes owned by `self`.
+        unsafe { std::slice::from_raw_parts(self.pointer.as_ptr(), self.capacity()) }
+    }
+
+    pub fn as_mut_slice(&mut self) -> &mut [u8] {
+        // SAFETY: as above, and `&mut self` makes the borrow unique.
+        unsafe { std::slice::from_raw_parts_mut(self.pointer.as_ptr(), self.capacity()) }
+    }
+}
+
+impl Drop for AlignedBuffer {
+    fn drop(&mut self) {
+        // SAFETY: allocated in `new` with this layout.
+        unsafe { dealloc(self.pointer.as_ptr(), self.layout) }
+    }
+}
+
+/// The state the store keeps for direct appends: the buffer pool and the
+/// recent appends served from memory.
+pub struct DirectSegmentIo {
+    idle: Mutex<Vec<AlignedBuffer>>,
+    recent: Mutex<RecentAppends>,
+}
+
+impl DirectSegmentIo {
+    /// Checks that the filesystem under `directory` accepts direct writes, so
+    /// a data dir on a filesystem without `O_DIRECT` (tmpfs on older
+    /// kernels, some overlay setups) keeps buffered appends.
+    pub fn probe(directory: &Path) -> Result<Self, String> {
+        std::fs::create_dir_all(directory).map_err(|error| {
+            format!(
+                "failed to create segment directory {}: {error}",
+                directory.display()
+            )
+        })?;
+        let path = directory.join(PROBE_FILE);
+        let written = open_direct(&path).and_then(|file| {
+            write_all_at(
+                &file,
+                AlignedBuffer::new(DIRECT_IO_ALIGNMENT as usize).as_slice(),
+                0,
+            )
+        });
+        let _ = std::fs::remove_file(&path);
+        written.map_err(|error| {
+            format!(
+                "direct I/O is not available under {}: {error}",
+                directory.display()
+            )
+        })?;
+        Ok(Self {
+            idle: Mutex::new(Vec::new()),
+            recent: Mutex::new(RecentAppends::default()),
+        })
+    }
+
+    pub fn take_buffer(&self) -> AlignedBuffer {
+        self.idle
+            .lock()
+            .expect("direct I/O buffer pool lock poisoned")
+            .pop()
+            .unwrap_or_else(|| AlignedBuffer::new(DIRECT_IO_BUFFER_BYTES))
+    }
+
+    pub fn return_buffer(&self, buffer: AlignedBuffer) {
+        let mut idle = self
+            .idle
+            .lock()
+            .expect("direct I/O buffer pool lock poisoned");
+        if idle.len() < DIRECT_IO_IDLE_BUFFERS {
+            idle.push(buffer);
+        }
+    }
+
+    pub fn remember(&self, segment_id: &str, offset: u64, body: Bytes) {
+        self.recent
+            .lock()
+            .expect("recent appends lock poisoned")
+            .insert(segment_id, offset, body, RECENT_APPENDS_MAX_BYTES);
+    }
+
+    /// The body appended at `offset`, if it is still buffered and has the
+    /// expected size.
+    pub fn recent(&self, segment_id: &str, offset: u64, size: u64) -> Option<Bytes> {
+        self.recent
+            .lock()
+            .expect("recent appends lock poisoned")
+            .get(segment_id, offset)
+            .filter(|body| body.len() as u64 == size)
+    }
+
+    pub fn forget_segment(&self, segment_id: &str) {
+        self.recent
+            .lock()
+            .expect("recent appends lock poisoned")
+            .remove_segment(segment_id);
+    }
+}
+
+/// Recently appended bodies, oldest first, bounded by total bytes.
+#[derive(Default)]
+struct RecentAppends {
+    bodies: HashMap<(String, u64), Bytes>,
+    order: VecDeque<(String, u64)>,
+    bytes: usize,
+}
+
+impl RecentAppends {
+    fn insert(&mut self, segment_id: &str, offset: u64, body: Bytes, max_bytes: usize) {
+        let key = (segment_id.to_owned(), offset);
+        self.bytes += body.len();
+        if let Some(replaced) = self.bodies.insert(key.clone(), body) {
+            self.bytes -= replaced.len();
+        } else {
+            self.order.push_back(key);
+        }
+        while self.bytes > max_bytes {
+            let Some(oldest) = self.order.pop_front() else {
+                break;
+            };
+            if let Some(body) = self.bodies.remove(&oldest) {
+                self.bytes -= body.len();
+            }
+        }
+    }
+
+    fn get(&self, segment_id: &str, offset: u64) -> Option<Bytes> {
+        self.bodies.get(&(segment_id.to_owned(), offset)).cloned()
+    }
+
+    fn remove_segment(&mut self, segment_id: &str) {
+        self.order.retain(|(id, _)| id != segment_id);
+        let bytes = &mut self.bytes;
+        self.bodies.retain(|(id, _), body| {
+            let keep = id != segment_id;
+            if !keep {
+                *bytes -= body.len();
+            }
+            keep
+        });
+    }
+}
+
+/// Opens a segment for direct writes. Not in append mode: `pwrite` ignores
+/// its offset on an `O_APPEND` descriptor, and direct writes need theirs.
+#[cfg(target_os = "linux")]
+pub fn open_direct(path: &Path) -> std::io::Result<std::fs::File> {
+    use std::os::unix::fs::OpenOptionsExt;
+
+    std::fs::OpenOptions::new()
+        .create(true)
+        .write(true)
+        .custom_flags(libc::O_DIRECT)
+        .open(path)
+}
+
+#[cfg(not(target_os = "linux"))]
+pub fn open_direct(_path: &Path) -> std::io::Result<std::fs::File> {
+    Err(std::io::Error::new(
+        std::io::ErrorKind::Unsupported,
+        "direct I/O segment appends require Linux",
+    ))
+}
+
+#[cfg(unix)]
+pub fn write_all_at(file: &std::fs::File, bytes: &[u8], offset: u64) -> std::io::Result<()> {
+    use std::os::unix::fs::FileExt;
+
+    file.write_all_at(bytes, offset)
+}
+
+#[cfg(not(unix))]
+pub fn write_all_at(_file: &std::fs::File, _bytes: &[u8], _offset: u64) -> std::io::Result<()> {
+    Err(std::io::Error::new(
+        std::io::ErrorKind::Unsupported,
+        "direct I/O segment appends require Linux",
+    ))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn appends_start_and_end_on_block_boundaries() {
+        assert_eq!(align_up(0), 0);
+        assert_eq!(align_up(1), DIRECT_IO_ALIGNMENT);
+        assert_eq!(align_up(DIRECT_IO_ALIGNMENT), DIRECT_IO_ALIGNMENT);
+        assert_eq!(align_up(DIRECT_IO_ALIGNMENT + 1), 2 * DIRECT_IO_ALIGNMENT);
+
+        let buffer = AlignedBuffer::new(DIRECT_IO_BUFFER_BYTES);
+        assert_eq!(
+            buffer.as_slice().as_ptr() as usize % DIRECT_IO_ALIGNMENT as usize,
+            0
+        );
+    }
+
+    #[test]
+    fn recent_appends_evict_oldest_first_and_by_segment() {
+        let mut recent = RecentAppends::default();
+        recent.insert("a", 0, Bytes::from_static(b"first"), 10);
+        recent.insert("a", 4096, Bytes::from_static(b"second"), 10);
+
+        assert!(recent.get("a", 0).is_none());
+        assert_eq!(recent.get("a", 4096).as_deref(), Some(&b"second"[..]));
+
+        recent.insert("b", 0, Bytes::from_static(b"third"), 20);
+        recent.remove_segment("a");
+        assert!(recent.get("a", 4096).is_none());
+        assert_eq!(recent.bytes, 5);
+    }
+}
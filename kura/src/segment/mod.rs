@@ -1,3 +1,5 @@
+pub mod compression;
+pub mod direct;
 pub mod generation;
 pub mod reader;
 pub mod reference;
@@ -2,6 +2,7 @@ use std::{
     pin::Pin,
     sync::Arc,
     task::{Context, Poll},
+    time::Instant,
 };
 
 use tokio::{
@@ -9,7 +10,10 @@ use tokio::{
     task::JoinHandle,
 };
 
-use crate::io::PersistentFile;
+use crate::{
+    io::PersistentFile,
+    stage_timing::{self, Stage, StageTimings},
+};
 
 const READ_CHUNK_BYTES: usize = 512 * 1024;
 
@@ -20,6 +24,9 @@ pub struct SegmentReader {
     pending_read: Option<JoinHandle<Result<Vec<u8>, String>>>,
     buffered: Option<Vec<u8>>,
     buffered_offset: usize,
+    /// The serving request's timings, until its first chunk is read; the
+    /// instant is when that read was issued.
+    first_read: Option<(Arc<StageTimings>, Option<Instant>)>,
 }
 
 impl SegmentReader {
@@ -31,6 +38,7 @@ impl SegmentReader {
             pending_read: None,
             buffered: None,
             buffered_offset: 0,
+            first_read: stage_timing::current().map(|timings| (timings, None)),
         }
     }
 }
@@ -68,6 +76,9 @@ impl AsyncRead for SegmentReader {
                     Poll::Pending => return Poll::Pending,
                     Poll::Ready(Ok(Ok(bytes))) => {
                         self.pending_read = None;
+                        if let Some((timings, Some(issued_at))) = self.first_read.take() {
+                            timings.add(Stage::FirstRead, issued_at.elapsed());
+                        }
                         if bytes.is_empty() {
                             // EOF before `remaining` bytes: the backing file is
                             // shorter than the artifact's manifested length (the
@@ -106,7 +117,10 @@ impl AsyncRead for SegmentReader {
             let len = self.remaining.min(READ_CHUNK_BYTES as u64) as usize;
             let offset = self.offset;
             let handle = self.handle.clone();
-            self.pending_read = Some(tokio::task::spawn_blocking(move || {
+            if let Some((_, issued_at)) = &mut self.first_read {
+                issued_at.get_or_insert_with(Instant::now);
+            }
+            self.pending_read = Some(crate::tasks::spawn_blocking(move || {
                 let mut bytes = vec![0; len];
                 let read = read_at(handle.as_std(), &mut bytes, offset).map_err(|error| {
                     format!("failed to read segment at offset {offset}: {error}")
@@ -0,0 +1,112 @@
+//! Per-thread shards for the accumulators every public request writes to.
+//!
+//! Usage and analytics record on each request, from whichever runtime worker
+//! happens to run it. One shared mutex or atomic there bounces a cache line
+//! between every core serving traffic; a shard per worker keeps each record
+//! local, and the rare reader (a closing window, a metrics tick) pays for the
+//! merge instead.
+
+use std::{
+    cell::Cell,
+    sync::atomic::{AtomicU64, AtomicUsize, Ordering},
+};
+
+/// More shards than runtime workers only spreads the merge thinner; the
+/// runtime caps its workers at the same figure (see `resolve_worker_threads`).
+const MAX_SHARDS: usize = 16;
+
+static NEXT_THREAD_SHARD: AtomicUsize = AtomicUsize::new(0);
+
+thread_local! {
+    static THREAD_SHARD: Cell<Option<usize>> = const { Cell::new(None) };
+}
+
+/// How many shards an accumulator should hold on this host.
+pub fn shard_count() -> usize {
+    std::thread::available_parallelism()
+        .map(|count| count.get())
+        .unwrap_or(1)
+        .clamp(1, MAX_SHARDS)
+}
+
+/// The shard the calling thread records into. Threads are dealt shards
+/// round-robin on first use, so the runtime's long-lived workers each land on
+/// their own while the count allows it.
+pub fn shard_index(shards: usize) -> usize {
+    let thread_shard = THREAD_SHARD.with(|shard| match shard.get() {
+        Some(index) => index,
+        None => {
+            let index = NEXT_THREAD_SHARD.fetch_add(1, Ordering::Relaxed);
+            shard.set(Some(index));
+            index
+        }
+    });
+    thread_shard % shards.max(1)
+}
+
+/// Keeps neighbouring shards off each other's cache line.
+#[repr(align(128))]
+#[derive(Default)]
+pub struct CachePadded<T>(pub T);
+
+/// A counter written per request and read by a periodic drain.
+pub struct ShardedCounter {
+    shards: Box<[CachePadded<AtomicU64>]>,
+}
+
+impl ShardedCounter {
+    pub fn new(shards: usize) -> Self {
+        Self {
+            shards: (0..shards.max(1)).map(|_| CachePadded::default()).collect(),
+        }
+    }
+
+    pub fn add(&self, value: u64) {
+        self.shards[shard_index(self.shards.len())]
+            .0
+            .fetch_add(value, Ordering::Relaxed);
+    }
+
+    /// Everything added since the last take.
+    pub fn take(&self) -> u64 {
+        self.shards
+            .iter()
+            .map(|shard| shard.0.swap(0, Ordering::Relaxed))
+            .fold(0, u64::saturating_add)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::Arc;
+
+    use super::*;
+
+    #[test]
+    fn a_thread_keeps_its_shard() {
+        let first = shard_index(8);
+        assert!(first < 8);
+        assert_eq!(shard_index(8), first);
+    }
+
+    #[test]
+    fn a_counter_takes_what_every_thread_added() {
+        let counter = Arc::new(ShardedCounter::new(4));
+        let threads = (0..8)
+            .map(|_| {
+                let counter = counter.clone();
+                std::thread::spawn(move || {
+                    for _ in 0..1_000 {
+                        counter.add(1);
+                    }
+                })
+            })
+            .collect::<Vec<_>>();
+        for thread in threads {
+            thread.join().expect("recording thread");
+        }
+
+        assert_eq!(counter.take(), 8_000);
+        assert_eq!(counter.take(), 0);
+    }
+}
@@ -0,0 +1,316 @@
+//! Where a public request's time went, stage by stage.
+//!
+//! Time to first byte says a download was slow, not whether it waited on the
+//! auth backend, the memory gate or the disk. Each public HTTP and gRPC
+//! request therefore carries a [`StageTimings`] in a task-local for as long
+//! as its handler runs, and the code on the serving path adds to it through
+//! [`enter`] guards: authorization, admission (response-stream and
+//! materialization memory), manifest lookup, segment or blob open, and the
+//! first read from disk. The body transfer is timed from the response head to
+//! the end of the body.
+//!
+//! Guards outside a request scope (background work, replication) record
+//! nothing and cost a failed task-local lookup. When the request asks for it
+//! with [`SERVER_TIMING_REQUEST_HEADER`], the stages known when the head is
+//! written go back in a `Server-Timing` header; once the body is done every
+//! stage is observed in `kura_request_stage_duration_seconds` and recorded on
+//! the request span.
+
+use std::{
+    future::Future,
+    pin::Pin,
+    sync::{
+        Arc,
+        atomic::{AtomicU8, AtomicU64, Ordering},
+    },
+    task::{Context, Poll},
+    time::{Duration, Instant},
+};
+
+use bytes::Bytes;
+use http_body::{Body as HttpBody, Frame, SizeHint};
+use tracing::Span;
+
+use crate::{metrics::Metrics, state::SharedState};
+
+/// Request header that asks for a `Server-Timing` response header. Any value
+/// other than `0` or `false` turns it on.
+pub const SERVER_TIMING_REQUEST_HEADER: &str = "x-kura-server-timing";
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Stage {
+    Auth,
+    Admission,
+    Manifest,
+    SegmentOpen,
+    FirstRead,
+    Transfer,
+}
+
+const STAGES: [Stage; 6] = [
+    Stage::Auth,
+    Stage::Admission,
+    Stage::Manifest,
+    Stage::SegmentOpen,
+    Stage::FirstRead,
+    Stage::Transfer,
+];
+
+impl Stage {
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Self::Auth => "auth",
+            Self::Admission => "admission",
+            Self::Manifest => "manifest",
+            Self::SegmentOpen => "segment_open",
+            Self::FirstRead => "first_read",
+            Self::Transfer => "transfer",
+        }
+    }
+
+    /// The span field the stage is recorded under; declared on the request
+    /// spans in `http` and `reapi::admission`.
+    fn span_field(self) -> &'static str {
+        match self {
+            Self::Auth => "kura.stage.auth_ms",
+            Self::Admission => "kura.stage.admission_ms",
+            Self::Manifest => "kura.stage.manifest_ms",
+            Self::SegmentOpen => "kura.stage.segment_open_ms",
+            Self::FirstRead => "kura.stage.first_read_ms",
+            Self::Transfer => "kura.stage.transfer_ms",
+        }
+    }
+
+    fn index(self) -> usize {
+        self as usize
+    }
+}
+
+/// Time spent per stage by one request. Stages can repeat (a batch read opens
+/// several segments), so each accumulates; a stage never entered is absent
+/// rather than zero.
+#[derive(Default)]
+pub struct StageTimings {
+    spent_nanos: [AtomicU64; STAGES.len()],
+    entered: AtomicU8,
+}
+
+impl StageTimings {
+    pub fn add(&self, stage: Stage, elapsed: Duration) {
+        let nanos = u64::try_from(elapsed.as_nanos()).unwrap_or(u64::MAX);
+        self.spent_nanos[stage.index()].fetch_add(nanos, Ordering::Relaxed);
+        self.entered.fetch_or(1 << stage.index(), Ordering::Relaxed);
+    }
+
+    pub fn spent(&self, stage: Stage) -> Option<Duration> {
+        (self.entered.load(Ordering::Relaxed) & (1 << stage.index()) != 0)
+            .then(|| Duration::from_nanos(self.spent_nanos[stage.index()].load(Ordering::Relaxed)))
+    }
+
+    /// Observes every entered stage in the stage histogram.
+    pub fn observe(&self, metrics: &Metrics, transport: &'static str) {
+        for (stage, spent) in self.entered_stages() {
+            metrics.observe_request_stage(transport, stage.as_str(), spent);
+        }
+    }
+
+    fn entered_stages(&self) -> impl Iterator<Item = (Stage, Duration)> + '_ {
+        STAGES
+            .into_iter()
+            .filter_map(|stage| self.spent(stage).map(|spent| (stage, spent)))
+    }
+
+    /// The `Server-Timing` value for the stages entered so far, plus the time
+    /// from the start of the request to the response head as `total`.
+    pub fn server_timing(&self, total: Duration) -> String {
+        let mut value = String::new();
+        for (stage, spent) in self.entered_stages() {
+            value.push_str(&format!(
+                "{};dur={:.3}, ",
+                stage.as_str(),
+                spent.as_secs_f64() * 1_000.0
+            ));
+        }
+        value.push_str(&format!("total;dur={:.3}", total.as_secs_f64() * 1_000.0));
+        value
+    }
+}
+
+tokio::task_local! {
+    static CURRENT: Arc<StageTimings>;
+}
+
+/// Runs `future` with `timings` as the request's stage timings.
+pub async fn scope<F: Future>(timings: Arc<StageTimings>, future: F) -> F::Output {
+    CURRENT.scope(timings, future).await
+}
+
+/// The stage timings of the request being served, if any.
+pub fn current() -> Option<Arc<StageTimings>> {
+    CURRENT.try_with(Arc::clone).ok()
+}
+
+/// Times `stage` until the guard drops.
+pub fn enter(stage: Stage) -> StageGuard {
+    StageGuard {
+        timing: current().map(|timings| (timings, Instant::now())),
+        stage,
+    }
+}
+
+/// [`enter`] for work that has left the request's task, such as a blocking
+/// pool closure.
+pub fn enter_in(timings: Arc<StageTimings>, stage: Stage) -> StageGuard {
+    StageGuard {
+        timing: Some((timings, Instant::now())),
+        stage,
+    }
+}
+
+pub struct StageGuard {
+    timing: Option<(Arc<StageTimings>, Instant)>,
+    stage: Stage,
+}
+
+impl Drop for StageGuard {
+    fn drop(&mut self) {
+        if let Some((timings, started)) = &self.timing {
+            timings.add(self.stage, started.elapsed());
+        }
+    }
+}
+
+/// Whether the request asked for a `Server-Timing` header.
+pub fn server_timing_requested(headers: &axum::http::HeaderMap) -> bool {
+    headers
+        .get(SERVER_TIMING_REQUEST_HEADER)
+        .and_then(|value| value.to_str().ok())
+        .is_some_and(|value| !matches!(value.trim(), "0" | "false"))
+}
+
+/// Stage timings of a request whose response head is out, finished when its
+/// body ends or is dropped.
+pub struct RequestStages {
+    timings: Arc<StageTimings>,
+    state: SharedState,
+    transport: &'static str,
+    span: Span,
+    head_at: Instant,
+}
+
+impl RequestStages {
+    pub fn new(
+        timings: Arc<StageTimings>,
+        state: SharedState,
+        transport: &'static str,
+        span: Span,
+    ) -> Self {
+        Self {
+            timings,
+            state,
+            transport,
+            span,
+            head_at: Instant::now(),
+        }
+    }
+
+    fn finish(self) {
+        self.timings.add(Stage::Transfer, self.head_at.elapsed());
+        self.timings.observe(&self.state.metrics, self.transport);
+        for (stage, spent) in self.timings.entered_stages() {
+            self.span
+                .record(stage.span_field(), spent.as_secs_f64() * 1_000.0);
+        }
+    }
+}
+
+/// A response body that finishes its request's stage timings once it ends.
+pub struct StageTimedBody<B> {
+    body: B,
+    stages: Option<RequestStages>,
+}
+
+impl<B> StageTimedBody<B> {
+    pub fn new(body: B, stages: RequestStages) -> Self {
+        Self {
+            body,
+            stages: Some(stages),
+        }
+    }
+
+    fn finish(&mut self) {
+        if let Some(stages) = self.stages.take() {
+            stages.finish();
+        }
+    }
+}
+
+impl<B> Drop for StageTimedBody<B> {
+    fn drop(&mut self) {
+        self.finish();
+    }
+}
+
+impl<B> HttpBody for StageTimedBody<B>
+where
+    B: HttpBody<Data = Bytes> + Unpin,
+{
+    type Data = Bytes;
+    type Error = B::Error;
+
+    fn poll_frame(
+        mut self: Pin<&mut Self>,
+        cx: &mut Context<'_>,
+    ) -> Poll<Option<Result<Frame<Self::Data>, Self::Error>>> {
+        let polled = Pin::new(&mut self.body).poll_frame(cx);
+        if matches!(polled, Poll::Ready(None) | Poll::Ready(Some(Err(_))))
+            || self.body.is_end_stream()
+        {
+            self.finish();
+        }
+        polled
+    }
+
+    fn is_end_stream(&self) -> bool {
+        self.body.is_end_stream()
+    }
+
+    fn size_hint(&self) -> SizeHint {
+        self.body.size_hint()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[tokio::test]
+    async fn guards_record_into_the_request_in_scope_and_nowhere_else() {
+        drop(enter(Stage::Auth));
+
+        let timings = Arc::new(StageTimings::default());
+        scope(timings.clone(), async {
+            let _manifest = enter(Stage::Manifest);
+            drop(enter(Stage::SegmentOpen));
+            drop(enter(Stage::SegmentOpen));
+        })
+        .await;
+
+        assert!(timings.spent(Stage::Auth).is_none());
+        assert!(timings.spent(Stage::Manifest).is_some());
+        assert!(timings.spent(Stage::SegmentOpen).is_some());
+        assert!(timings.spent(Stage::Transfer).is_none());
+    }
+
+    #[test]
+    fn server_timing_lists_entered_stages_in_milliseconds() {
+        let timings = StageTimings::default();
+        timings.add(Stage::Auth, Duration::from_micros(1_500));
+        timings.add(Stage::FirstRead, Duration::ZERO);
+
+        assert_eq!(
+            timings.server_timing(Duration::from_millis(4)),
+            "auth;dur=1.500, first_read;dur=0.000, total;dur=4.000"
+        );
+    }
+}
@@ -20,6 +20,7 @@ use crate::{
     bandwidth::BandwidthLimiter,
     config::Config,
     constants::{REPLICATION_BACKOFF_BASE_SECS, REPLICATION_BACKOFF_MAX_SECS},
+    inflight_uploads::InflightUploads,
     io::IoController,
     memory::MemoryController,
     metrics::Metrics,
@@ -76,6 +77,8 @@ pub struct AppState {
     /// The backfill walker's node-side state machine, driven by the
     /// membership loop.
     pub backfill: Arc<BackfillLifecycle>,
+    /// Uploads staging a body right now, for reads of the same key to follow.
+    pub inflight_uploads: Arc<InflightUploads>,
 }
 
 /// One-in-flight-per-identity gate for `POST /_internal/backfill/bodies`.
@@ -429,7 +432,7 @@ impl AppState {
         if self.runtime.is_draining() || self.runtime.is_serving() {
             return;
         }
-        if self.runtime.peer_view_pending() {
+        if self.runtime.peer_view_pending() || self.runtime.is_warming() {
             return;
         }
         let snapshot = self.readiness_snapshot().await;
@@ -476,6 +479,9 @@ impl AppState {
         if self.runtime.peer_view_pending() {
             reasons.push("awaiting control-plane peer view".to_string());
         }
+        if self.runtime.is_warming() {
+            reasons.push("warming hot set from previous run".to_string());
+        }
         if !self.runtime.is_serving()
             && snapshot.initial_discovery_completed
             && !snapshot.readiness_settled
@@ -10,10 +10,12 @@ use std::{
     time::{Duration, Instant},
 };
 
+use arc_swap::ArcSwap;
 use bytes::Bytes;
 use rocksdb::{
     BlockBasedOptions, Cache, ColumnFamily, ColumnFamilyDescriptor, DB, IteratorMode, Options,
     WriteBatch, WriteBufferManager, WriteOptions,
+    statistics::{StatsLevel, Ticker},
 };
 use serde::{Deserialize, Serialize};
 use tokio::{
@@ -33,9 +35,10 @@ use crate::{
     constants::{
         ACTION_CACHE_TRUNK_SCAN_FACTOR, BACKFILL_APPLY_GROUP_RECORDS,
         BACKFILL_INDEX_BUILD_CHUNK_ROWS, BACKFILL_SEQ_STAMP_SLACK_SEQS,
-        CAS_CAPACITY_DEFAULT_DISK_PERCENT, CAS_CAPACITY_MAX_DISK_PERCENT, DESIRED_CURRENT_SEGMENTS,
-        DESIRED_NEW_SEGMENTS, DESIRED_OLD_SEGMENTS, MAX_DESIRED_SEGMENTS, MAX_MODULE_TOTAL_BYTES,
-        MAX_SEGMENT_BYTES, REAPI_ACTION_CACHE_REFRESH_DAMPING_MS, ROCKSDB_BYTES_PER_SYNC,
+        BACKFILL_TREE_REJECTED_ROWS_PER_PAGE, CAS_CAPACITY_DEFAULT_DISK_PERCENT,
+        CAS_CAPACITY_MAX_DISK_PERCENT, DESIRED_CURRENT_SEGMENTS, DESIRED_NEW_SEGMENTS,
+        DESIRED_OLD_SEGMENTS, MAX_DESIRED_SEGMENTS, MAX_MODULE_TOTAL_BYTES, MAX_SEGMENT_BYTES,
+        REAPI_ACTION_CACHE_REFRESH_DAMPING_MS, ROCKSDB_BYTES_PER_SYNC,
         ROCKSDB_CF_ACTION_CACHE_INDEX, ROCKSDB_CF_KEY_VALUE, ROCKSDB_CF_MANIFESTS,
         ROCKSDB_CF_MULTIPART_UPLOADS, ROCKSDB_CF_NAMESPACE_ARTIFACTS,
         ROCKSDB_CF_NAMESPACE_TOMBSTONES, ROCKSDB_CF_OUTBOX, ROCKSDB_CF_SEGMENT_ARTIFACTS,
@@ -49,14 +52,27 @@ use crate::{
         FOREGROUND_FILE_CACHE_DROP_INTERVAL_BYTES, FileCachePolicy, reserve_foreground_staging,
     },
     io::{IoController, PersistentFile},
-    memory::MemoryController,
+    memory::{MemoryController, PooledBuffer},
     mmap::{map_file_region, mapped_span_bytes},
+    mrc::{MissRatioCurve, MissRatioReport},
     multipart::{error::MultipartError, part::MultipartPart, upload::MultipartUpload},
-    replication::{operation::ReplicationOperation, outbox_message::OutboxMessage},
+    namespace_share::{NamespaceShareConfig, NamespaceShares},
+    readahead::{
+        READAHEAD_MAX_BLOB_BYTES, READAHEAD_MAX_BLOBS_PER_REQUEST, ReadaheadClaim,
+        ReadaheadTracker, ReadaheadTrigger, page_span,
+    },
+    replication::{
+        operation::ReplicationOperation, outbox_index::OutboxIndex, outbox_message::OutboxMessage,
+    },
     segment::{
-        generation::SegmentGeneration, reader::SegmentReader, reference::SegmentReference,
+        compression::{self, SegmentCompressionConfig},
+        direct::{self, DirectSegmentIo},
+        generation::SegmentGeneration,
+        reader::SegmentReader,
+        reference::SegmentReference,
         state::SegmentState,
     },
+    stage_timing::{self, Stage},
     usage::UsageRollup,
     utils::{
         BACKFILL_IDX_PREFIX, BACKFILL_WM_PREFIX, BackfillIndexRow, BackfillRecordKind,
@@ -65,10 +81,11 @@ use crate::{
         action_cache_index_prefix, action_cache_manifest_hash, artifact_storage_id,
         backfill_index_key, backfill_index_prefix_upper_bound, backfill_index_value,
         backfill_meta_key, backfill_wm_key, backfill_wm_prefix_upper_bound,
-        decode_backfill_index_row, decode_backfill_watermark_value, drop_staging_cache_range,
-        encode_backfill_watermark_value, module_key, namespace_artifact_index_key, now_ms,
-        segment_artifact_index_key, segment_artifact_index_prefix, segment_path, temp_file_path,
-        try_path_size_bytes,
+        cas_blob_content_address, content_index_key, content_segment_index_key,
+        content_segment_index_prefix, decode_backfill_index_row, decode_backfill_watermark_value,
+        drop_staging_cache_range, encode_backfill_watermark_value, module_key,
+        namespace_artifact_index_key, now_ms, segment_artifact_index_key,
+        segment_artifact_index_prefix, segment_path, temp_file_path, try_path_size_bytes,
     },
 };
 
@@ -97,6 +114,28 @@ pub struct ActionCacheBlobRefsBackfillStep {
     pub complete: bool,
 }
 
+// Namespace-index rows one reaper step purges per WriteBatch. Bounds both the
+// batch the RocksDB writer absorbs at once and the ids and blob paths held in
+// memory, where the single-batch delete this replaced scaled with the whole
+// namespace (millions of action-cache entries stalled the writer for seconds).
+const NAMESPACE_REAP_BATCH_ROWS: usize = 1_024;
+/// Hot-set manifests cloned per hold of the manifest cache lock, so a drain
+/// never stalls serving lookups behind tens of thousands of clones.
+const HOT_MANIFEST_CLONE_BATCH: usize = 1_024;
+const NAMESPACE_REAP_PREFIX: &str = "namespace_reap/";
+
+pub struct NamespaceReapStep {
+    pub purged: usize,
+    pub idle: bool,
+}
+
+/// What one committed purge batch leaves to clean up outside RocksDB.
+#[derive(Default)]
+struct NamespacePurge {
+    artifact_ids: Vec<String>,
+    blob_paths: Vec<String>,
+}
+
 const BACKFILL_META_BUILD_COMPLETE: &str = "build_complete";
 const BACKFILL_META_LAST_MAINTAINED_SEQ: &str = "last_maintained_seq";
 const BACKFILL_META_FORGIVEN_SEQS: &str = "forgiven_seqs";
@@ -121,8 +160,14 @@ pub struct Store {
     rocksdb_block_cache_capacity_bytes: usize,
     rocksdb_block_cache: Cache,
     rocksdb_write_buffer_manager: WriteBufferManager,
+    // Kept for its statistics handle (the write-amplification tickers).
+    rocksdb_options: Options,
     outbox_depth: AtomicUsize,
     outbox_max_depth: usize,
+    // Newest pending message per (target, namespace, artifact) and per
+    // namespace delete, rebuilt from the outbox at boot; lets the drain drop
+    // messages a later one already covers (see `outbox_message_superseded`).
+    outbox_index: StdMutex<OutboxIndex>,
     multipart_uploads: AtomicUsize,
     multipart_stored_bytes: AtomicU64,
     multipart_max_active_uploads: usize,
@@ -193,6 +238,33 @@ pub struct Store {
     // rollback-window staleness check at open). Write-path maintenance runs
     // regardless; this only gates what the listing endpoint may serve.
     backfill_index_built: AtomicBool,
+    // Tombstoned namespaces whose entries the reaper has not purged yet, keyed
+    // to the tombstone version. Reads consult it on every manifest lookup, so
+    // it is swapped wholesale rather than locked; it is empty outside the
+    // window between a namespace delete and its reap completing. Mirrors the
+    // `namespace_reap/` records, which hold the durable resume point.
+    namespace_reaps: ArcSwap<HashMap<String, u64>>,
+    // Serializes reaper steps against tombstone commits, so a re-delete that
+    // resets a namespace's reap record cannot be overwritten by a step that
+    // read the previous record.
+    namespace_reap_lock: Mutex<()>,
+    namespace_reap_notify: Notify,
+    // Per-namespace usage against fair share from the last manifest scan (see
+    // namespace_share); swapped wholesale like `namespace_reaps`, since the
+    // promotion worker and serving lookups read it per artifact.
+    namespace_share_config: NamespaceShareConfig,
+    namespace_shares: ArcSwap<NamespaceShares>,
+    segment_compression: SegmentCompressionConfig,
+    // Set when `KURA_SEGMENT_DIRECT_IO` is on and the data dir accepted a
+    // direct write at startup; appends are buffered otherwise.
+    direct_io: Option<DirectSegmentIo>,
+    readahead: ReadaheadTracker,
+    // Reuse distances of segment-ring reads (see `mrc`).
+    miss_ratio: MissRatioCurve,
+    // Test stores run no reaper task, so a delete purges inline unless a test
+    // opts into the deferred production shape.
+    #[cfg(test)]
+    namespace_reap_inline: AtomicBool,
     // WAL write accounting so tests can pin durability semantics: live apply
     // paths must keep producing sync WriteBatch commits, and only the backfill
     // batch-apply path may produce deferred (non-sync) commits plus WAL
@@ -312,6 +384,9 @@ pub struct StoreSnapshot {
     pub rocksdb_block_cache_capacity_bytes: u64,
     pub rocksdb_write_buffer_usage_bytes: u64,
     pub rocksdb_write_buffer_capacity_bytes: u64,
+    pub rocksdb_user_bytes_written: u64,
+    pub rocksdb_flush_bytes_written: u64,
+    pub rocksdb_compaction_bytes_written: u64,
 }
 
 pub enum ArtifactReader {
@@ -355,6 +430,18 @@ pub struct ManifestPage {
     pub next_after: Option<String>,
 }
 
+/// What re-warming one hot-set artifact did at boot.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum HotArtifactWarmth {
+    /// Deleted, evicted or hidden since the drain.
+    Missing,
+    /// Manifest and existence cached; no readahead (inline, over the
+    /// remaining budget, or no backing file).
+    Cached { moved: bool },
+    /// Cached, with `bytes` of readahead queued, rounded out to whole pages.
+    ReadAhead { moved: bool, bytes: u64 },
+}
+
 /// One newest-first page of the backfill per-entry index. `next_after` is the
 /// raw key of the last returned row, fed back as the next page's `after`.
 #[derive(Clone, Debug, PartialEq, Eq)]
@@ -792,6 +879,10 @@ impl Store {
         options.set_bytes_per_sync(ROCKSDB_BYTES_PER_SYNC);
         options.set_wal_bytes_per_sync(ROCKSDB_WAL_BYTES_PER_SYNC);
         options.set_write_buffer_manager(&rocksdb_write_buffer_manager);
+        // Tickers only: enough to derive write amplification (flush plus
+        // compaction bytes over user bytes) without the timer overhead.
+        options.enable_statistics();
+        options.set_statistics_level(StatsLevel::ExceptHistogramOrTimers);
 
         let cfs = vec![
             ColumnFamilyDescriptor::new(
@@ -879,6 +970,7 @@ impl Store {
         let db_path = config.data_dir.join("rocksdb");
         let db = DB::open_cf_descriptors(&options, db_path, cfs)
             .map_err(|error| format!("failed to open RocksDB: {error}"))?;
+        let rocksdb_options = options;
         io.metrics()
             .update_manifest_cache_capacity_bytes(config.manifest_cache_max_bytes);
         io.metrics().update_manifest_index_entries(0);
@@ -907,6 +999,18 @@ impl Store {
             capacity_bytes = segment_ring_limits.capacity_bytes(),
             "resolved CAS segment ring limits"
         );
+        let direct_io = if config.segment_direct_io {
+            match DirectSegmentIo::probe(&config.data_dir.join("segments")) {
+                Ok(direct_io) => Some(direct_io),
+                Err(error) => {
+                    tracing::warn!("{error}; segment appends stay buffered");
+                    None
+                }
+            }
+        } else {
+            None
+        };
+        let miss_ratio = MissRatioCurve::new(segment_ring_limits.capacity_bytes(), io.metrics());
 
         let store = Self {
             db,
@@ -920,8 +1024,10 @@ impl Store {
             rocksdb_block_cache_capacity_bytes: config.rocksdb_block_cache_bytes,
             rocksdb_block_cache,
             rocksdb_write_buffer_manager,
+            rocksdb_options,
             outbox_depth: AtomicUsize::new(0),
             outbox_max_depth: config.outbox_max_depth,
+            outbox_index: StdMutex::new(OutboxIndex::default()),
             multipart_uploads: AtomicUsize::new(0),
             multipart_stored_bytes: AtomicU64::new(0),
             multipart_max_active_uploads: config.multipart_max_active_uploads,
@@ -949,6 +1055,17 @@ impl Store {
             action_cache_eviction_cascade_enabled: config.action_cache_eviction_cascade_enabled,
             action_cache_blob_refs_ready: AtomicBool::new(false),
             backfill_index_built: AtomicBool::new(false),
+            namespace_reaps: ArcSwap::from_pointee(HashMap::new()),
+            namespace_reap_lock: Mutex::new(()),
+            namespace_reap_notify: Notify::new(),
+            namespace_share_config: config.namespace_shares.clone(),
+            namespace_shares: ArcSwap::from_pointee(NamespaceShares::default()),
+            segment_compression: config.segment_compression.clone(),
+            direct_io,
+            readahead: ReadaheadTracker::new(config.readahead_budget_bytes),
+            miss_ratio,
+            #[cfg(test)]
+            namespace_reap_inline: AtomicBool::new(true),
             wal_sync_write_count: AtomicU64::new(0),
             wal_deferred_write_count: AtomicU64::new(0),
             wal_flush_count: AtomicU64::new(0),
@@ -960,7 +1077,8 @@ impl Store {
         store.replace_segment_state_snapshot(segment_state);
         store.rederive_active_segment_max_version()?;
         store.init_backfill_index_state()?;
-        let outbox_depth = store.count_cf_entries_exact(ROCKSDB_CF_OUTBOX)?;
+        store.load_namespace_reaps()?;
+        let outbox_depth = store.load_outbox_index()?;
         store.outbox_depth.store(outbox_depth, Ordering::Release);
         let (multipart_uploads, multipart_stored_bytes) = store.reconcile_multipart_storage()?;
         store
@@ -1107,7 +1225,8 @@ impl Store {
         key: &str,
     ) -> Result<bool, String> {
         let artifact_id = artifact_storage_id(producer, &self.tenant_id, namespace_id, key);
-        if self.existence_cache_contains(&artifact_id) {
+        if !self.namespace_reap_pending(namespace_id) && self.existence_cache_contains(&artifact_id)
+        {
             return Ok(true);
         }
         match self.manifest(&artifact_id)? {
@@ -1134,7 +1253,8 @@ impl Store {
         key: &str,
     ) -> Result<bool, String> {
         let artifact_id = artifact_storage_id(producer, &self.tenant_id, namespace_id, key);
-        if self.existence_cache_contains(&artifact_id) {
+        if !self.namespace_reap_pending(namespace_id) && self.existence_cache_contains(&artifact_id)
+        {
             return Ok(true);
         }
         Ok(self.manifest(&artifact_id)?.is_some())
@@ -1156,13 +1276,19 @@ impl Store {
     }
 
     pub fn manifest(&self, artifact_id: &str) -> Result<Option<ArtifactManifest>, String> {
+        let _manifest = stage_timing::enter(Stage::Manifest);
         if let Some(manifest) = self.manifest_cache_get(artifact_id) {
             self.io.metrics().record_manifest_cache_lookup("hit");
+            if self.hidden_by_namespace_reap(&manifest) {
+                return Ok(None);
+            }
             return Ok(Some(manifest));
         }
 
         self.io.metrics().record_manifest_cache_lookup("miss");
-        let manifest = self.manifest_from_db(artifact_id)?;
+        let manifest = self
+            .manifest_from_db(artifact_id)?
+            .filter(|manifest| !self.hidden_by_namespace_reap(manifest));
         if let Some(manifest) = &manifest {
             self.maybe_cache_manifest(manifest.clone());
         }
@@ -1193,10 +1319,17 @@ impl Store {
         key: &str,
     ) -> Result<Option<ArtifactManifest>, String> {
         let artifact_id = artifact_storage_id(producer, &self.tenant_id, namespace_id, key);
-        match self.manifest(&artifact_id)? {
-            Some(manifest) => self.prepare_artifact_for_serving(manifest).await,
-            None => Ok(None),
+        let served = match self.manifest(&artifact_id)? {
+            Some(manifest) => self.prepare_artifact_for_serving(manifest).await?,
+            None => None,
+        };
+        if served.is_none() {
+            // An evicted body is the read a larger ring would have served.
+            self.miss_ratio
+                .record_miss(&artifact_id, producer, namespace_id);
         }
+        self.record_namespace_lookup(namespace_id, served.is_some());
+        Ok(served)
     }
 
     pub async fn fetch_artifact_by_id_for_serving(
@@ -1216,13 +1349,26 @@ impl Store {
         key: &str,
     ) -> Result<Option<Vec<u8>>, String> {
         let artifact_id = artifact_storage_id(producer, &self.tenant_id, namespace_id, key);
+        // The payload row outlives its tombstone until the reaper reaches it,
+        // so while a reap is pending only a visible manifest vouches for it.
+        if self.namespace_reap_pending(namespace_id) && self.manifest(&artifact_id)?.is_none() {
+            return Ok(None);
+        }
         let bytes = self.inline_bytes(&artifact_id)?;
         if bytes.is_some() {
             self.note_artifact_exists(&artifact_id);
         }
+        self.record_namespace_lookup(namespace_id, bytes.is_some());
         Ok(bytes)
     }
 
+    fn record_namespace_lookup(&self, namespace_id: &str, hit: bool) {
+        self.io.metrics().record_namespace_lookup(
+            self.namespace_shares.load().metric_label(namespace_id),
+            if hit { "hit" } else { "miss" },
+        );
+    }
+
     pub async fn persist_artifact_from_path_and_enqueue(
         &self,
         producer: ArtifactProducer,
@@ -1311,9 +1457,57 @@ impl Store {
             };
         let outbox_reservation = self.reserve_outbox_slots(spec.replication_targets.len())?;
 
-        let (location, evicted_segments, _durability_seq) = self
-            .append_to_segment(source_path, size, file_cache_policy, ApplyDurability::Sync)
-            .await?;
+        let content_address = shared_content_address(spec.producer, spec.key, size);
+        let shared = match &content_address {
+            Some(content_address) => self.shared_body_location(content_address)?,
+            None => None,
+        };
+        let shared_body = shared.is_some();
+        let (location, evicted_segments, stored_encoding) = match shared {
+            Some(location) => {
+                self.io.remove_file_if_exists(source_path).await;
+                self.io.metrics().record_content_dedup("linked", size);
+                (location, Vec::new(), None)
+            }
+            None => {
+                if content_address.is_some() {
+                    self.io.metrics().record_content_dedup("stored", size);
+                }
+                match self.compress_staged_body(&spec, source_path, size).await {
+                    Some(compressed) => {
+                        let stored_size = compressed.len() as u64;
+                        let mut body = compressed.as_slice();
+                        let appended = self
+                            .append_reader_to_segment(
+                                &mut body,
+                                stored_size,
+                                None,
+                                file_cache_policy,
+                                ApplyDurability::Sync,
+                            )
+                            .await;
+                        self.io.remove_file_if_exists(source_path).await;
+                        let (location, evicted_segments, _durability_seq) = appended?;
+                        (
+                            location,
+                            evicted_segments,
+                            Some(StoredEncoding::Zstd { stored_size }),
+                        )
+                    }
+                    None => {
+                        let (location, evicted_segments, _durability_seq) = self
+                            .append_to_segment(
+                                source_path,
+                                size,
+                                file_cache_policy,
+                                ApplyDurability::Sync,
+                            )
+                            .await?;
+                        (location, evicted_segments, None)
+                    }
+                }
+            }
+        };
 
         self.hit_failpoint(FailpointName::AfterArtifactBytesDurableBeforeMetadata)
             .await?;
@@ -1325,6 +1519,8 @@ impl Store {
                 existing.as_ref(),
                 &location,
                 size,
+                stored_encoding,
+                shared_body,
                 outbox_reservation,
             )
             .await?;
@@ -1384,11 +1580,21 @@ impl Store {
         existing: Option<&ArtifactManifest>,
         location: &SegmentLocation,
         size: u64,
+        stored_encoding: Option<StoredEncoding>,
+        shared_body: bool,
         outbox_reservation: OutboxReservation<'_>,
     ) -> Result<ArtifactManifest, String> {
         let mut batch = WriteBatch::default();
-        let manifest =
-            self.stage_segment_manifest(&mut batch, spec, artifact_id, existing, location, size)?;
+        let manifest = self.stage_segment_manifest(
+            &mut batch,
+            spec,
+            artifact_id,
+            existing,
+            location,
+            size,
+            stored_encoding,
+            shared_body,
+        )?;
         self.write_batch_sync(batch, "manifest batch")?;
         outbox_reservation.commit();
         self.note_segment_manifest_committed(&manifest, &location.segment_id)
@@ -1411,6 +1617,8 @@ impl Store {
         existing: Option<&ArtifactManifest>,
         location: &SegmentLocation,
         size: u64,
+        stored_encoding: Option<StoredEncoding>,
+        shared_body: bool,
     ) -> Result<ArtifactManifest, String> {
         let artifact_id = artifact_id.to_owned();
         let persisted_version_ms = persisted_version_ms(spec.version_ms);
@@ -1428,6 +1636,7 @@ impl Store {
             version_ms: persisted_version_ms,
             created_at_ms: persisted_version_ms,
             branch: spec.branch.map(str::to_owned),
+            stored_encoding,
         };
         let metadata = manifest.metadata(&self.tenant_id);
 
@@ -1500,12 +1709,14 @@ impl Store {
                 [],
             );
         }
+        self.stage_content_location(batch, &manifest, location);
         self.stage_backfill_index_update(batch, existing, &manifest);
         self.append_artifact_replication_messages(
             batch,
             &manifest,
             spec.replication_targets,
             spec.trunk,
+            shared_body,
         )?;
 
         Ok(manifest)
@@ -1528,6 +1739,181 @@ impl Store {
         Ok(())
     }
 
+    /// Compresses a staged body for storage when its producer is opted in and
+    /// the body looks compressible (see `segment::compression`). `None`
+    /// stores it as is. Skipped under memory pressure: the body and its
+    /// compressed copy are both held in memory for the duration.
+    async fn compress_staged_body(
+        &self,
+        spec: &PersistArtifactSpec<'_>,
+        source_path: &Path,
+        size: u64,
+    ) -> Option<Vec<u8>> {
+        if !self
+            .segment_compression
+            .should_compress(spec.producer, spec.content_type, size)
+        {
+            return None;
+        }
+        let metrics = self.io.metrics();
+        if !self.memory.allow_background_admission() {
+            metrics.record_segment_compression(spec.producer, "skipped_pressure", size, 0, None);
+            return None;
+        }
+        let path = source_path.to_path_buf();
+        let compressed = crate::tasks::spawn_blocking(move || {
+            let body = std::fs::read(&path)
+                .map_err(|error| format!("failed to read {}: {error}", path.display()))?;
+            let started = std::time::Instant::now();
+            compression::compress(&body).map(|compressed| (compressed, started.elapsed()))
+        })
+        .await
+        .map_err(|error| format!("compression task failed: {error}"))
+        .and_then(|compressed| compressed);
+        match compressed {
+            Ok((Some(compressed), elapsed)) => {
+                metrics.record_segment_compression(
+                    spec.producer,
+                    "compressed",
+                    size,
+                    compressed.len() as u64,
+                    Some(elapsed),
+                );
+                Some(compressed)
+            }
+            Ok((None, elapsed)) => {
+                metrics.record_segment_compression(
+                    spec.producer,
+                    "incompressible",
+                    size,
+                    0,
+                    Some(elapsed),
+                );
+                None
+            }
+            Err(error) => {
+                tracing::warn!(key = spec.key, "storing body uncompressed: {error}");
+                metrics.record_segment_compression(spec.producer, "error", size, 0, None);
+                None
+            }
+        }
+    }
+
+    /// Where a body with this content address can be shared from: the
+    /// indexed location, as long as its segment is still Current or New. A
+    /// body in an Old segment is left to promotion, and requiring a younger
+    /// segment leaves the whole Old stage between the link and that segment's
+    /// eviction, so a manifest never gets linked into a segment on its way out.
+    fn shared_body_location(
+        &self,
+        content_address: &str,
+    ) -> Result<Option<SegmentLocation>, String> {
+        let Some(location) = self
+            .db
+            .get_cf(
+                self.cf(ROCKSDB_CF_KEY_VALUE),
+                content_index_key(content_address).as_bytes(),
+            )
+            .map_err(|error| format!("failed to read content index: {error}"))?
+            .map(|value| decode_content_location(&value))
+            .transpose()?
+        else {
+            return Ok(None);
+        };
+        Ok(match self.segment_generation(&location.segment_id)? {
+            Some(SegmentGeneration::Current | SegmentGeneration::New) => Some(location),
+            Some(SegmentGeneration::Old) | None => None,
+        })
+    }
+
+    /// Points the content index at `location` for a REAPI CAS body. The row
+    /// carries no reference count: every manifest sharing the body has its
+    /// own `segment_artifacts` row, so evicting the segment removes all of
+    /// them together with the row, and a namespace delete only drops its own
+    /// manifests while the body stays shareable until its segment goes.
+    fn stage_content_location(
+        &self,
+        batch: &mut WriteBatch,
+        manifest: &ArtifactManifest,
+        location: &SegmentLocation,
+    ) {
+        let Some(content_address) =
+            shared_content_address(manifest.producer, &manifest.key, manifest.size)
+        else {
+            return;
+        };
+        batch.put_cf(
+            self.cf(ROCKSDB_CF_KEY_VALUE),
+            content_index_key(&content_address).as_bytes(),
+            encode_content_location(location),
+        );
+        batch.put_cf(
+            self.cf(ROCKSDB_CF_KEY_VALUE),
+            content_segment_index_key(&location.segment_id, &content_address).as_bytes(),
+            [],
+        );
+    }
+
+    /// Applies a replicated REAPI CAS blob by linking it to a body this node
+    /// already stores, so the sender does not have to upload it. `None` means
+    /// no live body with that content address is stored here and the sender
+    /// must fall back to the regular upload.
+    pub async fn apply_replicated_content_link(
+        &self,
+        producer: ArtifactProducer,
+        namespace_id: &str,
+        key: &str,
+        content_type: &str,
+        version_ms: u64,
+        branch: Option<&str>,
+        trunk: Option<&str>,
+    ) -> Result<Option<ArtifactApplyOutcome>, String> {
+        let Some((content_address, size)) = (producer == ArtifactProducer::Reapi)
+            .then(|| cas_blob_content_address(key))
+            .flatten()
+        else {
+            return Ok(None);
+        };
+        let spec = PersistArtifactSpec {
+            producer,
+            namespace_id,
+            key,
+            content_type,
+            version_ms,
+            replication_targets: &[],
+            branch,
+            trunk,
+        };
+        let artifact_id = artifact_storage_id(producer, &self.tenant_id, namespace_id, key);
+        let _write_guard = self.artifact_write_lock_for(&artifact_id).lock().await;
+        let existing = match self.segment_apply_precheck(&artifact_id, &spec).await? {
+            SegmentApplyPrecheck::Ignored { outcome, .. } => {
+                return Ok(Some(outcome.apply_outcome()));
+            }
+            SegmentApplyPrecheck::Proceed { existing, .. } => existing,
+        };
+        let Some(location) = self.shared_body_location(&content_address)? else {
+            return Ok(None);
+        };
+        let outbox_reservation = self.reserve_outbox_slots(0)?;
+        let manifest = self
+            .commit_segment_manifest(
+                &spec,
+                &artifact_id,
+                existing.as_ref(),
+                &location,
+                size,
+                None,
+                true,
+                outbox_reservation,
+            )
+            .await?;
+        self.io.metrics().record_content_dedup("linked", size);
+        Ok(Some(
+            PersistArtifactOutcome::Applied(manifest).apply_outcome(),
+        ))
+    }
+
     pub async fn open_artifact_reader(
         &self,
         manifest: &ArtifactManifest,
@@ -1540,7 +1926,8 @@ impl Store {
         &self,
         manifest: &ArtifactManifest,
     ) -> Result<Option<AcceleratedArtifactFile>, String> {
-        if manifest.inline {
+        // Encoded bodies are not the bytes the client asked for.
+        if manifest.inline || manifest.stored_encoding.is_some() {
             return Ok(None);
         }
 
@@ -1587,7 +1974,10 @@ impl Store {
         &self,
         manifest: &ArtifactManifest,
     ) -> Result<Option<Bytes>, String> {
-        if manifest.inline || manifest.size > self.memory.mmap_serving_pool_bytes() as u64 {
+        if manifest.inline
+            || manifest.stored_encoding.is_some()
+            || manifest.size > self.memory.mmap_serving_pool_bytes() as u64
+        {
             return Ok(None);
         }
 
@@ -1595,6 +1985,11 @@ impl Store {
             let offset = manifest
                 .segment_offset
                 .ok_or_else(|| "segment-backed manifest is missing segment offset".to_string())?;
+            self.note_body_read(manifest);
+            if let Some(body) = self.recent_append(segment_id, offset, manifest.size, "mmap") {
+                self.note_artifact_exists(&manifest.artifact_id);
+                return Ok(Some(body));
+            }
             let Some(requested_bytes) = mapped_span_bytes(offset, manifest.size) else {
                 return Ok(None);
             };
@@ -1614,6 +2009,7 @@ impl Store {
         }
 
         if let Some(blob_path) = &manifest.blob_path {
+            self.note_body_read(manifest);
             let Some(requested_bytes) = mapped_span_bytes(0, manifest.size) else {
                 return Ok(None);
             };
@@ -1634,6 +2030,13 @@ impl Store {
         Ok(None)
     }
 
+    /// A body still held from its direct append (see [`direct`]).
+    fn recent_append(&self, segment_id: &str, offset: u64, size: u64, path: &str) -> Option<Bytes> {
+        let body = self.direct_io.as_ref()?.recent(segment_id, offset, size)?;
+        self.io.metrics().record_segment_recent_append_hit(path);
+        Some(body)
+    }
+
     pub async fn read_artifact_bytes(
         &self,
         manifest: &ArtifactManifest,
@@ -1652,12 +2055,48 @@ impl Store {
             let offset = manifest
                 .segment_offset
                 .ok_or_else(|| "segment-backed manifest is missing segment offset".to_string())?;
-            let handle = self.segment_handle(segment_id).await?;
-            let size = manifest.size;
-            let bytes =
-                tokio::task::spawn_blocking(move || read_bytes_at(handle.as_std(), offset, size))
+            let stored_size = manifest.stored_size();
+            self.note_body_read(manifest);
+            let bytes = match manifest.stored_encoding {
+                Some(StoredEncoding::Zstd { .. }) => {
+                    // The stored body is only decompressed from, so it is read
+                    // into a pooled buffer.
+                    let stored = match self.recent_append(segment_id, offset, stored_size, "read") {
+                        Some(body) => body,
+                        None => self
+                            .read_pooled_at(
+                                self.segment_handle(segment_id).await?,
+                                offset,
+                                stored_size,
+                            )
+                            .await?
+                            .into_bytes(),
+                    };
+                    let size = manifest.size;
+                    let started = std::time::Instant::now();
+                    let bytes = crate::tasks::spawn_blocking(move || {
+                        compression::decompress(&stored, size)
+                    })
                     .await
-                    .map_err(|error| format!("failed to join segment read task: {error}"))??;
+                    .map_err(|error| format!("failed to join decompression task: {error}"))??;
+                    self.io
+                        .metrics()
+                        .observe_segment_compression_duration("decompress", started.elapsed());
+                    bytes
+                }
+                None => match self.recent_append(segment_id, offset, stored_size, "read") {
+                    Some(body) => body.to_vec(),
+                    None => {
+                        let handle = self.segment_handle(segment_id).await?;
+                        let _first_read = stage_timing::enter(Stage::FirstRead);
+                        crate::tasks::spawn_blocking(move || {
+                            read_bytes_at(handle.as_std(), offset, stored_size)
+                        })
+                        .await
+                        .map_err(|error| format!("failed to join segment read task: {error}"))??
+                    }
+                },
+            };
             self.hit_failpoint(FailpointName::AfterReadArtifactBytesBeforeReturn)
                 .await?;
             self.note_artifact_exists(&manifest.artifact_id);
@@ -1665,12 +2104,15 @@ impl Store {
         }
 
         if let Some(blob_path) = &manifest.blob_path {
+            self.note_body_read(manifest);
             let handle = self.blob_handle(blob_path).await?;
             let size = manifest.size;
+            let first_read = stage_timing::enter(Stage::FirstRead);
             let bytes =
-                tokio::task::spawn_blocking(move || read_bytes_at(handle.as_std(), 0, size))
+                crate::tasks::spawn_blocking(move || read_bytes_at(handle.as_std(), 0, size))
                     .await
                     .map_err(|error| format!("failed to join blob read task: {error}"))??;
+            drop(first_read);
             self.hit_failpoint(FailpointName::AfterReadArtifactBytesBeforeReturn)
                 .await?;
             self.note_artifact_exists(&manifest.artifact_id);
@@ -1680,6 +2122,80 @@ impl Store {
         Err("manifest does not have a readable storage location".to_string())
     }
 
+    /// [`Self::read_artifact_bytes`] into a buffer from the memory
+    /// controller's pool, for reads that are decoded and dropped rather than
+    /// moved into a response (see [`crate::memory::BufferPool`]).
+    pub async fn read_artifact_buffer(
+        &self,
+        manifest: &ArtifactManifest,
+    ) -> Result<PooledBuffer, String> {
+        if manifest.inline || manifest.stored_encoding.is_some() {
+            return self
+                .read_artifact_bytes(manifest)
+                .await
+                .map(PooledBuffer::from);
+        }
+        let buffer = if let Some(segment_id) = &manifest.segment_id {
+            let offset = manifest
+                .segment_offset
+                .ok_or_else(|| "segment-backed manifest is missing segment offset".to_string())?;
+            self.note_body_read(manifest);
+            match self.recent_append(segment_id, offset, manifest.size, "read") {
+                Some(body) => PooledBuffer::from(body.to_vec()),
+                None => {
+                    let handle = self.segment_handle(segment_id).await?;
+                    self.read_pooled_at(handle, offset, manifest.size).await?
+                }
+            }
+        } else if let Some(blob_path) = &manifest.blob_path {
+            self.note_body_read(manifest);
+            let handle = self.blob_handle(blob_path).await?;
+            self.read_pooled_at(handle, 0, manifest.size).await?
+        } else {
+            return Err("manifest does not have a readable storage location".to_string());
+        };
+        self.hit_failpoint(FailpointName::AfterReadArtifactBytesBeforeReturn)
+            .await?;
+        self.note_artifact_exists(&manifest.artifact_id);
+        Ok(buffer)
+    }
+
+    async fn read_pooled_at(
+        &self,
+        handle: Arc<PersistentFile>,
+        offset: u64,
+        size: u64,
+    ) -> Result<PooledBuffer, String> {
+        let len = usize::try_from(size)
+            .map_err(|_| format!("artifact size {size} exceeds addressable memory"))?;
+        let mut buffer = self.memory.buffer_pool().take(len);
+        let _first_read = stage_timing::enter(Stage::FirstRead);
+        crate::tasks::spawn_blocking(move || {
+            read_exact_at(handle.as_std(), offset, buffer.as_mut_slice())?;
+            Ok(buffer)
+        })
+        .await
+        .map_err(|error| format!("failed to join artifact read task: {error}"))?
+    }
+
+    /// [`Self::read_artifact_bytes_tolerating_promotion`] for
+    /// [`Self::read_artifact_buffer`].
+    pub async fn read_artifact_buffer_tolerating_promotion(
+        &self,
+        manifest: &ArtifactManifest,
+    ) -> Result<Option<PooledBuffer>, String> {
+        match self.read_artifact_buffer(manifest).await {
+            Ok(buffer) => Ok(Some(buffer)),
+            Err(first_error) => match self.manifest_from_db(&manifest.artifact_id)? {
+                Some(fresh) if fresh.segment_id != manifest.segment_id => {
+                    self.read_artifact_buffer(&fresh).await.map(Some)
+                }
+                Some(_) => Err(first_error),
+                None => Ok(None),
+            },
+        }
+    }
+
     /// Reads a served artifact's bytes, tolerating a concurrent background
     /// promotion (see [`Store::enqueue_promotion`]). A promotion can rewrite the
     /// artifact into the current segment and evict the old one between the
@@ -1763,6 +2279,18 @@ impl Store {
         let readable_bytes = manifest.size.saturating_sub(read_offset);
         let limit = read_limit.unwrap_or(readable_bytes).min(readable_bytes);
 
+        // Encoded bodies only decode whole (and are bounded in size by
+        // `SEGMENT_COMPRESSION_MAX_BYTES`), so ranges are cut from memory.
+        if manifest.stored_encoding.is_some() {
+            let bytes = self.read_artifact_bytes(manifest).await?;
+            let start = read_offset as usize;
+            let end = start.saturating_add(limit as usize).min(bytes.len());
+            return Ok(ArtifactReader::Inline {
+                bytes: Bytes::from(bytes).slice(start..end),
+                offset: 0,
+            });
+        }
+
         if manifest.inline
             && let Some(bytes) = self.inline_bytes(&manifest.artifact_id)?
         {
@@ -1802,6 +2330,7 @@ impl Store {
                 ));
             }
             self.note_artifact_exists(&manifest.artifact_id);
+            self.note_body_read(manifest);
             return Ok(ArtifactReader::FileRange(SegmentReader::new(
                 handle,
                 offset + read_offset,
@@ -1834,6 +2363,22 @@ impl Store {
         Err("manifest does not have a readable storage location".to_string())
     }
 
+    /// Opens the bytes of a segment-backed artifact as stored, without
+    /// decoding: the zstd frame of an encoded body, for clients that accept
+    /// it as is.
+    pub async fn open_stored_body_reader(
+        &self,
+        manifest: &ArtifactManifest,
+    ) -> Result<SegmentReader, String> {
+        let (Some(segment_id), Some(offset)) = (&manifest.segment_id, manifest.segment_offset)
+        else {
+            return Err("manifest is not segment-backed".to_string());
+        };
+        let handle = self.segment_handle(segment_id).await?;
+        self.note_artifact_exists(&manifest.artifact_id);
+        Ok(SegmentReader::new(handle, offset, manifest.stored_size()))
+    }
+
     async fn prepare_artifact_for_serving(
         &self,
         manifest: ArtifactManifest,
@@ -1935,10 +2480,10 @@ impl Store {
             return Ok(false);
         }
         self.note_artifact_exists(&artifact_id);
-        if let Some(segment_id) = manifest.segment_id.as_deref()
-            && self.segment_generation(segment_id)? == Some(SegmentGeneration::Old)
-        {
-            self.enqueue_promotion(&artifact_id, trigger);
+        if let Some(segment_id) = manifest.segment_id.as_deref() {
+            if self.segment_generation(segment_id)? == Some(SegmentGeneration::Old) {
+                self.enqueue_promotion(&artifact_id, trigger);
+            }
         }
         Ok(true)
     }
@@ -2025,6 +2570,15 @@ impl Store {
         if self.segment_generation(segment_id)? != Some(SegmentGeneration::Old) {
             return Ok(());
         }
+        if !trigger.extends_vouched_lifetime() {
+            let shares = self.namespace_shares.load();
+            if shares.over_share(&manifest.namespace_id) {
+                self.io.metrics().record_namespace_promotion_deferred(
+                    shares.metric_label(&manifest.namespace_id),
+                );
+                return Ok(());
+            }
+        }
         self.maybe_refresh_manifest(manifest, trigger)
             .await
             .map(|_| ())
@@ -2071,16 +2625,47 @@ impl Store {
             return Ok(None);
         }
 
-        let mut reader = self.open_manifest_reader(&current).await?;
-        let (location, evicted_segments, _durability_seq) = self
-            .append_reader_to_segment(
-                &mut reader,
-                current.size,
-                None,
-                FileCachePolicy::Adaptive,
-                ApplyDurability::Sync,
-            )
-            .await?;
+        // A REAPI CAS body another manifest already carried forward is linked
+        // rather than copied a second time.
+        let shared = match shared_content_address(current.producer, &current.key, current.size) {
+            Some(content_address) => self.shared_body_location(&content_address)?,
+            None => None,
+        };
+        let (location, evicted_segments) = match shared {
+            Some(location) => {
+                self.io
+                    .metrics()
+                    .record_content_dedup("promotion_linked", current.size);
+                (location, Vec::new())
+            }
+            // An encoded body moves as stored and keeps its encoding.
+            None if current.stored_encoding.is_some() => {
+                let mut reader = self.open_stored_body_reader(&current).await?;
+                let (location, evicted_segments, _durability_seq) = self
+                    .append_reader_to_segment(
+                        &mut reader,
+                        current.stored_size(),
+                        None,
+                        FileCachePolicy::Adaptive,
+                        ApplyDurability::Sync,
+                    )
+                    .await?;
+                (location, evicted_segments)
+            }
+            None => {
+                let mut reader = self.open_manifest_reader(&current).await?;
+                let (location, evicted_segments, _durability_seq) = self
+                    .append_reader_to_segment(
+                        &mut reader,
+                        current.size,
+                        None,
+                        FileCachePolicy::Adaptive,
+                        ApplyDurability::Sync,
+                    )
+                    .await?;
+                (location, evicted_segments)
+            }
+        };
         let mut refreshed = current.clone();
         let previous_segment_id = current_segment_id.to_owned();
         refreshed.inline = false;
@@ -2107,6 +2692,7 @@ impl Store {
             segment_artifact_index_key(&location.segment_id, &current.artifact_id).as_bytes(),
             [],
         );
+        self.stage_content_location(&mut batch, &refreshed, &location);
         self.write_batch_sync(batch, "refreshed manifest")?;
         // The promoted entry keeps its original version, which the max-only
         // stat semantics absorb without dragging the destination segment's
@@ -2260,6 +2846,7 @@ impl Store {
             version_ms: persisted_version_ms,
             created_at_ms: persisted_version_ms,
             branch: branch.map(str::to_owned),
+            stored_encoding: None,
         };
         let metadata = manifest.metadata(&self.tenant_id);
 
@@ -2337,6 +2924,7 @@ impl Store {
             &manifest,
             spec.replication_targets,
             spec.trunk,
+            false,
         )?;
 
         Ok((manifest, wrote_action_cache_index))
@@ -2411,7 +2999,19 @@ impl Store {
         // single group-commit fsync rather than serializing one fsync each.
         let (location, evicted_segments, durability_seq) = {
             let _guard = self.segment_write_lock.lock().await;
-            let (segment, evicted_segments) = self.active_segment(size).await?;
+            // Direct appends pad to a block boundary, so reserve the padded
+            // length against the segment size. Small bodies skip direct I/O
+            // rather than pay up to a block of padding each.
+            let direct_io = self
+                .direct_io
+                .as_ref()
+                .filter(|_| size >= direct::DIRECT_IO_MIN_BODY_BYTES);
+            let reserved = if direct_io.is_some() {
+                direct::align_up(size)
+            } else {
+                size
+            };
+            let (segment, evicted_segments) = self.active_segment(reserved).await?;
             let segment_path = self.segment_path(&segment.segment_id);
             let segment_dir = segment_path
                 .parent()
@@ -2419,182 +3019,338 @@ impl Store {
             self.io.create_dir_all(segment_dir).await?;
 
             let segment_already_exists = self.io.path_exists(&segment_path).await?;
-            let offset = if segment_already_exists {
+            let segment_len = if segment_already_exists {
                 self.io.metadata_len(&segment_path).await?
             } else {
                 0
             };
-
-            let mut destination = self.io.open_append_file(&segment_path).await?;
-            let mut buffer = vec![0_u8; SEGMENT_COPY_BUFFER_BYTES];
-            let mut copied = 0_u64;
-            let mut advised_through = 0_u64;
-            while copied < size {
-                let remaining = usize::try_from((size - copied).min(buffer.len() as u64))
-                    .expect("copy chunk fits usize");
-                let read = source
-                    .read(&mut buffer[..remaining])
-                    .await
-                    .map_err(|error| {
-                        format!(
-                            "failed to read source while appending into segment {}: {error}",
-                            segment_path.display()
+            let offset = match direct_io {
+                Some(direct) => {
+                    let offset = direct::align_up(segment_len);
+                    self.copy_into_segment_direct(
+                        direct,
+                        source,
+                        size,
+                        &segment.segment_id,
+                        &segment_path,
+                        offset,
+                    )
+                    .await?;
+                    if let Some(source_path) = source_cache_path
+                        && file_cache_policy.should_drop(
+                            self.memory.should_reclaim_file_cache(),
+                            self.memory.transient_reserved_bytes(),
                         )
-                    })?;
-                if read == 0 {
-                    break;
-                }
-                destination
-                    .write_all(&buffer[..read])
-                    .await
-                    .map_err(|error| {
-                        format!(
-                            "failed to append into segment {}: {error}",
-                            segment_path.display()
+                    {
+                        self.drop_source_cache(
+                            source_path,
+                            0,
+                            size,
+                            file_cache_policy,
+                            &segment_path,
                         )
-                    })?;
-                copied = copied.saturating_add(read as u64);
-
-                if copied.saturating_sub(advised_through)
-                    >= FOREGROUND_FILE_CACHE_DROP_INTERVAL_BYTES
-                    && file_cache_policy.should_drop(
-                        self.memory.should_reclaim_file_cache(),
-                        self.memory.transient_reserved_bytes(),
-                    )
-                {
-                    destination = match self
-                        .io
-                        .sync_drop_cache_and_reopen_append(
-                            destination,
-                            &segment_path,
-                            offset.saturating_add(advised_through),
-                            copied - advised_through,
-                        )
-                        .await
-                    {
-                        Ok(destination) => destination,
-                        Err(error) => {
-                            self.io
-                                .metrics()
-                                .record_memory_action("segment_file_cache_drop_failed");
-                            return Err(format!(
-                                "failed to bound segment file cache for {}: {error}",
-                                segment_path.display()
-                            ));
-                        }
-                    };
-                    if let Some(source_path) = source_cache_path
-                        && let Err(error) = self
-                            .io
-                            .drop_cached_pages(
-                                source_path,
-                                advised_through,
-                                copied - advised_through,
-                            )
-                            .await
-                    {
-                        self.io
-                            .metrics()
-                            .record_memory_action("source_file_cache_drop_failed");
-                        tracing::warn!("failed to release source file cache: {error}");
-                        if file_cache_policy.drop_failure_is_fatal() {
-                            return Err(format!(
-                                "failed to bound source file cache while appending {}: {error}",
-                                segment_path.display()
-                            ));
-                        }
+                        .await?;
                     }
-                    advised_through = copied;
-                    self.io
-                        .metrics()
-                        .record_memory_action("segment_file_cache_drop");
+                    offset
+                }
+                None => {
+                    self.copy_into_segment_buffered(
+                        source,
+                        size,
+                        source_cache_path,
+                        file_cache_policy,
+                        &segment_path,
+                        segment_len,
+                    )
+                    .await?;
+                    segment_len
                 }
+            };
+            if !segment_already_exists {
+                self.io.sync_directory(segment_dir).await?;
             }
-            if copied != size {
-                return Err(format!(
-                    "appended {copied} bytes into segment {}, expected {size}",
-                    segment_path.display()
-                ));
+
+            let durability_seq = self.pending_seq.fetch_add(1, Ordering::AcqRel) + 1;
+            (
+                SegmentLocation {
+                    segment_id: segment.segment_id,
+                    offset,
+                },
+                evicted_segments,
+                durability_seq,
+            )
+        };
+
+        if durability == ApplyDurability::Sync {
+            self.ensure_segment_durable(durability_seq).await?;
+        }
+
+        Ok((location, evicted_segments, durability_seq))
+    }
+
+    /// Copies `size` bytes from `source` to the end of a segment through the
+    /// page cache, syncing and dropping the written range as it goes whenever
+    /// `file_cache_policy` asks for it.
+    async fn copy_into_segment_buffered<R>(
+        &self,
+        source: &mut R,
+        size: u64,
+        source_cache_path: Option<&Path>,
+        file_cache_policy: FileCachePolicy,
+        segment_path: &Path,
+        offset: u64,
+    ) -> Result<(), String>
+    where
+        R: AsyncRead + Unpin,
+    {
+        let mut destination = self.io.open_append_file(segment_path).await?;
+        let mut buffer = vec![0_u8; SEGMENT_COPY_BUFFER_BYTES];
+        let mut copied = 0_u64;
+        let mut advised_through = 0_u64;
+        while copied < size {
+            let remaining = usize::try_from((size - copied).min(buffer.len() as u64))
+                .expect("copy chunk fits usize");
+            let read = source
+                .read(&mut buffer[..remaining])
+                .await
+                .map_err(|error| {
+                    format!(
+                        "failed to read source while appending into segment {}: {error}",
+                        segment_path.display()
+                    )
+                })?;
+            if read == 0 {
+                break;
             }
-            destination.flush().await.map_err(|error| {
-                format!(
-                    "failed to flush segment {}: {error}",
-                    segment_path.display()
-                )
-            })?;
-            let drop_final_range = copied > advised_through
+            destination
+                .write_all(&buffer[..read])
+                .await
+                .map_err(|error| {
+                    format!(
+                        "failed to append into segment {}: {error}",
+                        segment_path.display()
+                    )
+                })?;
+            copied = copied.saturating_add(read as u64);
+
+            if copied.saturating_sub(advised_through) >= FOREGROUND_FILE_CACHE_DROP_INTERVAL_BYTES
                 && file_cache_policy.should_drop(
                     self.memory.should_reclaim_file_cache(),
                     self.memory.transient_reserved_bytes(),
-                );
-            if drop_final_range {
-                destination.sync_data().await.map_err(|error| {
-                    format!("failed to sync segment {}: {error}", segment_path.display())
-                })?;
-                drop(destination);
-                if let Err(error) = self
+                )
+            {
+                destination = match self
                     .io
-                    .drop_cached_pages(
-                        &segment_path,
+                    .sync_drop_cache_and_reopen_append(
+                        destination,
+                        segment_path,
                         offset.saturating_add(advised_through),
                         copied - advised_through,
                     )
                     .await
                 {
-                    self.io
-                        .metrics()
-                        .record_memory_action("segment_file_cache_drop_failed");
-                    tracing::warn!(
-                        path = %segment_path.display(),
-                        "failed to release segment file cache: {error}"
-                    );
-                    if file_cache_policy.drop_failure_is_fatal() {
+                    Ok(destination) => destination,
+                    Err(error) => {
+                        self.io
+                            .metrics()
+                            .record_memory_action("segment_file_cache_drop_failed");
                         return Err(format!(
                             "failed to bound segment file cache for {}: {error}",
                             segment_path.display()
                         ));
                     }
+                };
+                if let Some(source_path) = source_cache_path {
+                    self.drop_source_cache(
+                        source_path,
+                        advised_through,
+                        copied - advised_through,
+                        file_cache_policy,
+                        segment_path,
+                    )
+                    .await?;
                 }
-                if let Some(source_path) = source_cache_path
-                    && let Err(error) = self
-                        .io
-                        .drop_cached_pages(source_path, advised_through, copied - advised_through)
-                        .await
+                advised_through = copied;
+                self.io
+                    .metrics()
+                    .record_memory_action("segment_file_cache_drop");
+            }
+        }
+        if copied != size {
+            return Err(format!(
+                "appended {copied} bytes into segment {}, expected {size}",
+                segment_path.display()
+            ));
+        }
+        destination.flush().await.map_err(|error| {
+            format!(
+                "failed to flush segment {}: {error}",
+                segment_path.display()
+            )
+        })?;
+        let drop_final_range = copied > advised_through
+            && file_cache_policy.should_drop(
+                self.memory.should_reclaim_file_cache(),
+                self.memory.transient_reserved_bytes(),
+            );
+        if drop_final_range {
+            destination.sync_data().await.map_err(|error| {
+                format!("failed to sync segment {}: {error}", segment_path.display())
+            })?;
+            drop(destination);
+            if let Err(error) = self
+                .io
+                .drop_cached_pages(
+                    segment_path,
+                    offset.saturating_add(advised_through),
+                    copied - advised_through,
+                )
+                .await
+            {
+                self.io
+                    .metrics()
+                    .record_memory_action("segment_file_cache_drop_failed");
+                tracing::warn!(
+                    path = %segment_path.display(),
+                    "failed to release segment file cache: {error}"
+                );
+                if file_cache_policy.drop_failure_is_fatal() {
+                    return Err(format!(
+                        "failed to bound segment file cache for {}: {error}",
+                        segment_path.display()
+                    ));
+                }
+            }
+            if let Some(source_path) = source_cache_path {
+                self.drop_source_cache(
+                    source_path,
+                    advised_through,
+                    copied - advised_through,
+                    file_cache_policy,
+                    segment_path,
+                )
+                .await?;
+            }
+        } else {
+            drop(destination);
+        }
+        Ok(())
+    }
+
+    /// Copies `size` bytes from `source` into a segment at the block-aligned
+    /// `offset` with direct writes, zero-padding the last block (see
+    /// [`direct`]). Small bodies are kept for reads that follow right away.
+    /// The pooled buffer goes back to the pool on every path that keeps it.
+    async fn copy_into_segment_direct<R>(
+        &self,
+        direct: &DirectSegmentIo,
+        source: &mut R,
+        size: u64,
+        segment_id: &str,
+        segment_path: &Path,
+        offset: u64,
+    ) -> Result<(), String>
+    where
+        R: AsyncRead + Unpin,
+    {
+        let destination = Arc::new(self.io.open_direct_write_file(segment_path).await?);
+        let mut buffer = direct.take_buffer();
+        let mut recent = (size <= direct::RECENT_APPEND_MAX_BODY_BYTES)
+            .then(|| Vec::with_capacity(size as usize));
+        let mut copied = 0_u64;
+        let mut written = 0_u64;
+        while copied < size {
+            let mut filled = 0_usize;
+            while filled < buffer.capacity() && copied < size {
+                let remaining =
+                    usize::try_from((size - copied).min((buffer.capacity() - filled) as u64))
+                        .expect("copy chunk fits usize");
+                let read = match source
+                    .read(&mut buffer.as_mut_slice()[filled..filled + remaining])
+                    .await
                 {
-                    self.io
-                        .metrics()
-                        .record_memory_action("source_file_cache_drop_failed");
-                    tracing::warn!("failed to release source file cache: {error}");
-                    if file_cache_policy.drop_failure_is_fatal() {
+                    Ok(read) => read,
+                    Err(error) => {
+                        direct.return_buffer(buffer);
                         return Err(format!(
-                            "failed to bound source file cache while appending {}: {error}",
+                            "failed to read source while appending into segment {}: {error}",
                             segment_path.display()
                         ));
                     }
+                };
+                if read == 0 {
+                    break;
                 }
-            } else {
-                drop(destination);
+                filled += read;
+                copied = copied.saturating_add(read as u64);
             }
-            if !segment_already_exists {
-                self.io.sync_directory(segment_dir).await?;
+            if filled == 0 {
+                break;
             }
-
-            let durability_seq = self.pending_seq.fetch_add(1, Ordering::AcqRel) + 1;
-            (
-                SegmentLocation {
-                    segment_id: segment.segment_id,
-                    offset,
-                },
-                evicted_segments,
-                durability_seq,
-            )
-        };
-
-        if durability == ApplyDurability::Sync {
-            self.ensure_segment_durable(durability_seq).await?;
+            if let Some(recent) = recent.as_mut() {
+                recent.extend_from_slice(&buffer.as_slice()[..filled]);
+            }
+            let block_len = direct::align_up(filled as u64) as usize;
+            buffer.as_mut_slice()[filled..block_len].fill(0);
+            let position = offset + written;
+            let file = destination.clone();
+            let (returned, result) = crate::tasks::spawn_blocking(move || {
+                let result =
+                    direct::write_all_at(file.as_std(), &buffer.as_slice()[..block_len], position);
+                (buffer, result)
+            })
+            .await
+            .map_err(|error| format!("failed to join direct segment write task: {error}"))?;
+            buffer = returned;
+            if let Err(error) = result {
+                direct.return_buffer(buffer);
+                return Err(format!(
+                    "failed to append into segment {}: {error}",
+                    segment_path.display()
+                ));
+            }
+            written += block_len as u64;
+            self.io
+                .metrics()
+                .record_segment_direct_write(filled as u64, (block_len - filled) as u64);
+            if filled < buffer.capacity() {
+                break;
+            }
+        }
+        direct.return_buffer(buffer);
+        if copied != size {
+            return Err(format!(
+                "appended {copied} bytes into segment {}, expected {size}",
+                segment_path.display()
+            ));
+        }
+        if let Some(recent) = recent {
+            direct.remember(segment_id, offset, Bytes::from(recent));
         }
+        Ok(())
+    }
 
-        Ok((location, evicted_segments, durability_seq))
+    async fn drop_source_cache(
+        &self,
+        source_path: &Path,
+        offset: u64,
+        length: u64,
+        file_cache_policy: FileCachePolicy,
+        segment_path: &Path,
+    ) -> Result<(), String> {
+        if let Err(error) = self.io.drop_cached_pages(source_path, offset, length).await {
+            self.io
+                .metrics()
+                .record_memory_action("source_file_cache_drop_failed");
+            tracing::warn!("failed to release source file cache: {error}");
+            if file_cache_policy.drop_failure_is_fatal() {
+                return Err(format!(
+                    "failed to bound source file cache while appending {}: {error}",
+                    segment_path.display()
+                ));
+            }
+        }
+        Ok(())
     }
 
     /// Group-commit fsync: makes every append with sequence `<= seq` durable.
@@ -2903,6 +3659,7 @@ impl Store {
         let mut saw_entries = false;
         let mut removed_artifacts = BTreeMap::<ArtifactProducer, u64>::new();
         let mut removed_artifact_ids = Vec::new();
+        let mut removed_namespace_bytes = HashMap::<String, u64>::new();
         // The cascade is engaged whenever the operator has it enabled. It acts on
         // whatever reverse rows exist, so coverage grows as entries are written;
         // the serve-side presence gates remain the safety net for the rest.
@@ -2948,6 +3705,9 @@ impl Store {
                         )?;
                     }
                     *removed_artifacts.entry(manifest.producer).or_default() += 1;
+                    *removed_namespace_bytes
+                        .entry(manifest.namespace_id)
+                        .or_default() += manifest.stored_size();
                     removed_artifact_ids.push(artifact_id);
                 }
                 Some(_) | None => {
@@ -2956,10 +3716,12 @@ impl Store {
             }
         }
 
+        self.stage_content_index_eviction(&mut batch, segment_id)?;
+
+        self.db
+            .write(batch)
+            .map_err(|error| format!("failed to evict segment metadata: {error}"))?;
         if saw_entries {
-            self.db
-                .write(batch)
-                .map_err(|error| format!("failed to evict segment metadata: {error}"))?;
             self.remove_manifest_cache_keys(&removed_artifact_ids);
             if !cascaded_entries.is_empty() {
                 let cascaded_ids: Vec<String> = cascaded_entries.iter().cloned().collect();
@@ -2980,6 +3742,9 @@ impl Store {
             }
         }
         self.remove_segment_handle(segment_id).await;
+        if let Some(direct) = &self.direct_io {
+            direct.forget_segment(segment_id);
+        }
         self.io
             .remove_file_if_exists(&self.segment_path(segment_id))
             .await;
@@ -2990,7 +3755,49 @@ impl Store {
                 .metrics()
                 .record_segment_eviction(producer, "ok", artifacts);
         }
+        let shares = self.namespace_shares.load();
+        for (namespace_id, bytes) in removed_namespace_bytes {
+            self.io
+                .metrics()
+                .record_namespace_evicted_bytes(shares.metric_label(&namespace_id), bytes);
+        }
+
+        Ok(())
+    }
 
+    /// Drops the content index rows pointing into an evicted segment. A row
+    /// that has since moved to a younger copy only loses its per-segment
+    /// mirror.
+    fn stage_content_index_eviction(
+        &self,
+        batch: &mut WriteBatch,
+        segment_id: &str,
+    ) -> Result<(), String> {
+        let prefix = content_segment_index_prefix(segment_id);
+        let iter = self.db.iterator_cf(
+            self.cf(ROCKSDB_CF_KEY_VALUE),
+            IteratorMode::From(prefix.as_bytes(), rocksdb::Direction::Forward),
+        );
+        for item in iter {
+            let (index_key, _) =
+                item.map_err(|error| format!("failed to iterate content index: {error}"))?;
+            if !index_key.starts_with(prefix.as_bytes()) {
+                break;
+            }
+            batch.delete_cf(self.cf(ROCKSDB_CF_KEY_VALUE), &index_key);
+            let content_address = std::str::from_utf8(&index_key[prefix.len()..])
+                .map_err(|error| format!("invalid content index key: {error}"))?;
+            let content_key = content_index_key(content_address);
+            let points_here = self
+                .db
+                .get_cf(self.cf(ROCKSDB_CF_KEY_VALUE), content_key.as_bytes())
+                .map_err(|error| format!("failed to read content index: {error}"))?
+                .and_then(|value| decode_content_location(&value).ok())
+                .is_none_or(|location| location.segment_id == segment_id);
+            if points_here {
+                batch.delete_cf(self.cf(ROCKSDB_CF_KEY_VALUE), content_key.as_bytes());
+            }
+        }
         Ok(())
     }
 
@@ -3188,6 +3995,7 @@ impl Store {
         path: &Path,
         storage_kind: &'static str,
     ) -> Result<Arc<PersistentFile>, String> {
+        let _segment_open = stage_timing::enter(Stage::SegmentOpen);
         if let Some(handle) = self.segment_handle_cache_get(&cache_key).await {
             self.io.metrics().record_segment_handle_cache_lookup("hit");
             return Ok(handle);
@@ -3749,6 +4557,8 @@ impl Store {
                                 existing.as_ref(),
                                 &staged.location,
                                 staged.size,
+                                None,
+                                false,
                             )?;
                             committed.push(CommittedGroupRecord::Segmented {
                                 manifest,
@@ -3867,75 +4677,268 @@ impl Store {
         version_ms: u64,
         replication_targets: &[String],
     ) -> Result<NamespaceDeleteOutcome, String> {
-        let prefix = format!("{namespace_id}\0");
-        let mut batch = WriteBatch::default();
-        let mut blob_paths = Vec::new();
-        let mut removed_artifact_ids = Vec::new();
-        let delete_everything = version_ms == 0;
-
         self.hit_failpoint(FailpointName::BeforeApplyReplicatedTombstone)
             .await?;
+        if version_ms == 0 {
+            self.purge_namespace(namespace_id).await?;
+            self.hit_failpoint(FailpointName::AfterApplyReplicatedTombstone)
+                .await?;
+            return Ok(NamespaceDeleteOutcome::Applied);
+        }
+
+        let reap_guard = self.namespace_reap_lock.lock().await;
         let previous_tombstone = self.namespace_tombstone_version(namespace_id)?;
-        if !delete_everything
-            && let Some(current_tombstone) = previous_tombstone
+        if let Some(current_tombstone) = previous_tombstone
             && current_tombstone >= version_ms
         {
             return Ok(NamespaceDeleteOutcome::IgnoredOlder);
         }
-        let outbox_reservation = self.reserve_outbox_slots(if delete_everything {
-            0
-        } else {
-            replication_targets.len()
-        })?;
-        if !delete_everything {
-            batch.put_cf(
-                self.cf(ROCKSDB_CF_NAMESPACE_TOMBSTONES),
-                namespace_id.as_bytes(),
-                version_ms.to_le_bytes(),
-            );
-            // A re-delete overwrites the tombstone in place, so its previous
-            // backfill index row (keyed by the old version) goes with it.
-            if let Some(previous_version_ms) = previous_tombstone {
-                batch.delete_cf(
-                    self.cf(ROCKSDB_CF_KEY_VALUE),
-                    backfill_index_key(
-                        previous_version_ms,
-                        BackfillRecordKind::NamespaceTombstone,
-                        namespace_id,
-                    ),
-                );
-            }
-            batch.put_cf(
+        let outbox_reservation = self.reserve_outbox_slots(replication_targets.len())?;
+        let mut batch = WriteBatch::default();
+        batch.put_cf(
+            self.cf(ROCKSDB_CF_NAMESPACE_TOMBSTONES),
+            namespace_id.as_bytes(),
+            version_ms.to_le_bytes(),
+        );
+        // A re-delete overwrites the tombstone in place, so its previous
+        // backfill index row (keyed by the old version) goes with it.
+        if let Some(previous_version_ms) = previous_tombstone {
+            batch.delete_cf(
                 self.cf(ROCKSDB_CF_KEY_VALUE),
                 backfill_index_key(
-                    version_ms,
+                    previous_version_ms,
                     BackfillRecordKind::NamespaceTombstone,
                     namespace_id,
                 ),
-                backfill_index_value(None),
             );
         }
-
-        let iter = self.db.iterator_cf(
-            self.cf(ROCKSDB_CF_NAMESPACE_ARTIFACTS),
-            IteratorMode::From(prefix.as_bytes(), rocksdb::Direction::Forward),
+        batch.put_cf(
+            self.cf(ROCKSDB_CF_KEY_VALUE),
+            backfill_index_key(
+                version_ms,
+                BackfillRecordKind::NamespaceTombstone,
+                namespace_id,
+            ),
+            backfill_index_value(None),
         );
-
-        for item in iter {
-            let (index_key, _) =
+        // Tombstone first: the entries themselves are purged by the reaper in
+        // bounded batches, resuming from this record. A re-delete restarts the
+        // walk from the top, since entries the previous walk kept as newer
+        // than its tombstone may be covered by this one.
+        batch.put_cf(
+            self.cf(ROCKSDB_CF_KEY_VALUE),
+            namespace_reap_key(namespace_id).as_bytes(),
+            encode_namespace_reap_record(version_ms, None),
+        );
+        // Reset the action-cache index migration: surviving newer manifests
+        // keep their rows, but a wiped namespace must re-backfill rather than
+        // trust a marker written for the deleted keyspace.
+        batch.delete_cf(
+            self.cf(ROCKSDB_CF_KEY_VALUE),
+            Self::action_cache_index_marker_key(namespace_id).as_bytes(),
+        );
+        self.append_namespace_delete_messages(
+            &mut batch,
+            namespace_id,
+            version_ms,
+            replication_targets,
+        )?;
+
+        self.write_batch_sync(batch, "delete namespace batch")?;
+        outbox_reservation.commit();
+        self.note_namespace_reap(namespace_id, version_ms);
+        drop(reap_guard);
+
+        self.hit_failpoint(FailpointName::AfterApplyReplicatedTombstone)
+            .await?;
+        self.wake_namespace_reaper().await?;
+
+        Ok(NamespaceDeleteOutcome::Applied)
+    }
+
+    /// The legacy `version_ms == 0` purge: removes every entry of the
+    /// namespace whatever its version, without a tombstone, so there is
+    /// nothing for reads to filter against and the purge runs to completion
+    /// before returning. It still commits in bounded batches.
+    async fn purge_namespace(&self, namespace_id: &str) -> Result<(), String> {
+        let mut after = None;
+        loop {
+            let mut batch = WriteBatch::default();
+            let mut purged = NamespacePurge::default();
+            after = self.stage_namespace_purge_rows(
+                &mut batch,
+                namespace_id,
+                None,
+                after.as_deref(),
+                NAMESPACE_REAP_BATCH_ROWS,
+                &mut purged,
+            )?;
+            if after.is_none() {
+                batch.delete_cf(
+                    self.cf(ROCKSDB_CF_KEY_VALUE),
+                    Self::action_cache_index_marker_key(namespace_id).as_bytes(),
+                );
+            }
+            self.write_batch_sync(batch, "purge namespace batch")?;
+            self.release_namespace_purge(purged).await;
+            if after.is_none() {
+                return Ok(());
+            }
+        }
+    }
+
+    /// One bounded reaper step: purges up to [`NAMESPACE_REAP_BATCH_ROWS`]
+    /// namespace-index rows of a namespace with a pending reap, persisting the
+    /// resume point in the same WriteBatch so a restart continues from the
+    /// last committed step. Reports `idle` when no reap is pending.
+    pub async fn reap_namespace_tombstones_step(&self) -> Result<NamespaceReapStep, String> {
+        let reap_guard = self.namespace_reap_lock.lock().await;
+        let Some(namespace_id) = self.namespace_reaps.load().keys().next().cloned() else {
+            return Ok(NamespaceReapStep {
+                purged: 0,
+                idle: true,
+            });
+        };
+        let reap_key = namespace_reap_key(&namespace_id);
+        let record = self
+            .db
+            .get_cf(self.cf(ROCKSDB_CF_KEY_VALUE), reap_key.as_bytes())
+            .map_err(|error| format!("failed to read namespace reap record: {error}"))?;
+        let Some((version_ms, after)) = record.as_deref().and_then(decode_namespace_reap_record)
+        else {
+            self.db
+                .delete_cf(self.cf(ROCKSDB_CF_KEY_VALUE), reap_key.as_bytes())
+                .map_err(|error| format!("failed to drop namespace reap record: {error}"))?;
+            self.forget_namespace_reap(&namespace_id);
+            return Err(format!(
+                "namespace reap record for {namespace_id} is missing or malformed"
+            ));
+        };
+
+        let mut batch = WriteBatch::default();
+        let mut purged = NamespacePurge::default();
+        let next_after = self.stage_namespace_purge_rows(
+            &mut batch,
+            &namespace_id,
+            Some(version_ms),
+            after.as_deref(),
+            NAMESPACE_REAP_BATCH_ROWS,
+            &mut purged,
+        )?;
+        match next_after.as_deref() {
+            Some(next_after) => batch.put_cf(
+                self.cf(ROCKSDB_CF_KEY_VALUE),
+                reap_key.as_bytes(),
+                encode_namespace_reap_record(version_ms, Some(next_after)),
+            ),
+            None => {
+                batch.delete_cf(self.cf(ROCKSDB_CF_KEY_VALUE), reap_key.as_bytes());
+                // Rows the index migration re-added for not-yet-reaped entries
+                // are gone now, so its marker must not outlive them either.
+                batch.delete_cf(
+                    self.cf(ROCKSDB_CF_KEY_VALUE),
+                    Self::action_cache_index_marker_key(&namespace_id).as_bytes(),
+                );
+            }
+        }
+        self.write_batch_sync(batch, "namespace reap batch")?;
+        // Cached manifests of the purged rows go before the namespace leaves
+        // the pending set, which is what hides them until then.
+        self.remove_manifest_cache_keys(&purged.artifact_ids);
+        if next_after.is_none() {
+            self.forget_namespace_reap(&namespace_id);
+        }
+        drop(reap_guard);
+
+        let purged_rows = self.release_namespace_purge(purged).await;
+        self.io
+            .metrics()
+            .record_namespace_reaped_entries(purged_rows as u64);
+        if next_after.is_none() {
+            tracing::info!(
+                namespace_id,
+                version_ms,
+                "namespace tombstone reap complete"
+            );
+        }
+        Ok(NamespaceReapStep {
+            purged: purged_rows,
+            idle: false,
+        })
+    }
+
+    /// Purges tombstoned namespaces step by step for the life of the process,
+    /// parking until a delete commits a new tombstone. Spawned once at boot;
+    /// reaps left pending by a previous process resume immediately.
+    pub async fn run_namespace_reaper(&self) {
+        loop {
+            match self.reap_namespace_tombstones_step().await {
+                Ok(step) if step.idle => self.namespace_reap_notify.notified().await,
+                Ok(_) => {
+                    self.memory.wait_for_background_headroom().await;
+                    tokio::task::yield_now().await;
+                }
+                Err(error) => {
+                    tracing::warn!(error, "namespace reap step failed");
+                    tokio::time::sleep(Duration::from_secs(1)).await;
+                }
+            }
+        }
+    }
+
+    /// Stages the purge of up to `limit` namespace-index rows after `after`.
+    /// Every manifest at or below `version_ms` (every manifest, for the legacy
+    /// `None` purge) loses its manifest, index rows, inline payload and
+    /// segment reference; newer manifests survived the tombstone and are
+    /// stepped over. Returns the last artifact id visited, or `None` once the
+    /// namespace prefix is exhausted.
+    fn stage_namespace_purge_rows(
+        &self,
+        batch: &mut WriteBatch,
+        namespace_id: &str,
+        version_ms: Option<u64>,
+        after: Option<&str>,
+        limit: usize,
+        purged: &mut NamespacePurge,
+    ) -> Result<Option<String>, String> {
+        let prefix = format!("{namespace_id}\0");
+        let start = match after {
+            Some(after) => format!("{prefix}{after}"),
+            None => prefix.clone(),
+        };
+        let iter = self.db.iterator_cf(
+            self.cf(ROCKSDB_CF_NAMESPACE_ARTIFACTS),
+            IteratorMode::From(start.as_bytes(), rocksdb::Direction::Forward),
+        );
+
+        let mut visited = 0_usize;
+        let mut last_visited = None;
+        for item in iter {
+            let (index_key, _) =
                 item.map_err(|error| format!("failed to iterate namespace index: {error}"))?;
             if !index_key.starts_with(prefix.as_bytes()) {
-                break;
+                return Ok(None);
+            }
+            if after.is_some() && *index_key == *start.as_bytes() {
+                continue;
+            }
+            if visited == limit {
+                return Ok(last_visited);
             }
+            visited += 1;
 
             let artifact_id = std::str::from_utf8(&index_key[prefix.len()..])
                 .map_err(|error| format!("invalid namespace index key: {error}"))?
                 .to_owned();
 
-            if let Some(manifest) = self.manifest_from_db(&artifact_id)? {
-                if !delete_everything && manifest_version_ms(&manifest) > version_ms {
-                    continue;
-                }
+            let manifest = self.manifest_from_db(&artifact_id)?;
+            if let Some(manifest) = &manifest
+                && version_ms.is_some_and(|version_ms| manifest_version_ms(manifest) > version_ms)
+            {
+                last_visited = Some(artifact_id);
+                continue;
+            }
+            if let Some(manifest) = manifest {
                 if manifest.inline {
                     batch.delete_cf(self.cf(ROCKSDB_CF_KEY_VALUE), artifact_id.as_bytes());
                 }
@@ -3958,7 +4961,7 @@ impl Store {
                     // above commits.
                     if let Some(action_result_bytes) = self.inline_bytes(&artifact_id)? {
                         self.stage_action_cache_blob_refs_delete(
-                            &mut batch,
+                            batch,
                             namespace_id,
                             &artifact_id,
                             &action_result_bytes,
@@ -3967,9 +4970,9 @@ impl Store {
                 }
                 // Covers the `version_ms == 0` purge branch too: every removed
                 // manifest — whatever its version — loses its index row here.
-                self.stage_backfill_index_delete(&mut batch, &manifest);
+                self.stage_backfill_index_delete(batch, &manifest);
                 if let Some(blob_path) = manifest.blob_path {
-                    blob_paths.push(blob_path);
+                    purged.blob_paths.push(blob_path);
                 }
                 if let Some(segment_id) = manifest.segment_id {
                     batch.delete_cf(
@@ -3979,41 +4982,125 @@ impl Store {
                 }
             }
 
-            batch.delete_cf(self.cf(ROCKSDB_CF_NAMESPACE_ARTIFACTS), index_key);
+            batch.delete_cf(self.cf(ROCKSDB_CF_NAMESPACE_ARTIFACTS), &index_key);
             batch.delete_cf(self.cf(ROCKSDB_CF_MANIFESTS), artifact_id.as_bytes());
-            removed_artifact_ids.push(artifact_id);
+            purged.artifact_ids.push(artifact_id.clone());
+            last_visited = Some(artifact_id);
         }
+        Ok(None)
+    }
 
-        // Reset the action-cache index migration: surviving newer manifests
-        // keep their rows, but a wiped namespace must re-backfill rather than
-        // trust a marker written for the deleted keyspace.
-        batch.delete_cf(
+    /// Drops what a committed purge batch leaves behind outside RocksDB: the
+    /// cached manifests and existence entries of its artifacts and any legacy
+    /// blob files. Returns how many entries the batch purged.
+    async fn release_namespace_purge(&self, purged: NamespacePurge) -> usize {
+        self.remove_manifest_cache_keys(&purged.artifact_ids);
+        for path in purged.blob_paths {
+            self.remove_blob_handle(&path).await;
+            self.io.remove_file_if_exists(Path::new(&path)).await;
+        }
+        purged.artifact_ids.len()
+    }
+
+    /// Seeds the pending-reap set from the `namespace_reap/` records at open,
+    /// so tombstones a previous process had not finished reaping keep hiding
+    /// their entries and the reaper resumes them.
+    fn load_namespace_reaps(&self) -> Result<(), String> {
+        let iter = self.db.iterator_cf(
             self.cf(ROCKSDB_CF_KEY_VALUE),
-            Self::action_cache_index_marker_key(namespace_id).as_bytes(),
+            IteratorMode::From(
+                NAMESPACE_REAP_PREFIX.as_bytes(),
+                rocksdb::Direction::Forward,
+            ),
         );
-
-        if !delete_everything {
-            self.append_namespace_delete_messages(
-                &mut batch,
-                namespace_id,
-                version_ms,
-                replication_targets,
-            )?;
+        let mut reaps = HashMap::new();
+        for item in iter {
+            let (key, value) =
+                item.map_err(|error| format!("failed to iterate namespace reaps: {error}"))?;
+            let Some(namespace_id) = key.strip_prefix(NAMESPACE_REAP_PREFIX.as_bytes()) else {
+                break;
+            };
+            let namespace_id = std::str::from_utf8(namespace_id)
+                .map_err(|error| format!("invalid namespace reap key: {error}"))?;
+            let Some((version_ms, _)) = decode_namespace_reap_record(&value) else {
+                return Err(format!(
+                    "namespace reap record for {namespace_id} is malformed"
+                ));
+            };
+            reaps.insert(namespace_id.to_owned(), version_ms);
+        }
+        if !reaps.is_empty() {
+            tracing::info!(
+                namespaces = reaps.len(),
+                "resuming namespace tombstone reaps"
+            );
         }
+        self.io
+            .metrics()
+            .update_namespace_reaps_pending(reaps.len());
+        self.namespace_reaps.store(Arc::new(reaps));
+        Ok(())
+    }
 
-        self.write_batch_sync(batch, "delete namespace batch")?;
-        outbox_reservation.commit();
-        self.remove_manifest_cache_keys(&removed_artifact_ids);
+    fn note_namespace_reap(&self, namespace_id: &str, version_ms: u64) {
+        let previous = self.namespace_reaps.rcu(|reaps| {
+            let mut reaps = (**reaps).clone();
+            reaps.insert(namespace_id.to_owned(), version_ms);
+            reaps
+        });
+        let pending = previous.len() + usize::from(!previous.contains_key(namespace_id));
+        self.io.metrics().update_namespace_reaps_pending(pending);
+    }
 
-        for path in blob_paths {
-            self.remove_blob_handle(&path).await;
-            self.io.remove_file_if_exists(Path::new(&path)).await;
-        }
+    fn forget_namespace_reap(&self, namespace_id: &str) {
+        let previous = self.namespace_reaps.rcu(|reaps| {
+            let mut reaps = (**reaps).clone();
+            reaps.remove(namespace_id);
+            reaps
+        });
+        let pending = previous.len() - usize::from(previous.contains_key(namespace_id));
+        self.io.metrics().update_namespace_reaps_pending(pending);
+    }
 
-        self.hit_failpoint(FailpointName::AfterApplyReplicatedTombstone)
-            .await?;
+    fn namespace_reap_pending(&self, namespace_id: &str) -> bool {
+        let reaps = self.namespace_reaps.load();
+        !reaps.is_empty() && reaps.contains_key(namespace_id)
+    }
 
-        Ok(NamespaceDeleteOutcome::Applied)
+    /// Whether a tombstone still being reaped covers `manifest`. Reads treat
+    /// such entries as already deleted, so a namespace delete takes effect
+    /// when its tombstone commits rather than when the reaper catches up.
+    fn hidden_by_namespace_reap(&self, manifest: &ArtifactManifest) -> bool {
+        let reaps = self.namespace_reaps.load();
+        !reaps.is_empty()
+            && reaps
+                .get(&manifest.namespace_id)
+                .is_some_and(|&tombstone_version_ms| {
+                    manifest_version_ms(manifest) <= tombstone_version_ms
+                })
+    }
+
+    /// Hands a committed namespace tombstone to the reaper task.
+    #[cfg(not(test))]
+    async fn wake_namespace_reaper(&self) -> Result<(), String> {
+        self.namespace_reap_notify.notify_one();
+        Ok(())
+    }
+
+    /// Test stores run no reaper task, so the reap runs to completion here
+    /// unless the test deferred it to drive the steps itself.
+    #[cfg(test)]
+    async fn wake_namespace_reaper(&self) -> Result<(), String> {
+        if self.namespace_reap_inline.load(Ordering::Acquire) {
+            while !self.reap_namespace_tombstones_step().await?.idle {}
+        }
+        self.namespace_reap_notify.notify_one();
+        Ok(())
+    }
+
+    #[cfg(test)]
+    fn defer_namespace_reaps_for_testing(&self) {
+        self.namespace_reap_inline.store(false, Ordering::Release);
     }
 
     pub fn start_multipart_upload(
@@ -4465,9 +5552,70 @@ impl Store {
         batch.put_cf(self.cf(ROCKSDB_CF_OUTBOX), key.as_bytes(), value);
         self.write_batch_sync(batch, "outbox message")?;
         outbox_reservation.commit();
+        self.outbox_index
+            .lock()
+            .expect("outbox index lock poisoned")
+            .note(key.as_bytes(), &message);
         Ok(())
     }
 
+    /// Counts the outbox and rebuilds [`Self::outbox_index`] from it in the
+    /// same pass; runs once at boot. A message that no longer decodes is
+    /// counted but left unindexed, so the drain still reports it.
+    fn load_outbox_index(&self) -> Result<usize, String> {
+        let mut index = OutboxIndex::default();
+        let mut depth = 0_usize;
+        let iter = self
+            .db
+            .iterator_cf(self.cf(ROCKSDB_CF_OUTBOX), IteratorMode::Start);
+        for item in iter {
+            let (key, value) =
+                item.map_err(|error| format!("failed to iterate outbox: {error}"))?;
+            depth += 1;
+            if let Ok(message) = serde_json::from_slice::<OutboxMessage>(&value) {
+                index.note(&key, &message);
+            }
+        }
+        *self
+            .outbox_index
+            .lock()
+            .expect("outbox index lock poisoned") = index;
+        Ok(depth)
+    }
+
+    /// Whether a message queued later already carries everything `message`
+    /// would deliver: a newer upsert of the same artifact to the same target,
+    /// or a namespace delete that covers it. The index is noted before a batch
+    /// commits, so the superseding message is confirmed to be in the outbox
+    /// before this answers yes; an entry whose message is missing is
+    /// forgotten, which at worst delivers one stale upsert the peer ignores.
+    pub fn outbox_message_superseded(
+        &self,
+        key: &[u8],
+        message: &OutboxMessage,
+    ) -> Result<bool, String> {
+        let Some(superseding_key) = self
+            .outbox_index
+            .lock()
+            .expect("outbox index lock poisoned")
+            .superseding_key(key, message)
+        else {
+            return Ok(false);
+        };
+        let queued = self
+            .db
+            .get_pinned_cf(self.cf(ROCKSDB_CF_OUTBOX), &superseding_key)
+            .map_err(|error| format!("failed to read outbox entry: {error}"))?
+            .is_some();
+        if !queued {
+            self.outbox_index
+                .lock()
+                .expect("outbox index lock poisoned")
+                .forget_key(&superseding_key);
+        }
+        Ok(queued)
+    }
+
     pub fn next_outbox_message(
         &self,
         after: Option<&[u8]>,
@@ -4506,12 +5654,10 @@ impl Store {
 
         let mut batch = WriteBatch::default();
         for rollup in rollups {
-            let value = serde_json::to_vec(rollup)
-                .map_err(|error| format!("failed to encode usage rollup: {error}"))?;
             batch.put_cf(
                 self.cf(ROCKSDB_CF_USAGE_OUTBOX),
                 rollup.event_id.as_bytes(),
-                value,
+                rollup.encode(),
             );
         }
         self.write_batch_sync(batch, "usage rollups")
@@ -4526,8 +5672,7 @@ impl Store {
         for item in iter {
             let (key, value) =
                 item.map_err(|error| format!("failed to iterate usage outbox: {error}"))?;
-            let rollup = serde_json::from_slice::<UsageRollup>(&value)
-                .map_err(|error| format!("failed to decode usage rollup: {error}"))?;
+            let rollup = UsageRollup::decode(&key, &value)?;
             rollups.push((key.to_vec(), rollup));
             if rollups.len() >= limit {
                 break;
@@ -4591,6 +5736,13 @@ impl Store {
             rocksdb_write_buffer_usage_bytes: self.rocksdb_write_buffer_manager.get_usage() as u64,
             rocksdb_write_buffer_capacity_bytes: self.rocksdb_write_buffer_manager.get_buffer_size()
                 as u64,
+            rocksdb_user_bytes_written: self.rocksdb_options.get_ticker_count(Ticker::BytesWritten),
+            rocksdb_flush_bytes_written: self
+                .rocksdb_options
+                .get_ticker_count(Ticker::FlushWriteBytes),
+            rocksdb_compaction_bytes_written: self
+                .rocksdb_options
+                .get_ticker_count(Ticker::CompactWriteBytes),
         })
     }
 
@@ -4824,7 +5976,8 @@ impl Store {
                 Some(manifest)
                     if manifest.producer == ArtifactProducer::Reapi
                         && manifest.key.starts_with("action_cache/")
-                        && row_version == Some(manifest.version_ms) =>
+                        && row_version == Some(manifest.version_ms)
+                        && !self.hidden_by_namespace_reap(&manifest) =>
                 {
                     // A valid entry outside the trunk filter is skipped, not
                     // deleted: it is a live entry for another branch.
@@ -5347,9 +6500,38 @@ impl Store {
         &self,
         after: Option<&[u8]>,
         limit: usize,
+    ) -> Result<BackfillIndexPage, String> {
+        self.backfill_index_page_matching(after, limit, None, None, |_| true)
+    }
+
+    /// [`Self::backfill_index_page`] restricted to the rows `keep` accepts
+    /// with `version_ms` at or above `min_version_ms` and below
+    /// `max_version_ms`. The index is newest-first, so the scan seeks past
+    /// the rows at or above the upper bound and ends at the first row below
+    /// the lower one. A
+    /// page also ends after rejecting [`BACKFILL_TREE_REJECTED_ROWS_PER_PAGE`]
+    /// rows, possibly with no entries. Its cursor is then the last rejected
+    /// row, so the next page resumes past the rows this one rejected instead
+    /// of scanning them again.
+    pub fn backfill_index_page_matching(
+        &self,
+        after: Option<&[u8]>,
+        limit: usize,
+        min_version_ms: Option<u64>,
+        max_version_ms: Option<u64>,
+        keep: impl Fn(&BackfillIndexRow) -> bool,
     ) -> Result<BackfillIndexPage, String> {
         let prefix = BACKFILL_IDX_PREFIX.as_bytes();
-        let start = after.unwrap_or(prefix);
+        let Some(scan_start) = backfill_index_scan_start(max_version_ms) else {
+            return Ok(BackfillIndexPage {
+                entries: Vec::new(),
+                next_after: None,
+            });
+        };
+        let start = match after {
+            Some(after) if after > scan_start.as_slice() => after,
+            _ => scan_start.as_slice(),
+        };
         let iter = self.db.iterator_cf(
             self.cf(ROCKSDB_CF_KEY_VALUE),
             IteratorMode::From(start, rocksdb::Direction::Forward),
@@ -5357,6 +6539,7 @@ impl Store {
         let mut entries = Vec::new();
         let mut last_key: Option<Vec<u8>> = None;
         let mut next_after = None;
+        let mut rejected = 0_usize;
         for item in iter {
             let (key, value) =
                 item.map_err(|error| format!("failed to iterate backfill index: {error}"))?;
@@ -5366,12 +6549,20 @@ impl Store {
             if !key.starts_with(prefix) {
                 break;
             }
-            if entries.len() == limit {
+            if entries.len() == limit || rejected == BACKFILL_TREE_REJECTED_ROWS_PER_PAGE {
                 next_after = last_key.take();
                 break;
             }
-            entries.push(decode_backfill_index_row(&key, &value)?);
+            let row = decode_backfill_index_row(&key, &value)?;
+            if min_version_ms.is_some_and(|min_version_ms| row.version_ms < min_version_ms) {
+                break;
+            }
             last_key = Some(key.to_vec());
+            if !keep(&row) {
+                rejected += 1;
+                continue;
+            }
+            entries.push(row);
         }
         Ok(BackfillIndexPage {
             entries,
@@ -5379,6 +6570,38 @@ impl Store {
         })
     }
 
+    /// Visits every backfill index row at or above `min_version_ms` and below
+    /// `max_version_ms` in key order (newest-first). Blocking: a scan of that
+    /// part of the keyspace, so callers run it on the blocking pool.
+    pub fn for_each_backfill_index_row(
+        &self,
+        min_version_ms: Option<u64>,
+        max_version_ms: Option<u64>,
+        mut visit: impl FnMut(BackfillIndexRow),
+    ) -> Result<(), String> {
+        let prefix = BACKFILL_IDX_PREFIX.as_bytes();
+        let Some(start) = backfill_index_scan_start(max_version_ms) else {
+            return Ok(());
+        };
+        let iter = self.db.iterator_cf(
+            self.cf(ROCKSDB_CF_KEY_VALUE),
+            IteratorMode::From(&start, rocksdb::Direction::Forward),
+        );
+        for item in iter {
+            let (key, value) =
+                item.map_err(|error| format!("failed to iterate backfill index: {error}"))?;
+            if !key.starts_with(prefix) {
+                break;
+            }
+            let row = decode_backfill_index_row(&key, &value)?;
+            if min_version_ms.is_some_and(|min_version_ms| row.version_ms < min_version_ms) {
+                break;
+            }
+            visit(row);
+        }
+        Ok(())
+    }
+
     /// Resolves one requested backfill tuple against the CURRENT manifest —
     /// the read side of the eventually-exact index contract.
     ///
@@ -5968,11 +7191,15 @@ impl Store {
         self.stamp_backfill_maintained_seq()
     }
 
-    pub fn delete_outbox_message(&self, key: &[u8]) -> Result<(), String> {
+    pub fn delete_outbox_message(&self, key: &[u8], message: &OutboxMessage) -> Result<(), String> {
         self.db
             .delete_cf(self.cf(ROCKSDB_CF_OUTBOX), key)
             .map_err(|error| format!("failed to delete outbox entry: {error}"))?;
         release_atomic_slots(&self.outbox_depth, 1);
+        self.outbox_index
+            .lock()
+            .expect("outbox index lock poisoned")
+            .forget(key, message);
         Ok(())
     }
 
@@ -6038,6 +7265,7 @@ impl Store {
         manifest: &ArtifactManifest,
         replication_targets: &[String],
         trunk: Option<&str>,
+        shared_body: bool,
     ) -> Result<(), String> {
         for target in replication_targets {
             self.append_outbox_message(
@@ -6056,6 +7284,7 @@ impl Store {
                         // infer it from a request header it never saw.
                         branch: manifest.branch.clone(),
                         trunk: trunk.map(str::to_owned),
+                        shared_body,
                     },
                 },
             )?;
@@ -6094,6 +7323,10 @@ impl Store {
         let value = serde_json::to_vec(&message)
             .map_err(|error| format!("failed to encode outbox message: {error}"))?;
         batch.put_cf(self.cf(ROCKSDB_CF_OUTBOX), key.as_bytes(), value);
+        self.outbox_index
+            .lock()
+            .expect("outbox index lock poisoned")
+            .note(key.as_bytes(), &message);
         Ok(())
     }
 
@@ -6216,27 +7449,243 @@ impl Store {
         self.existence_cache.trim_to(target_entries)
     }
 
-    fn manifest_from_db(&self, artifact_id: &str) -> Result<Option<ArtifactManifest>, String> {
-        self.db
-            .get_cf(self.cf(ROCKSDB_CF_MANIFESTS), artifact_id.as_bytes())
-            .map_err(|error| format!("failed to read manifest from RocksDB: {error}"))?
-            .map(|bytes| decode_manifest_record(artifact_id, &bytes))
-            .transpose()
-    }
-
-    fn manifest_cache_get(&self, artifact_id: &str) -> Option<ArtifactManifest> {
-        let mut cache = self
-            .manifest_cache
-            .lock()
-            .expect("manifest cache lock poisoned");
-        cache.get(artifact_id)
+    /// Re-sums manifest sizes per namespace and recomputes each namespace's
+    /// share of the CAS ring (see `namespace_share`). One full scan of the
+    /// manifests column family; blocking. Returns the namespace count.
+    pub fn refresh_namespace_shares(&self) -> Result<usize, String> {
+        let mut usage = BTreeMap::<String, u64>::new();
+        let iter = self
+            .db
+            .iterator_cf(self.cf(ROCKSDB_CF_MANIFESTS), IteratorMode::Start);
+        for item in iter {
+            let (key, value) =
+                item.map_err(|error| format!("failed to iterate manifests: {error}"))?;
+            let artifact_id = std::str::from_utf8(&key)
+                .map_err(|error| format!("invalid manifest key: {error}"))?;
+            let manifest = decode_manifest_record(artifact_id, &value)?;
+            if self.hidden_by_namespace_reap(&manifest) {
+                continue;
+            }
+            *usage.entry(manifest.namespace_id).or_default() += manifest.stored_size();
+        }
+        let namespaces = usage.len();
+        let shares = NamespaceShares::compute(
+            usage,
+            self.segment_ring_limits.capacity_bytes(),
+            &self.namespace_share_config,
+        );
+        self.io.metrics().update_namespace_shares(
+            shares
+                .labeled_shares()
+                .into_iter()
+                .map(|(label, share)| (label, share.usage_bytes, share.share_bytes)),
+        );
+        self.namespace_shares.store(Arc::new(shares));
+        Ok(namespaces)
+    }
+
+    /// Up to `limit` cached manifests, most recently used first: the hot set
+    /// a draining node writes for its successor (see `warm_restart`).
+    /// Only the ids are copied in one hold of the lock serving lookups take;
+    /// the manifests are cloned in short batches after it, skipping any
+    /// evicted meanwhile.
+    pub fn hot_manifests(&self, limit: usize) -> Vec<ArtifactManifest> {
+        let artifact_ids = {
+            let cache = self
+                .manifest_cache
+                .lock()
+                .expect("manifest cache lock poisoned");
+            cache
+                .access
+                .most_recent()
+                .filter(|artifact_id| cache.entries.contains_key(*artifact_id))
+                .take(limit)
+                .cloned()
+                .collect::<Vec<_>>()
+        };
+        let mut manifests = Vec::with_capacity(artifact_ids.len());
+        for batch in artifact_ids.chunks(HOT_MANIFEST_CLONE_BATCH) {
+            let cache = self
+                .manifest_cache
+                .lock()
+                .expect("manifest cache lock poisoned");
+            manifests.extend(
+                batch
+                    .iter()
+                    .filter_map(|artifact_id| cache.entries.get(artifact_id))
+                    .map(|cached| cached.manifest.clone()),
+            );
+        }
+        manifests
     }
 
-    fn maybe_cache_manifest(&self, manifest: ArtifactManifest) {
-        if !self.memory.allow_manifest_cache_admission() {
-            self.io
-                .metrics()
-                .record_manifest_cache_admission("pressure_skipped");
+    /// Re-warms one hot-set artifact at boot: its manifest goes through the
+    /// manifest and existence caches like a served read, and when it fits in
+    /// `readahead_budget` its file handle is opened into the handle cache and
+    /// the kernel is asked to read its range ahead. The range comes from the
+    /// CURRENT manifest; the hot set's recorded location only tells whether
+    /// the artifact moved (promotion, replacement) since the drain.
+    pub async fn warm_hot_artifact(
+        &self,
+        artifact_id: &str,
+        recorded_segment: Option<(&str, u64)>,
+        readahead_budget: u64,
+    ) -> Result<HotArtifactWarmth, String> {
+        let Some(manifest) = self.manifest(artifact_id)? else {
+            return Ok(HotArtifactWarmth::Missing);
+        };
+        if !self.storage_exists(&manifest).await? {
+            return Ok(HotArtifactWarmth::Missing);
+        }
+        self.note_artifact_exists(artifact_id);
+        let moved = recorded_segment != manifest.segment_id.as_deref().zip(manifest.segment_offset);
+        // The kernel reads whole pages, so the budget is charged the pages
+        // the range touches, as blob readahead is.
+        let charged = page_span(manifest.segment_offset.unwrap_or(0), manifest.stored_size());
+        if manifest.inline || charged > readahead_budget {
+            return Ok(HotArtifactWarmth::Cached { moved });
+        }
+        let (handle, offset) = match (&manifest.segment_id, &manifest.blob_path) {
+            (Some(segment_id), _) => (
+                self.segment_handle(segment_id).await?,
+                manifest.segment_offset.unwrap_or(0),
+            ),
+            (None, Some(blob_path)) => (self.blob_handle(blob_path).await?, 0),
+            (None, None) => return Ok(HotArtifactWarmth::Cached { moved }),
+        };
+        let size = manifest.stored_size();
+        crate::tasks::spawn_blocking(move || handle.will_need(offset, size))
+            .await
+            .map_err(|error| format!("readahead task failed: {error}"))?
+            .map_err(|error| format!("failed to advise readahead: {error}"))?;
+        Ok(HotArtifactWarmth::ReadAhead {
+            moved,
+            bytes: charged,
+        })
+    }
+
+    /// Asks the kernel to read ahead the blobs behind `keys`, which a client
+    /// was just told it can fetch (see [`crate::readahead`]). Best effort:
+    /// blobs that are missing, inline, large, already advised or over the
+    /// budget are skipped, and nothing is advised under memory pressure.
+    pub async fn read_ahead(
+        &self,
+        producer: ArtifactProducer,
+        namespace_id: &str,
+        keys: &[String],
+        trigger: ReadaheadTrigger,
+    ) {
+        if !self.readahead.enabled() || self.memory.should_reclaim_file_cache() {
+            return;
+        }
+        let metrics = self.io.metrics();
+        let mut advised = Vec::new();
+        for key in keys.iter().take(READAHEAD_MAX_BLOBS_PER_REQUEST) {
+            let artifact_id = artifact_storage_id(producer, &self.tenant_id, namespace_id, key);
+            let Ok(Some(manifest)) = self.manifest(&artifact_id) else {
+                continue;
+            };
+            let size = manifest.stored_size();
+            if manifest.inline || size == 0 || size > READAHEAD_MAX_BLOB_BYTES {
+                continue;
+            }
+            let (claim, expired) = self.readahead.claim(
+                &artifact_id,
+                manifest.segment_offset.unwrap_or(0),
+                size,
+                trigger,
+                std::time::Instant::now(),
+            );
+            for expired in expired {
+                metrics.record_readahead(expired.as_str(), "expired");
+            }
+            match claim {
+                ReadaheadClaim::Claimed => {}
+                ReadaheadClaim::Pending => continue,
+                ReadaheadClaim::OverBudget => {
+                    metrics.record_readahead(trigger.as_str(), "over_budget");
+                    continue;
+                }
+            }
+            let handle = match (&manifest.segment_id, &manifest.blob_path) {
+                (Some(segment_id), _) => self
+                    .segment_handle(segment_id)
+                    .await
+                    .map(|handle| (handle, manifest.segment_offset.unwrap_or(0))),
+                (None, Some(blob_path)) => {
+                    self.blob_handle(blob_path).await.map(|handle| (handle, 0))
+                }
+                (None, None) => Err("manifest does not have a readable storage location".into()),
+            };
+            match handle {
+                Ok((handle, offset)) => {
+                    metrics.record_readahead(trigger.as_str(), "issued");
+                    metrics.record_readahead_bytes(trigger.as_str(), size);
+                    advised.push((handle, offset, size));
+                }
+                Err(_) => self.readahead.release(&artifact_id),
+            }
+        }
+        if advised.is_empty() {
+            return;
+        }
+        // One blocking task for the whole batch: each advisory only queues I/O.
+        let advised = crate::tasks::spawn_blocking(move || {
+            advised
+                .into_iter()
+                .try_for_each(|(handle, offset, size)| handle.will_need(offset, size))
+        })
+        .await;
+        if let Ok(Err(error)) = advised {
+            tracing::debug!("failed to advise readahead: {error}");
+        }
+    }
+
+    /// Notes a read of an artifact's body: a hit if it was read ahead, and a
+    /// reference for the segment ring's miss ratio curve.
+    fn note_body_read(&self, manifest: &ArtifactManifest) {
+        if let Some(trigger) = self
+            .readahead
+            .consume(&manifest.artifact_id, std::time::Instant::now())
+        {
+            self.io.metrics().record_readahead(trigger.as_str(), "hit");
+        }
+        if manifest.is_segment_backed() {
+            self.miss_ratio.record(
+                &manifest.artifact_id,
+                manifest.producer,
+                &manifest.namespace_id,
+                manifest.stored_size(),
+            );
+        }
+    }
+
+    /// Expected segment-ring hit ratios at multiples of its capacity.
+    pub fn miss_ratio_report(&self) -> MissRatioReport {
+        self.miss_ratio.report()
+    }
+
+    fn manifest_from_db(&self, artifact_id: &str) -> Result<Option<ArtifactManifest>, String> {
+        self.db
+            .get_cf(self.cf(ROCKSDB_CF_MANIFESTS), artifact_id.as_bytes())
+            .map_err(|error| format!("failed to read manifest from RocksDB: {error}"))?
+            .map(|bytes| decode_manifest_record(artifact_id, &bytes))
+            .transpose()
+    }
+
+    fn manifest_cache_get(&self, artifact_id: &str) -> Option<ArtifactManifest> {
+        let mut cache = self
+            .manifest_cache
+            .lock()
+            .expect("manifest cache lock poisoned");
+        cache.get(artifact_id)
+    }
+
+    fn maybe_cache_manifest(&self, manifest: ArtifactManifest) {
+        if !self.memory.allow_manifest_cache_admission() {
+            self.io
+                .metrics()
+                .record_manifest_cache_admission("pressure_skipped");
             self.io
                 .metrics()
                 .record_memory_action("manifest_cache_skip");
@@ -6527,7 +7976,7 @@ fn release_atomic_slots(depth: &AtomicUsize, slots: usize) {
 }
 
 async fn path_size_bytes_on_blocking_pool(path: PathBuf) -> Result<u64, String> {
-    tokio::task::spawn_blocking(move || try_path_size_bytes(&path))
+    crate::tasks::spawn_blocking(move || try_path_size_bytes(&path))
         .await
         .map_err(|error| format!("filesystem accounting task failed: {error}"))?
         .map_err(|error| error.to_string())
@@ -6607,6 +8056,11 @@ impl AccessOrder {
     fn pop_lru(&mut self) -> Option<String> {
         self.order.pop_first().map(|(_, key)| key)
     }
+
+    /// Keys from most to least recently used.
+    fn most_recent(&self) -> impl Iterator<Item = &String> {
+        self.order.values().rev()
+    }
 }
 
 struct ManifestCache {
@@ -7025,6 +8479,17 @@ fn resolve_segment_ring_limits(
     }
 }
 
+/// Where a newest-first scan of the backfill index starts when it skips rows
+/// at or above `max_version_ms`: the key prefix of the newest version below
+/// the bound. `None` when no row can be below it.
+fn backfill_index_scan_start(max_version_ms: Option<u64>) -> Option<Vec<u8>> {
+    let mut start = BACKFILL_IDX_PREFIX.as_bytes().to_vec();
+    if let Some(max_version_ms) = max_version_ms {
+        start.extend_from_slice(&(!max_version_ms.checked_sub(1)?).to_be_bytes());
+    }
+    Some(start)
+}
+
 fn rocksdb_column_family_options(
     config: &Config,
     block_cache: &Cache,
@@ -7081,6 +8546,35 @@ struct SegmentLocation {
     offset: u64,
 }
 
+/// The content address a manifest's body may be shared under: REAPI CAS blobs
+/// only, and only when the stored size is the one the digest names.
+fn shared_content_address(producer: ArtifactProducer, key: &str, size: u64) -> Option<String> {
+    if producer != ArtifactProducer::Reapi {
+        return None;
+    }
+    cas_blob_content_address(key)
+        .filter(|&(_, digest_size)| digest_size == size)
+        .map(|(content_address, _)| content_address)
+}
+
+/// Content index value: `{segment_id}\0{offset}`.
+fn encode_content_location(location: &SegmentLocation) -> Vec<u8> {
+    format!("{}\0{}", location.segment_id, location.offset).into_bytes()
+}
+
+fn decode_content_location(value: &[u8]) -> Result<SegmentLocation, String> {
+    std::str::from_utf8(value)
+        .ok()
+        .and_then(|value| value.split_once('\0'))
+        .and_then(|(segment_id, offset)| {
+            Some(SegmentLocation {
+                segment_id: segment_id.to_owned(),
+                offset: offset.parse().ok()?,
+            })
+        })
+        .ok_or_else(|| "invalid content index row".to_string())
+}
+
 struct SegmentHandleCache {
     entries: HashMap<String, CachedSegmentHandle>,
     access: AccessOrder,
@@ -7183,6 +8677,28 @@ pub(crate) fn backfill_record_kind(manifest: &ArtifactManifest) -> BackfillRecor
     }
 }
 
+fn namespace_reap_key(namespace_id: &str) -> String {
+    format!("{NAMESPACE_REAP_PREFIX}{namespace_id}")
+}
+
+/// Value of a `namespace_reap/` record: the tombstone version being reaped
+/// (8 bytes, little-endian, like the tombstone itself) followed by the
+/// artifact id the last committed step stopped at — empty before the first.
+fn encode_namespace_reap_record(version_ms: u64, after: Option<&str>) -> Vec<u8> {
+    let after = after.unwrap_or_default();
+    let mut bytes = Vec::with_capacity(8 + after.len());
+    bytes.extend_from_slice(&version_ms.to_le_bytes());
+    bytes.extend_from_slice(after.as_bytes());
+    bytes
+}
+
+fn decode_namespace_reap_record(bytes: &[u8]) -> Option<(u64, Option<String>)> {
+    let (version, after) = bytes.split_at_checked(8)?;
+    let version_ms = u64::from_le_bytes(version.try_into().ok()?);
+    let after = std::str::from_utf8(after).ok()?;
+    Some((version_ms, (!after.is_empty()).then(|| after.to_owned())))
+}
+
 /// Value of `backfill/meta/last_maintained_seq`: the latest sequence number
 /// observed just before the stamp write, plus whether the stamp marks a clean
 /// shutdown.
@@ -7224,10 +8740,19 @@ fn versions_converged(existing_version_ms: u64, incoming_version_ms: u64) -> boo
     incoming_version_ms != 0 && existing_version_ms == incoming_version_ms
 }
 
-fn read_bytes_at(file: &std::fs::File, offset: u64, size: u64) -> Result<Vec<u8>, String> {
+pub(crate) fn read_bytes_at(
+    file: &std::fs::File,
+    offset: u64,
+    size: u64,
+) -> Result<Vec<u8>, String> {
     let size = usize::try_from(size)
         .map_err(|_| format!("artifact size {size} exceeds addressable memory"))?;
     let mut bytes = vec![0; size];
+    read_exact_at(file, offset, &mut bytes)?;
+    Ok(bytes)
+}
+
+fn read_exact_at(file: &std::fs::File, offset: u64, bytes: &mut [u8]) -> Result<(), String> {
     let mut read_offset = 0_usize;
     while read_offset < bytes.len() {
         let bytes_read = read_at(file, &mut bytes[read_offset..], offset + read_offset as u64)
@@ -7242,7 +8767,7 @@ fn read_bytes_at(file: &std::fs::File, offset: u64, size: u64) -> Result<Vec<u8>
         }
         read_offset += bytes_read;
     }
-    Ok(bytes)
+    Ok(())
 }
 
 #[cfg(unix)]
@@ -7478,6 +9003,11 @@ mod tests {
             data_dir: temp_dir.path().join("data"),
             tmp_dir_max_bytes: 8 * 1024 * 1024 * 1024,
             cas_capacity_bytes: None,
+            namespace_shares: Default::default(),
+            admission_read_weight: crate::constants::DEFAULT_ADMISSION_READ_WEIGHT,
+            readahead_budget_bytes: crate::constants::DEFAULT_READAHEAD_BUDGET_BYTES,
+            segment_compression: Default::default(),
+            segment_direct_io: false,
             node_url: "http://127.0.0.1:7443".into(),
             peer_gateway_url: None,
             peers: vec!["http://127.0.0.1:7443".into()],
@@ -7486,11 +9016,13 @@ mod tests {
             peer_tls: None,
             public_tls: None,
             https_port: 0,
+            alt_svc: None,
             accelerated_file_serving: AcceleratedFileServingConfig {
                 enabled: true,
                 mode: AcceleratedFileServingMode::Splice,
                 max_concurrent: 32,
                 chunk_bytes: 1024 * 1024,
+                thread_per_core: false,
             },
             action_cache_eviction_cascade_enabled: true,
             file_descriptor_pool_size: 32,
@@ -8823,6 +10355,137 @@ mod tests {
         );
     }
 
+    #[tokio::test]
+    async fn namespace_delete_hides_entries_until_the_reaper_purges_them() {
+        let (_temp_dir, _config, store) = temp_store();
+        store.defer_namespace_reaps_for_testing();
+
+        for (key, version_ms) in [("old", 100), ("new", 300)] {
+            store
+                .apply_replicated_artifact_from_bytes(
+                    ArtifactProducer::Xcode,
+                    "ios",
+                    key,
+                    "application/octet-stream",
+                    key.as_bytes(),
+                    version_ms,
+                )
+                .await
+                .expect("failed to apply replicated artifact");
+        }
+        assert!(
+            store
+                .artifact_exists(ArtifactProducer::Xcode, "ios", "old")
+                .await
+                .expect("failed to check artifact existence")
+        );
+
+        assert!(
+            store
+                .apply_replicated_namespace_delete("ios", 200)
+                .await
+                .expect("failed to apply replicated namespace delete")
+                .applied()
+        );
+
+        // The tombstone alone hides the older entry; its rows are still on disk.
+        let old_id = artifact_storage_id(ArtifactProducer::Xcode, "test-tenant", "ios", "old");
+        assert!(
+            !store
+                .artifact_exists(ArtifactProducer::Xcode, "ios", "old")
+                .await
+                .expect("failed to re-check artifact existence")
+        );
+        assert!(store.manifest(&old_id).expect("manifest read").is_none());
+        assert!(
+            store
+                .manifest_from_db(&old_id)
+                .expect("raw manifest read")
+                .is_some()
+        );
+
+        let step = store
+            .reap_namespace_tombstones_step()
+            .await
+            .expect("reap step should succeed");
+        assert_eq!(step.purged, 1);
+        assert!(!step.idle);
+        assert!(
+            store
+                .reap_namespace_tombstones_step()
+                .await
+                .expect("idle reap step should succeed")
+                .idle
+        );
+        assert!(
+            store
+                .manifest_from_db(&old_id)
+                .expect("raw manifest read")
+                .is_none()
+        );
+        assert!(
+            store
+                .fetch_artifact(ArtifactProducer::Xcode, "ios", "new")
+                .await
+                .expect("failed to fetch surviving artifact")
+                .is_some()
+        );
+    }
+
+    #[tokio::test]
+    async fn namespace_reap_resumes_from_its_persisted_cursor_after_reopen() {
+        let (_temp_dir, config, store) = temp_store();
+        store.defer_namespace_reaps_for_testing();
+
+        for index in 0..NAMESPACE_REAP_BATCH_ROWS + 3 {
+            store
+                .apply_replicated_inline_artifact_from_bytes(
+                    ArtifactProducer::Gradle,
+                    "android",
+                    &format!("entry-{index}"),
+                    "application/octet-stream",
+                    b"payload",
+                    100,
+                    None,
+                    None,
+                )
+                .await
+                .expect("failed to apply replicated inline artifact");
+        }
+        store
+            .apply_replicated_namespace_delete("android", 200)
+            .await
+            .expect("failed to apply replicated namespace delete");
+        let step = store
+            .reap_namespace_tombstones_step()
+            .await
+            .expect("first reap step should succeed");
+        assert_eq!(step.purged, NAMESPACE_REAP_BATCH_ROWS);
+        drop(store);
+
+        let reopened = reopen_store(&config);
+        reopened.defer_namespace_reaps_for_testing();
+        assert!(
+            reopened
+                .fetch_inline_artifact_bytes(ArtifactProducer::Gradle, "android", "entry-0")
+                .expect("inline read should succeed")
+                .is_none(),
+            "a reopened store must keep hiding entries its tombstone covers"
+        );
+        let step = reopened
+            .reap_namespace_tombstones_step()
+            .await
+            .expect("resumed reap step should succeed");
+        assert_eq!(step.purged, 3);
+        assert!(
+            reopened
+                .reap_namespace_tombstones_step()
+                .await
+                .expect("idle reap step should succeed")
+                .idle
+        );
+    }
+
     #[test]
     fn existence_cache_expires_entries_after_ttl() {
         let mut cache = ExistenceCache::new(8, Duration::from_millis(10));
@@ -9501,6 +11164,42 @@ mod tests {
         );
     }
 
+    #[tokio::test]
+    async fn sealed_max_version_survives_a_restart_through_the_stats_row() {
+        let (_temp_dir, config, store) = temp_store();
+        store
+            .apply_replicated_artifact_from_bytes(
+                ArtifactProducer::Xcode,
+                "ios",
+                "artifact-a",
+                "application/octet-stream",
+                b"bytes",
+                300,
+            )
+            .await
+            .expect("artifact should apply");
+        let sealed_id = seal_active_segment(&store).await;
+        // The seal raise is a merge operand, not a ring persist: the ring
+        // JSON still lacks the stat until the next ring mutation.
+        let persisted = store
+            .load_segment_state_from_db()
+            .expect("ring should load");
+        assert!(
+            persisted
+                .old
+                .iter()
+                .chain(persisted.current.iter())
+                .chain(persisted.new.iter())
+                .any(|reference| reference.segment_id == sealed_id
+                    && reference.max_version_ms.is_none())
+        );
+        drop(store);
+
+        let store = reopen_store(&config);
+
+        assert_eq!(ring_reference(&store, &sealed_id).max_version_ms, Some(300));
+    }
+
     #[tokio::test]
     async fn promotion_of_an_old_entry_never_lowers_the_running_max() {
         let (_temp_dir, _config, store) = temp_store();
@@ -9894,124 +11593,486 @@ mod tests {
     }
 
     #[tokio::test]
-    async fn blob_handle_cache_is_bounded_and_dropped_before_namespace_delete() {
-        let (_temp_dir, config, store) = temp_store_with(|config| {
-            config.segment_handle_cache_size = 1;
+    async fn blob_handle_cache_is_bounded_and_dropped_before_namespace_delete() {
+        let (_temp_dir, config, store) = temp_store_with(|config| {
+            config.segment_handle_cache_size = 1;
+        });
+        let blob_path = config.data_dir.join("blobs").join("legacy-blob");
+        std::fs::write(&blob_path, b"legacy-blob-payload").expect("failed to write blob");
+        let blob_path_string = blob_path.to_string_lossy().into_owned();
+        let artifact_id = artifact_storage_id(
+            ArtifactProducer::Module,
+            &config.tenant_id,
+            "ios",
+            "legacy-key",
+        );
+        let manifest = ArtifactManifest {
+            artifact_id: artifact_id.clone(),
+            producer: ArtifactProducer::Module,
+            namespace_id: "ios".to_owned(),
+            key: "legacy-key".to_owned(),
+            content_type: "application/octet-stream".to_owned(),
+            inline: false,
+            blob_path: Some(blob_path_string.clone()),
+            segment_id: None,
+            segment_offset: None,
+            size: b"legacy-blob-payload".len() as u64,
+            version_ms: 100,
+            created_at_ms: 100,
+            branch: None,
+            stored_encoding: None,
+        };
+
+        store
+            .db
+            .put_cf(
+                store.cf(ROCKSDB_CF_MANIFESTS),
+                artifact_id.as_bytes(),
+                encode_manifest_record(&manifest).expect("manifest should encode"),
+            )
+            .expect("failed to persist manifest");
+        store
+            .db
+            .put_cf(
+                store.cf(ROCKSDB_CF_NAMESPACE_ARTIFACTS),
+                namespace_artifact_index_key("ios", &artifact_id).as_bytes(),
+                [],
+            )
+            .expect("failed to persist namespace index");
+
+        assert_eq!(
+            read_manifest_bytes(&store, &manifest).await,
+            b"legacy-blob-payload"
+        );
+        {
+            let cache = store.segment_handles.lock().await;
+            assert_eq!(cache.len(), 1);
+            assert!(
+                cache
+                    .entries
+                    .contains_key(&blob_handle_cache_key(&blob_path_string))
+            );
+        }
+
+        store
+            .delete_namespace("ios")
+            .await
+            .expect("failed to delete namespace");
+
+        {
+            let cache = store.segment_handles.lock().await;
+            assert!(
+                !cache
+                    .entries
+                    .contains_key(&blob_handle_cache_key(&blob_path_string))
+            );
+        }
+        assert!(!blob_path.exists());
+    }
+
+    #[tokio::test]
+    async fn fetch_artifact_refreshes_old_segment_backed_artifacts() {
+        let (_temp_dir, _config, store) = temp_store();
+
+        let manifest = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Xcode,
+                "ios",
+                "artifact-1",
+                "application/octet-stream",
+                b"hello",
+            )
+            .await
+            .expect("failed to persist artifact");
+        let original_segment_id = manifest
+            .segment_id
+            .clone()
+            .expect("segment-backed artifact should have a segment id");
+        store
+            .save_segment_state(&SegmentState {
+                old: vec![SegmentReference::new(original_segment_id.clone(), 1)],
+                current: Vec::new(),
+                new: vec![SegmentReference::new("fresh-segment".into(), 2)],
+            })
+            .expect("failed to seed segment state");
+
+        let fetched = store
+            .fetch_artifact(ArtifactProducer::Xcode, "ios", "artifact-1")
+            .await
+            .expect("failed to fetch artifact")
+            .expect("artifact should still exist");
+
+        assert_ne!(fetched.segment_id, Some(original_segment_id));
+        assert_eq!(read_manifest_bytes(&store, &fetched).await, b"hello");
+        assert_eq!(
+            store
+                .manifest(&fetched.artifact_id)
+                .expect("failed to load manifest")
+                .expect("refreshed manifest should still exist"),
+            fetched
+        );
+        assert_eq!(store.segment_handles.lock().await.len(), 2);
+    }
+
+    #[tokio::test]
+    async fn serve_path_promotion_skips_namespaces_over_their_share() {
+        let (_temp_dir, _config, store) = temp_store_with(|config| {
+            config.namespace_shares =
+                NamespaceShareConfig::parse("weights", None, "quotas", Some("ios=1"))
+                    .expect("quota should parse");
+        });
+        let manifest = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Xcode,
+                "ios",
+                "artifact-1",
+                "application/octet-stream",
+                b"hello",
+            )
+            .await
+            .expect("failed to persist artifact");
+        let original_segment_id = manifest.segment_id.clone().expect("segment id");
+        store
+            .save_segment_state(&SegmentState {
+                old: vec![SegmentReference::new(original_segment_id.clone(), 1)],
+                current: Vec::new(),
+                new: vec![SegmentReference::new("fresh-segment".into(), 2)],
+            })
+            .expect("failed to seed segment state");
+        assert_eq!(store.refresh_namespace_shares(), Ok(1));
+
+        store
+            .promote_artifact(&manifest.artifact_id, RefreshTrigger::Serve)
+            .await
+            .expect("deferred promotion should succeed");
+        let current = store
+            .manifest(&manifest.artifact_id)
+            .expect("failed to load manifest")
+            .expect("manifest should exist");
+        assert_eq!(current.segment_id, Some(original_segment_id.clone()));
+
+        // A vouched-for refresh still runs: the node has promised the blob.
+        store
+            .promote_artifact(&manifest.artifact_id, RefreshTrigger::FindMissing)
+            .await
+            .expect("promotion should succeed");
+        let promoted = store
+            .manifest(&manifest.artifact_id)
+            .expect("failed to load manifest")
+            .expect("manifest should exist");
+        assert_ne!(promoted.segment_id, Some(original_segment_id));
+    }
+
+    #[tokio::test]
+    async fn cas_blobs_share_one_body_across_namespaces_until_its_segment_is_evicted() {
+        let (_temp_dir, _config, store) = temp_store();
+        let key = format!("blob/{}/5", "ab".repeat(32));
+        let ios = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Reapi,
+                "ios",
+                &key,
+                "application/octet-stream",
+                b"hello",
+            )
+            .await
+            .expect("failed to persist blob");
+        let segment_id = ios.segment_id.clone().expect("segment id");
+        let segment_len = std::fs::metadata(store.segment_path(&segment_id))
+            .expect("segment should exist")
+            .len();
+
+        let android = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Reapi,
+                "android",
+                &key,
+                "application/octet-stream",
+                b"hello",
+            )
+            .await
+            .expect("failed to persist blob");
+        assert_ne!(android.artifact_id, ios.artifact_id);
+        assert_eq!(
+            (&android.segment_id, android.segment_offset),
+            (&ios.segment_id, ios.segment_offset)
+        );
+        assert_eq!(
+            std::fs::metadata(store.segment_path(&segment_id))
+                .expect("segment should exist")
+                .len(),
+            segment_len
+        );
+        assert_eq!(
+            store
+                .apply_replicated_content_link(
+                    ArtifactProducer::Reapi,
+                    "macos",
+                    &key,
+                    "application/octet-stream",
+                    now_ms(),
+                    None,
+                    None,
+                )
+                .await,
+            Ok(Some(ArtifactApplyOutcome::Applied))
+        );
+
+        store
+            .evict_segment(&segment_id)
+            .await
+            .expect("failed to evict segment");
+        for namespace_id in ["ios", "android", "macos"] {
+            assert_eq!(
+                store
+                    .fetch_artifact(ArtifactProducer::Reapi, namespace_id, &key)
+                    .await,
+                Ok(None)
+            );
+        }
+        assert_eq!(
+            store
+                .apply_replicated_content_link(
+                    ArtifactProducer::Reapi,
+                    "linux",
+                    &key,
+                    "application/octet-stream",
+                    now_ms(),
+                    None,
+                    None,
+                )
+                .await,
+            Ok(None)
+        );
+    }
+
+    #[tokio::test]
+    async fn only_a_linked_cas_blob_offers_peers_a_link() {
+        let (_temp_dir, _config, store) = temp_store();
+        let key = format!("blob/{}/5", "cd".repeat(32));
+        let targets = vec!["http://peer-a".to_string()];
+        for namespace_id in ["ios", "android"] {
+            store
+                .persist_artifact_from_bytes_and_enqueue(
+                    ArtifactProducer::Reapi,
+                    namespace_id,
+                    &key,
+                    "application/octet-stream",
+                    b"hello",
+                    &targets,
+                )
+                .await
+                .expect("failed to persist blob");
+        }
+
+        let offers = store
+            .outbox_messages()
+            .expect("outbox messages should load")
+            .into_iter()
+            .map(|(_, message)| match message.operation {
+                ReplicationOperation::UpsertArtifact {
+                    namespace_id,
+                    shared_body,
+                    ..
+                } => (namespace_id, shared_body),
+                other => panic!("unexpected operation {other:?}"),
+            })
+            .collect::<std::collections::BTreeMap<_, _>>();
+        assert!(!offers["ios"]);
+        assert!(offers["android"]);
+    }
+
+    #[tokio::test]
+    async fn direct_appends_land_on_block_boundaries_and_read_back() {
+        let (_temp_dir, _config, store) = temp_store_with(|config| {
+            config.segment_direct_io = true;
         });
-        let blob_path = config.data_dir.join("blobs").join("legacy-blob");
-        std::fs::write(&blob_path, b"legacy-blob-payload").expect("failed to write blob");
-        let blob_path_string = blob_path.to_string_lossy().into_owned();
-        let artifact_id = artifact_storage_id(
-            ArtifactProducer::Module,
-            &config.tenant_id,
-            "ios",
-            "legacy-key",
-        );
-        let manifest = ArtifactManifest {
-            artifact_id: artifact_id.clone(),
-            producer: ArtifactProducer::Module,
-            namespace_id: "ios".to_owned(),
-            key: "legacy-key".to_owned(),
-            content_type: "application/octet-stream".to_owned(),
-            inline: false,
-            blob_path: Some(blob_path_string.clone()),
-            segment_id: None,
-            segment_offset: None,
-            size: b"legacy-blob-payload".len() as u64,
-            version_ms: 100,
-            created_at_ms: 100,
-            branch: None,
+        let Some(direct) = store.direct_io.as_ref() else {
+            // The test filesystem does not take O_DIRECT; the store fell back.
+            return;
         };
+        // The tiny body is buffered and leaves the segment unaligned.
+        let tiny = vec![5_u8; 1_000];
+        let small = vec![7_u8; 100_000];
+        let large = (0..3 * direct::DIRECT_IO_BUFFER_BYTES / 2)
+            .map(|index| index as u8)
+            .collect::<Vec<_>>();
 
-        store
-            .db
-            .put_cf(
-                store.cf(ROCKSDB_CF_MANIFESTS),
-                artifact_id.as_bytes(),
-                encode_manifest_record(&manifest).expect("manifest should encode"),
+        let mut manifests = Vec::new();
+        for (key, body) in [("tiny", &tiny), ("small", &small), ("large", &large)] {
+            manifests.push(
+                store
+                    .persist_artifact_from_bytes(
+                        ArtifactProducer::Gradle,
+                        "android",
+                        key,
+                        "application/octet-stream",
+                        body,
+                    )
+                    .await
+                    .expect("failed to persist artifact"),
+            );
+        }
+
+        let tiny_manifest = manifests.remove(0);
+        for manifest in &manifests {
+            let offset = manifest.segment_offset.expect("segment-backed artifact");
+            assert_eq!(offset % direct::DIRECT_IO_ALIGNMENT, 0);
+        }
+        assert!(
+            direct
+                .recent(
+                    tiny_manifest.segment_id.as_deref().unwrap(),
+                    tiny_manifest.segment_offset.unwrap(),
+                    tiny.len() as u64
+                )
+                .is_none()
+        );
+        assert_eq!(store.read_artifact_bytes(&tiny_manifest).await, Ok(tiny));
+        let small_manifest = &manifests[0];
+        let segment_id = small_manifest.segment_id.as_deref().unwrap();
+        let offset = small_manifest.segment_offset.unwrap();
+        assert!(
+            direct
+                .recent(segment_id, offset, small.len() as u64)
+                .is_some()
+        );
+        assert_eq!(
+            store.read_artifact_bytes(small_manifest).await,
+            Ok(small.clone())
+        );
+
+        // Once the recent body is gone the read comes from disk.
+        direct.forget_segment(segment_id);
+        assert_eq!(store.read_artifact_bytes(small_manifest).await, Ok(small));
+        assert_eq!(store.read_artifact_bytes(&manifests[1]).await, Ok(large));
+    }
+
+    #[tokio::test]
+    async fn read_ahead_blobs_count_as_hits_when_read() {
+        let (_temp_dir, _config, store) = temp_store_with(|_| {});
+        let body = vec![3_u8; 64 * 1024];
+        let manifest = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Reapi,
+                "ios",
+                "blob/ready",
+                "application/octet-stream",
+                &body,
             )
-            .expect("failed to persist manifest");
+            .await
+            .expect("failed to persist artifact");
+
         store
-            .db
-            .put_cf(
-                store.cf(ROCKSDB_CF_NAMESPACE_ARTIFACTS),
-                namespace_artifact_index_key("ios", &artifact_id).as_bytes(),
-                [],
+            .read_ahead(
+                ArtifactProducer::Reapi,
+                "ios",
+                &["blob/ready".to_owned(), "blob/absent".to_owned()],
+                ReadaheadTrigger::ActionResult,
             )
-            .expect("failed to persist namespace index");
+            .await;
 
+        let (claim, _) = store.readahead.claim(
+            &manifest.artifact_id,
+            manifest.segment_offset.unwrap_or(0),
+            body.len() as u64,
+            ReadaheadTrigger::FindMissing,
+            std::time::Instant::now(),
+        );
+        assert_eq!(claim, ReadaheadClaim::Pending);
+        assert_eq!(store.read_artifact_bytes(&manifest).await, Ok(body));
         assert_eq!(
-            read_manifest_bytes(&store, &manifest).await,
-            b"legacy-blob-payload"
+            store
+                .readahead
+                .consume(&manifest.artifact_id, std::time::Instant::now()),
+            None,
+            "the read consumed the readahead"
         );
-        {
-            let cache = store.segment_handles.lock().await;
-            assert_eq!(cache.len(), 1);
-            assert!(
-                cache
-                    .entries
-                    .contains_key(&blob_handle_cache_key(&blob_path_string))
-            );
-        }
+    }
 
-        store
-            .delete_namespace("ios")
+    #[tokio::test]
+    async fn pooled_reads_match_plain_reads_and_reuse_buffers() {
+        let (_temp_dir, _config, store) = temp_store_with(|_| {});
+        let body = (0..200_000_u32)
+            .map(|value| value as u8)
+            .collect::<Vec<_>>();
+        let manifest = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Reapi,
+                "ios",
+                "blob/pooled",
+                "application/octet-stream",
+                &body,
+            )
             .await
-            .expect("failed to delete namespace");
+            .expect("failed to persist artifact");
 
-        {
-            let cache = store.segment_handles.lock().await;
-            assert!(
-                !cache
-                    .entries
-                    .contains_key(&blob_handle_cache_key(&blob_path_string))
-            );
+        for _ in 0..2 {
+            let buffer = store
+                .read_artifact_buffer(&manifest)
+                .await
+                .expect("failed to read pooled artifact");
+            assert_eq!(&buffer[..], &body[..]);
         }
-        assert!(!blob_path.exists());
+        assert!(
+            store.io.metrics().render().contains("result=\"reused\""),
+            "the second read should reuse the first read's buffer"
+        );
     }
 
     #[tokio::test]
-    async fn fetch_artifact_refreshes_old_segment_backed_artifacts() {
-        let (_temp_dir, _config, store) = temp_store();
+    async fn opted_in_producers_store_compressible_bodies_compressed() {
+        let (_temp_dir, _config, store) = temp_store_with(|config| {
+            config.segment_compression = SegmentCompressionConfig::parse(
+                "KURA_SEGMENT_COMPRESSION_PRODUCERS",
+                Some("gradle"),
+            )
+            .expect("producers should parse");
+        });
+        let body = b"task :app:compileKotlin UP-TO-DATE\n".repeat(2_048);
 
-        let manifest = store
+        let gradle = store
+            .persist_artifact_from_bytes(
+                ArtifactProducer::Gradle,
+                "android",
+                "build-cache-entry",
+                "application/octet-stream",
+                &body,
+            )
+            .await
+            .expect("failed to persist artifact");
+        let xcode = store
             .persist_artifact_from_bytes(
                 ArtifactProducer::Xcode,
                 "ios",
                 "artifact-1",
                 "application/octet-stream",
-                b"hello",
+                &body,
             )
             .await
             .expect("failed to persist artifact");
-        let original_segment_id = manifest
-            .segment_id
-            .clone()
-            .expect("segment-backed artifact should have a segment id");
-        store
-            .save_segment_state(&SegmentState {
-                old: vec![SegmentReference::new(original_segment_id.clone(), 1)],
-                current: Vec::new(),
-                new: vec![SegmentReference::new("fresh-segment".into(), 2)],
-            })
-            .expect("failed to seed segment state");
 
-        let fetched = store
-            .fetch_artifact(ArtifactProducer::Xcode, "ios", "artifact-1")
-            .await
-            .expect("failed to fetch artifact")
-            .expect("artifact should still exist");
+        assert_eq!(gradle.size, body.len() as u64);
+        assert!(gradle.stored_size() < gradle.size / 10);
+        assert_eq!(xcode.stored_encoding, None);
+        let reloaded = store
+            .manifest_from_db(&gradle.artifact_id)
+            .expect("manifest lookup should succeed")
+            .expect("manifest should exist");
+        assert_eq!(reloaded.stored_encoding, gradle.stored_encoding);
+        assert_eq!(store.read_artifact_bytes(&reloaded).await, Ok(body.clone()));
 
-        assert_ne!(fetched.segment_id, Some(original_segment_id));
-        assert_eq!(read_manifest_bytes(&store, &fetched).await, b"hello");
-        assert_eq!(
-            store
-                .manifest(&fetched.artifact_id)
-                .expect("failed to load manifest")
-                .expect("refreshed manifest should still exist"),
-            fetched
-        );
-        assert_eq!(store.segment_handles.lock().await.len(), 2);
+        let mut ranged = Vec::new();
+        store
+            .open_artifact_reader_range_tolerating_promotion(&reloaded, 36, Some(36))
+            .await
+            .expect("reader should open")
+            .expect("artifact should exist")
+            .1
+            .read_to_end(&mut ranged)
+            .await
+            .expect("ranged read should succeed");
+        assert_eq!(ranged, body[36..72]);
     }
 
     #[tokio::test]
@@ -11476,6 +13537,7 @@ mod tests {
             version_ms,
             created_at_ms,
             branch: None,
+            stored_encoding: None,
         };
         let record = encode_manifest_record(&manifest).expect("manifest should encode");
         (artifact_id, record)
@@ -12354,6 +14416,67 @@ mod tests {
         );
     }
 
+    #[tokio::test]
+    async fn bounded_backfill_index_scans_stop_below_the_bound() {
+        let (_temp_dir, _config, store) = temp_store();
+        for version_ms in 1..=5_u64 {
+            store
+                .apply_replicated_inline_artifact_from_bytes(
+                    ArtifactProducer::Xcode,
+                    "ios",
+                    &format!("artifact-{version_ms}"),
+                    "application/octet-stream",
+                    b"payload",
+                    version_ms * 100,
+                    None,
+                    None,
+                )
+                .await
+                .expect("artifact should apply");
+        }
+
+        let page = store
+            .backfill_index_page_matching(None, 16, Some(300), None, |row| row.version_ms != 400)
+            .expect("page should load");
+        assert_eq!(
+            page.entries
+                .iter()
+                .map(|row| row.version_ms)
+                .collect::<Vec<_>>(),
+            vec![500, 300]
+        );
+        assert_eq!(page.next_after, None);
+
+        let mut visited = Vec::new();
+        store
+            .for_each_backfill_index_row(Some(300), None, |row| visited.push(row.version_ms))
+            .expect("scan should succeed");
+        assert_eq!(visited, vec![500, 400, 300]);
+
+        let mut visited = Vec::new();
+        store
+            .for_each_backfill_index_row(Some(200), Some(400), |row| visited.push(row.version_ms))
+            .expect("scan should succeed");
+        assert_eq!(visited, vec![300, 200]);
+        let page = store
+            .backfill_index_page_matching(None, 16, None, Some(500), |_| true)
+            .expect("page should load");
+        assert_eq!(
+            page.entries
+                .iter()
+                .map(|row| row.version_ms)
+                .collect::<Vec<_>>(),
+            vec![400, 300, 200, 100]
+        );
+        assert!(
+            store
+                .backfill_index_page_matching(None, 16, None, Some(0), |_| true)
+                .expect("page should load")
+                .entries
+                .is_empty()
+        );
+    }
+
     #[tokio::test]
     async fn backfill_index_pages_walk_every_row_with_stable_cursors() {
         let (_temp_dir, _config, store) = temp_store();
@@ -12944,7 +15067,7 @@ mod tests {
         );
 
         store
-            .delete_outbox_message(key)
+            .delete_outbox_message(key, message)
             .expect("failed to delete outbox message");
         assert!(
             store
@@ -13014,11 +15137,13 @@ mod tests {
                 .expect_err("capacity rejection")
         ));
 
-        let (key, _) = store
+        let (key, queued) = store
             .next_outbox_message(None)
             .expect("outbox read")
             .expect("queued message");
-        store.delete_outbox_message(&key).expect("outbox deletion");
+        store
+            .delete_outbox_message(&key, &queued)
+            .expect("outbox deletion");
         store.enqueue(message).expect("capacity should be reusable");
         assert_eq!(store.outbox_depth(), 1);
     }
@@ -13060,6 +15185,70 @@ mod tests {
         ));
     }
 
+    #[tokio::test]
+    async fn rewritten_keys_leave_only_their_newest_outbox_message_deliverable() {
+        let (_temp_dir, config, store) = temp_store();
+        let targets = ["http://peer".to_owned()];
+        for body in [b"v1".as_slice(), b"v2", b"v3"] {
+            store
+                .persist_inline_artifact_from_bytes_and_enqueue(
+                    ArtifactProducer::Reapi,
+                    "ios",
+                    "action_cache/hot",
+                    "application/x-protobuf",
+                    body,
+                    &targets,
+                    None,
+                    None,
+                )
+                .await
+                .expect("write should enqueue");
+        }
+
+        let superseded = |store: &Store| -> Vec<bool> {
+            store
+                .outbox_messages()
+                .expect("outbox read")
+                .iter()
+                .map(|(key, message)| {
+                    store
+                        .outbox_message_superseded(key, message)
+                        .expect("supersession check")
+                })
+                .collect()
+        };
+        assert_eq!(superseded(&store), [true, true, false]);
+
+        // The index is rebuilt from the outbox at boot.
+        drop(store);
+        let store = reopen_store(&config);
+        assert_eq!(superseded(&store), [true, true, false]);
+
+        // Once the newest message is delivered, nothing supersedes the older
+        // ones any more, so the worst case is a stale delivery, never a drop.
+        let (newest_key, newest) = store
+            .outbox_messages()
+            .expect("outbox read")
+            .pop()
+            .expect("newest message");
+        store
+            .delete_outbox_message(&newest_key, &newest)
+            .expect("outbox deletion");
+        assert_eq!(superseded(&store), [false, false]);
+
+        // A namespace delete queued after them covers both.
+        store
+            .enqueue(OutboxMessage {
+                target: "http://peer".into(),
+                operation: ReplicationOperation::DeleteNamespace {
+                    namespace_id: "ios".into(),
+                    version_ms: 0,
+                },
+            })
+            .expect("delete should enqueue");
+        assert_eq!(superseded(&store), [true, true, false]);
+    }
+
     #[test]
     fn outbox_drains_metadata_before_earlier_bulk_messages() {
         let (_temp_dir, _config, store) = temp_store();
@@ -13080,6 +15269,7 @@ mod tests {
                     version_ms: 1,
                     branch: None,
                     trunk: None,
+                    shared_body: false,
                 },
             })
             .expect("failed to enqueue bulk message");
@@ -13096,6 +15286,7 @@ mod tests {
                     version_ms: 2,
                     branch: None,
                     trunk: None,
+                    shared_body: false,
                 },
             })
             .expect("failed to enqueue metadata message");
@@ -13203,6 +15394,7 @@ mod tests {
                     inline: true,
                     branch: None,
                     trunk: None,
+                    shared_body: false,
                 }
             );
         }
@@ -0,0 +1,290 @@
+//! Scheduling signals from the Tokio runtime and the blocking pool.
+//!
+//! A slow request can be waiting on disk, or waiting for a worker that some
+//! other task is holding with a long synchronous stretch. The two look the
+//! same from the request's side, so the runtime is sampled for how busy each
+//! worker is and how much work is waiting for one, named tasks time each of
+//! their polls, and blocking work submitted through [`spawn_blocking`] is
+//! counted while it waits for a pool thread and while it runs.
+
+use std::{
+    cell::Cell,
+    future::Future,
+    pin::Pin,
+    sync::atomic::{AtomicU64, AtomicUsize, Ordering},
+    task::{Context, Poll},
+    time::{Duration, Instant},
+};
+
+use prometheus_client::metrics::{counter::Counter, histogram::Histogram};
+use tokio::task::JoinHandle;
+
+use crate::{
+    constants::{RUNTIME_SAMPLED_POLL_EVERY, RUNTIME_SLOW_POLL_THRESHOLD_MS},
+    metrics::Metrics,
+};
+
+static BLOCKING_QUEUED: AtomicUsize = AtomicUsize::new(0);
+static BLOCKING_QUEUED_PEAK: AtomicUsize = AtomicUsize::new(0);
+static BLOCKING_ACTIVE: AtomicUsize = AtomicUsize::new(0);
+/// Milliseconds since the Unix epoch of the last slow-poll warning, so a task
+/// that stalls on every poll logs once a second rather than per poll.
+static LAST_SLOW_POLL_WARNING_MS: AtomicU64 = AtomicU64::new(0);
+
+thread_local! {
+    /// Polls of sampled tasks on this worker, which picks the ones observed.
+    static SAMPLED_POLLS: Cell<u64> = const { Cell::new(0) };
+}
+
+/// The poll-time histogram and slow-poll counter for one task name. Resolve
+/// it once per spawn site (or once per listener for per-connection tasks)
+/// and clone it into each task.
+#[derive(Clone)]
+pub struct TaskPollMetrics {
+    pub task: &'static str,
+    pub poll_duration: Histogram,
+    pub slow_polls: Counter,
+    /// Every poll is observed when 1; see [`TaskPollMetrics::sampled`].
+    pub observe_every: u64,
+}
+
+impl TaskPollMetrics {
+    /// Observes one poll in [`RUNTIME_SAMPLED_POLL_EVERY`] per worker, for
+    /// tasks spawned per connection: every worker polls them, and observing
+    /// each poll would have all of them contend on one histogram.
+    pub fn sampled(mut self) -> Self {
+        self.observe_every = RUNTIME_SAMPLED_POLL_EVERY;
+        self
+    }
+
+    fn observe(&self, elapsed: Duration) {
+        if self.observe_every > 1 {
+            let polls = SAMPLED_POLLS.with(|polls| {
+                polls.set(polls.get().wrapping_add(1));
+                polls.get()
+            });
+            if polls % self.observe_every != 0 {
+                return;
+            }
+        }
+        self.poll_duration.observe(elapsed.as_secs_f64());
+    }
+}
+
+/// Wraps `future` so each of its polls is timed under `polls`.
+pub fn timed<F: Future>(polls: TaskPollMetrics, future: F) -> TimedPolls<F> {
+    TimedPolls {
+        polls,
+        inner: Box::pin(future),
+    }
+}
+
+/// `tokio::spawn` for a task whose polls should be timed under `name`.
+pub fn spawn<F>(metrics: &Metrics, name: &'static str, future: F) -> JoinHandle<F::Output>
+where
+    F: Future + Send + 'static,
+    F::Output: Send + 'static,
+{
+    tokio::spawn(timed(metrics.task_poll_metrics(name), future))
+}
+
+pub struct TimedPolls<F> {
+    polls: TaskPollMetrics,
+    inner: Pin<Box<F>>,
+}
+
+impl<F: Future> Future for TimedPolls<F> {
+    type Output = F::Output;
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let started = Instant::now();
+        let result = self.inner.as_mut().poll(cx);
+        let elapsed = started.elapsed();
+        self.polls.observe(elapsed);
+        if elapsed >= Duration::from_millis(RUNTIME_SLOW_POLL_THRESHOLD_MS) {
+            self.polls.slow_polls.inc();
+            warn_slow_poll(self.polls.task, elapsed);
+        }
+        result
+    }
+}
+
+fn warn_slow_poll(name: &'static str, elapsed: Duration) {
+    let now_ms = std::time::SystemTime::now()
+        .duration_since(std::time::UNIX_EPOCH)
+        .map_or(0, |since| since.as_millis() as u64);
+    let last_ms = LAST_SLOW_POLL_WARNING_MS.load(Ordering::Relaxed);
+    if now_ms.saturating_sub(last_ms) < 1_000
+        || LAST_SLOW_POLL_WARNING_MS
+            .compare_exchange(last_ms, now_ms, Ordering::Relaxed, Ordering::Relaxed)
+            .is_err()
+    {
+        return;
+    }
+    tracing::warn!(
+        task = name,
+        poll_ms = elapsed.as_millis() as u64,
+        "task held a runtime worker past the slow-poll threshold"
+    );
+}
+
+/// `tokio::task::spawn_blocking`, counted as queued until a pool thread picks
+/// it up and as active while it runs. A task cancelled before it starts
+/// leaves the queue when its closure is dropped.
+pub fn spawn_blocking<F, R>(work: F) -> JoinHandle<R>
+where
+    F: FnOnce() -> R + Send + 'static,
+    R: Send + 'static,
+{
+    let queued = BlockingQueued::enter();
+    tokio::task::spawn_blocking(move || {
+        let _active = BlockingActive::enter();
+        drop(queued);
+        work()
+    })
+}
+
+struct BlockingQueued;
+
+impl BlockingQueued {
+    fn enter() -> Self {
+        let depth = BLOCKING_QUEUED.fetch_add(1, Ordering::Relaxed) + 1;
+        BLOCKING_QUEUED_PEAK.fetch_max(depth, Ordering::Relaxed);
+        Self
+    }
+}
+
+impl Drop for BlockingQueued {
+    fn drop(&mut self) {
+        BLOCKING_QUEUED.fetch_sub(1, Ordering::Relaxed);
+    }
+}
+
+struct BlockingActive;
+
+impl BlockingActive {
+    fn enter() -> Self {
+        BLOCKING_ACTIVE.fetch_add(1, Ordering::Relaxed);
+        Self
+    }
+}
+
+impl Drop for BlockingActive {
+    fn drop(&mut self) {
+        BLOCKING_ACTIVE.fetch_sub(1, Ordering::Relaxed);
+    }
+}
+
+/// Blocking-pool occupancy: queued now, the most queued at once since the
+/// last call, and running now. The peak catches bursts a periodic sample of
+/// the current depth would miss.
+pub fn take_blocking_pool_depth() -> (usize, usize, usize) {
+    let queued = BLOCKING_QUEUED.load(Ordering::Relaxed);
+    let peak = BLOCKING_QUEUED_PEAK.swap(queued, Ordering::Relaxed);
+    (
+        queued,
+        peak.max(queued),
+        BLOCKING_ACTIVE.load(Ordering::Relaxed),
+    )
+}
+
+/// Turns the runtime's cumulative per-worker busy time into a busy ratio per
+/// sampling interval.
+pub struct RuntimeSampler {
+    handle: tokio::runtime::Handle,
+    busy: Vec<Duration>,
+    sampled_at: Instant,
+}
+
+impl RuntimeSampler {
+    pub fn new(handle: tokio::runtime::Handle) -> Self {
+        let runtime = handle.metrics();
+        let busy = (0..runtime.num_workers())
+            .map(|worker| runtime.worker_total_busy_duration(worker))
+            .collect();
+        Self {
+            handle,
+            busy,
+            sampled_at: Instant::now(),
+        }
+    }
+
+    pub fn sample(&mut self, metrics: &Metrics) {
+        let runtime = self.handle.metrics();
+        let now = Instant::now();
+        let interval = now.duration_since(self.sampled_at).as_secs_f64();
+        self.sampled_at = now;
+        for (worker, previous) in self.busy.iter_mut().enumerate() {
+            let busy = runtime.worker_total_busy_duration(worker);
+            let ratio = if interval > 0.0 {
+                (busy.saturating_sub(*previous).as_secs_f64() / interval).min(1.0)
+            } else {
+                0.0
+            };
+            *previous = busy;
+            metrics.record_runtime_worker_busy_ratio(worker, ratio);
+        }
+
+        let (queued, queued_peak, active) = take_blocking_pool_depth();
+        metrics.update_runtime_scheduling(
+            runtime.num_workers(),
+            runtime.num_alive_tasks(),
+            runtime.global_queue_depth(),
+            queued,
+            queued_peak,
+            active,
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[tokio::test]
+    async fn blocking_work_is_counted_while_it_runs() {
+        let (release, released) = std::sync::mpsc::channel::<()>();
+        let (started, wait_started) = std::sync::mpsc::channel::<()>();
+        let task = spawn_blocking(move || {
+            started.send(()).expect("signal start");
+            released.recv().expect("wait for release");
+        });
+        wait_started.recv().expect("blocking task started");
+
+        let (_, _, active) = take_blocking_pool_depth();
+        assert!(active >= 1);
+        release.send(()).expect("release");
+        task.await.expect("blocking task");
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 2)]
+    async fn a_stalling_task_is_counted_as_a_slow_poll() {
+        let metrics = Metrics::new("region".into(), "tenant".into());
+        spawn(&metrics, "stall", async {
+            std::thread::sleep(Duration::from_millis(RUNTIME_SLOW_POLL_THRESHOLD_MS + 5));
+        })
+        .await
+        .expect("stalling task");
+
+        let polls = metrics.task_poll_metrics("stall");
+        assert_eq!(polls.slow_polls.get(), 1);
+    }
+
+    #[test]
+    fn sampled_tasks_observe_one_poll_in_the_sampling_interval() {
+        let metrics = Metrics::new("region".into(), "tenant".into());
+        let polls = metrics.task_poll_metrics("connection").sampled();
+        for _ in 0..(3 * RUNTIME_SAMPLED_POLL_EVERY) {
+            polls.observe(Duration::from_micros(10));
+        }
+        let rendered = metrics.render();
+        let count = rendered
+            .lines()
+            .find(|line| {
+                line.starts_with("kura_runtime_task_poll_duration_seconds_count")
+                    && line.contains("task=\"connection\"")
+            })
+            .expect("poll count");
+        assert!(count.ends_with(" 3"), "{count}");
+    }
+}
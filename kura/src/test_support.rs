@@ -1,4 +1,9 @@
-use std::{sync::Arc, time::Duration};
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    cell::Cell,
+    sync::Arc,
+    time::Duration,
+};
 
 use axum::response::Response;
 use http_body_util::BodyExt;
@@ -51,6 +56,11 @@ where
         data_dir: temp_dir.path().join("data"),
         tmp_dir_max_bytes: 8 * 1024 * 1024 * 1024,
         cas_capacity_bytes: None,
+        namespace_shares: Default::default(),
+        admission_read_weight: crate::constants::DEFAULT_ADMISSION_READ_WEIGHT,
+        readahead_budget_bytes: crate::constants::DEFAULT_READAHEAD_BUDGET_BYTES,
+        segment_compression: Default::default(),
+        segment_direct_io: false,
         node_url: "http://127.0.0.1:7443".into(),
         peer_gateway_url: None,
         peers: vec!["http://127.0.0.1:7443".into()],
@@ -59,11 +69,13 @@ where
         peer_tls: None,
         public_tls: None,
         https_port: 0,
+        alt_svc: None,
         accelerated_file_serving: AcceleratedFileServingConfig {
             enabled: true,
             mode: AcceleratedFileServingMode::Splice,
             max_concurrent: 32,
             chunk_bytes: 1024 * 1024,
+            thread_per_core: false,
         },
         action_cache_eviction_cascade_enabled: true,
         file_descriptor_pool_size: 32,
@@ -191,6 +203,7 @@ where
         replication_backoff: tokio::sync::Mutex::new(std::collections::HashMap::new()),
         backfill_bodies_peer_slots: Arc::new(crate::state::BackfillBodiesPeerSlots::default()),
         backfill: crate::backfill::lifecycle::BackfillLifecycle::new(),
+        inflight_uploads: Arc::new(crate::inflight_uploads::InflightUploads::default()),
     });
     state.sync_runtime_metrics().await;
 
@@ -227,3 +240,63 @@ pub(crate) async fn response_text(response: Response) -> String {
         .to_bytes();
     String::from_utf8(bytes.to_vec()).expect("response body should be utf-8")
 }
+
+/// The lib test binary's global allocator: the system allocator, counting
+/// each thread's allocations so a test can pin how much a code path copies.
+pub(crate) struct CountingAllocator;
+
+thread_local! {
+    /// Allocations and bytes allocated on this thread.
+    static ALLOCATED: Cell<(u64, u64)> = const { Cell::new((0, 0)) };
+}
+
+fn count_allocation(bytes: usize) {
+    // `try_with` because the allocator still runs while thread-locals are
+    // torn down.
+    let _ = ALLOCATED.try_with(|allocated| {
+        let (count, total) = allocated.get();
+        allocated.set((count + 1, total + bytes as u64));
+    });
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        count_allocation(layout.size());
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        count_allocation(layout.size());
+        unsafe { System.alloc_zeroed(layout) }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        count_allocation(new_size);
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { System.dealloc(ptr, layout) }
+    }
+}
+
+#[derive(Debug, Clone, Copy)]
+pub(crate) struct Allocations {
+    pub count: u64,
+    pub bytes: u64,
+}
+
+/// Runs `run` and reports what it allocated on this thread. A `realloc`
+/// counts as an allocation of its new size.
+pub(crate) fn allocations_during<T>(run: impl FnOnce() -> T) -> (T, Allocations) {
+    let (count_before, bytes_before) = ALLOCATED.with(Cell::get);
+    let value = run();
+    let (count_after, bytes_after) = ALLOCATED.with(Cell::get);
+    (
+        value,
+        Allocations {
+            count: count_after - count_before,
+            bytes: bytes_after - bytes_before,
+        },
+    )
+}
@@ -1,5 +1,5 @@
 use std::{
-    collections::HashMap,
+    collections::{HashMap, HashSet},
     sync::{Arc, Mutex},
     time::{Duration, SystemTime, UNIX_EPOCH},
 };
@@ -11,11 +11,21 @@ use serde::{Deserialize, Serialize};
 use tokio::time::{MissedTickBehavior, interval, sleep};
 use tracing::warn;
 
-use crate::{config::UsageConfig, metrics::Metrics, state::SharedState};
+use crate::{
+    config::UsageConfig,
+    metrics::Metrics,
+    shards::{CachePadded, shard_count, shard_index},
+    state::SharedState,
+};
 
 const USAGE_PATH: &str = "/_internal/kura/usage";
 const USAGE_CONNECT_TIMEOUT: Duration = Duration::from_secs(1);
 const USAGE_REQUEST_TIMEOUT: Duration = Duration::from_secs(5);
+/// Leading byte of a rollup in the usage outbox's compact encoding. Rows
+/// written as JSON before it existed start with `{` and still decode.
+const ROLLUP_ENCODING_COMPACT_V1: u8 = 1;
+
+type UsageBuckets = HashMap<UsageBucketKey, UsageBucket>;
 
 #[derive(Clone)]
 pub struct Usage {
@@ -27,7 +37,14 @@ struct UsageInner {
     node_id: String,
     region: String,
     metrics: Metrics,
-    buckets: Mutex<HashMap<UsageBucketKey, UsageBucket>>,
+    /// One bucket map per recording shard, so concurrent requests on
+    /// different workers never share a lock. A key hot on several workers has
+    /// a bucket in each; they are summed when the window closes.
+    shards: Box<[CachePadded<Mutex<UsageBuckets>>]>,
+    /// Distinct keys across every shard, held to `max_buckets` however many
+    /// shards a key has a bucket in. Only a key new to a shard consults it,
+    /// so recording into an existing bucket stays shard-local.
+    admitted: Mutex<HashSet<UsageBucketKey>>,
 }
 
 #[derive(Clone, Debug, Deserialize, Serialize, PartialEq, Eq)]
@@ -90,7 +107,10 @@ impl Usage {
                 node_id: usage_node_id(node_url),
                 region: metrics.region().to_owned(),
                 metrics,
-                buckets: Mutex::new(HashMap::new()),
+                shards: (0..shard_count())
+                    .map(|_| CachePadded(Mutex::new(HashMap::new())))
+                    .collect(),
+                admitted: Mutex::new(HashSet::new()),
             }),
         }))
     }
@@ -205,35 +225,63 @@ impl Usage {
             artifact_kind,
         };
 
-        let mut buckets = self.inner.buckets.lock().expect("usage buckets poisoned");
-        if buckets.len() >= self.inner.config.max_buckets && !buckets.contains_key(&key) {
+        let mut buckets = self.shard().lock().expect("usage buckets poisoned");
+        if let Some(bucket) = buckets.get_mut(&key) {
+            bucket.add(bytes, 1);
+            return;
+        }
+        if !self.admit(&key) {
             self.inner
                 .metrics
                 .record_memory_action("usage_bucket_rejected");
             return;
         }
 
-        let bucket = buckets.entry(key).or_default();
-        bucket.bytes = bucket.bytes.saturating_add(bytes);
-        bucket.request_count = bucket.request_count.saturating_add(1);
+        buckets.entry(key).or_default().add(bytes, 1);
+    }
+
+    /// Whether `key` may have a bucket: it already has one on another shard,
+    /// or the node holds fewer than `max_buckets` distinct keys.
+    fn admit(&self, key: &UsageBucketKey) -> bool {
+        let mut admitted = self.inner.admitted.lock().expect("usage keys poisoned");
+        if admitted.contains(key) {
+            return true;
+        }
+        if admitted.len() >= self.inner.config.max_buckets {
+            return false;
+        }
+        admitted.insert(key.clone());
+        true
+    }
+
+    fn shard(&self) -> &Mutex<UsageBuckets> {
+        &self.inner.shards[shard_index(self.inner.shards.len())].0
+    }
+
+    /// Every shard's buckets matching `filter`, summed per key.
+    fn merged_buckets(&self, filter: impl Fn(&UsageBucketKey) -> bool) -> UsageBuckets {
+        let mut merged = UsageBuckets::new();
+        for shard in &self.inner.shards {
+            let buckets = shard.0.lock().expect("usage buckets poisoned");
+            for (key, bucket) in buckets.iter().filter(|(key, _)| filter(key)) {
+                merged
+                    .entry(key.clone())
+                    .or_default()
+                    .add(bucket.bytes, bucket.request_count);
+            }
+        }
+        merged
     }
 
     fn closed_rollups(&self) -> Vec<(UsageBucketKey, UsageRollup)> {
         let now = unix_seconds();
         let current_window = now - (now % self.inner.config.window_secs.max(1));
-        let buckets = self.inner.buckets.lock().expect("usage buckets poisoned");
-        let closed_keys = buckets
-            .keys()
-            .filter(|key| key.window_start_unix_seconds < current_window)
-            .cloned()
-            .collect::<Vec<_>>();
 
-        closed_keys
+        self.merged_buckets(|key| key.window_start_unix_seconds < current_window)
             .into_iter()
-            .filter_map(|key| {
-                buckets
-                    .get(&key)
-                    .map(|bucket| (key.clone(), self.rollup_for_bucket(&key, bucket)))
+            .map(|(key, bucket)| {
+                let rollup = self.rollup_for_bucket(&key, &bucket);
+                (key, rollup)
             })
             .collect()
     }
@@ -270,24 +318,145 @@ impl Usage {
         }
     }
 
+    /// Drops the buckets of closed windows. Nothing records into a closed
+    /// window, so no shard re-creates a key between its removal and its
+    /// admission being released.
     fn remove_buckets(&self, keys: &[UsageBucketKey]) {
-        let mut buckets = self.inner.buckets.lock().expect("usage buckets poisoned");
+        for shard in &self.inner.shards {
+            let mut buckets = shard.0.lock().expect("usage buckets poisoned");
+            for key in keys {
+                buckets.remove(key);
+            }
+        }
+        let mut admitted = self.inner.admitted.lock().expect("usage keys poisoned");
         for key in keys {
-            buckets.remove(key);
+            admitted.remove(key);
         }
     }
 
     #[cfg(test)]
     pub(crate) fn current_rollups_for_tests(&self) -> Vec<UsageRollup> {
-        let buckets = self.inner.buckets.lock().expect("usage buckets poisoned");
-
-        buckets
+        self.merged_buckets(|_| true)
             .iter()
             .map(|(key, bucket)| self.rollup_for_bucket(key, bucket))
             .collect()
     }
 }
 
+impl UsageBucket {
+    fn add(&mut self, bytes: u64, request_count: u64) {
+        self.bytes = self.bytes.saturating_add(bytes);
+        self.request_count = self.request_count.saturating_add(request_count);
+    }
+}
+
+impl UsageRollup {
+    /// The usage outbox row for this rollup. The row key is the event id, so
+    /// it is not repeated in the value, and the counters are varints: a
+    /// rollup takes well under half the bytes its JSON did.
+    pub fn encode(&self) -> Vec<u8> {
+        let mut out = Vec::with_capacity(64);
+        out.push(ROLLUP_ENCODING_COMPACT_V1);
+        for field in [
+            &self.tenant_id,
+            &self.namespace_id,
+            &self.node_id,
+            &self.region,
+            &self.traffic_plane,
+            &self.direction,
+            &self.operation,
+            &self.protocol,
+            &self.artifact_kind,
+        ] {
+            put_varint(&mut out, field.len() as u64);
+            out.extend_from_slice(field.as_bytes());
+        }
+        for value in [
+            self.window_start_unix_seconds,
+            self.window_seconds,
+            self.bytes,
+            self.request_count,
+        ] {
+            put_varint(&mut out, value);
+        }
+        out
+    }
+
+    /// Reads a usage outbox row back, in either encoding.
+    pub fn decode(event_id: &[u8], value: &[u8]) -> Result<Self, String> {
+        match value.first() {
+            Some(&ROLLUP_ENCODING_COMPACT_V1) => {}
+            _ => {
+                return serde_json::from_slice(value)
+                    .map_err(|error| format!("failed to decode usage rollup: {error}"));
+            }
+        }
+        let mut reader = RollupReader { value, position: 1 };
+        Ok(Self {
+            event_id: String::from_utf8(event_id.to_vec())
+                .map_err(|_| "usage rollup key is not UTF-8".to_string())?,
+            tenant_id: reader.string()?,
+            namespace_id: reader.string()?,
+            node_id: reader.string()?,
+            region: reader.string()?,
+            traffic_plane: reader.string()?,
+            direction: reader.string()?,
+            operation: reader.string()?,
+            protocol: reader.string()?,
+            artifact_kind: reader.string()?,
+            window_start_unix_seconds: reader.varint()?,
+            window_seconds: reader.varint()?,
+            bytes: reader.varint()?,
+            request_count: reader.varint()?,
+        })
+    }
+}
+
+fn put_varint(out: &mut Vec<u8>, mut value: u64) {
+    while value >= 0x80 {
+        out.push((value as u8) | 0x80);
+        value >>= 7;
+    }
+    out.push(value as u8);
+}
+
+struct RollupReader<'a> {
+    value: &'a [u8],
+    position: usize,
+}
+
+impl RollupReader<'_> {
+    fn varint(&mut self) -> Result<u64, String> {
+        let mut value = 0_u64;
+        for shift in (0..64).step_by(7) {
+            let byte = *self
+                .value
+                .get(self.position)
+                .ok_or_else(|| "usage rollup is truncated".to_string())?;
+            self.position += 1;
+            value |= u64::from(byte & 0x7f) << shift;
+            if byte & 0x80 == 0 {
+                return Ok(value);
+            }
+        }
+        Err("usage rollup varint is too long".into())
+    }
+
+    fn string(&mut self) -> Result<String, String> {
+        let length = usize::try_from(self.varint()?)
+            .map_err(|_| "usage rollup field is too long".to_string())?;
+        let end = self
+            .position
+            .checked_add(length)
+            .filter(|end| *end <= self.value.len())
+            .ok_or_else(|| "usage rollup is truncated".to_string())?;
+        let field = std::str::from_utf8(&self.value[self.position..end])
+            .map_err(|_| "usage rollup field is not UTF-8".to_string())?;
+        self.position = end;
+        Ok(field.to_owned())
+    }
+}
+
 async fn flush_loop(state: SharedState) {
     let mut ticker = interval(Duration::from_millis(
         state
@@ -524,7 +693,7 @@ mod tests {
         usage.record_public_download("acme", "ios", "xcframework", 250);
         usage.record_public_download("acme", "ios", "xcframework", 50);
 
-        let buckets = usage.inner.buckets.lock().unwrap();
+        let buckets = usage.merged_buckets(|_| true);
         assert_eq!(buckets.len(), 1);
         let bucket = buckets.values().next().unwrap();
         assert_eq!(bucket.bytes, 400);
@@ -539,7 +708,7 @@ mod tests {
         usage.record_public_download("acme", "android", "xcframework", 200);
         usage.record_public_upload("acme", "ios", "xcframework", 300);
 
-        let buckets = usage.inner.buckets.lock().unwrap();
+        let buckets = usage.merged_buckets(|_| true);
         assert_eq!(buckets.len(), 3);
     }
 
@@ -554,7 +723,7 @@ mod tests {
         // Existing keys still accumulate.
         usage.record_public_download("acme", "ios", "xcframework", 9);
 
-        let buckets = usage.inner.buckets.lock().unwrap();
+        let buckets = usage.merged_buckets(|_| true);
         assert_eq!(buckets.len(), 2);
         let key = bucket_key(
             "acme",
@@ -566,6 +735,42 @@ mod tests {
         assert!(!buckets.keys().any(|k| k.tenant_id == "globex"));
     }
 
+    #[test]
+    fn removed_buckets_free_room_under_the_node_wide_cap() {
+        let usage = test_usage(60, 1);
+
+        usage.record_public_download("acme", "ios", "xcframework", 1);
+        usage.record_public_download("globex", "ios", "xcframework", 1);
+        let keys = usage
+            .merged_buckets(|_| true)
+            .into_keys()
+            .collect::<Vec<_>>();
+        assert_eq!(keys.len(), 1);
+
+        usage.remove_buckets(&keys);
+        usage.record_public_download("globex", "ios", "xcframework", 1);
+        let buckets = usage.merged_buckets(|_| true);
+        assert_eq!(buckets.len(), 1);
+        assert!(buckets.keys().all(|key| key.tenant_id == "globex"));
+    }
+
+    #[test]
+    fn a_key_recorded_on_every_shard_counts_once_against_the_cap() {
+        let usage = test_usage(60, 1);
+        let threads = 2 * shard_count();
+        std::thread::scope(|scope| {
+            for _ in 0..threads {
+                scope.spawn(|| usage.record_public_download("acme", "ios", "xcframework", 1));
+            }
+        });
+
+        let buckets = usage.merged_buckets(|_| true);
+        assert_eq!(buckets.len(), 1);
+        let bucket = buckets.values().next().unwrap();
+        assert_eq!(bucket.request_count, threads as u64);
+        assert_eq!(bucket.bytes, threads as u64);
+    }
+
     #[test]
     fn record_uses_saturating_add_on_overflow() {
         let usage = test_usage(60, 100);
@@ -573,7 +778,7 @@ mod tests {
         usage.record_public_download("acme", "ios", "xcframework", u64::MAX - 5);
         usage.record_public_download("acme", "ios", "xcframework", 100);
 
-        let buckets = usage.inner.buckets.lock().unwrap();
+        let buckets = usage.merged_buckets(|_| true);
         let bucket = buckets.values().next().unwrap();
         assert_eq!(bucket.bytes, u64::MAX);
         assert_eq!(bucket.request_count, 2);
@@ -587,7 +792,7 @@ mod tests {
         let past_window = current_window - 60;
 
         {
-            let mut buckets = usage.inner.buckets.lock().unwrap();
+            let mut buckets = usage.shard().lock().unwrap();
             buckets.insert(
                 bucket_key("acme", "ios", past_window),
                 UsageBucket {
@@ -623,7 +828,7 @@ mod tests {
         let key = bucket_key("acme", "ios", past_window);
 
         {
-            let mut buckets = usage.inner.buckets.lock().unwrap();
+            let mut buckets = usage.shard().lock().unwrap();
             buckets.insert(
                 key.clone(),
                 UsageBucket {
@@ -655,7 +860,7 @@ mod tests {
         let globex_key = bucket_key("globex", "ios", past_window);
 
         {
-            let mut buckets = usage.inner.buckets.lock().unwrap();
+            let mut buckets = usage.shard().lock().unwrap();
             buckets.insert(
                 acme_key.clone(),
                 UsageBucket {
@@ -674,8 +879,83 @@ mod tests {
 
         usage.remove_buckets(std::slice::from_ref(&acme_key));
 
-        let buckets = usage.inner.buckets.lock().unwrap();
+        let buckets = usage.merged_buckets(|_| true);
         assert!(!buckets.contains_key(&acme_key));
         assert!(buckets.contains_key(&globex_key));
     }
+
+    #[test]
+    fn closed_rollups_sum_a_key_recorded_on_several_shards() {
+        let usage = test_usage(60, 100);
+        let past_window = (unix_seconds() / 60 - 1) * 60;
+        let key = bucket_key("acme", "ios", past_window);
+
+        for (shard, bytes) in usage.inner.shards.iter().zip([10, 20]) {
+            shard.0.lock().unwrap().insert(
+                key.clone(),
+                UsageBucket {
+                    bytes,
+                    request_count: 1,
+                },
+            );
+        }
+        let recorded_shards = usage.inner.shards.len().min(2) as u64;
+
+        let rollups = usage.closed_rollups();
+        assert_eq!(rollups.len(), 1);
+        assert_eq!(rollups[0].1.request_count, recorded_shards);
+
+        usage.remove_buckets(std::slice::from_ref(&key));
+        assert!(usage.merged_buckets(|_| true).is_empty());
+    }
+
+    #[test]
+    fn records_from_concurrent_threads_all_land_in_the_rollup() {
+        let usage = test_usage(60, 100);
+        let threads = (0..8)
+            .map(|_| {
+                let usage = usage.clone();
+                std::thread::spawn(move || {
+                    for _ in 0..500 {
+                        usage.record_public_download("acme", "ios", "xcframework", 2);
+                    }
+                })
+            })
+            .collect::<Vec<_>>();
+        for thread in threads {
+            thread.join().unwrap();
+        }
+
+        let rollups = usage.current_rollups_for_tests();
+        assert_eq!(rollups.len(), 1);
+        assert_eq!(rollups[0].request_count, 4_000);
+        assert_eq!(rollups[0].bytes, 8_000);
+    }
+
+    #[test]
+    fn rollups_round_trip_through_the_compact_encoding() {
+        let usage = test_usage(60, 100);
+        let key = bucket_key("acme", "ios", 1_700_000_040);
+        let rollup = usage.rollup_for_bucket(
+            &key,
+            &UsageBucket {
+                bytes: u64::MAX,
+                request_count: 300,
+            },
+        );
+
+        let encoded = rollup.encode();
+        let json = serde_json::to_vec(&rollup).unwrap();
+        assert!(encoded.len() * 2 < json.len());
+        assert_eq!(
+            UsageRollup::decode(rollup.event_id.as_bytes(), &encoded).unwrap(),
+            rollup
+        );
+        // Rows written before the compact encoding still read back.
+        assert_eq!(
+            UsageRollup::decode(rollup.event_id.as_bytes(), &json).unwrap(),
+            rollup
+        );
+        assert!(UsageRollup::decode(b"id", &encoded[..encoded.len() - 1]).is_err());
+    }
 }
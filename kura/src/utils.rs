@@ -20,6 +20,7 @@ use crate::{
         FOREGROUND_FILE_CACHE_DROP_INTERVAL_BYTES, FileCachePolicy, ForegroundFileCacheReservation,
         reserve_foreground_staging,
     },
+    inflight_uploads::StagingUpload,
     io::{IoController, TrackedFile},
     memory::MemoryController,
 };
@@ -275,26 +276,25 @@ pub struct RequestBodyStaging<'a> {
     pub io: &'a IoController,
     pub memory: &'a MemoryController,
     pub bandwidth_limiter: Option<&'a BandwidthLimiter>,
+    /// Registration that lets reads of the key follow this upload.
+    pub inflight: Option<&'a StagingUpload>,
 }
 
-pub async fn read_request_to_temp(
-    request: Request,
+/// A staging file created for a request body, with the memory and disk
+/// reservations that cover it.
+struct OpenedTempBody {
+    file: TrackedFile,
+    path: PathBuf,
+    file_cache_policy: FileCachePolicy,
+    cleanup: TempFileCleanup,
+    memory_reservation: ForegroundFileCacheReservation,
+}
+
+async fn open_temp_body(
     directory: &Path,
-    max_bytes: u64,
-    staging: RequestBodyStaging<'_>,
-) -> Result<TempBodyFile, BodyReadError> {
-    let declared_or_max_bytes = match request
-        .headers()
-        .get(axum::http::header::CONTENT_LENGTH)
-        .and_then(|value| value.to_str().ok())
-        .and_then(|value| value.parse::<u64>().ok())
-    {
-        Some(declared_bytes) if declared_bytes > max_bytes => {
-            return Err(BodyReadError::TooLarge);
-        }
-        Some(declared_bytes) => declared_bytes,
-        None => max_bytes,
-    };
+    declared_or_max_bytes: u64,
+    staging: &RequestBodyStaging<'_>,
+) -> Result<OpenedTempBody, BodyReadError> {
     let memory_reservation = reserve_foreground_staging(staging.memory, declared_or_max_bytes)
         .await
         .map_err(|_| BodyReadError::MemoryPressure)?;
@@ -314,11 +314,48 @@ pub async fn read_request_to_temp(
     }
     let cleanup = TempFileCleanup::new(temp_path.clone(), disk_reservation);
 
-    let mut file = staging
+    let file = staging
         .io
         .create_file(&temp_path)
         .await
         .map_err(BodyReadError::Io)?;
+    if let Some(inflight) = staging.inflight {
+        inflight.opened(&temp_path);
+    }
+    Ok(OpenedTempBody {
+        file,
+        path: temp_path,
+        file_cache_policy,
+        cleanup,
+        memory_reservation,
+    })
+}
+
+pub async fn read_request_to_temp(
+    request: Request,
+    directory: &Path,
+    max_bytes: u64,
+    staging: RequestBodyStaging<'_>,
+) -> Result<TempBodyFile, BodyReadError> {
+    let declared_or_max_bytes = match request
+        .headers()
+        .get(axum::http::header::CONTENT_LENGTH)
+        .and_then(|value| value.to_str().ok())
+        .and_then(|value| value.parse::<u64>().ok())
+    {
+        Some(declared_bytes) if declared_bytes > max_bytes => {
+            return Err(BodyReadError::TooLarge);
+        }
+        Some(declared_bytes) => declared_bytes,
+        None => max_bytes,
+    };
+    let OpenedTempBody {
+        mut file,
+        path: temp_path,
+        file_cache_policy,
+        cleanup,
+        memory_reservation,
+    } = open_temp_body(directory, declared_or_max_bytes, &staging).await?;
     let mut stream = request.into_body().into_data_stream();
     let mut size = 0_u64;
     let mut advised_through = 0_u64;
@@ -334,6 +371,7 @@ pub async fn read_request_to_temp(
                 )));
             }
         };
+        let written_before = size;
         size += chunk.len() as u64;
         if size > max_bytes {
             drop(file);
@@ -351,6 +389,11 @@ pub async fn read_request_to_temp(
                 "failed to write temp file: {error}"
             )));
         }
+        // The file writes in the background; once a write is accepted, the
+        // one before it has reached the file.
+        if let Some(inflight) = staging.inflight {
+            inflight.staging(written_before);
+        }
         if file_cache_policy.should_drop(
             staging.memory.should_reclaim_file_cache(),
             staging.memory.transient_reserved_bytes(),
@@ -392,6 +435,267 @@ pub async fn read_request_to_temp(
     })
 }
 
+/// A plaintext HTTP/1 request body the accelerator left on the connection,
+/// to be spliced into a staging file instead of read through Hyper.
+pub struct SplicedRequestBody {
+    stream: Option<tokio::net::TcpStream>,
+    content_length: u64,
+    expect_continue: bool,
+    chunk_bytes: usize,
+    consumed: bool,
+}
+
+impl SplicedRequestBody {
+    pub fn new(
+        stream: tokio::net::TcpStream,
+        content_length: u64,
+        expect_continue: bool,
+        chunk_bytes: usize,
+    ) -> Self {
+        Self {
+            stream: Some(stream),
+            content_length,
+            expect_continue,
+            chunk_bytes: chunk_bytes.max(1),
+            consumed: false,
+        }
+    }
+
+    /// Whether the whole body has been taken off the connection, so the next
+    /// bytes on it are the next request.
+    pub fn consumed(&self) -> bool {
+        self.consumed
+    }
+
+    /// The connection, unless a failed transfer left it unusable.
+    pub fn into_stream(self) -> Option<tokio::net::TcpStream> {
+        self.stream
+    }
+}
+
+/// [`read_request_to_temp`] for a body still on the socket: the bytes move
+/// socket → pipe → staging file with `splice`, so they never enter user
+/// space. Runs the transfer on the blocking pool with the socket in blocking
+/// mode, like the accelerator's downloads. A body left unread (too large, no
+/// admission) stays on the connection, which the caller must then close.
+pub async fn splice_request_to_temp(
+    body: &mut SplicedRequestBody,
+    directory: &Path,
+    max_bytes: u64,
+    staging: RequestBodyStaging<'_>,
+) -> Result<TempBodyFile, BodyReadError> {
+    if body.content_length > max_bytes {
+        return Err(BodyReadError::TooLarge);
+    }
+    let Some(mut stream) = body.stream.take() else {
+        return Err(BodyReadError::Io(
+            "request connection already closed".into(),
+        ));
+    };
+    let OpenedTempBody {
+        file,
+        path: temp_path,
+        file_cache_policy,
+        cleanup,
+        memory_reservation,
+    } = match open_temp_body(directory, body.content_length, &staging).await {
+        Ok(opened) => opened,
+        Err(error) => {
+            body.stream = Some(stream);
+            return Err(error);
+        }
+    };
+    if body.expect_continue
+        && let Err(error) = stream.write_all(b"HTTP/1.1 100 Continue\r\n\r\n").await
+    {
+        drop(file);
+        staging.io.remove_file_if_exists(&temp_path).await;
+        return Err(BodyReadError::Io(format!(
+            "failed to write 100 Continue: {error}"
+        )));
+    }
+    let file = file.into_persistent().await;
+    let content_length = body.content_length;
+    let chunk_bytes = body.chunk_bytes;
+    let memory = staging.memory.clone();
+    let progress = staging.inflight.map(StagingUpload::progress);
+    let transferred = crate::tasks::spawn_blocking(move || {
+        let mut stream = stream.into_std()?;
+        stream.set_nonblocking(false)?;
+        stream.set_read_timeout(Some(SPLICED_BODY_READ_TIMEOUT))?;
+        let mut advised_through = 0_u64;
+        splice_socket_to_file(
+            &stream,
+            file.as_std(),
+            content_length,
+            chunk_bytes,
+            |size| {
+                // `size` bytes are in the file: the splice out of the pipe is a
+                // write, not a buffer handoff.
+                if let Some(progress) = progress.as_ref() {
+                    progress.staging(size);
+                }
+                if file_cache_policy.should_drop(
+                    memory.should_reclaim_file_cache(),
+                    memory.transient_reserved_bytes(),
+                ) && size.saturating_sub(advised_through)
+                    >= FOREGROUND_FILE_CACHE_DROP_INTERVAL_BYTES
+                {
+                    file.as_std().sync_data()?;
+                    file.drop_cached_pages(advised_through, size - advised_through)?;
+                    advised_through = size;
+                }
+                Ok(())
+            },
+        )?;
+        stream.set_read_timeout(None)?;
+        stream.set_nonblocking(true)?;
+        Ok::<_, std::io::Error>(stream)
+    })
+    .await
+    .map_err(std::io::Error::other)
+    .and_then(|transferred| transferred);
+    match transferred {
+        Ok(stream) => match tokio::net::TcpStream::from_std(stream) {
+            Ok(stream) => {
+                body.stream = Some(stream);
+                body.consumed = true;
+            }
+            Err(error) => {
+                staging.io.remove_file_if_exists(&temp_path).await;
+                return Err(BodyReadError::Io(format!(
+                    "failed to re-register request connection: {error}"
+                )));
+            }
+        },
+        Err(error) => {
+            staging.io.remove_file_if_exists(&temp_path).await;
+            return Err(BodyReadError::Io(format!(
+                "failed to splice request body: {error}"
+            )));
+        }
+    }
+
+    Ok(TempBodyFile {
+        path: temp_path,
+        size: content_length,
+        file_cache_policy,
+        _cleanup: cleanup,
+        _memory_reservation: memory_reservation,
+    })
+}
+
+const SPLICED_BODY_READ_TIMEOUT: Duration = Duration::from_secs(120);
+
+#[cfg(target_os = "linux")]
+fn splice_socket_to_file(
+    socket: &std::net::TcpStream,
+    file: &std::fs::File,
+    length: u64,
+    chunk_bytes: usize,
+    mut on_progress: impl FnMut(u64) -> std::io::Result<()>,
+) -> std::io::Result<()> {
+    use std::os::fd::AsRawFd;
+
+    let in_fd = socket.as_raw_fd();
+    let out_fd = file.as_raw_fd();
+    let mut pipe_fds = [0_i32; 2];
+    if unsafe { libc::pipe2(pipe_fds.as_mut_ptr(), libc::O_CLOEXEC) } != 0 {
+        return Err(std::io::Error::last_os_error());
+    }
+    // A pipe holds 64 KiB by default; a chunk-sized one halves the syscalls
+    // per chunk. Best effort: the loop works with whatever size it gets.
+    unsafe {
+        libc::fcntl(
+            pipe_fds[1],
+            libc::F_SETPIPE_SZ,
+            chunk_bytes.min(libc::c_int::MAX as usize) as libc::c_int,
+        );
+    }
+
+    let result = (|| {
+        let mut offset: libc::off_t = 0;
+        while (offset as u64) < length {
+            let remaining = length - offset as u64;
+            let chunk = remaining.min(chunk_bytes as u64) as usize;
+            let spliced_in = unsafe {
+                libc::splice(
+                    in_fd,
+                    std::ptr::null_mut(),
+                    pipe_fds[1],
+                    std::ptr::null_mut(),
+                    chunk,
+                    libc::SPLICE_F_MOVE,
+                )
+            };
+            if spliced_in < 0 {
+                let error = std::io::Error::last_os_error();
+                if error.kind() == std::io::ErrorKind::Interrupted {
+                    continue;
+                }
+                return Err(error);
+            }
+            if spliced_in == 0 {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::UnexpectedEof,
+                    format!("request body ended after {offset} of {length} bytes"),
+                ));
+            }
+
+            let mut pending = spliced_in as usize;
+            while pending > 0 {
+                let spliced_out = unsafe {
+                    libc::splice(
+                        pipe_fds[0],
+                        std::ptr::null_mut(),
+                        out_fd,
+                        &mut offset,
+                        pending,
+                        libc::SPLICE_F_MOVE,
+                    )
+                };
+                if spliced_out < 0 {
+                    let error = std::io::Error::last_os_error();
+                    if error.kind() == std::io::ErrorKind::Interrupted {
+                        continue;
+                    }
+                    return Err(error);
+                }
+                if spliced_out == 0 {
+                    return Err(std::io::Error::new(
+                        std::io::ErrorKind::WriteZero,
+                        "splice to staging file returned 0",
+                    ));
+                }
+                pending -= spliced_out as usize;
+            }
+            on_progress(offset as u64)?;
+        }
+        Ok(())
+    })();
+
+    unsafe {
+        libc::close(pipe_fds[0]);
+        libc::close(pipe_fds[1]);
+    }
+    result
+}
+
+// The accelerator only takes uploads on Linux.
+#[cfg(not(target_os = "linux"))]
+fn splice_socket_to_file(
+    _socket: &std::net::TcpStream,
+    _file: &std::fs::File,
+    _length: u64,
+    _chunk_bytes: usize,
+    _on_progress: impl FnMut(u64) -> std::io::Result<()>,
+) -> std::io::Result<()> {
+    Err(std::io::Error::new(
+        std::io::ErrorKind::Unsupported,
+        "spliced uploads are only supported on Linux",
+    ))
+}
+
 pub(crate) async fn drop_staging_cache_range(
     file: TrackedFile,
     path: &Path,
@@ -515,6 +819,40 @@ pub fn action_cache_blob_ref_prefix(blob_artifact_id: &str) -> String {
     format!("{ACTION_CACHE_BLOB_REF_PREFIX}{blob_artifact_id}\0")
 }
 
+/// Key prefixes of the content index, in the `key_value` column family for the
+/// same rollback-safety reason as [`ACTION_CACHE_BLOB_REF_PREFIX`]. A
+/// `content/{hash}/{size}` row holds the segment location of the most recently
+/// stored body of a REAPI CAS blob; a `content_seg/{segment}\0{hash}/{size}`
+/// row mirrors it per segment so eviction can drop every row pointing into the
+/// segment it removes, the way `segment_artifacts` drops the manifests.
+const CONTENT_INDEX_PREFIX: &str = "content/";
+const CONTENT_SEGMENT_INDEX_PREFIX: &str = "content_seg/";
+
+pub fn content_index_key(content_address: &str) -> String {
+    format!("{CONTENT_INDEX_PREFIX}{content_address}")
+}
+
+pub fn content_segment_index_key(segment_id: &str, content_address: &str) -> String {
+    format!("{CONTENT_SEGMENT_INDEX_PREFIX}{segment_id}\0{content_address}")
+}
+
+pub fn content_segment_index_prefix(segment_id: &str) -> String {
+    format!("{CONTENT_SEGMENT_INDEX_PREFIX}{segment_id}\0")
+}
+
+/// The content address (`{hash}/{size}`, hash lowercased) of a REAPI CAS blob
+/// key, with the size it names. Only these keys name their bytes: the CAS
+/// write paths verify the body against the digest, where every other
+/// producer's key is an opaque name.
+pub fn cas_blob_content_address(key: &str) -> Option<(String, u64)> {
+    let (hash, size) = key.strip_prefix("blob/")?.split_once('/')?;
+    if hash.len() != 64 || !hash.bytes().all(|byte| byte.is_ascii_hexdigit()) {
+        return None;
+    }
+    let size = size.parse::<u64>().ok()?;
+    Some((format!("{}/{size}", hash.to_ascii_lowercase()), size))
+}
+
 /// Reserved keyspace for the backfill subsystem, shared with inline-artifact
 /// bytes and `blob_ref/` rows in the `key_value` column family for the same
 /// rollback-safety reason as [`ACTION_CACHE_BLOB_REF_PREFIX`]: a new column
@@ -1026,6 +1364,21 @@ mod tests {
         assert!(upper.as_slice() < BACKFILL_WM_PREFIX.as_bytes());
     }
 
+    #[test]
+    fn only_cas_blob_keys_have_a_content_address() {
+        let hash = "AB".repeat(32);
+        assert_eq!(
+            cas_blob_content_address(&format!("blob/{hash}/10")),
+            Some((format!("{}/10", "ab".repeat(32)), 10))
+        );
+        assert_eq!(
+            cas_blob_content_address(&format!("action_cache/{hash}/10")),
+            None
+        );
+        assert_eq!(cas_blob_content_address("blob/abc/10"), None);
+        assert_eq!(cas_blob_content_address(&format!("blob/{hash}/ten")), None);
+    }
+
     #[test]
     fn segment_artifact_index_keys_include_segment_and_artifact() {
         assert_eq!(
@@ -1061,6 +1414,7 @@ mod tests {
                 io: &io,
                 memory: &memory,
                 bandwidth_limiter: None,
+                inflight: None,
             },
         )
         .await
@@ -1103,6 +1457,7 @@ mod tests {
                 io: &io,
                 memory: &memory,
                 bandwidth_limiter: None,
+                inflight: None,
             },
         )
         .await
@@ -1149,6 +1504,7 @@ mod tests {
                     io: &io,
                     memory: &memory,
                     bandwidth_limiter: None,
+                    inflight: None,
                 },
             ),
         )
@@ -1208,6 +1564,7 @@ mod tests {
                 io: &io,
                 memory: &memory,
                 bandwidth_limiter: None,
+                inflight: None,
             },
         )
         .await
@@ -0,0 +1,243 @@
+//! Warm restart: the caches a node built up survive a rolling restart.
+//!
+//! A restarted node comes back with empty manifest and existence caches and a
+//! page cache that no longer holds its hot segments, so the first minutes of
+//! traffic all go to RocksDB and the disk at once. When a node starts
+//! draining it therefore writes a hot set next to its data: the most recently
+//! used artifact ids from the manifest cache, with the segment and offset
+//! each sat at. The next process reads (and removes) the file before it marks
+//! itself serving, looks each artifact up through the regular read path so
+//! both caches fill, opens the backing files into the handle cache and asks
+//! the kernel to read their ranges ahead (`POSIX_FADV_WILLNEED`).
+//!
+//! `/ready` stays false while this runs, bounded by a time budget and a
+//! readahead byte budget, hottest entries first. The file is only a hint:
+//! ranges come from the current manifests, so an artifact that moved or went
+//! away since the drain is skipped or warmed at its new location, and a
+//! missing, stale or unreadable file just means a cold start.
+
+use std::{
+    fmt::Write as _,
+    path::{Path, PathBuf},
+    time::{Duration, Instant},
+};
+
+use tracing::{info, warn};
+
+use crate::{
+    constants::{
+        WARM_RESTART_HOT_SET_MAX_AGE_MS, WARM_RESTART_HOT_SET_MAX_ENTRIES,
+        WARM_RESTART_READAHEAD_BUDGET_BYTES, WARM_RESTART_TIME_BUDGET_MS,
+    },
+    state::SharedState,
+    store::HotArtifactWarmth,
+    tasks,
+    utils::now_ms,
+};
+
+const HOT_SET_FILE: &str = ".kura.hot_set";
+const HOT_SET_HEADER: &str = "kura-hot-set 1";
+
+#[derive(Clone, Debug, PartialEq, Eq)]
+struct HotSetEntry {
+    artifact_id: String,
+    segment: Option<(String, u64)>,
+}
+
+fn hot_set_path(data_dir: &Path) -> PathBuf {
+    data_dir.join(HOT_SET_FILE)
+}
+
+/// One header line (`kura-hot-set 1 <written_at_ms>`), then one tab-separated
+/// `artifact_id segment_id offset` line per entry, `-` for artifacts that are
+/// not in a segment.
+fn encode_hot_set(entries: &[HotSetEntry], written_at_ms: u64) -> String {
+    let mut encoded = format!("{HOT_SET_HEADER} {written_at_ms}\n");
+    for entry in entries {
+        match &entry.segment {
+            Some((segment_id, offset)) => {
+                let _ = writeln!(encoded, "{}\t{segment_id}\t{offset}", entry.artifact_id);
+            }
+            None => {
+                let _ = writeln!(encoded, "{}\t-\t0", entry.artifact_id);
+            }
+        }
+    }
+    encoded
+}
+
+fn decode_hot_set(contents: &str, now_ms: u64) -> Result<Vec<HotSetEntry>, String> {
+    let mut lines = contents.lines();
+    let written_at_ms = lines
+        .next()
+        .and_then(|header| header.strip_prefix(HOT_SET_HEADER))
+        .and_then(|written_at| written_at.trim().parse::<u64>().ok())
+        .ok_or_else(|| "unrecognized hot set header".to_string())?;
+    if now_ms.saturating_sub(written_at_ms) > WARM_RESTART_HOT_SET_MAX_AGE_MS {
+        return Err(format!(
+            "hot set is {}s old",
+            now_ms.saturating_sub(written_at_ms) / 1_000
+        ));
+    }
+    lines
+        .take(WARM_RESTART_HOT_SET_MAX_ENTRIES)
+        .map(|line| {
+            let mut fields = line.split('\t');
+            let (Some(artifact_id), Some(segment_id), Some(offset), None) =
+                (fields.next(), fields.next(), fields.next(), fields.next())
+            else {
+                return Err(format!("malformed hot set line: {line:?}"));
+            };
+            let offset = offset
+                .parse::<u64>()
+                .map_err(|error| format!("malformed hot set offset: {error}"))?;
+            Ok(HotSetEntry {
+                artifact_id: artifact_id.to_owned(),
+                segment: (segment_id != "-").then(|| (segment_id.to_owned(), offset)),
+            })
+        })
+        .collect()
+}
+
+/// Writes the hot set for the next process. Called once, when draining
+/// starts; failures are logged and leave the successor to start cold.
+pub async fn persist_hot_set(state: &SharedState) {
+    let write_state = state.clone();
+    let written = tasks::spawn_blocking(move || {
+        let entries = write_state
+            .store
+            .hot_manifests(WARM_RESTART_HOT_SET_MAX_ENTRIES)
+            .into_iter()
+            .filter(|manifest| !manifest.artifact_id.contains(['\t', '\n']))
+            .map(|manifest| HotSetEntry {
+                segment: manifest.segment_id.zip(manifest.segment_offset),
+                artifact_id: manifest.artifact_id,
+            })
+            .collect::<Vec<_>>();
+        let path = hot_set_path(&write_state.config.data_dir);
+        let tmp_path = path.with_extension("tmp");
+        std::fs::write(&tmp_path, encode_hot_set(&entries, now_ms()))
+            .and_then(|()| std::fs::rename(&tmp_path, &path))
+            .map(|()| entries.len())
+            .map_err(|error| format!("failed to write {}: {error}", path.display()))
+    })
+    .await
+    .map_err(|error| format!("hot set task failed: {error}"))
+    .and_then(|written| written);
+    match written {
+        Ok(entries) => {
+            state.metrics.set_warm_restart_hot_set_written(entries);
+            info!(entries, "wrote hot set for warm restart");
+        }
+        Err(error) => warn!("{error}"),
+    }
+}
+
+/// Re-warms the caches from the previous process's hot set, if it left one.
+/// Runs with serving held back; the caller clears the warming gate once this
+/// returns.
+pub async fn warm_from_hot_set(state: &SharedState) {
+    let path = hot_set_path(&state.config.data_dir);
+    let read = tasks::spawn_blocking(move || {
+        let contents = match std::fs::read_to_string(&path) {
+            Ok(contents) => contents,
+            Err(error) if error.kind() == std::io::ErrorKind::NotFound => return Ok(None),
+            Err(error) => return Err(format!("failed to read {}: {error}", path.display())),
+        };
+        // One use only: a crash mid-warm must not replay it on the next boot.
+        let _ = std::fs::remove_file(&path);
+        decode_hot_set(&contents, now_ms()).map(Some)
+    })
+    .await
+    .map_err(|error| format!("hot set task failed: {error}"))
+    .and_then(|read| read);
+    let entries = match read {
+        Ok(Some(entries)) => entries,
+        Ok(None) => return,
+        Err(error) => {
+            warn!("skipping warm restart: {error}");
+            return;
+        }
+    };
+
+    let started = Instant::now();
+    let deadline = started + Duration::from_millis(WARM_RESTART_TIME_BUDGET_MS);
+    let mut readahead_budget = WARM_RESTART_READAHEAD_BUDGET_BYTES;
+    let mut warmed = 0_usize;
+    for entry in &entries {
+        if Instant::now() >= deadline || state.runtime.is_draining() {
+            break;
+        }
+        // Readahead fills the page cache the memory controller is trying to
+        // shrink; under pressure the caches still warm, the disk does not.
+        let budget = if state.memory.allow_background_admission() {
+            readahead_budget
+        } else {
+            0
+        };
+        let recorded = entry
+            .segment
+            .as_ref()
+            .map(|(segment_id, offset)| (segment_id.as_str(), *offset));
+        let (result, bytes) = match state
+            .store
+            .warm_hot_artifact(&entry.artifact_id, recorded, budget)
+            .await
+        {
+            Ok(HotArtifactWarmth::Missing) => ("missing", 0),
+            Ok(HotArtifactWarmth::Cached { moved: true }) => ("moved", 0),
+            Ok(HotArtifactWarmth::Cached { moved: false }) => ("cached", 0),
+            Ok(HotArtifactWarmth::ReadAhead { moved, bytes }) => {
+                (if moved { "moved" } else { "read_ahead" }, bytes)
+            }
+            Err(error) => {
+                warn!(artifact_id = %entry.artifact_id, "failed to warm hot artifact: {error}");
+                ("error", 0)
+            }
+        };
+        readahead_budget = readahead_budget.saturating_sub(bytes);
+        state.metrics.record_warm_restart_entry(result, bytes);
+        warmed += 1;
+    }
+    info!(
+        warmed,
+        skipped = entries.len() - warmed,
+        readahead_bytes = WARM_RESTART_READAHEAD_BUDGET_BYTES - readahead_budget,
+        elapsed_ms = started.elapsed().as_millis() as u64,
+        "warmed caches from previous hot set"
+    );
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn entry(artifact_id: &str, segment: Option<(&str, u64)>) -> HotSetEntry {
+        HotSetEntry {
+            artifact_id: artifact_id.to_owned(),
+            segment: segment.map(|(segment_id, offset)| (segment_id.to_owned(), offset)),
+        }
+    }
+
+    #[test]
+    fn hot_set_round_trips_in_order() {
+        let entries = vec![
+            entry("hot", Some(("segment-1", 4096))),
+            entry("inline", None),
+            entry("cold", Some(("segment-0", 0))),
+        ];
+
+        let decoded = decode_hot_set(&encode_hot_set(&entries, 1_000), 2_000);
+
+        assert_eq!(decoded, Ok(entries));
+    }
+
+    #[test]
+    fn stale_or_foreign_hot_sets_are_rejected() {
+        let encoded = encode_hot_set(&[entry("a", None)], 1_000);
+
+        assert!(decode_hot_set(&encoded, 1_000 + WARM_RESTART_HOT_SET_MAX_AGE_MS + 1).is_err());
+        assert!(decode_hot_set("kura-hot-set 2 1000\na\t-\t0\n", 1_000).is_err());
+        assert!(decode_hot_set("kura-hot-set 1 1000\na\t-\n", 1_000).is_err());
+    }
+}